@@ -0,0 +1,393 @@
+//*****************************************************************************
+//
+// encoders.c - Rotary encoder to MIDI controller driver.
+//
+// Created on: Oct 18, 2026
+//
+// MODS:
+//
+//*****************************************************************************
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "inc/hw_gpio.h"
+#include "inc/hw_memmap.h"
+#include "inc/hw_types.h"
+#include "driverlib/gpio.h"
+#include "driverlib/pin_map.h"
+#include "driverlib/qei.h"
+#include "driverlib/rom.h"
+#include "driverlib/rom_map.h"
+#include "driverlib/sysctl.h"
+#include "drivers/encoders.h"
+
+#include "midi.h"
+#include "usb_midi.h"
+#include "usbmidi_types.h"
+#include "usbmidi.h"
+#include "usbmidi_timestamp.h"
+
+//*****************************************************************************
+//
+//! \addtogroup encoders_api
+//! @{
+//
+//*****************************************************************************
+
+//*****************************************************************************
+//
+// NRPN value change per detent before acceleration: 1024 clicks end to end.
+//
+//*****************************************************************************
+#define ENCODERS_NRPN_STEP      16
+#define ENCODERS_NRPN_MAX       0x3FFF
+
+//*****************************************************************************
+//
+// Acceleration. An update's detents are multiplied by the factor for the
+// speed they were turned at, in detents per second.
+//
+//*****************************************************************************
+static const struct
+{
+    uint32_t ui32Rate;
+    int32_t i32Factor;
+}
+g_psAccel[] =
+{
+    { 100, 8 },
+    {  50, 4 },
+    {  20, 2 },
+    {   0, 1 }
+};
+
+//*****************************************************************************
+//
+// Quadrature decoding for the GPIO encoders: the step for each transition
+// from the previous phase state (high two bits) to the current one.
+//
+//*****************************************************************************
+static const int8_t g_pi8QuadTable[16] =
+{
+     0, +1, -1,  0,
+    -1,  0,  0, +1,
+    +1,  0,  0, -1,
+     0, -1, +1,  0
+};
+
+//*****************************************************************************
+//
+// The state of one encoder.
+//
+//*****************************************************************************
+typedef struct
+{
+    tEncoderConfig sConfig;
+    uint32_t ui32LastPos;       // position at the last EncodersTask()
+    int32_t i32Counts;          // counts short of a whole detent
+    int32_t i32Detents;         // detents not sent yet
+    uint32_t ui32LastSend;      // timestamp of the last update sent
+    uint16_t ui16Value;         // NRPN mode: current value
+} tEncoder;
+
+static tEncoder g_psEncoders[ENCODERS_NUM];
+
+//*****************************************************************************
+//
+// GPIO encoder positions. Only EncodersGpioPoll() writes these, so the main
+// loop can read them without locking, like a QEI position register.
+//
+//*****************************************************************************
+static volatile uint32_t g_pui32GpioPos[ENCODERS_NUM_GPIO];
+static uint8_t g_pui8GpioPhase[ENCODERS_NUM_GPIO];
+
+static const uint32_t g_pui32QEIBase[ENCODERS_NUM_QEI] =
+{
+    QEI0_BASE, QEI1_BASE
+};
+
+static uint32_t g_ui32CyclesPerMs;
+
+static const tEncoderConfig g_psDefaultConfig[ENCODERS_NUM] =
+{
+    { eEncoderRelativeTwos,   0, 0, 16 },
+    { eEncoderRelativeTwos,   0, 0, 17 },
+    { eEncoderRelativeOffset, 0, 0, 18 },
+    { eEncoderNRPN,           0, 0, 0x0101 }
+};
+
+//*****************************************************************************
+//
+// Write one Control Change.
+//
+//*****************************************************************************
+static void
+EncodersCC(const tEncoderConfig *psConfig, uint8_t ui8Number, uint8_t ui8Value)
+{
+    USBMIDI_Message_t sMsg;
+
+    sMsg.header = USB_MIDI_HEADER(psConfig->ui8Cable, USB_MIDI_CIN_CTRLCHANGE);
+    sMsg.byte1 = MIDI_MSG_CTRLCHANGE | psConfig->ui8Channel;
+    sMsg.byte2 = ui8Number;
+    sMsg.byte3 = ui8Value;
+    USBMIDI_InEpMsgWrite(&sMsg);
+}
+
+//*****************************************************************************
+//
+// Send an update for an encoder that moved by i32Steps (accelerated).
+//
+//*****************************************************************************
+static void
+EncodersSend(tEncoder *psEnc, int32_t i32Steps)
+{
+    const tEncoderConfig *psConfig = &psEnc->sConfig;
+    int32_t i32Value;
+
+    switch(psConfig->eMode)
+    {
+        case eEncoderRelativeTwos:
+        case eEncoderRelativeOffset:
+        {
+            if(i32Steps > 63)
+            {
+                i32Steps = 63;
+            }
+            else if(i32Steps < -63)
+            {
+                i32Steps = -63;
+            }
+
+            if(psConfig->eMode == eEncoderRelativeTwos)
+            {
+                i32Value = i32Steps & 0x7F;
+            }
+            else
+            {
+                i32Value = 64 + i32Steps;
+            }
+            EncodersCC(psConfig, (uint8_t)psConfig->ui16Number,
+                       (uint8_t)i32Value);
+            break;
+        }
+
+        case eEncoderNRPN:
+        {
+            i32Value = (int32_t)psEnc->ui16Value +
+                       (i32Steps * ENCODERS_NRPN_STEP);
+            if(i32Value < 0)
+            {
+                i32Value = 0;
+            }
+            else if(i32Value > ENCODERS_NRPN_MAX)
+            {
+                i32Value = ENCODERS_NRPN_MAX;
+            }
+            if(i32Value == psEnc->ui16Value)
+            {
+                break;
+            }
+            psEnc->ui16Value = (uint16_t)i32Value;
+
+            //
+            // The stack's encoder for the cable keeps the selected parameter
+            // per channel, so CC 99/98 only go out when it changes.
+            //
+            USBMIDI_ParamWrite(psConfig->ui8Cable, USBMIDI_PARAM_NRPN,
+                               psConfig->ui8Channel, psConfig->ui16Number,
+                               psEnc->ui16Value);
+            break;
+        }
+    }
+}
+
+//*****************************************************************************
+//
+//! Decodes the GPIO encoders.
+//!
+//! This must be called at a fixed rate fast enough to see every phase
+//! change; the input scan timer calls it on every tick.
+//!
+//! \return None.
+//
+//*****************************************************************************
+void
+EncodersGpioPoll(void)
+{
+    uint32_t ui32Pins;
+    uint32_t ui32Idx;
+    uint8_t ui8Phase;
+
+    ui32Pins = MAP_GPIOPinRead(ENCODERS_GPIO_BASE, ENCODERS_GPIO_PINS) >>
+               ENCODERS_GPIO_SHIFT;
+
+    for(ui32Idx = 0; ui32Idx < ENCODERS_NUM_GPIO; ui32Idx++)
+    {
+        ui8Phase = (ui32Pins >> (ui32Idx * 2)) & 0x03;
+        g_pui32GpioPos[ui32Idx] +=
+            g_pi8QuadTable[(g_pui8GpioPhase[ui32Idx] << 2) | ui8Phase];
+        g_pui8GpioPhase[ui32Idx] = ui8Phase;
+    }
+}
+
+//*****************************************************************************
+//
+//! Reads the encoders and sends controller updates.
+//!
+//! Call from the main loop, as often as possible. Each encoder's movement is
+//! collected until its rate limit allows an update, then scaled by the speed
+//! it was turned at and sent in the encoder's output mode.
+//!
+//! \return None.
+//
+//*****************************************************************************
+void
+EncodersTask(void)
+{
+    tEncoder *psEnc;
+    uint32_t ui32Now;
+    uint32_t ui32Pos;
+    uint32_t ui32Ms;
+    uint32_t ui32Rate;
+    uint32_t ui32Idx;
+    uint32_t ui32Accel;
+    int32_t i32Detents;
+
+    ui32Now = USBMIDI_Timestamp();
+
+    for(ui32Idx = 0; ui32Idx < ENCODERS_NUM; ui32Idx++)
+    {
+        psEnc = &g_psEncoders[ui32Idx];
+
+        if(ui32Idx < ENCODERS_NUM_QEI)
+        {
+            ui32Pos = MAP_QEIPositionGet(g_pui32QEIBase[ui32Idx]);
+        }
+        else
+        {
+            ui32Pos = g_pui32GpioPos[ui32Idx - ENCODERS_NUM_QEI];
+        }
+        psEnc->i32Counts += (int32_t)(ui32Pos - psEnc->ui32LastPos);
+        psEnc->ui32LastPos = ui32Pos;
+
+        i32Detents = psEnc->i32Counts / ENCODERS_COUNTS_PER_DETENT;
+        psEnc->i32Counts -= i32Detents * ENCODERS_COUNTS_PER_DETENT;
+        psEnc->i32Detents += i32Detents;
+
+        if(psEnc->i32Detents == 0)
+        {
+            continue;
+        }
+
+        ui32Ms = (ui32Now - psEnc->ui32LastSend) / g_ui32CyclesPerMs;
+        if(ui32Ms < ENCODERS_MIN_INTERVAL_MS)
+        {
+            continue;
+        }
+
+        //
+        // Speed over the time since the last update. After a pause this is
+        // slow, so the first click of a new turn is never accelerated.
+        //
+        i32Detents = psEnc->i32Detents;
+        ui32Rate = (uint32_t)((i32Detents < 0) ? -i32Detents : i32Detents) *
+                   1000 / ui32Ms;
+        for(ui32Accel = 0; ui32Rate < g_psAccel[ui32Accel].ui32Rate;
+            ui32Accel++)
+        {
+        }
+
+        EncodersSend(psEnc, i32Detents * g_psAccel[ui32Accel].i32Factor);
+        psEnc->i32Detents = 0;
+        psEnc->ui32LastSend = ui32Now;
+    }
+}
+
+//*****************************************************************************
+//
+//! Sets the output of one encoder.
+//!
+//! \param ui32Encoder is the encoder number, 0 to ENCODERS_NUM - 1.
+//! \param psConfig is the new output mode, channel and controller.
+//!
+//! \return None.
+//
+//*****************************************************************************
+void
+EncodersConfigSet(uint32_t ui32Encoder, const tEncoderConfig *psConfig)
+{
+    if(ui32Encoder < ENCODERS_NUM)
+    {
+        g_psEncoders[ui32Encoder].sConfig = *psConfig;
+        g_psEncoders[ui32Encoder].ui16Value = ENCODERS_NRPN_MAX / 2;
+    }
+}
+
+//*****************************************************************************
+//
+//! Initializes the QEI modules and the GPIO encoder pins.
+//!
+//! \return None.
+//
+//*****************************************************************************
+void
+EncodersInit(void)
+{
+    uint32_t ui32Idx;
+
+    MAP_SysCtlPeripheralEnable(SYSCTL_PERIPH_QEI0);
+    MAP_SysCtlPeripheralEnable(SYSCTL_PERIPH_QEI1);
+    MAP_SysCtlPeripheralEnable(SYSCTL_PERIPH_GPIOC);
+    MAP_SysCtlPeripheralEnable(SYSCTL_PERIPH_GPIOD);
+    MAP_SysCtlPeripheralEnable(ENCODERS_GPIO_PERIPH);
+    MAP_SysCtlPeripheralSleepEnable(ENCODERS_GPIO_PERIPH);
+
+    //
+    // PD7 is an NMI pin and has to be unlocked first.
+    //
+    HWREG(GPIO_PORTD_BASE + GPIO_O_LOCK) = GPIO_LOCK_KEY;
+    HWREG(GPIO_PORTD_BASE + GPIO_O_CR) |= GPIO_PIN_7;
+    HWREG(GPIO_PORTD_BASE + GPIO_O_LOCK) = 0;
+
+    MAP_GPIOPinConfigure(GPIO_PD6_PHA0);
+    MAP_GPIOPinConfigure(GPIO_PD7_PHB0);
+    MAP_GPIOPinConfigure(GPIO_PC5_PHA1);
+    MAP_GPIOPinConfigure(GPIO_PC6_PHB1);
+    MAP_GPIOPinTypeQEI(GPIO_PORTD_BASE, GPIO_PIN_6 | GPIO_PIN_7);
+    MAP_GPIOPinTypeQEI(GPIO_PORTC_BASE, GPIO_PIN_5 | GPIO_PIN_6);
+
+    for(ui32Idx = 0; ui32Idx < ENCODERS_NUM_QEI; ui32Idx++)
+    {
+        MAP_QEIConfigure(g_pui32QEIBase[ui32Idx],
+                         (QEI_CONFIG_CAPTURE_A_B | QEI_CONFIG_NO_RESET |
+                          QEI_CONFIG_QUADRATURE | QEI_CONFIG_NO_SWAP),
+                         0xFFFFFFFF);
+        MAP_QEIPositionSet(g_pui32QEIBase[ui32Idx], 0);
+        MAP_QEIEnable(g_pui32QEIBase[ui32Idx]);
+    }
+
+    MAP_GPIODirModeSet(ENCODERS_GPIO_BASE, ENCODERS_GPIO_PINS,
+                       GPIO_DIR_MODE_IN);
+    MAP_GPIOPadConfigSet(ENCODERS_GPIO_BASE, ENCODERS_GPIO_PINS,
+                         GPIO_STRENGTH_2MA, GPIO_PIN_TYPE_STD_WPU);
+    for(ui32Idx = 0; ui32Idx < ENCODERS_NUM_GPIO; ui32Idx++)
+    {
+        g_pui8GpioPhase[ui32Idx] =
+            (MAP_GPIOPinRead(ENCODERS_GPIO_BASE, ENCODERS_GPIO_PINS) >>
+             (ENCODERS_GPIO_SHIFT + (ui32Idx * 2))) & 0x03;
+    }
+
+    g_ui32CyclesPerMs = MAP_SysCtlClockGet() / 1000;
+
+    for(ui32Idx = 0; ui32Idx < ENCODERS_NUM; ui32Idx++)
+    {
+        EncodersConfigSet(ui32Idx, &g_psDefaultConfig[ui32Idx]);
+    }
+}
+
+//*****************************************************************************
+//
+// Close the Doxygen group.
+//! @}
+//
+//*****************************************************************************
@@ -0,0 +1,115 @@
+//*****************************************************************************
+//
+// encoders.h - Prototypes for the rotary encoder to MIDI controller driver.
+//
+// Created on: Oct 18, 2026
+//
+// MODS:
+//
+//*****************************************************************************
+
+#ifndef __ENCODERS_H__
+#define __ENCODERS_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+//*****************************************************************************
+//
+// If building with a C++ compiler, make all of the definitions in this header
+// have a C binding.
+//
+//*****************************************************************************
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+//*****************************************************************************
+//
+// Defines for the hardware resources used by the encoders.
+//
+// Encoders 0 and 1 are counted in hardware by QEI0 (PD6/PD7) and QEI1
+// (PC5/PC6). Encoders 2 and 3 are plain GPIO pairs (PA2/PA3 and PA4/PA5)
+// decoded by EncodersGpioPoll(), which the input scan timer calls on every
+// tick. All of them are counted in 4x mode, so a detented encoder gives
+// ENCODERS_COUNTS_PER_DETENT counts per click.
+//
+//*****************************************************************************
+#define ENCODERS_NUM_QEI        2
+#define ENCODERS_NUM_GPIO       2
+#define ENCODERS_NUM            (ENCODERS_NUM_QEI + ENCODERS_NUM_GPIO)
+
+#define ENCODERS_GPIO_PERIPH    SYSCTL_PERIPH_GPIOA
+#define ENCODERS_GPIO_BASE      GPIO_PORTA_BASE
+#define ENCODERS_GPIO_PINS      (GPIO_PIN_2 | GPIO_PIN_3 | GPIO_PIN_4 |       \
+                                 GPIO_PIN_5)
+#define ENCODERS_GPIO_SHIFT     2       // phase A of encoder 2 is pin 2
+
+#ifndef ENCODERS_COUNTS_PER_DETENT
+#define ENCODERS_COUNTS_PER_DETENT 4
+#endif
+
+//*****************************************************************************
+//
+// Rate limit. An encoder sends at most one update per ENCODERS_MIN_INTERVAL_MS;
+// turns in between are added up and go out with the next update, so a fast
+// spin costs at most this many messages per second per encoder.
+//
+//*****************************************************************************
+#ifndef ENCODERS_MIN_INTERVAL_MS
+#define ENCODERS_MIN_INTERVAL_MS 10
+#endif
+
+//*****************************************************************************
+//
+// Output modes.
+//
+// Relative modes send one Control Change with a signed step (clamped to
+// +/-63). Two's complement sends 1..63 for up and 127..65 for down; binary
+// offset sends 65..127 for up and 63..1 for down.
+//
+// The NRPN mode keeps a 14-bit value on the device and sends it as an NRPN
+// through USBMIDI_ParamWrite(): parameter number (CC 99/98) and data entry
+// (CC 6/38). The stack remembers the selected parameter per cable and channel,
+// so the parameter number is only sent again when it changes there, and an
+// unchanged data MSB is left out. The cable must be below
+// USBMIDI_PARAM_NUM_CABLES.
+//
+//*****************************************************************************
+typedef enum
+{
+    eEncoderRelativeTwos,
+    eEncoderRelativeOffset,
+    eEncoderNRPN
+} tEncoderMode;
+
+typedef struct
+{
+    tEncoderMode eMode;
+    uint8_t ui8Cable;
+    uint8_t ui8Channel;
+    uint16_t ui16Number;        // controller number, or NRPN parameter number
+} tEncoderConfig;
+
+//*****************************************************************************
+//
+// Functions exported from encoders.c
+//
+//*****************************************************************************
+extern void EncodersInit(void);
+extern void EncodersConfigSet(uint32_t ui32Encoder,
+                              const tEncoderConfig *psConfig);
+extern void EncodersGpioPoll(void);
+extern void EncodersTask(void);
+
+//*****************************************************************************
+//
+// Mark the end of the C bindings section for C++ compilers.
+//
+//*****************************************************************************
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __ENCODERS_H__
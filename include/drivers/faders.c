@@ -0,0 +1,478 @@
+//*****************************************************************************
+//
+// faders.c - ADC fader and potentiometer driver.
+//
+// Created on: Oct 18, 2026
+//
+// MODS:
+//
+//*****************************************************************************
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "inc/hw_adc.h"
+#include "inc/hw_ints.h"
+#include "inc/hw_memmap.h"
+#include "inc/hw_types.h"
+#include "driverlib/adc.h"
+#include "driverlib/gpio.h"
+#include "driverlib/interrupt.h"
+#include "driverlib/rom.h"
+#include "driverlib/rom_map.h"
+#include "driverlib/sysctl.h"
+#include "driverlib/timer.h"
+#include "driverlib/udma.h"
+#include "drivers/faders.h"
+
+#include "midi.h"
+#include "usb_midi.h"
+#include "usbmidi_types.h"
+#include "usbmidi.h"
+#include "usbmidi_timestamp.h"
+
+//*****************************************************************************
+//
+//! \addtogroup faders_api
+//! @{
+//
+//*****************************************************************************
+
+#define FADERS_MAX              0x3FFF
+#define FADERS_BLOCK_SAMPLES    (FADERS_BLOCK_SCANS * FADERS_NUM)
+
+//*****************************************************************************
+//
+// Right shift that takes the sum of a block of 12-bit samples to 14 bits.
+//
+//*****************************************************************************
+#if FADERS_BLOCK_SCANS == 4
+#define FADERS_BLOCK_SHIFT      0
+#elif FADERS_BLOCK_SCANS == 8
+#define FADERS_BLOCK_SHIFT      1
+#elif FADERS_BLOCK_SCANS == 16
+#define FADERS_BLOCK_SHIFT      2
+#elif FADERS_BLOCK_SCANS == 32
+#define FADERS_BLOCK_SHIFT      3
+#elif FADERS_BLOCK_SCANS == 64
+#define FADERS_BLOCK_SHIFT      4
+#else
+#error "FADERS_BLOCK_SCANS must be a power of two from 4 to 64"
+#endif
+
+//*****************************************************************************
+//
+// The analog inputs, in fader order, and their pins.
+//
+//*****************************************************************************
+static const uint32_t g_pui32Channels[FADERS_NUM] =
+{
+    ADC_CTL_CH7, ADC_CTL_CH6, ADC_CTL_CH5, ADC_CTL_CH4, ADC_CTL_CH8
+};
+
+#define FADERS_PORTD_PINS       (GPIO_PIN_0 | GPIO_PIN_1 | GPIO_PIN_2 |       \
+                                 GPIO_PIN_3)
+#define FADERS_PORTE_PINS       GPIO_PIN_5
+
+//*****************************************************************************
+//
+// The uDMA control table, which the hardware requires to be 1024-byte
+// aligned, and the ping-pong sample buffers. A buffer holds a block of scans,
+// FADERS_NUM samples each.
+//
+//*****************************************************************************
+#pragma DATA_ALIGN(g_pui8DMAControlTable, 1024)
+static uint8_t g_pui8DMAControlTable[1024];
+
+static uint16_t g_pui16Samples[2][FADERS_BLOCK_SAMPLES];
+
+//*****************************************************************************
+//
+// The latest 14-bit value of each fader, written by the ADC interrupt only.
+//
+//*****************************************************************************
+static volatile uint16_t g_pui16Value[FADERS_NUM];
+
+//*****************************************************************************
+//
+// The output side of one fader, owned by FadersTask().
+//
+//*****************************************************************************
+typedef struct
+{
+    tFaderConfig sConfig;
+    uint16_t ui16Anchor;            // input after hysteresis
+    uint16_t ui16Sent;              // last value sent, at output resolution
+    uint32_t ui32LastSend;          // timestamp of the last message
+} tFader;
+
+static tFader g_psFaders[FADERS_NUM];
+static bool g_bPrimed;
+static uint32_t g_ui32CyclesPerMs;
+static tFaderStats g_sStats;
+
+static const tFaderConfig g_psDefaultConfig[FADERS_NUM] =
+{
+    { eFaderCC14, 0, 0, MIDI_CC_MODWHEEL_MSB },
+    { eFaderCC7,  0, 0, MIDI_CC_CHANNELVOLUME_MSB },
+    { eFaderCC7,  0, 0, MIDI_CC_PAN_MSB },
+    { eFaderCC7,  0, 0, MIDI_CC_EXPRESSION_MSB },
+    { eFaderCC7,  0, 0, MIDI_CC_GP1_MSB }
+};
+
+//*****************************************************************************
+//
+// Point one half of the ping-pong transfer at its buffer again.
+//
+//*****************************************************************************
+static void
+FadersDMAArm(uint32_t ui32Select, uint16_t *pui16Buffer)
+{
+    MAP_uDMAChannelTransferSet(UDMA_CHANNEL_ADC0 | ui32Select,
+                               UDMA_MODE_PINGPONG,
+                               (void *)(ADC0_BASE + ADC_O_SSFIFO0),
+                               pui16Buffer, FADERS_BLOCK_SAMPLES);
+}
+
+//*****************************************************************************
+//
+// Reduce a full buffer to one 14-bit value per fader.
+//
+//*****************************************************************************
+static void
+FadersBlock(const uint16_t *pui16Buffer)
+{
+    uint32_t pui32Sum[FADERS_NUM];
+    uint32_t ui32Scan;
+    uint32_t ui32Fader;
+
+    for(ui32Fader = 0; ui32Fader < FADERS_NUM; ui32Fader++)
+    {
+        pui32Sum[ui32Fader] = 0;
+    }
+
+    for(ui32Scan = 0; ui32Scan < FADERS_BLOCK_SCANS; ui32Scan++)
+    {
+        for(ui32Fader = 0; ui32Fader < FADERS_NUM; ui32Fader++)
+        {
+            pui32Sum[ui32Fader] += *pui16Buffer++ & 0x0FFF;
+        }
+    }
+
+    for(ui32Fader = 0; ui32Fader < FADERS_NUM; ui32Fader++)
+    {
+        g_pui16Value[ui32Fader] =
+            (uint16_t)(pui32Sum[ui32Fader] >> FADERS_BLOCK_SHIFT);
+    }
+
+    g_sStats.ui32Blocks++;
+}
+
+//*****************************************************************************
+//
+//! Handles the ADC0 sequence 0 interrupt.
+//!
+//! The interrupt fires when the uDMA has filled one of the sample buffers.
+//! This must be in the vector table for ADC sequence 0.
+//!
+//! \return None.
+//
+//*****************************************************************************
+void
+FadersIntHandler(void)
+{
+    bool bPrimary;
+    bool bAlternate;
+
+    MAP_ADCIntClearEx(ADC0_BASE, ADC_INT_DMA_SS0);
+
+    bPrimary = (MAP_uDMAChannelModeGet(UDMA_CHANNEL_ADC0 | UDMA_PRI_SELECT) ==
+                UDMA_MODE_STOP);
+    bAlternate = (MAP_uDMAChannelModeGet(UDMA_CHANNEL_ADC0 | UDMA_ALT_SELECT) ==
+                  UDMA_MODE_STOP);
+
+    if(bPrimary && bAlternate)
+    {
+        //
+        // The interrupt was held off for a whole block and the transfer has
+        // stopped; both buffers are full, take both and start over.
+        //
+        g_sStats.ui32Overruns++;
+    }
+
+    if(bPrimary)
+    {
+        FadersBlock(g_pui16Samples[0]);
+        FadersDMAArm(UDMA_PRI_SELECT, g_pui16Samples[0]);
+    }
+    if(bAlternate)
+    {
+        FadersBlock(g_pui16Samples[1]);
+        FadersDMAArm(UDMA_ALT_SELECT, g_pui16Samples[1]);
+    }
+    if(bPrimary && bAlternate)
+    {
+        MAP_uDMAChannelEnable(UDMA_CHANNEL_ADC0);
+    }
+}
+
+//*****************************************************************************
+//
+// Write one Control Change.
+//
+//*****************************************************************************
+static void
+FadersCC(const tFaderConfig *psConfig, uint8_t ui8Number, uint8_t ui8Value)
+{
+    USBMIDI_Message_t sMsg;
+
+    sMsg.header = USB_MIDI_HEADER(psConfig->ui8Cable, USB_MIDI_CIN_CTRLCHANGE);
+    sMsg.byte1 = MIDI_MSG_CTRLCHANGE | psConfig->ui8Channel;
+    sMsg.byte2 = ui8Number;
+    sMsg.byte3 = ui8Value;
+    USBMIDI_InEpMsgWrite(&sMsg);
+    g_sStats.ui32Messages++;
+}
+
+//*****************************************************************************
+//
+// Move a fader's anchor toward a new input, keeping it FADERS_HYSTERESIS
+// behind, and return the 14-bit output for it. The anchor can only get to
+// within FADERS_HYSTERESIS of either end, so that range is stretched back to
+// the full 0 to FADERS_MAX.
+//
+//*****************************************************************************
+static uint32_t
+FadersTrack(tFader *psFader, uint32_t ui32Input)
+{
+    uint32_t ui32Anchor;
+    uint32_t ui32Out;
+
+    ui32Anchor = psFader->ui16Anchor;
+    if(ui32Input > ui32Anchor + FADERS_HYSTERESIS)
+    {
+        ui32Anchor = ui32Input - FADERS_HYSTERESIS;
+    }
+    else if(ui32Input + FADERS_HYSTERESIS < ui32Anchor)
+    {
+        ui32Anchor = ui32Input + FADERS_HYSTERESIS;
+    }
+    psFader->ui16Anchor = (uint16_t)ui32Anchor;
+
+    if(ui32Anchor <= FADERS_HYSTERESIS)
+    {
+        return(0);
+    }
+    ui32Out = ((ui32Anchor - FADERS_HYSTERESIS) * FADERS_MAX) /
+              (FADERS_MAX - (2 * FADERS_HYSTERESIS));
+
+    return((ui32Out > FADERS_MAX) ? FADERS_MAX : ui32Out);
+}
+
+//*****************************************************************************
+//
+//! Sends controller messages for the faders that moved.
+//!
+//! Call from the main loop. The faders' current positions are taken as the
+//! starting point when the first samples arrive; nothing is sent for them.
+//!
+//! \return None.
+//
+//*****************************************************************************
+void
+FadersTask(void)
+{
+    tFader *psFader;
+    uint32_t ui32Now;
+    uint32_t ui32Idx;
+    uint32_t ui32Value;
+    uint32_t ui32Out;
+
+    if(g_sStats.ui32Blocks == 0)
+    {
+        return;
+    }
+
+    ui32Now = USBMIDI_Timestamp();
+
+    for(ui32Idx = 0; ui32Idx < FADERS_NUM; ui32Idx++)
+    {
+        psFader = &g_psFaders[ui32Idx];
+
+        if(!g_bPrimed)
+        {
+            psFader->ui16Anchor = g_pui16Value[ui32Idx];
+        }
+        ui32Value = FadersTrack(psFader, g_pui16Value[ui32Idx]);
+        ui32Out = (psFader->sConfig.eMode == eFaderCC14) ? ui32Value :
+                  (ui32Value >> 7);
+
+        if(!g_bPrimed)
+        {
+            psFader->ui16Sent = (uint16_t)ui32Out;
+            psFader->ui32LastSend = ui32Now;
+            continue;
+        }
+
+        if((ui32Out == psFader->ui16Sent) ||
+           (((ui32Now - psFader->ui32LastSend) / g_ui32CyclesPerMs) <
+            FADERS_MIN_INTERVAL_MS))
+        {
+            continue;
+        }
+
+        if(psFader->sConfig.eMode == eFaderCC14)
+        {
+            if((ui32Out >> 7) != (psFader->ui16Sent >> 7))
+            {
+                FadersCC(&psFader->sConfig, psFader->sConfig.ui8Number,
+                         (uint8_t)(ui32Out >> 7));
+            }
+            FadersCC(&psFader->sConfig, psFader->sConfig.ui8Number + 32,
+                     (uint8_t)(ui32Out & 0x7F));
+        }
+        else
+        {
+            FadersCC(&psFader->sConfig, psFader->sConfig.ui8Number,
+                     (uint8_t)ui32Out);
+        }
+
+        psFader->ui16Sent = (uint16_t)ui32Out;
+        psFader->ui32LastSend = ui32Now;
+    }
+
+    g_bPrimed = true;
+}
+
+//*****************************************************************************
+//
+//! Sets the output of one fader.
+//!
+//! \param ui32Fader is the fader number, 0 to FADERS_NUM - 1.
+//! \param psConfig is the new output mode, channel and controller.
+//!
+//! The next message for the fader is sent when it next moves.
+//!
+//! \return None.
+//
+//*****************************************************************************
+void
+FadersConfigSet(uint32_t ui32Fader, const tFaderConfig *psConfig)
+{
+    tFader *psFader;
+
+    if(ui32Fader < FADERS_NUM)
+    {
+        psFader = &g_psFaders[ui32Fader];
+        psFader->sConfig = *psConfig;
+        psFader->ui16Sent = FadersTrack(psFader, psFader->ui16Anchor);
+        if(psConfig->eMode == eFaderCC7)
+        {
+            psFader->ui16Sent >>= 7;
+        }
+    }
+}
+
+//*****************************************************************************
+//
+//! Returns the latest reading of a fader.
+//!
+//! \param ui32Fader is the fader number, 0 to FADERS_NUM - 1.
+//!
+//! \return Returns the 14-bit reading, before hysteresis.
+//
+//*****************************************************************************
+uint32_t
+FadersValueGet(uint32_t ui32Fader)
+{
+    return((ui32Fader < FADERS_NUM) ? g_pui16Value[ui32Fader] : 0);
+}
+
+//*****************************************************************************
+//
+//! Returns the fader statistics.
+//!
+//! \param psStats points to the structure to fill in.
+//!
+//! \return None.
+//
+//*****************************************************************************
+void
+FadersStatsGet(tFaderStats *psStats)
+{
+    *psStats = g_sStats;
+}
+
+//*****************************************************************************
+//
+//! Initializes the ADC, the uDMA and the trigger timer, and starts scanning.
+//!
+//! \return None.
+//
+//*****************************************************************************
+void
+FadersInit(void)
+{
+    uint32_t ui32Idx;
+
+    MAP_SysCtlPeripheralEnable(SYSCTL_PERIPH_ADC0);
+    MAP_SysCtlPeripheralEnable(SYSCTL_PERIPH_UDMA);
+    MAP_SysCtlPeripheralEnable(SYSCTL_PERIPH_GPIOD);
+    MAP_SysCtlPeripheralEnable(SYSCTL_PERIPH_GPIOE);
+    MAP_SysCtlPeripheralEnable(FADERS_TIMER_PERIPH);
+
+    MAP_GPIOPinTypeADC(GPIO_PORTD_BASE, FADERS_PORTD_PINS);
+    MAP_GPIOPinTypeADC(GPIO_PORTE_BASE, FADERS_PORTE_PINS);
+
+    //
+    // One step per fader, each raising a DMA request, triggered by the timer.
+    //
+    MAP_ADCHardwareOversampleConfigure(ADC0_BASE, FADERS_HW_OVERSAMPLE);
+    MAP_ADCSequenceConfigure(ADC0_BASE, 0, ADC_TRIGGER_TIMER, 0);
+    for(ui32Idx = 0; ui32Idx < FADERS_NUM; ui32Idx++)
+    {
+        MAP_ADCSequenceStepConfigure(ADC0_BASE, 0, ui32Idx,
+                                     (g_pui32Channels[ui32Idx] | ADC_CTL_IE |
+                                      ((ui32Idx == FADERS_NUM - 1) ?
+                                       ADC_CTL_END : 0)));
+    }
+
+    MAP_uDMAEnable();
+    MAP_uDMAControlBaseSet(g_pui8DMAControlTable);
+    MAP_uDMAChannelAssign(UDMA_CH14_ADC0_0);
+    MAP_uDMAChannelAttributeDisable(UDMA_CHANNEL_ADC0, UDMA_ATTR_ALL);
+    MAP_uDMAChannelControlSet(UDMA_CHANNEL_ADC0 | UDMA_PRI_SELECT,
+                              (UDMA_SIZE_16 | UDMA_SRC_INC_NONE |
+                               UDMA_DST_INC_16 | UDMA_ARB_1));
+    MAP_uDMAChannelControlSet(UDMA_CHANNEL_ADC0 | UDMA_ALT_SELECT,
+                              (UDMA_SIZE_16 | UDMA_SRC_INC_NONE |
+                               UDMA_DST_INC_16 | UDMA_ARB_1));
+    FadersDMAArm(UDMA_PRI_SELECT, g_pui16Samples[0]);
+    FadersDMAArm(UDMA_ALT_SELECT, g_pui16Samples[1]);
+    MAP_uDMAChannelEnable(UDMA_CHANNEL_ADC0);
+
+    MAP_ADCSequenceDMAEnable(ADC0_BASE, 0);
+    MAP_ADCSequenceEnable(ADC0_BASE, 0);
+    MAP_ADCIntEnableEx(ADC0_BASE, ADC_INT_DMA_SS0);
+    MAP_IntPrioritySet(INT_ADC0SS0, FADERS_INT_PRIORITY);
+    MAP_IntEnable(INT_ADC0SS0);
+
+    g_ui32CyclesPerMs = MAP_SysCtlClockGet() / 1000;
+
+    for(ui32Idx = 0; ui32Idx < FADERS_NUM; ui32Idx++)
+    {
+        g_psFaders[ui32Idx].sConfig = g_psDefaultConfig[ui32Idx];
+    }
+
+    MAP_TimerConfigure(FADERS_TIMER_BASE, TIMER_CFG_PERIODIC);
+    MAP_TimerLoadSet(FADERS_TIMER_BASE, TIMER_A,
+                     (MAP_SysCtlClockGet() / FADERS_RATE_HZ) - 1);
+    MAP_TimerControlTrigger(FADERS_TIMER_BASE, TIMER_A, true);
+    MAP_TimerEnable(FADERS_TIMER_BASE, TIMER_A);
+}
+
+//*****************************************************************************
+//
+// Close the Doxygen group.
+//! @}
+//
+//*****************************************************************************
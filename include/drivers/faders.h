@@ -0,0 +1,148 @@
+//*****************************************************************************
+//
+// faders.h - Prototypes for the ADC fader and potentiometer driver.
+//
+// Created on: Oct 18, 2026
+//
+// MODS:
+//
+//*****************************************************************************
+
+#ifndef __FADERS_H__
+#define __FADERS_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+//*****************************************************************************
+//
+// If building with a C++ compiler, make all of the definitions in this header
+// have a C binding.
+//
+//*****************************************************************************
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+//*****************************************************************************
+//
+// Defines for the hardware resources used by the faders.
+//
+// Timer 1A triggers ADC0 sequencer 0 at FADERS_RATE_HZ. Each trigger converts
+// every fader once, each conversion averaged over FADERS_HW_OVERSAMPLE
+// samples by the ADC itself, and the uDMA moves the results into one of two
+// ping-pong buffers. The ADC interrupt only fires when a buffer of
+// FADERS_BLOCK_SCANS scans is full; it sums the scans per fader into a
+// 14-bit value and re-arms the buffer, so the CPU touches each sample once.
+//
+// The faders are on AIN4-AIN7 (PD3-PD0) and AIN8 (PE5), the analog inputs
+// left free by the key matrix and the encoders. (On the LaunchPad, R9 and
+// R10 also tie PD0/PD1 to PB6/PB7; see keymatrix.h.)
+//
+//*****************************************************************************
+#define FADERS_NUM              5
+
+#define FADERS_TIMER_PERIPH     SYSCTL_PERIPH_TIMER1
+#define FADERS_TIMER_BASE       TIMER1_BASE
+
+#ifndef FADERS_RATE_HZ
+#define FADERS_RATE_HZ          4000
+#endif
+
+//*****************************************************************************
+//
+// The ADC interrupt has a whole block of scans to answer in, so it runs
+// below the USB interrupt's priority.
+//
+//*****************************************************************************
+#ifndef FADERS_INT_PRIORITY
+#define FADERS_INT_PRIORITY     0x60
+#endif
+
+#ifndef FADERS_HW_OVERSAMPLE
+#define FADERS_HW_OVERSAMPLE    16
+#endif
+
+//*****************************************************************************
+//
+// Scans per DMA buffer. Must be a power of two from 4 to 64; the sum of this
+// many 12-bit samples is scaled to 14 bits. 16 scans at 4 kHz is one
+// interrupt every 4 ms.
+//
+//*****************************************************************************
+#ifndef FADERS_BLOCK_SCANS
+#define FADERS_BLOCK_SCANS      16
+#endif
+
+//*****************************************************************************
+//
+// Change detection. A fader's value only moves once the input has moved
+// FADERS_HYSTERESIS (in 14-bit steps) past it, so noise around one reading
+// never toggles the output, and a message is only sent when the value at the
+// output resolution (7 or 14 bits) has actually changed, at most once per
+// FADERS_MIN_INTERVAL_MS per fader.
+//
+//*****************************************************************************
+#ifndef FADERS_HYSTERESIS
+#define FADERS_HYSTERESIS       24
+#endif
+
+#ifndef FADERS_MIN_INTERVAL_MS
+#define FADERS_MIN_INTERVAL_MS  5
+#endif
+
+//*****************************************************************************
+//
+// Output modes. A 14-bit fader sends controller ui8Number (0-31) with the
+// MSB and ui8Number + 32 with the LSB; the MSB is only sent when it changed.
+//
+//*****************************************************************************
+typedef enum
+{
+    eFaderCC7,
+    eFaderCC14
+} tFaderMode;
+
+typedef struct
+{
+    tFaderMode eMode;
+    uint8_t ui8Cable;
+    uint8_t ui8Channel;
+    uint8_t ui8Number;
+} tFaderConfig;
+
+//*****************************************************************************
+//
+// Fader statistics.
+//
+//*****************************************************************************
+typedef struct
+{
+    uint32_t ui32Blocks;            // DMA buffers processed
+    uint32_t ui32Overruns;          // both buffers were full at once
+    uint32_t ui32Messages;          // controller messages sent
+} tFaderStats;
+
+//*****************************************************************************
+//
+// Functions exported from faders.c
+//
+//*****************************************************************************
+extern void FadersInit(void);
+extern void FadersConfigSet(uint32_t ui32Fader, const tFaderConfig *psConfig);
+extern uint32_t FadersValueGet(uint32_t ui32Fader);
+extern void FadersStatsGet(tFaderStats *psStats);
+extern void FadersTask(void);
+extern void FadersIntHandler(void);
+
+//*****************************************************************************
+//
+// Mark the end of the C bindings section for C++ compilers.
+//
+//*****************************************************************************
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __FADERS_H__
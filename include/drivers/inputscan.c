@@ -0,0 +1,241 @@
+//*****************************************************************************
+//
+// inputscan.c - Timer-driven input scan service.
+//
+// Created on: Oct 18, 2026
+//
+// MODS:
+//
+//*****************************************************************************
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "inc/hw_ints.h"
+#include "inc/hw_memmap.h"
+#include "inc/hw_types.h"
+#include "driverlib/interrupt.h"
+#include "driverlib/rom.h"
+#include "driverlib/rom_map.h"
+#include "driverlib/sysctl.h"
+#include "driverlib/timer.h"
+#include "drivers/buttons.h"
+#include "drivers/encoders.h"
+#include "drivers/keymatrix.h"
+#include "drivers/inputscan.h"
+
+#include "usbmidi_timestamp.h"
+
+//*****************************************************************************
+//
+//! \addtogroup inputscan_api
+//! @{
+//
+//*****************************************************************************
+
+#define INPUTSCAN_QUEUE_MASK    (INPUTSCAN_QUEUE_SIZE - 1)
+
+//*****************************************************************************
+//
+// The event queue. Only the timer interrupt writes ui32Head and only the main
+// loop writes ui32Tail, and each index is written after the slot it covers, so
+// neither side needs to mask interrupts. One slot is always left empty to tell
+// full from empty.
+//
+//*****************************************************************************
+static volatile tInputEvent g_psQueue[INPUTSCAN_QUEUE_SIZE];
+static volatile uint32_t g_ui32Head;
+static volatile uint32_t g_ui32Tail;
+
+static uint32_t g_ui32ButtonDivider;
+static uint32_t g_ui32Load;
+static tInputScanStats g_sStats;
+
+//*****************************************************************************
+//
+// Post one event. Called from the timer interrupt only.
+//
+//*****************************************************************************
+static void
+InputScanPost(uint8_t ui8Source, uint8_t ui8Id, bool bPressed,
+              uint8_t ui8Velocity, uint32_t ui32Time)
+{
+    volatile tInputEvent *psEvent;
+    uint32_t ui32Head;
+    uint32_t ui32Waiting;
+
+    ui32Head = g_ui32Head;
+    ui32Waiting = (ui32Head - g_ui32Tail) & INPUTSCAN_QUEUE_MASK;
+    if(ui32Waiting == INPUTSCAN_QUEUE_MASK)
+    {
+        g_sStats.ui32Overflows++;
+        return;
+    }
+
+    psEvent = &g_psQueue[ui32Head];
+    psEvent->ui32Time = ui32Time;
+    psEvent->ui8Source = ui8Source;
+    psEvent->ui8Id = ui8Id;
+    psEvent->ui8Velocity = ui8Velocity;
+    psEvent->bPressed = bPressed;
+    g_ui32Head = (ui32Head + 1) & INPUTSCAN_QUEUE_MASK;
+
+    g_sStats.ui32Events++;
+    if(ui32Waiting + 1 > g_sStats.ui32QueueHighWater)
+    {
+        g_sStats.ui32QueueHighWater = ui32Waiting + 1;
+    }
+}
+
+//*****************************************************************************
+//
+// Key events from KeyMatrixScan(), which runs in the timer interrupt.
+//
+//*****************************************************************************
+static void
+InputScanKeyEvent(uint32_t ui32Key, bool bPressed, uint8_t ui8Velocity,
+                  uint32_t ui32Time)
+{
+    InputScanPost(INPUTSCAN_SOURCE_KEY, (uint8_t)ui32Key, bPressed,
+                  ui8Velocity, ui32Time);
+}
+
+//*****************************************************************************
+//
+//! Handles the scan timer interrupt.
+//!
+//! Runs the key matrix scan and the GPIO encoder decoder on every tick and the pushbutton debouncer on
+//! every INPUTSCAN_BUTTON_DIVIDER-th tick, posting every debounced edge to
+//! the event queue. This must be in the vector table for Timer 0A.
+//!
+//! \return None.
+//
+//*****************************************************************************
+void
+InputScanIntHandler(void)
+{
+    uint32_t ui32Start;
+    uint32_t ui32Elapsed;
+    uint8_t ui8Delta;
+    uint8_t ui8Buttons;
+
+    MAP_TimerIntClear(INPUTSCAN_TIMER_BASE, TIMER_TIMA_TIMEOUT);
+    ui32Start = USBMIDI_Timestamp();
+    g_sStats.ui32Ticks++;
+
+    //
+    // The timer counts down from the load value and reloads at timeout, so
+    // what it has counted since is how late this interrupt is.
+    //
+    ui32Elapsed = g_ui32Load - MAP_TimerValueGet(INPUTSCAN_TIMER_BASE, TIMER_A);
+    if(ui32Elapsed > g_sStats.ui32LatencyMax)
+    {
+        g_sStats.ui32LatencyMax = ui32Elapsed;
+    }
+
+    KeyMatrixScan();
+    EncodersGpioPoll();
+
+    if(++g_ui32ButtonDivider == INPUTSCAN_BUTTON_DIVIDER)
+    {
+        g_ui32ButtonDivider = 0;
+        ui8Buttons = ButtonsPoll(&ui8Delta, 0);
+        if(ui8Delta & LEFT_BUTTON)
+        {
+            InputScanPost(INPUTSCAN_SOURCE_BUTTON, LEFT_BUTTON,
+                          (ui8Buttons & LEFT_BUTTON) != 0, 0, ui32Start);
+        }
+        if(ui8Delta & RIGHT_BUTTON)
+        {
+            InputScanPost(INPUTSCAN_SOURCE_BUTTON, RIGHT_BUTTON,
+                          (ui8Buttons & RIGHT_BUTTON) != 0, 0, ui32Start);
+        }
+    }
+
+    ui32Elapsed = USBMIDI_Timestamp() - ui32Start;
+    if(ui32Elapsed > g_sStats.ui32IsrTimeMax)
+    {
+        g_sStats.ui32IsrTimeMax = ui32Elapsed;
+    }
+}
+
+//*****************************************************************************
+//
+//! Takes the oldest event off the queue.
+//!
+//! \param psEvent points to where the event is copied.
+//!
+//! Call from the main loop only; the queue has a single consumer.
+//!
+//! \return Returns true if an event was returned, false if the queue was
+//! empty.
+//
+//*****************************************************************************
+bool
+InputScanEventGet(tInputEvent *psEvent)
+{
+    uint32_t ui32Tail;
+
+    ui32Tail = g_ui32Tail;
+    if(ui32Tail == g_ui32Head)
+    {
+        return(false);
+    }
+
+    *psEvent = g_psQueue[ui32Tail];
+    g_ui32Tail = (ui32Tail + 1) & INPUTSCAN_QUEUE_MASK;
+
+    return(true);
+}
+
+//*****************************************************************************
+//
+//! Returns the scan service statistics.
+//!
+//! \param psStats points to the structure to fill in.
+//!
+//! \return None.
+//
+//*****************************************************************************
+void
+InputScanStatsGet(tInputScanStats *psStats)
+{
+    *psStats = g_sStats;
+}
+
+//*****************************************************************************
+//
+//! Initializes the key matrix and the pushbuttons and starts the scan timer.
+//!
+//! The timer keeps running in sleep mode, so input is still scanned while
+//! the main loop sleeps through a USB suspend.
+//!
+//! \return None.
+//
+//*****************************************************************************
+void
+InputScanInit(void)
+{
+    ButtonsInit();
+    KeyMatrixInit();
+    KeyMatrixEventHandlerSet(InputScanKeyEvent);
+
+    g_ui32Head = 0;
+    g_ui32Tail = 0;
+
+    MAP_SysCtlPeripheralEnable(INPUTSCAN_TIMER_PERIPH);
+    MAP_SysCtlPeripheralSleepEnable(INPUTSCAN_TIMER_PERIPH);
+    MAP_TimerConfigure(INPUTSCAN_TIMER_BASE, TIMER_CFG_PERIODIC);
+    g_ui32Load = (MAP_SysCtlClockGet() / INPUTSCAN_RATE_HZ) - 1;
+    MAP_TimerLoadSet(INPUTSCAN_TIMER_BASE, TIMER_A, g_ui32Load);
+    MAP_TimerIntEnable(INPUTSCAN_TIMER_BASE, TIMER_TIMA_TIMEOUT);
+    MAP_IntPrioritySet(INPUTSCAN_TIMER_INT, INPUTSCAN_INT_PRIORITY);
+    MAP_IntEnable(INPUTSCAN_TIMER_INT);
+    MAP_TimerEnable(INPUTSCAN_TIMER_BASE, TIMER_A);
+}
+
+//*****************************************************************************
+//
+// Close the Doxygen group.
+//! @}
+//
+//*****************************************************************************
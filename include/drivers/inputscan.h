@@ -0,0 +1,128 @@
+//*****************************************************************************
+//
+// inputscan.h - Prototypes for the timer-driven input scan service.
+//
+// Created on: Oct 18, 2026
+//
+// MODS:
+//
+//*****************************************************************************
+
+#ifndef __INPUTSCAN_H__
+#define __INPUTSCAN_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+//*****************************************************************************
+//
+// If building with a C++ compiler, make all of the definitions in this header
+// have a C binding.
+//
+//*****************************************************************************
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+//*****************************************************************************
+//
+// Defines for the hardware resources used by the scan service.
+//
+// Timer 0A interrupts at INPUTSCAN_RATE_HZ and runs the key matrix scan on
+// every tick and the pushbutton debouncer on every INPUTSCAN_BUTTON_DIVIDER-th
+// tick, so both debouncers see exactly the sample rate they were designed for
+// no matter what the main loop is doing. Debounced edges are posted to a
+// single-producer, single-consumer queue that the main loop drains with
+// InputScanEventGet().
+//
+//*****************************************************************************
+#define INPUTSCAN_TIMER_PERIPH  SYSCTL_PERIPH_TIMER0
+#define INPUTSCAN_TIMER_BASE    TIMER0_BASE
+#define INPUTSCAN_TIMER_INT     INT_TIMER0A
+
+#ifndef INPUTSCAN_RATE_HZ
+#define INPUTSCAN_RATE_HZ       2000
+#endif
+
+//*****************************************************************************
+//
+// The scan interrupt is above the USB interrupt's priority, so key velocity
+// timing does not wait for the USB stack, and it never calls into the stack.
+//
+//*****************************************************************************
+#ifndef INPUTSCAN_INT_PRIORITY
+#define INPUTSCAN_INT_PRIORITY  0x20
+#endif
+
+#ifndef INPUTSCAN_BUTTON_DIVIDER
+#define INPUTSCAN_BUTTON_DIVIDER 20
+#endif
+
+//*****************************************************************************
+//
+// Number of events the queue holds. Must be a power of two.
+//
+//*****************************************************************************
+#ifndef INPUTSCAN_QUEUE_SIZE
+#define INPUTSCAN_QUEUE_SIZE    64
+#endif
+
+//*****************************************************************************
+//
+// Where an event came from.
+//
+//*****************************************************************************
+#define INPUTSCAN_SOURCE_BUTTON 0       // ui8Id is the button's pin mask
+#define INPUTSCAN_SOURCE_KEY    1       // ui8Id is the key number
+
+//*****************************************************************************
+//
+// One debounced edge. ui32Time is the USBMIDI_Timestamp() of the scan that
+// saw it, for latency measurement.
+//
+//*****************************************************************************
+typedef struct
+{
+    uint32_t ui32Time;
+    uint8_t ui8Source;
+    uint8_t ui8Id;
+    uint8_t ui8Velocity;                // keys only
+    bool bPressed;
+} tInputEvent;
+
+//*****************************************************************************
+//
+// Scan service statistics. Times are in CPU cycles.
+//
+//*****************************************************************************
+typedef struct
+{
+    uint32_t ui32Ticks;                 // timer interrupts taken
+    uint32_t ui32IsrTimeMax;            // longest interrupt, scan included
+    uint32_t ui32LatencyMax;            // most cycles from timeout to the handler
+    uint32_t ui32Events;                // events posted
+    uint32_t ui32Overflows;             // events lost to a full queue
+    uint32_t ui32QueueHighWater;        // most events waiting at once
+} tInputScanStats;
+
+//*****************************************************************************
+//
+// Functions exported from inputscan.c
+//
+//*****************************************************************************
+extern void InputScanInit(void);
+extern bool InputScanEventGet(tInputEvent *psEvent);
+extern void InputScanStatsGet(tInputScanStats *psStats);
+extern void InputScanIntHandler(void);
+
+//*****************************************************************************
+//
+// Mark the end of the C bindings section for C++ compilers.
+//
+//*****************************************************************************
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __INPUTSCAN_H__
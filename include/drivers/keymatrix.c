@@ -0,0 +1,418 @@
+//*****************************************************************************
+//
+// keymatrix.c - Velocity-sensing key matrix driver.
+//
+// Created on: Oct 18, 2026
+//
+// MODS:
+//
+//*****************************************************************************
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "inc/hw_gpio.h"
+#include "inc/hw_types.h"
+#include "inc/hw_memmap.h"
+#include "driverlib/gpio.h"
+#include "driverlib/rom.h"
+#include "driverlib/rom_map.h"
+#include "driverlib/sysctl.h"
+#include "drivers/keymatrix.h"
+
+#include "midi.h"
+#include "usb_midi.h"
+#include "usbmidi_types.h"
+#include "usbmidi.h"
+#include "usbmidi_bits.h"
+#include "usbmidi_timestamp.h"
+
+//*****************************************************************************
+//
+//! \addtogroup keymatrix_api
+//! @{
+//
+//*****************************************************************************
+
+//*****************************************************************************
+//
+// Column settle time after selecting a row, in SysCtlDelay() loops (three
+// cycles each): about 1 us at 80 MHz.
+//
+//*****************************************************************************
+#define KEYMATRIX_SETTLE_LOOPS  27
+
+//*****************************************************************************
+//
+// Valid keys in the last word of a bitmap. The unused columns of the last
+// group are masked off.
+//
+//*****************************************************************************
+#if (KEYMATRIX_NUM_KEYS % 32)
+#define KEYMATRIX_LAST_WORD_MASK ((1UL << (KEYMATRIX_NUM_KEYS % 32)) - 1)
+#else
+#define KEYMATRIX_LAST_WORD_MASK 0xFFFFFFFF
+#endif
+
+//*****************************************************************************
+//
+// Debounced state of both contacts of every key, one bit per key, 32 keys per
+// word. A 1 means the contact is closed. Both banks are debounced with the
+// same 2-bit vertical counter as ButtonsPoll(), a word at a time, so a change
+// has to be seen on four scans in a row before it counts.
+//
+//*****************************************************************************
+typedef struct
+{
+    uint32_t pui32State[KEYMATRIX_NUM_WORDS];
+    uint32_t pui32ClockA[KEYMATRIX_NUM_WORDS];
+    uint32_t pui32ClockB[KEYMATRIX_NUM_WORDS];
+} tKeyMatrixBank;
+
+static tKeyMatrixBank g_sFirst;
+static tKeyMatrixBank g_sSecond;
+
+//*****************************************************************************
+//
+// Keys with a Note On sent and no Note Off yet, and the time each key's first
+// contact closed.
+//
+//*****************************************************************************
+static uint32_t g_pui32Sounding[KEYMATRIX_NUM_WORDS];
+static uint32_t g_pui32FirstTime[KEYMATRIX_NUM_WORDS * 32];
+
+static tKeyMatrixEventHandler g_pfnEventHandler;
+static uint32_t g_ui32CyclesPerUs;
+static uint32_t g_ui32LastScan;
+static tKeyMatrixStats g_sStats;
+
+//*****************************************************************************
+//
+// Read the raw state of all rows into two bitmaps, first contacts and second
+// contacts, with a 1 for a closed contact.
+//
+//*****************************************************************************
+static void
+KeyMatrixRead(uint32_t *pui32First, uint32_t *pui32Second)
+{
+    uint32_t ui32Row;
+    uint32_t ui32Cols;
+    uint32_t ui32Group;
+    uint32_t ui32Word;
+
+    for(ui32Word = 0; ui32Word < KEYMATRIX_NUM_WORDS; ui32Word++)
+    {
+        pui32First[ui32Word] = 0;
+        pui32Second[ui32Word] = 0;
+    }
+
+    for(ui32Row = 0; ui32Row < KEYMATRIX_NUM_ROWS; ui32Row++)
+    {
+        MAP_GPIOPinWrite(KEYMATRIX_ROW_BASE, KEYMATRIX_ROW_PINS, ui32Row);
+        MAP_SysCtlDelay(KEYMATRIX_SETTLE_LOOPS);
+        ui32Cols = ~MAP_GPIOPinRead(KEYMATRIX_COL_BASE, KEYMATRIX_COL_PINS) & 0xFF;
+
+        if(ui32Row < KEYMATRIX_NUM_GROUPS)
+        {
+            ui32Group = ui32Row;
+            pui32First[ui32Group / 4] |= ui32Cols << ((ui32Group % 4) * 8);
+        }
+        else
+        {
+            ui32Group = ui32Row - KEYMATRIX_NUM_GROUPS;
+            pui32Second[ui32Group / 4] |= ui32Cols << ((ui32Group % 4) * 8);
+        }
+    }
+
+    pui32First[KEYMATRIX_NUM_WORDS - 1] &= KEYMATRIX_LAST_WORD_MASK;
+    pui32Second[KEYMATRIX_NUM_WORDS - 1] &= KEYMATRIX_LAST_WORD_MASK;
+}
+
+//*****************************************************************************
+//
+// Debounce one bank against a fresh raw read. Returns the keys whose
+// debounced state changed in each word through pui32Changed.
+//
+//*****************************************************************************
+static void
+KeyMatrixDebounce(tKeyMatrixBank *psBank, const uint32_t *pui32Raw,
+                  uint32_t *pui32Changed)
+{
+    uint32_t ui32Word;
+    uint32_t ui32Delta;
+    uint32_t ui32A;
+    uint32_t ui32B;
+
+    for(ui32Word = 0; ui32Word < KEYMATRIX_NUM_WORDS; ui32Word++)
+    {
+        ui32Delta = pui32Raw[ui32Word] ^ psBank->pui32State[ui32Word];
+
+        //
+        // Count by one, and reset the counters of keys that agree with
+        // their debounced state.
+        //
+        ui32A = psBank->pui32ClockA[ui32Word] ^ psBank->pui32ClockB[ui32Word];
+        ui32B = ~psBank->pui32ClockB[ui32Word];
+        ui32A &= ui32Delta;
+        ui32B &= ui32Delta;
+        psBank->pui32ClockA[ui32Word] = ui32A;
+        psBank->pui32ClockB[ui32Word] = ui32B;
+
+        //
+        // Keys whose counter rolled over take the raw state.
+        //
+        ui32Delta &= ~(ui32A | ui32B);
+        psBank->pui32State[ui32Word] ^= ui32Delta;
+        pui32Changed[ui32Word] = ui32Delta;
+    }
+}
+
+//*****************************************************************************
+//
+//! Writes the note message for a key to the USB MIDI IN FIFO.
+//!
+//! \param ui32Key is the key number, 0 for the lowest key.
+//! \param bOn is true for a Note On, false for a Note Off.
+//! \param ui8Velocity is the velocity.
+//!
+//! \return None.
+//
+//*****************************************************************************
+void
+KeyMatrixNoteWrite(uint32_t ui32Key, bool bOn, uint8_t ui8Velocity)
+{
+    USBMIDI_Message_t sMsg;
+
+    sMsg.header = USB_MIDI_HEADER(KEYMATRIX_CABLE,
+                                  (bOn ? USB_MIDI_CIN_NOTEON : USB_MIDI_CIN_NOTEOFF));
+    sMsg.byte1 = (bOn ? MIDI_MSG_NOTEON : MIDI_MSG_NOTEOFF) | KEYMATRIX_CHANNEL;
+    sMsg.byte2 = KEYMATRIX_FIRST_NOTE + ui32Key;
+    sMsg.byte3 = ui8Velocity;
+    USBMIDI_InEpMsgWrite(&sMsg);
+}
+
+//*****************************************************************************
+//
+// Hand a key event to the handler, or write it straight to USB.
+//
+//*****************************************************************************
+static void
+KeyMatrixEvent(uint32_t ui32Key, bool bOn, uint8_t ui8Velocity,
+               uint32_t ui32Time)
+{
+    if(g_pfnEventHandler)
+    {
+        g_pfnEventHandler(ui32Key, bOn, ui8Velocity, ui32Time);
+    }
+    else
+    {
+        KeyMatrixNoteWrite(ui32Key, bOn, ui8Velocity);
+    }
+}
+
+//*****************************************************************************
+//
+// Velocity from the time between the two contacts.
+//
+//*****************************************************************************
+static uint8_t
+KeyMatrixVelocity(uint32_t ui32Cycles)
+{
+    uint32_t ui32Us;
+    uint32_t ui32Velocity;
+
+    ui32Us = ui32Cycles / g_ui32CyclesPerUs;
+    if(ui32Us == 0)
+    {
+        return(127);
+    }
+
+    ui32Velocity = KEYMATRIX_VELOCITY_SCALE / ui32Us;
+    if(ui32Velocity > 127)
+    {
+        ui32Velocity = 127;
+    }
+    else if(ui32Velocity == 0)
+    {
+        ui32Velocity = 1;
+    }
+    return((uint8_t)ui32Velocity);
+}
+
+//*****************************************************************************
+//
+//! Scans the key matrix and sends Note On and Note Off messages.
+//!
+//! This function must be called at a regular rate, fast enough that the time
+//! between the two contacts of a hard key strike spans several scans: 2 kHz
+//! or more. A key sends its Note On when the second contact closes, with a
+//! velocity from the time since the first contact closed, and its Note Off
+//! when the first contact opens again.
+//!
+//! Without an event handler, the messages go straight into the USB MIDI IN
+//! FIFO, and the first event of each scan is timed through to the host with
+//! USBMIDI_LatencyProbe(). With one (see KeyMatrixEventHandlerSet()), each
+//! event is passed to it instead, so the scan can run in an interrupt that
+//! must not touch the USB FIFOs.
+//!
+//! \return None.
+//
+//*****************************************************************************
+void
+KeyMatrixScan(void)
+{
+    uint32_t pui32RawFirst[KEYMATRIX_NUM_WORDS];
+    uint32_t pui32RawSecond[KEYMATRIX_NUM_WORDS];
+    uint32_t pui32ChangedFirst[KEYMATRIX_NUM_WORDS];
+    uint32_t pui32ChangedSecond[KEYMATRIX_NUM_WORDS];
+    uint32_t ui32Now;
+    uint32_t ui32Period;
+    uint32_t ui32Word;
+    uint32_t ui32Bits;
+    uint32_t ui32Bit;
+    uint32_t ui32Key;
+    bool bEvent = false;
+
+    ui32Now = USBMIDI_Timestamp();
+    if(g_sStats.ui32Scans)
+    {
+        ui32Period = ui32Now - g_ui32LastScan;
+        if(ui32Period < g_sStats.ui32PeriodMin)
+        {
+            g_sStats.ui32PeriodMin = ui32Period;
+        }
+        if(ui32Period > g_sStats.ui32PeriodMax)
+        {
+            g_sStats.ui32PeriodMax = ui32Period;
+        }
+    }
+    g_ui32LastScan = ui32Now;
+    g_sStats.ui32Scans++;
+
+    KeyMatrixRead(pui32RawFirst, pui32RawSecond);
+    KeyMatrixDebounce(&g_sFirst, pui32RawFirst, pui32ChangedFirst);
+    KeyMatrixDebounce(&g_sSecond, pui32RawSecond, pui32ChangedSecond);
+
+    for(ui32Word = 0; ui32Word < KEYMATRIX_NUM_WORDS; ui32Word++)
+    {
+        //
+        // First contacts: a close starts the velocity timer, an open ends
+        // a sounding note.
+        //
+        for(ui32Bits = pui32ChangedFirst[ui32Word]; ui32Bits;
+            ui32Bits &= ~ui32Bit)
+        {
+            ui32Bit = ui32Bits & (0 - ui32Bits);
+            ui32Key = (ui32Word * 32) + USBMIDI_BIT_INDEX(ui32Bit);
+
+            if(g_sFirst.pui32State[ui32Word] & ui32Bit)
+            {
+                g_pui32FirstTime[ui32Key] = ui32Now;
+            }
+            else if(g_pui32Sounding[ui32Word] & ui32Bit)
+            {
+                g_pui32Sounding[ui32Word] &= ~ui32Bit;
+                KeyMatrixEvent(ui32Key, false, 0x40, ui32Now);
+                g_sStats.ui32NoteOffs++;
+                bEvent = true;
+            }
+        }
+
+        //
+        // Second contacts: a close sounds the note.
+        //
+        ui32Bits = pui32ChangedSecond[ui32Word] & g_sSecond.pui32State[ui32Word] &
+                   ~g_pui32Sounding[ui32Word];
+        for(; ui32Bits; ui32Bits &= ~ui32Bit)
+        {
+            ui32Bit = ui32Bits & (0 - ui32Bits);
+            ui32Key = (ui32Word * 32) + USBMIDI_BIT_INDEX(ui32Bit);
+
+            g_pui32Sounding[ui32Word] |= ui32Bit;
+            KeyMatrixEvent(ui32Key, true,
+                           KeyMatrixVelocity(ui32Now - g_pui32FirstTime[ui32Key]),
+                           ui32Now);
+            g_sStats.ui32NoteOns++;
+            bEvent = true;
+        }
+    }
+
+    if(bEvent && !g_pfnEventHandler)
+    {
+        USBMIDI_LatencyProbe(ui32Now);
+    }
+
+    ui32Period = USBMIDI_Timestamp() - ui32Now;
+    if(ui32Period > g_sStats.ui32ScanTimeMax)
+    {
+        g_sStats.ui32ScanTimeMax = ui32Period;
+    }
+}
+
+//*****************************************************************************
+//
+//! Sets the function that receives key events.
+//!
+//! \param pfnHandler is called from KeyMatrixScan() for every key event, or
+//! 0 to write the events to USB directly.
+//!
+//! \return None.
+//
+//*****************************************************************************
+void
+KeyMatrixEventHandlerSet(tKeyMatrixEventHandler pfnHandler)
+{
+    g_pfnEventHandler = pfnHandler;
+}
+
+//*****************************************************************************
+//
+//! Returns the scan statistics.
+//!
+//! \param psStats points to the structure to fill in.
+//!
+//! \return None.
+//
+//*****************************************************************************
+void
+KeyMatrixStatsGet(tKeyMatrixStats *psStats)
+{
+    *psStats = g_sStats;
+}
+
+//*****************************************************************************
+//
+//! Initializes the GPIO pins used by the key matrix.
+//!
+//! The row address pins are made outputs and the column pins inputs with
+//! pull-ups. The debounced state starts with every key up.
+//!
+//! \return None.
+//
+//*****************************************************************************
+void
+KeyMatrixInit(void)
+{
+    MAP_SysCtlPeripheralEnable(KEYMATRIX_ROW_PERIPH);
+    MAP_SysCtlPeripheralEnable(KEYMATRIX_COL_PERIPH);
+
+    //
+    // The scan may run from a timer while the CPU sleeps.
+    //
+    MAP_SysCtlPeripheralSleepEnable(KEYMATRIX_ROW_PERIPH);
+    MAP_SysCtlPeripheralSleepEnable(KEYMATRIX_COL_PERIPH);
+
+    MAP_GPIOPinTypeGPIOOutput(KEYMATRIX_ROW_BASE, KEYMATRIX_ROW_PINS);
+    MAP_GPIODirModeSet(KEYMATRIX_COL_BASE, KEYMATRIX_COL_PINS, GPIO_DIR_MODE_IN);
+    MAP_GPIOPadConfigSet(KEYMATRIX_COL_BASE, KEYMATRIX_COL_PINS,
+                         GPIO_STRENGTH_2MA, GPIO_PIN_TYPE_STD_WPU);
+
+    g_ui32CyclesPerUs = MAP_SysCtlClockGet() / 1000000;
+    g_sStats.ui32PeriodMin = 0xFFFFFFFF;
+}
+
+//*****************************************************************************
+//
+// Close the Doxygen group.
+//! @}
+//
+//*****************************************************************************
@@ -0,0 +1,138 @@
+//*****************************************************************************
+//
+// keymatrix.h - Prototypes for the velocity-sensing key matrix driver.
+//
+// Created on: Oct 18, 2026
+//
+// MODS:
+//
+//*****************************************************************************
+
+#ifndef __KEYMATRIX_H__
+#define __KEYMATRIX_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+//*****************************************************************************
+//
+// If building with a C++ compiler, make all of the definitions in this header
+// have a C binding.
+//
+//*****************************************************************************
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+//*****************************************************************************
+//
+// Defines for the hardware resources used by the key matrix.
+//
+// Every key has two contacts. The first closes early in the key travel, the
+// second at the bottom; the time between them gives the velocity. Keys come
+// in groups of eight, and each group has two rows, one per contact:
+//
+//   rows 0 .. G-1      first contacts of groups 0 .. G-1
+//   rows G .. 2G-1     second contacts of groups 0 .. G-1
+//
+// A row is selected by writing its number to five address pins (PE0-PE4)
+// that drive a pair of active-low 4-to-16 decoders, so up to 32 rows (16
+// groups, 128 keys) are possible. The eight columns are read on PB0-PB7 with
+// pull-ups through the usual diodes, so a 0 means the contact is closed.
+// (On the LaunchPad, remove R9 and R10, which tie PB6/PB7 to PD0/PD1.)
+//
+//*****************************************************************************
+#define KEYMATRIX_ROW_PERIPH    SYSCTL_PERIPH_GPIOE
+#define KEYMATRIX_ROW_BASE      GPIO_PORTE_BASE
+#define KEYMATRIX_ROW_PINS      (GPIO_PIN_0 | GPIO_PIN_1 | GPIO_PIN_2 |       \
+                                 GPIO_PIN_3 | GPIO_PIN_4)
+
+#define KEYMATRIX_COL_PERIPH    SYSCTL_PERIPH_GPIOB
+#define KEYMATRIX_COL_BASE      GPIO_PORTB_BASE
+#define KEYMATRIX_COL_PINS      0xFF
+
+//*****************************************************************************
+//
+// Keyboard size and mapping. 61 keys from C2 by default; an 88-key action
+// would use 88 keys from A0 (21).
+//
+//*****************************************************************************
+#ifndef KEYMATRIX_NUM_KEYS
+#define KEYMATRIX_NUM_KEYS      61
+#endif
+
+#ifndef KEYMATRIX_FIRST_NOTE
+#define KEYMATRIX_FIRST_NOTE    36
+#endif
+
+#ifndef KEYMATRIX_CABLE
+#define KEYMATRIX_CABLE         0
+#endif
+
+#ifndef KEYMATRIX_CHANNEL
+#define KEYMATRIX_CHANNEL       0
+#endif
+
+#define KEYMATRIX_NUM_GROUPS    ((KEYMATRIX_NUM_KEYS + 7) / 8)
+#define KEYMATRIX_NUM_ROWS      (KEYMATRIX_NUM_GROUPS * 2)
+#define KEYMATRIX_NUM_WORDS     ((KEYMATRIX_NUM_KEYS + 31) / 32)
+
+//*****************************************************************************
+//
+// Velocity curve. The velocity is KEYMATRIX_VELOCITY_SCALE divided by the
+// contact-to-contact time in microseconds, clamped to 1..127. With the
+// default, 2 ms or faster gives 127 and 64 ms gives 4.
+//
+//*****************************************************************************
+#ifndef KEYMATRIX_VELOCITY_SCALE
+#define KEYMATRIX_VELOCITY_SCALE 254000
+#endif
+
+//*****************************************************************************
+//
+// Scan statistics. Times are in CPU cycles (see usbmidi_timestamp.h).
+// The scan-to-USB latency is recorded by the USB MIDI stack; see
+// USBMIDI_LatencyProbe().
+//
+//*****************************************************************************
+typedef struct
+{
+    uint32_t ui32Scans;             // number of scans
+    uint32_t ui32PeriodMin;         // shortest time between scan starts
+    uint32_t ui32PeriodMax;         // longest time between scan starts
+    uint32_t ui32ScanTimeMax;       // longest scan, including the MIDI writes
+    uint32_t ui32NoteOns;
+    uint32_t ui32NoteOffs;
+} tKeyMatrixStats;
+
+//*****************************************************************************
+//
+// Receives key events when set with KeyMatrixEventHandlerSet(). ui32Time is
+// the USBMIDI_Timestamp() of the scan.
+//
+//*****************************************************************************
+typedef void (*tKeyMatrixEventHandler)(uint32_t ui32Key, bool bPressed,
+                                       uint8_t ui8Velocity, uint32_t ui32Time);
+
+//*****************************************************************************
+//
+// Functions exported from keymatrix.c
+//
+//*****************************************************************************
+extern void KeyMatrixInit(void);
+extern void KeyMatrixScan(void);
+extern void KeyMatrixStatsGet(tKeyMatrixStats *psStats);
+extern void KeyMatrixEventHandlerSet(tKeyMatrixEventHandler pfnHandler);
+extern void KeyMatrixNoteWrite(uint32_t ui32Key, bool bOn, uint8_t ui8Velocity);
+
+//*****************************************************************************
+//
+// Mark the end of the C bindings section for C++ compilers.
+//
+//*****************************************************************************
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __KEYMATRIX_H__
@@ -0,0 +1,495 @@
+//*****************************************************************************
+//
+// midiclock.c - MIDI clock master.
+//
+// Created on: Oct 18, 2026
+//
+// MODS:
+//
+//*****************************************************************************
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "inc/hw_ints.h"
+#include "inc/hw_memmap.h"
+#include "inc/hw_types.h"
+#include "driverlib/interrupt.h"
+#include "driverlib/rom.h"
+#include "driverlib/rom_map.h"
+#include "driverlib/sysctl.h"
+#include "driverlib/timer.h"
+#include "drivers/midiclock.h"
+
+#include "midi.h"
+#include "usb_midi.h"
+#include "usbmidi_types.h"
+#include "usbmidi.h"
+#include "usbmidi_timestamp.h"
+#include "usbmidi_critical.h"
+
+//*****************************************************************************
+//
+//! \addtogroup midiclock_api
+//! @{
+//
+//*****************************************************************************
+
+//*****************************************************************************
+//
+// Tick period. g_ui64PeriodScale divided by a tempo gives the period in 1/256
+// cycle units; g_ui32PeriodFrac carries what the whole-cycle periods have
+// not used up yet.
+//
+//*****************************************************************************
+static uint64_t g_ui64PeriodScale;
+static volatile uint32_t g_ui32PeriodQ8;
+static uint32_t g_ui32PeriodFrac;
+
+//*****************************************************************************
+//
+// The timer reloads at each timeout with the value written before it, so the
+// period written in one interrupt is the one after the period now running.
+//
+//*****************************************************************************
+static uint32_t g_ui32Running;
+static uint32_t g_ui32Next;
+static uint32_t g_ui32LastTick;
+
+//*****************************************************************************
+//
+// Tempo, in 1/256 thousandths of a BPM so a ramp can move by fractions, and
+// the ramp toward g_ui32TargetQ8, if one is running.
+//
+//*****************************************************************************
+static uint32_t g_ui32TempoQ8;
+static uint32_t g_ui32TargetQ8;
+static int32_t g_i32RampStep;
+static uint32_t g_ui32RampTicks;
+
+//*****************************************************************************
+//
+// Transport. The requests are set by the main loop and carried out, and
+// cleared, by the next tick, so every transport message is followed by
+// exactly one clock period before the next clock.
+//
+//*****************************************************************************
+static volatile bool g_bStartPending;
+static volatile bool g_bStopPending;
+static volatile bool g_bContinuePending;
+static volatile bool g_bPositionPending;
+static volatile bool g_bPlaying;
+static volatile uint32_t g_ui32Position;
+static uint32_t g_ui32SubPosition;
+
+static tMidiClockStats g_sStats;
+
+//*****************************************************************************
+//
+// Write one message to the head of the next IN packet.
+//
+//*****************************************************************************
+static void
+MidiClockSend(uint8_t ui8CIN, uint8_t ui8Status, uint8_t ui8Data1,
+              uint8_t ui8Data2)
+{
+    USBMIDI_Message_t sMsg;
+
+    sMsg.header = USB_MIDI_HEADER(MIDICLOCK_CABLE, ui8CIN);
+    sMsg.byte1 = ui8Status;
+    sMsg.byte2 = ui8Data1;
+    sMsg.byte3 = ui8Data2;
+    if(!USBMIDI_RealTimeWrite(&sMsg) && USBMIDI_IsConnected())
+    {
+        g_sStats.ui32Dropped++;
+    }
+}
+
+//*****************************************************************************
+//
+// Tick period for a tempo in 1/256 thousandths of a BPM.
+//
+//*****************************************************************************
+static uint32_t
+MidiClockPeriod(uint32_t ui32TempoQ8)
+{
+    return((uint32_t)((g_ui64PeriodScale << 8) / ui32TempoQ8));
+}
+
+//*****************************************************************************
+//
+// Clamp a tempo to the supported range.
+//
+//*****************************************************************************
+static uint32_t
+MidiClockClamp(uint32_t ui32Tempo)
+{
+    if(ui32Tempo < MIDICLOCK_TEMPO_MIN)
+    {
+        return(MIDICLOCK_TEMPO_MIN);
+    }
+    if(ui32Tempo > MIDICLOCK_TEMPO_MAX)
+    {
+        return(MIDICLOCK_TEMPO_MAX);
+    }
+    return(ui32Tempo);
+}
+
+//*****************************************************************************
+//
+//! Handles the clock timer interrupt.
+//!
+//! Programs the period after next, then sends any pending transport messages
+//! followed by the clock. This must be in the vector table for Timer 2A.
+//! MidiClockInit() gives it the USB interrupt's priority, which it must keep.
+//!
+//! \return None.
+//
+//*****************************************************************************
+void
+MidiClockIntHandler(void)
+{
+    uint32_t ui32Now;
+    uint32_t ui32Jitter;
+    uint32_t ui32Period;
+
+    MAP_TimerIntClear(MIDICLOCK_TIMER_BASE, TIMER_TIMA_TIMEOUT);
+    ui32Now = USBMIDI_Timestamp();
+
+    //
+    // How far this interrupt is from where the timer says it should be.
+    //
+    if(g_sStats.ui32Ticks != 0)
+    {
+        ui32Jitter = (ui32Now - g_ui32LastTick) - g_ui32Running;
+        if((int32_t)ui32Jitter < 0)
+        {
+            ui32Jitter = -ui32Jitter;
+        }
+        g_sStats.ui32JitterLast = ui32Jitter;
+        if(ui32Jitter > g_sStats.ui32JitterMax)
+        {
+            g_sStats.ui32JitterMax = ui32Jitter;
+        }
+    }
+    g_ui32LastTick = ui32Now;
+    g_sStats.ui32Ticks++;
+
+    //
+    // Step a tempo ramp; the last step lands exactly on the target.
+    //
+    if(g_ui32RampTicks != 0)
+    {
+        if(--g_ui32RampTicks == 0)
+        {
+            g_ui32TempoQ8 = g_ui32TargetQ8;
+        }
+        else
+        {
+            g_ui32TempoQ8 += g_i32RampStep;
+        }
+        g_ui32PeriodQ8 = MidiClockPeriod(g_ui32TempoQ8);
+    }
+
+    //
+    // The next whole-cycle period, carrying the fraction.
+    //
+    g_ui32PeriodFrac += g_ui32PeriodQ8 & 0xFF;
+    ui32Period = (g_ui32PeriodQ8 >> 8) + (g_ui32PeriodFrac >> 8);
+    g_ui32PeriodFrac &= 0xFF;
+    MAP_TimerLoadSet(MIDICLOCK_TIMER_BASE, TIMER_A, ui32Period - 1);
+    g_ui32Running = g_ui32Next;
+    g_ui32Next = ui32Period;
+
+    //
+    // Transport, then the clock itself.
+    //
+    if(g_bPositionPending)
+    {
+        g_bPositionPending = false;
+        MidiClockSend(USB_MIDI_CIN_SYSCOM3, MIDI_MSG_SPP,
+                      g_ui32Position & 0x7F, (g_ui32Position >> 7) & 0x7F);
+    }
+    if(g_bStopPending)
+    {
+        g_bStopPending = false;
+        g_bPlaying = false;
+        MidiClockSend(USB_MIDI_CIN_SINGLEBYTE, MIDI_MSG_STOP, 0, 0);
+    }
+    if(g_bStartPending)
+    {
+        g_bStartPending = false;
+        g_bPlaying = true;
+        g_ui32Position = 0;
+        g_ui32SubPosition = 0;
+        MidiClockSend(USB_MIDI_CIN_SINGLEBYTE, MIDI_MSG_START, 0, 0);
+    }
+    else if(g_bContinuePending)
+    {
+        g_bContinuePending = false;
+        g_bPlaying = true;
+        MidiClockSend(USB_MIDI_CIN_SINGLEBYTE, MIDI_MSG_CONTINUE, 0, 0);
+    }
+
+    MidiClockSend(USB_MIDI_CIN_SINGLEBYTE, MIDI_MSG_TIMINGCLOCK, 0, 0);
+
+    if(g_bPlaying && (++g_ui32SubPosition == MIDICLOCK_PER_SPP))
+    {
+        g_ui32SubPosition = 0;
+        g_ui32Position++;
+    }
+}
+
+//*****************************************************************************
+//
+//! Starts or stops the clock.
+//!
+//! \param bEnable is true to send clocks, false to stop sending them.
+//!
+//! Clocks are sent whether or not the transport is playing, so followers can
+//! lock to the tempo before Start. The first clock is one period after the
+//! clock is enabled.
+//!
+//! \return None.
+//
+//*****************************************************************************
+void
+MidiClockEnable(bool bEnable)
+{
+    uint32_t ui32Period;
+
+    MAP_TimerDisable(MIDICLOCK_TIMER_BASE, TIMER_A);
+    if(!bEnable)
+    {
+        return;
+    }
+
+    ui32Period = g_ui32PeriodQ8 >> 8;
+    g_ui32PeriodFrac = 0;
+    g_ui32Running = ui32Period;
+    g_ui32Next = ui32Period;
+    g_sStats.ui32Ticks = 0;
+    MAP_TimerLoadSet(MIDICLOCK_TIMER_BASE, TIMER_A, ui32Period - 1);
+    MAP_TimerEnable(MIDICLOCK_TIMER_BASE, TIMER_A);
+}
+
+//*****************************************************************************
+//
+//! Sets the tempo.
+//!
+//! \param ui32Tempo is the tempo in thousandths of a BPM, clamped to
+//! MIDICLOCK_TEMPO_MIN to MIDICLOCK_TEMPO_MAX.
+//!
+//! Any ramp in progress is cancelled. Because the timer is programmed one
+//! period ahead, the new tempo starts with the second clock from now.
+//!
+//! \return None.
+//
+//*****************************************************************************
+void
+MidiClockTempoSet(uint32_t ui32Tempo)
+{
+    MidiClockTempoRamp(ui32Tempo, 0);
+}
+
+//*****************************************************************************
+//
+//! Moves the tempo to a new value over a number of clocks.
+//!
+//! \param ui32Tempo is the target tempo in thousandths of a BPM.
+//! \param ui32Ticks is the number of clocks the ramp takes; 0 jumps straight
+//! to the target.
+//!
+//! The tempo (not the period) changes by the same amount on every clock.
+//!
+//! \return None.
+//
+//*****************************************************************************
+void
+MidiClockTempoRamp(uint32_t ui32Tempo, uint32_t ui32Ticks)
+{
+    uint32_t ui32TargetQ8;
+
+    ui32TargetQ8 = MidiClockClamp(ui32Tempo) << 8;
+
+    MAP_IntDisable(MIDICLOCK_TIMER_INT);
+    g_ui32TargetQ8 = ui32TargetQ8;
+    if(ui32Ticks == 0)
+    {
+        g_ui32RampTicks = 0;
+        g_ui32TempoQ8 = ui32TargetQ8;
+        g_ui32PeriodQ8 = MidiClockPeriod(ui32TargetQ8);
+    }
+    else
+    {
+        g_i32RampStep = ((int32_t)ui32TargetQ8 - (int32_t)g_ui32TempoQ8) /
+                        (int32_t)ui32Ticks;
+        g_ui32RampTicks = ui32Ticks;
+    }
+    MAP_IntEnable(MIDICLOCK_TIMER_INT);
+}
+
+//*****************************************************************************
+//
+//! Returns the current tempo, in thousandths of a BPM.
+//!
+//! \return Returns the tempo, part way through a ramp if one is running.
+//
+//*****************************************************************************
+uint32_t
+MidiClockTempoGet(void)
+{
+    return(g_ui32TempoQ8 >> 8);
+}
+
+//*****************************************************************************
+//
+//! Sends Start with the next clock and plays from the top.
+//!
+//! \return None.
+//
+//*****************************************************************************
+void
+MidiClockStart(void)
+{
+    g_bStartPending = true;
+}
+
+//*****************************************************************************
+//
+//! Sends Stop with the next clock. The song position stays where it stopped.
+//!
+//! \return None.
+//
+//*****************************************************************************
+void
+MidiClockStop(void)
+{
+    g_bStopPending = true;
+}
+
+//*****************************************************************************
+//
+//! Sends Continue with the next clock and plays from the song position.
+//!
+//! \return None.
+//
+//*****************************************************************************
+void
+MidiClockContinue(void)
+{
+    g_bContinuePending = true;
+}
+
+//*****************************************************************************
+//
+//! Moves the song position and sends it with the next clock.
+//!
+//! \param ui32Position is the new position in sixteenth notes (six clocks),
+//! 0 to 16383.
+//!
+//! Followers only accept a new position while stopped, so neither does this.
+//!
+//! \return Returns false if the transport is playing or about to play.
+//
+//*****************************************************************************
+bool
+MidiClockSongPositionSet(uint32_t ui32Position)
+{
+    bool bDone;
+
+    MAP_IntDisable(MIDICLOCK_TIMER_INT);
+    bDone = !g_bPlaying && !g_bStartPending && !g_bContinuePending;
+    if(bDone)
+    {
+        g_ui32Position = ui32Position & 0x3FFF;
+        g_ui32SubPosition = 0;
+        g_bPositionPending = true;
+    }
+    MAP_IntEnable(MIDICLOCK_TIMER_INT);
+
+    return(bDone);
+}
+
+//*****************************************************************************
+//
+//! Returns the song position, in sixteenth notes.
+//!
+//! \return Returns the position.
+//
+//*****************************************************************************
+uint32_t
+MidiClockSongPositionGet(void)
+{
+    return(g_ui32Position);
+}
+
+//*****************************************************************************
+//
+//! Returns whether the transport is playing.
+//!
+//! \return Returns true between the clocks that carried Start or Continue and
+//! Stop.
+//
+//*****************************************************************************
+bool
+MidiClockIsPlaying(void)
+{
+    return(g_bPlaying);
+}
+
+//*****************************************************************************
+//
+//! Returns the clock statistics.
+//!
+//! \param psStats points to the structure to fill in.
+//!
+//! \return None.
+//
+//*****************************************************************************
+void
+MidiClockStatsGet(tMidiClockStats *psStats)
+{
+    *psStats = g_sStats;
+}
+
+//*****************************************************************************
+//
+//! Initializes the clock timer at the default tempo, stopped.
+//!
+//! Call MidiClockEnable() to start sending clocks.
+//!
+//! \return None.
+//
+//*****************************************************************************
+void
+MidiClockInit(void)
+{
+    //
+    // Cycles per clock, in 1/256 cycles, times the tempo:
+    // clock * 60 s * 1000 (thousandths of a BPM) * 256 / 24 PPQN.
+    //
+    g_ui64PeriodScale = ((uint64_t)MAP_SysCtlClockGet() * 60 * 1000 * 256) /
+                        MIDICLOCK_PPQN;
+    g_ui32TempoQ8 = MIDICLOCK_TEMPO_DEFAULT << 8;
+    g_ui32PeriodQ8 = MidiClockPeriod(g_ui32TempoQ8);
+
+    MAP_SysCtlPeripheralEnable(MIDICLOCK_TIMER_PERIPH);
+    MAP_TimerConfigure(MIDICLOCK_TIMER_BASE, TIMER_CFG_PERIODIC);
+
+    //
+    // Take a new period at timeout, not the moment it is written, so the
+    // running period is never cut short.
+    //
+    TimerUpdateMode(MIDICLOCK_TIMER_BASE, TIMER_A, TIMER_UP_LOAD_TIMEOUT);
+
+    MAP_TimerIntEnable(MIDICLOCK_TIMER_BASE, TIMER_TIMA_TIMEOUT);
+    MAP_IntPrioritySet(MIDICLOCK_TIMER_INT, USBMIDI_INT_PRIORITY);
+    MAP_IntEnable(MIDICLOCK_TIMER_INT);
+}
+
+//*****************************************************************************
+//
+// Close the Doxygen group.
+//! @}
+//
+//*****************************************************************************
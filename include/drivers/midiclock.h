@@ -0,0 +1,106 @@
+//*****************************************************************************
+//
+// midiclock.h - Prototypes for the MIDI clock master.
+//
+// Created on: Oct 18, 2026
+//
+// MODS:
+//
+//*****************************************************************************
+
+#ifndef __MIDICLOCK_H__
+#define __MIDICLOCK_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+//*****************************************************************************
+//
+// If building with a C++ compiler, make all of the definitions in this header
+// have a C binding.
+//
+//*****************************************************************************
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+//*****************************************************************************
+//
+// Defines for the hardware resources used by the clock.
+//
+// Timer 2A, as a 32-bit periodic timer, interrupts once per clock (24 per
+// quarter note). The tick period is kept in 1/256 cycle units and the
+// fraction is carried from tick to tick, so the average tempo is exact even
+// though each tick is a whole number of cycles. The interrupt runs at the USB
+// interrupt's priority and writes its messages with USBMIDI_RealTimeWrite(),
+// which puts them at the head of the next IN packet.
+//
+//*****************************************************************************
+#define MIDICLOCK_TIMER_PERIPH  SYSCTL_PERIPH_TIMER2
+#define MIDICLOCK_TIMER_BASE    TIMER2_BASE
+#define MIDICLOCK_TIMER_INT     INT_TIMER2A
+
+#ifndef MIDICLOCK_CABLE
+#define MIDICLOCK_CABLE         0
+#endif
+
+#define MIDICLOCK_PPQN          24
+#define MIDICLOCK_PER_SPP       6       // clocks per Song Position unit
+
+//*****************************************************************************
+//
+// Tempos are in thousandths of a beat per minute (120000 is 120 BPM).
+//
+//*****************************************************************************
+#define MIDICLOCK_TEMPO_MIN     20000
+#define MIDICLOCK_TEMPO_MAX     300000
+
+#ifndef MIDICLOCK_TEMPO_DEFAULT
+#define MIDICLOCK_TEMPO_DEFAULT 120000
+#endif
+
+//*****************************************************************************
+//
+// Clock statistics. Jitter is the difference between the measured time from
+// one tick interrupt to the next and the period programmed for it, in CPU
+// cycles, so it is the interrupt latency variation the clock adds.
+//
+//*****************************************************************************
+typedef struct
+{
+    uint32_t ui32Ticks;             // clocks generated
+    uint32_t ui32JitterLast;
+    uint32_t ui32JitterMax;
+    uint32_t ui32Dropped;           // messages the USB stack refused
+} tMidiClockStats;
+
+//*****************************************************************************
+//
+// Functions exported from midiclock.c
+//
+//*****************************************************************************
+extern void MidiClockInit(void);
+extern void MidiClockEnable(bool bEnable);
+extern void MidiClockTempoSet(uint32_t ui32Tempo);
+extern void MidiClockTempoRamp(uint32_t ui32Tempo, uint32_t ui32Ticks);
+extern uint32_t MidiClockTempoGet(void);
+extern void MidiClockStart(void);
+extern void MidiClockStop(void);
+extern void MidiClockContinue(void);
+extern bool MidiClockSongPositionSet(uint32_t ui32Position);
+extern uint32_t MidiClockSongPositionGet(void);
+extern bool MidiClockIsPlaying(void);
+extern void MidiClockStatsGet(tMidiClockStats *psStats);
+extern void MidiClockIntHandler(void);
+
+//*****************************************************************************
+//
+// Mark the end of the C bindings section for C++ compilers.
+//
+//*****************************************************************************
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __MIDICLOCK_H__
@@ -0,0 +1,370 @@
+//*****************************************************************************
+//
+// mtcgen.c - MIDI Time Code generator.
+//
+// Created on: Oct 18, 2026
+//
+// MODS:
+//
+//*****************************************************************************
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "inc/hw_ints.h"
+#include "inc/hw_memmap.h"
+#include "inc/hw_types.h"
+#include "driverlib/interrupt.h"
+#include "driverlib/rom.h"
+#include "driverlib/rom_map.h"
+#include "driverlib/sysctl.h"
+#include "driverlib/timer.h"
+#include "drivers/mtcgen.h"
+
+#include "midi.h"
+#include "usb_midi.h"
+#include "usbmidi_types.h"
+#include "usbmidi.h"
+#include "usbmidi_timestamp.h"
+#include "usbmidi_critical.h"
+
+//*****************************************************************************
+//
+//! \addtogroup mtcgen_api
+//! @{
+//
+//*****************************************************************************
+
+//*****************************************************************************
+//
+// Quarter frame period in 1/256 cycles, and the fraction carried over.
+// The period written in one interrupt is the one after the period now
+// running; see midiclock.c.
+//
+//*****************************************************************************
+static uint32_t g_ui32PeriodQ8;
+static uint32_t g_ui32PeriodFrac;
+static uint32_t g_ui32Running;
+static uint32_t g_ui32Next;
+static uint32_t g_ui32LastTick;
+
+//*****************************************************************************
+//
+// Position: the frame being sent, the next piece (0-7), and the timecode
+// latched at piece 0 that pieces 0-7 carry.
+//
+//*****************************************************************************
+static uint8_t g_ui8Rate = USBMIDI_MTC_25;
+static volatile uint32_t g_ui32Frame;
+static uint32_t g_ui32Piece;
+static USBMIDIMtcTime_t g_sLatched;
+static volatile bool g_bRunning;
+
+//*****************************************************************************
+//
+// The Full Frame message sent on locate. It goes out straight from here, so
+// it is only rewritten while no SysEx is being sent.
+//
+//*****************************************************************************
+static uint8_t g_pui8FullFrame[10] =
+{
+    MIDI_MSG_SOX, 0x7F, 0x7F, 0x01, 0x01, 0, 0, 0, 0, MIDI_MSG_EOX
+};
+
+static tMtcGenStats g_sStats;
+
+//*****************************************************************************
+//
+// The data nibble for a piece of the latched timecode.
+//
+//*****************************************************************************
+static uint8_t
+MtcGenNibble(uint32_t ui32Piece)
+{
+    switch(ui32Piece)
+    {
+        case 0:
+            return(g_sLatched.frames & 0x0F);
+        case 1:
+            return(g_sLatched.frames >> 4);
+        case 2:
+            return(g_sLatched.seconds & 0x0F);
+        case 3:
+            return(g_sLatched.seconds >> 4);
+        case 4:
+            return(g_sLatched.minutes & 0x0F);
+        case 5:
+            return(g_sLatched.minutes >> 4);
+        case 6:
+            return(g_sLatched.hours & 0x0F);
+        default:
+            return((g_sLatched.hours >> 4) | (g_ui8Rate << 1));
+    }
+}
+
+//*****************************************************************************
+//
+//! Handles the quarter frame timer interrupt.
+//!
+//! Programs the period after next and sends the next quarter frame. This must
+//! be in the vector table for Timer 3A. MtcGenInit() gives it the USB
+//! interrupt's priority, which it must keep.
+//!
+//! \return None.
+//
+//*****************************************************************************
+void
+MtcGenIntHandler(void)
+{
+    USBMIDI_Message_t sMsg;
+    uint32_t ui32Now;
+    uint32_t ui32Jitter;
+    uint32_t ui32Period;
+
+    MAP_TimerIntClear(MTCGEN_TIMER_BASE, TIMER_TIMA_TIMEOUT);
+    ui32Now = USBMIDI_Timestamp();
+
+    if(g_sStats.ui32QuarterFrames != 0)
+    {
+        ui32Jitter = (ui32Now - g_ui32LastTick) - g_ui32Running;
+        if((int32_t)ui32Jitter < 0)
+        {
+            ui32Jitter = -ui32Jitter;
+        }
+        g_sStats.ui32JitterLast = ui32Jitter;
+        if(ui32Jitter > g_sStats.ui32JitterMax)
+        {
+            g_sStats.ui32JitterMax = ui32Jitter;
+        }
+    }
+    g_ui32LastTick = ui32Now;
+
+    g_ui32PeriodFrac += g_ui32PeriodQ8 & 0xFF;
+    ui32Period = (g_ui32PeriodQ8 >> 8) + (g_ui32PeriodFrac >> 8);
+    g_ui32PeriodFrac &= 0xFF;
+    MAP_TimerLoadSet(MTCGEN_TIMER_BASE, TIMER_A, ui32Period - 1);
+    g_ui32Running = g_ui32Next;
+    g_ui32Next = ui32Period;
+
+    //
+    // Piece 0 carries the frame it starts; the eight pieces span two frames.
+    //
+    if(g_ui32Piece == 0)
+    {
+        USBMIDIMtc_FromFrames(g_ui32Frame, g_ui8Rate, &g_sLatched);
+    }
+
+    sMsg.header = USB_MIDI_HEADER(MTCGEN_CABLE, USB_MIDI_CIN_SYSCOM2);
+    sMsg.byte1 = MIDI_MSG_MTCQF;
+    sMsg.byte2 = (g_ui32Piece << 4) | MtcGenNibble(g_ui32Piece);
+    sMsg.byte3 = 0;
+    if(!USBMIDI_RealTimeWrite(&sMsg) && USBMIDI_IsConnected())
+    {
+        g_sStats.ui32Dropped++;
+    }
+    g_sStats.ui32QuarterFrames++;
+
+    g_ui32Piece = (g_ui32Piece + 1) & 7;
+    if((g_ui32Piece & 3) == 0)
+    {
+        if(++g_ui32Frame >= USBMIDIMtc_FramesPerDay(g_ui8Rate))
+        {
+            g_ui32Frame = 0;
+        }
+    }
+}
+
+//*****************************************************************************
+//
+//! Sets the frame rate.
+//!
+//! \param ui8Rate is one of USBMIDI_MTC_24, USBMIDI_MTC_25, USBMIDI_MTC_30DF
+//! or USBMIDI_MTC_30.
+//!
+//! The position is kept as a frame count, so it is only valid to change the
+//! rate while stopped; locate afterwards.
+//!
+//! \return Returns false if the generator is running.
+//
+//*****************************************************************************
+bool
+MtcGenRateSet(uint8_t ui8Rate)
+{
+    if(g_bRunning)
+    {
+        return(false);
+    }
+
+    g_ui8Rate = ui8Rate & 3;
+    g_ui32PeriodQ8 = USBMIDIMtc_QuarterPeriod(MAP_SysCtlClockGet(), g_ui8Rate);
+    if(g_ui32Frame >= USBMIDIMtc_FramesPerDay(g_ui8Rate))
+    {
+        g_ui32Frame = 0;
+    }
+
+    return(true);
+}
+
+//*****************************************************************************
+//
+//! Moves the generator to a timecode.
+//!
+//! \param psTime is the new position. Its rate field is ignored; the
+//! generator's own rate applies.
+//!
+//! A Full Frame message is sent for the new position, so followers locate
+//! before the quarter frames start; it is skipped if another SysEx is still
+//! being sent.
+//!
+//! \return Returns false if the generator is running.
+//
+//*****************************************************************************
+bool
+MtcGenLocate(const USBMIDIMtcTime_t *psTime)
+{
+    USBMIDIMtcTime_t sTime;
+
+    if(g_bRunning)
+    {
+        return(false);
+    }
+
+    sTime = *psTime;
+    sTime.rate = g_ui8Rate;
+    g_ui32Frame = USBMIDIMtc_ToFrames(&sTime);
+    if(g_ui32Frame >= USBMIDIMtc_FramesPerDay(g_ui8Rate))
+    {
+        g_ui32Frame = 0;
+    }
+    g_ui32Piece = 0;
+
+    if(!USBMIDI_SysExTxBusy())
+    {
+        USBMIDIMtc_FromFrames(g_ui32Frame, g_ui8Rate, &sTime);
+        g_pui8FullFrame[5] = (g_ui8Rate << 5) | sTime.hours;
+        g_pui8FullFrame[6] = sTime.minutes;
+        g_pui8FullFrame[7] = sTime.seconds;
+        g_pui8FullFrame[8] = sTime.frames;
+        USBMIDI_SendSysEx(MTCGEN_CABLE, g_pui8FullFrame,
+                          sizeof(g_pui8FullFrame));
+    }
+
+    return(true);
+}
+
+//*****************************************************************************
+//
+//! Starts sending quarter frames from the current position.
+//!
+//! The first quarter frame, piece 0 of the current frame, goes out one
+//! quarter frame period from now.
+//!
+//! \return None.
+//
+//*****************************************************************************
+void
+MtcGenStart(void)
+{
+    uint32_t ui32Period;
+
+    if(g_bRunning)
+    {
+        return;
+    }
+
+    ui32Period = g_ui32PeriodQ8 >> 8;
+    g_ui32PeriodFrac = 0;
+    g_ui32Running = ui32Period;
+    g_ui32Next = ui32Period;
+    g_ui32Piece = 0;
+    g_sStats.ui32QuarterFrames = 0;
+    g_bRunning = true;
+    MAP_TimerLoadSet(MTCGEN_TIMER_BASE, TIMER_A, ui32Period - 1);
+    MAP_TimerEnable(MTCGEN_TIMER_BASE, TIMER_A);
+}
+
+//*****************************************************************************
+//
+//! Stops sending quarter frames. The position stays where it stopped.
+//!
+//! \return None.
+//
+//*****************************************************************************
+void
+MtcGenStop(void)
+{
+    MAP_TimerDisable(MTCGEN_TIMER_BASE, TIMER_A);
+    g_bRunning = false;
+}
+
+//*****************************************************************************
+//
+//! Returns whether quarter frames are being sent.
+//!
+//! \return Returns true between MtcGenStart() and MtcGenStop().
+//
+//*****************************************************************************
+bool
+MtcGenIsRunning(void)
+{
+    return(g_bRunning);
+}
+
+//*****************************************************************************
+//
+//! Returns the frame being sent.
+//!
+//! \param psTime points to the structure to fill in.
+//!
+//! \return None.
+//
+//*****************************************************************************
+void
+MtcGenTimeGet(USBMIDIMtcTime_t *psTime)
+{
+    USBMIDIMtc_FromFrames(g_ui32Frame, g_ui8Rate, psTime);
+}
+
+//*****************************************************************************
+//
+//! Returns the generator statistics.
+//!
+//! \param psStats points to the structure to fill in.
+//!
+//! \return None.
+//
+//*****************************************************************************
+void
+MtcGenStatsGet(tMtcGenStats *psStats)
+{
+    *psStats = g_sStats;
+}
+
+//*****************************************************************************
+//
+//! Initializes the quarter frame timer, stopped at 00:00:00:00, 25 fps.
+//!
+//! \return None.
+//
+//*****************************************************************************
+void
+MtcGenInit(void)
+{
+    MAP_SysCtlPeripheralEnable(MTCGEN_TIMER_PERIPH);
+    MAP_TimerConfigure(MTCGEN_TIMER_BASE, TIMER_CFG_PERIODIC);
+    TimerUpdateMode(MTCGEN_TIMER_BASE, TIMER_A, TIMER_UP_LOAD_TIMEOUT);
+    MAP_TimerIntEnable(MTCGEN_TIMER_BASE, TIMER_TIMA_TIMEOUT);
+    MAP_IntPrioritySet(MTCGEN_TIMER_INT, USBMIDI_INT_PRIORITY);
+    MAP_IntEnable(MTCGEN_TIMER_INT);
+
+    g_bRunning = false;
+    MtcGenRateSet(g_ui8Rate);
+    g_ui32Frame = 0;
+    g_ui32Piece = 0;
+}
+
+//*****************************************************************************
+//
+// Close the Doxygen group.
+//! @}
+//
+//*****************************************************************************
@@ -0,0 +1,87 @@
+//*****************************************************************************
+//
+// mtcgen.h - Prototypes for the MIDI Time Code generator.
+//
+// Created on: Oct 18, 2026
+//
+// MODS:
+//
+//*****************************************************************************
+
+#ifndef __MTCGEN_H__
+#define __MTCGEN_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "usb_midi.h"
+#include "usbmidi_mtc.h"
+
+//*****************************************************************************
+//
+// If building with a C++ compiler, make all of the definitions in this header
+// have a C binding.
+//
+//*****************************************************************************
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+//*****************************************************************************
+//
+// Defines for the hardware resources used by the generator.
+//
+// Timer 3A, as a 32-bit periodic timer, interrupts once per quarter frame
+// (four per frame; 119.88 per second at 29.97). As with the MIDI clock, the
+// period is kept in 1/256 cycles with the fraction carried over, and the
+// interrupt, at the USB interrupt's priority, writes each quarter frame with
+// USBMIDI_RealTimeWrite(). Main loop load has no effect on the timing.
+//
+//*****************************************************************************
+#define MTCGEN_TIMER_PERIPH     SYSCTL_PERIPH_TIMER3
+#define MTCGEN_TIMER_BASE       TIMER3_BASE
+#define MTCGEN_TIMER_INT        INT_TIMER3A
+
+#ifndef MTCGEN_CABLE
+#define MTCGEN_CABLE            0
+#endif
+
+//*****************************************************************************
+//
+// Generator statistics. Jitter is as for tMidiClockStats, in CPU cycles.
+//
+//*****************************************************************************
+typedef struct
+{
+    uint32_t ui32QuarterFrames;     // quarter frames sent
+    uint32_t ui32JitterLast;
+    uint32_t ui32JitterMax;
+    uint32_t ui32Dropped;           // messages the USB stack refused
+} tMtcGenStats;
+
+//*****************************************************************************
+//
+// Functions exported from mtcgen.c
+//
+//*****************************************************************************
+extern void MtcGenInit(void);
+extern bool MtcGenRateSet(uint8_t ui8Rate);
+extern bool MtcGenLocate(const USBMIDIMtcTime_t *psTime);
+extern void MtcGenStart(void);
+extern void MtcGenStop(void);
+extern bool MtcGenIsRunning(void);
+extern void MtcGenTimeGet(USBMIDIMtcTime_t *psTime);
+extern void MtcGenStatsGet(tMtcGenStats *psStats);
+extern void MtcGenIntHandler(void);
+
+//*****************************************************************************
+//
+// Mark the end of the C bindings section for C++ compilers.
+//
+//*****************************************************************************
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __MTCGEN_H__
@@ -0,0 +1,164 @@
+/*
+ * fwboot.c
+ *
+ * Boot stub for SysEx firmware update.
+ *
+ * This lives in the first 2 KB of flash with its own vector table (.bootvecs and
+ * .boot sections, see usb_dev_midi_ccs.cmd) and is never written by the updater.
+ * On every reset it looks at the update record. If a verified image is pending
+ * in slot B, it is copied over slot A and checked before the record is marked
+ * applied. Then the stub points VTABLE at slot A and jumps to the application's
+ * reset vector.
+ *
+ * Everything here must be self-contained: no RTS calls, no initialized data and
+ * only ROM driverlib functions, because the C runtime has not run yet and
+ * slot A may be half-written.
+ *
+ *  Created on: Oct 18, 2026
+ *
+ * MODS:
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "inc/hw_nvic.h"
+#include "inc/hw_types.h"
+#include "driverlib/flash.h"
+#include "driverlib/rom.h"
+
+#include "fwupdate.h"
+
+/*
+ * How often to retry the B to A copy before giving up and booting anyway.
+ */
+#define FWBOOT_COPY_TRIES 3
+
+/*
+ * Words moved per FlashProgram() call. Keeps the copy buffer off most of the 1 KB stack.
+ */
+#define FWBOOT_COPY_WORDS 32
+
+extern uint32_t __STACK_TOP;
+
+static uint32_t FwBoot_Crc32(uint32_t crc, const uint8_t *data, uint32_t len);
+static void FwBoot_Reset(void);
+static void FwBoot_Fault(void);
+static void FwBoot_Copy(uint32_t ui32Length);
+static void FwBoot_Jump(uint32_t ui32Base);
+
+/*
+ * The boot vector table. Only the core exceptions are needed; the stub runs
+ * with every peripheral interrupt disabled.
+ */
+#pragma DATA_SECTION(g_pfnBootVectors, ".bootvecs")
+void (* const g_pfnBootVectors[])(void) =
+{
+	(void (*)(void))((uint32_t)&__STACK_TOP),	// The initial stack pointer
+	FwBoot_Reset,								// The reset handler
+	FwBoot_Fault,								// The NMI handler
+	FwBoot_Fault,								// The hard fault handler
+	FwBoot_Fault,								// The MPU fault handler
+	FwBoot_Fault,								// The bus fault handler
+	FwBoot_Fault,								// The usage fault handler
+};
+
+/*
+ * The same CRC-32 as FwUpdate_Crc32(). The application has its own copy: code
+ * in .boot is never replaced, so nothing outside the stub may call into it.
+ */
+#pragma CODE_SECTION(FwBoot_Crc32, ".boot")
+static uint32_t FwBoot_Crc32(uint32_t crc, const uint8_t *data, uint32_t len)
+{
+	uint32_t bit;
+
+	crc = ~crc;
+	while( len-- )
+	{
+		crc ^= *data++;
+		for( bit = 0; bit < 8; bit++ )
+			crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
+	}
+	return ~crc;
+}
+
+#pragma CODE_SECTION(FwBoot_Reset, ".boot")
+static void FwBoot_Reset(void)
+{
+	const tFwUpdateRecord *psRec;
+	uint32_t ui32Word;
+	uint32_t tries;
+
+	psRec = (const tFwUpdateRecord *) FWUPDATE_RECORD_BASE;
+
+	if( (psRec->ui32Magic == FWUPDATE_RECORD_MAGIC) &&
+			(psRec->ui32Pending == FWUPDATE_RECORD_PENDING) &&
+			(psRec->ui32Applied == FWUPDATE_RECORD_ERASED) &&
+			(psRec->ui32Length <= FWUPDATE_SLOT_SIZE) &&
+			(FwBoot_Crc32(0, (const uint8_t *) FWUPDATE_SLOT_B_BASE, psRec->ui32Length) == psRec->ui32Crc) )
+	{
+		for( tries = 0; tries < FWBOOT_COPY_TRIES; tries++ )
+		{
+			FwBoot_Copy(psRec->ui32Length);
+			if( FwBoot_Crc32(0, (const uint8_t *) FWUPDATE_SLOT_A_BASE, psRec->ui32Length) == psRec->ui32Crc )
+			{
+				ui32Word = FWUPDATE_RECORD_APPLIED;
+				ROM_FlashProgram(&ui32Word, (uint32_t) &psRec->ui32Applied, sizeof(ui32Word));
+				break;
+			}
+		}
+	}
+
+	HWREG(NVIC_VTABLE) = FWUPDATE_SLOT_A_BASE;
+	FwBoot_Jump(FWUPDATE_SLOT_A_BASE);
+}
+
+/*
+ * Copy slot B over slot A, a page at a time. Slot B pages are always fully
+ * programmed (the tail is padded with 0xFF), so whole pages are copied.
+ */
+#pragma CODE_SECTION(FwBoot_Copy, ".boot")
+static void FwBoot_Copy(uint32_t ui32Length)
+{
+	uint32_t pui32Buf[FWBOOT_COPY_WORDS];
+	uint32_t ui32Offset;
+	uint32_t ui32Chunk;
+	uint32_t w;
+
+	for( ui32Offset = 0; ui32Offset < ui32Length; ui32Offset += FWUPDATE_PAGE_SIZE )
+	{
+		ROM_FlashErase(FWUPDATE_SLOT_A_BASE + ui32Offset);
+
+		for( ui32Chunk = 0; ui32Chunk < FWUPDATE_PAGE_SIZE; ui32Chunk += sizeof(pui32Buf) )
+		{
+			for( w = 0; w < FWBOOT_COPY_WORDS; w++ )
+				pui32Buf[w] = HWREG(FWUPDATE_SLOT_B_BASE + ui32Offset + ui32Chunk + (w * 4));
+			ROM_FlashProgram(pui32Buf, FWUPDATE_SLOT_A_BASE + ui32Offset + ui32Chunk, sizeof(pui32Buf));
+		}
+	}
+}
+
+/*
+ * Load the application's stack pointer and branch to its reset vector.
+ * ui32Base arrives in r0.
+ */
+#pragma CODE_SECTION(FwBoot_Jump, ".boot")
+#pragma FUNC_CANNOT_INLINE(FwBoot_Jump)
+static void FwBoot_Jump(uint32_t ui32Base)
+{
+	__asm("    ldr     r1, [r0]\n"
+		  "    msr     msp, r1\n"
+		  "    ldr     r0, [r0, #4]\n"
+		  "    bx      r0\n");
+}
+
+/*
+ * Faults in the stub: stop here for the debugger.
+ */
+#pragma CODE_SECTION(FwBoot_Fault, ".boot")
+static void FwBoot_Fault(void)
+{
+	while(1)
+	{
+	}
+}
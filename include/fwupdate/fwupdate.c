@@ -0,0 +1,385 @@
+/*
+ * fwupdate.c
+ *
+ * Receive side of the SysEx firmware update. See fwupdate.h for the protocol
+ * and flash layout.
+ *
+ * Incoming chunks are decoded straight out of the SysEx pool into one of two
+ * page buffers. When a buffer fills up it is handed to FwUpdate_Task(), which
+ * erases and programs the page from the main loop while the other buffer
+ * takes the next chunks. Meanwhile the USB interrupt keeps pulling packets
+ * into the SysEx pool, so reception and programming overlap.
+ *
+ *  Created on: Oct 18, 2026
+ *
+ * MODS:
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "inc/hw_types.h"
+#include "driverlib/flash.h"
+#include "driverlib/rom.h"
+#include "driverlib/rom_map.h"
+#include "driverlib/sysctl.h"
+
+#include "midi.h"
+#include "usbmidi_types.h"
+#include "usbmidi.h"
+#include "fwupdate.h"
+
+/*
+ * Receiver state.
+ */
+typedef enum
+{
+	eFwUpdateIdle,			// nothing announced
+	eFwUpdateReceiving,		// BEGIN seen, taking DATA
+	eFwUpdateVerified,		// END seen and slot B matches the CRC
+	eFwUpdateApplying		// APPLY seen, reset as soon as the ack is out
+} tFwUpdateState;
+
+/*
+ * Spin count to wait for a previous reply to leave before overwriting its buffer.
+ */
+#define FWUPDATE_REPLY_TIMEOUT 100000
+
+/*
+ * SysCtlDelay() count between the APPLY ack and the reset, about 4 ms at 80 MHz.
+ */
+#define FWUPDATE_RESET_DELAY 100000
+
+static tFwUpdateState g_eState;
+static uint32_t g_ui32Length;			// announced image length
+static uint32_t g_ui32Crc;				// announced CRC-32
+static uint32_t g_ui32Received;			// payload bytes taken so far
+static uint16_t g_ui16Seq;				// next DATA sequence number expected
+
+static uint32_t g_pui32Page[2][FWUPDATE_PAGE_SIZE / 4];		// page buffers, word aligned for FlashProgram()
+static uint32_t g_pui32PageAddr[2];		// where each buffer goes in slot B
+static bool g_pbPagePending[2];			// buffer is full and waiting to be programmed
+static uint8_t g_ui8Fill;				// buffer being filled
+static uint16_t g_ui16FillCnt;			// bytes in the fill buffer
+static uint32_t g_ui32NextAddr;			// slot B address of the fill buffer
+static bool g_bFlashError;
+
+static uint8_t g_pui8Reply[9];
+
+uint32_t FwUpdate_Crc32(uint32_t crc, const uint8_t *data, uint32_t len)
+{
+	uint32_t bit;
+
+	crc = ~crc;
+	while( len-- )
+	{
+		crc ^= *data++;
+		for( bit = 0; bit < 8; bit++ )
+			crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
+	}
+	return ~crc;
+}
+
+/*
+ * Send F0 7D 46 <ack/nak> <cmd> <seq lo> <seq hi> <status> F7.
+ */
+static void FwUpdate_Reply(uint8_t ui8Cmd, tFwUpdateStatus eStatus, uint16_t ui16Seq)
+{
+	uint32_t timeout = FWUPDATE_REPLY_TIMEOUT;
+
+	while( USBMIDI_SysExTxBusy() && --timeout )
+	{
+	}
+	if( timeout == 0 )
+		return;
+
+	g_pui8Reply[0] = MIDI_MSG_SOX;
+	g_pui8Reply[1] = FWUPDATE_SYSEX_ID;
+	g_pui8Reply[2] = FWUPDATE_SYSEX_SUBID;
+	g_pui8Reply[3] = (eStatus == eFwUpdateOk) ? FWUPDATE_REPLY_ACK : FWUPDATE_REPLY_NAK;
+	g_pui8Reply[4] = ui8Cmd;
+	g_pui8Reply[5] = ui16Seq & 0x7F;
+	g_pui8Reply[6] = (ui16Seq >> 7) & 0x7F;
+	g_pui8Reply[7] = eStatus;
+	g_pui8Reply[8] = MIDI_MSG_EOX;
+
+	USBMIDI_SendSysEx(0, g_pui8Reply, sizeof(g_pui8Reply));
+}
+
+/*
+ * Erase and program one page of slot B from a page buffer.
+ */
+static void FwUpdate_ProgramPage(uint8_t ui8Buf)
+{
+	if( MAP_FlashErase(g_pui32PageAddr[ui8Buf]) != 0 ||
+			MAP_FlashProgram(g_pui32Page[ui8Buf], g_pui32PageAddr[ui8Buf], FWUPDATE_PAGE_SIZE) != 0 )
+	{
+		g_bFlashError = true;
+	}
+	g_pbPagePending[ui8Buf] = false;
+}
+
+/*
+ * The fill buffer is complete: queue it and switch to the other one, which must
+ * be programmed first if the main loop has not got to it yet.
+ */
+static void FwUpdate_PageDone(void)
+{
+	uint8_t ui8Other = g_ui8Fill ^ 1;
+
+	if( g_pbPagePending[ui8Other] )
+		FwUpdate_ProgramPage(ui8Other);
+
+	g_pui32PageAddr[g_ui8Fill] = g_ui32NextAddr;
+	g_pbPagePending[g_ui8Fill] = true;
+	g_ui32NextAddr += FWUPDATE_PAGE_SIZE;
+
+	g_ui8Fill = ui8Other;
+	g_ui16FillCnt = 0;
+}
+
+static void FwUpdate_PutByte(uint8_t b)
+{
+	((uint8_t *) g_pui32Page[g_ui8Fill])[g_ui16FillCnt++] = b;
+	if( g_ui16FillCnt == FWUPDATE_PAGE_SIZE )
+		FwUpdate_PageDone();
+}
+
+/*
+ * Pad out and program whatever is left, so slot B is complete.
+ */
+static void FwUpdate_Flush(void)
+{
+	if( g_ui16FillCnt )
+	{
+		while( g_ui16FillCnt )
+			FwUpdate_PutByte(0xFF);
+	}
+	if( g_pbPagePending[0] )
+		FwUpdate_ProgramPage(0);
+	if( g_pbPagePending[1] )
+		FwUpdate_ProgramPage(1);
+}
+
+/*
+ * Read a number sent as n 7-bit groups, least significant first.
+ */
+static bool FwUpdate_ReadNumber(USBMIDISysExReader_t *rd, uint8_t n, uint32_t *value)
+{
+	uint8_t b;
+	uint8_t i;
+
+	*value = 0;
+	for( i = 0; i < n; i++ )
+	{
+		if( !USBMIDISysEx_ReadByte(rd, &b) || (b & 0x80) )
+			return false;
+		*value |= (uint32_t) b << (7 * i);
+	}
+	return true;
+}
+
+/*
+ * Decode the 8-to-7 packed payload of a DATA message.
+ * With bStore false, only check it and count the bytes; with bStore true, write
+ * them to the page buffers.
+ */
+static bool FwUpdate_Unpack(USBMIDISysExReader_t *rd, uint32_t ui32Packed, bool bStore, uint32_t *pui32Count)
+{
+	uint8_t b;
+	uint8_t msbs = 0;
+	uint8_t i = 0;
+
+	*pui32Count = 0;
+	while( ui32Packed-- )
+	{
+		if( !USBMIDISysEx_ReadByte(rd, &b) || (b & 0x80) )
+			return false;
+
+		if( i == 0 )
+		{
+			msbs = b;
+		}
+		else
+		{
+			if( bStore )
+				FwUpdate_PutByte(b | ((msbs << (8 - i)) & 0x80));
+			(*pui32Count)++;
+		}
+		i = (i == 7) ? 0 : i + 1;
+	}
+	return true;
+}
+
+static tFwUpdateStatus FwUpdate_Begin(USBMIDISysExReader_t *rd)
+{
+	tFwUpdateRecord sRec;
+
+	if( !FwUpdate_ReadNumber(rd, 5, &g_ui32Length) || !FwUpdate_ReadNumber(rd, 5, &g_ui32Crc) )
+		return eFwUpdateMalformed;
+	if( g_ui32Length == 0 || g_ui32Length > FWUPDATE_SLOT_SIZE )
+		return eFwUpdateBadLength;
+
+	// a new record: magic, length and CRC now; pending only after END verifies.
+	sRec.ui32Magic = FWUPDATE_RECORD_MAGIC;
+	sRec.ui32Length = g_ui32Length;
+	sRec.ui32Crc = g_ui32Crc;
+	if( MAP_FlashErase(FWUPDATE_RECORD_BASE) != 0 ||
+			MAP_FlashProgram(&sRec.ui32Magic, FWUPDATE_RECORD_BASE, 3 * sizeof(uint32_t)) != 0 )
+		return eFwUpdateFlashError;
+
+	g_ui32Received = 0;
+	g_ui16Seq = 0;
+	g_pbPagePending[0] = false;
+	g_pbPagePending[1] = false;
+	g_ui8Fill = 0;
+	g_ui16FillCnt = 0;
+	g_ui32NextAddr = FWUPDATE_SLOT_B_BASE;
+	g_bFlashError = false;
+	g_eState = eFwUpdateReceiving;
+
+	return eFwUpdateOk;
+}
+
+static tFwUpdateStatus FwUpdate_Data(USBMIDISysExReader_t *rd)
+{
+	USBMIDISysExReader_t sCheck;
+	uint32_t ui32Seq;
+	uint32_t ui32Packed;
+	uint32_t ui32Count;
+
+	if( g_eState != eFwUpdateReceiving )
+		return eFwUpdateBadState;
+	if( !FwUpdate_ReadNumber(rd, 2, &ui32Seq) )
+		return eFwUpdateMalformed;
+	if( ui32Seq != g_ui16Seq )
+		return eFwUpdateBadSequence;
+
+	// everything up to the F7 is payload.
+	if( rd->remaining < 1 )
+		return eFwUpdateMalformed;
+	ui32Packed = rd->remaining - 1;
+
+	// check the whole chunk before any of it goes into the page buffers.
+	sCheck = *rd;
+	if( !FwUpdate_Unpack(&sCheck, ui32Packed, false, &ui32Count) )
+		return eFwUpdateMalformed;
+	if( g_ui32Received + ui32Count > g_ui32Length )
+		return eFwUpdateOverrun;
+
+	FwUpdate_Unpack(rd, ui32Packed, true, &ui32Count);
+	g_ui32Received += ui32Count;
+	g_ui16Seq = (g_ui16Seq + 1) & 0x3FFF;
+
+	return g_bFlashError ? eFwUpdateFlashError : eFwUpdateOk;
+}
+
+static tFwUpdateStatus FwUpdate_End(void)
+{
+	if( g_eState != eFwUpdateReceiving )
+		return eFwUpdateBadState;
+	if( g_ui32Received != g_ui32Length )
+		return eFwUpdateBadLength;
+
+	FwUpdate_Flush();
+	if( g_bFlashError )
+	{
+		g_eState = eFwUpdateIdle;
+		return eFwUpdateFlashError;
+	}
+
+	if( FwUpdate_Crc32(0, (const uint8_t *) FWUPDATE_SLOT_B_BASE, g_ui32Length) != g_ui32Crc )
+	{
+		g_eState = eFwUpdateIdle;
+		return eFwUpdateBadCrc;
+	}
+
+	g_eState = eFwUpdateVerified;
+	return eFwUpdateOk;
+}
+
+static tFwUpdateStatus FwUpdate_Apply(void)
+{
+	uint32_t ui32Word = FWUPDATE_RECORD_PENDING;
+
+	if( g_eState != eFwUpdateVerified )
+		return eFwUpdateBadState;
+
+	if( MAP_FlashProgram(&ui32Word, FWUPDATE_RECORD_BASE + 3 * sizeof(uint32_t), sizeof(ui32Word)) != 0 )
+		return eFwUpdateFlashError;
+
+	g_eState = eFwUpdateApplying;
+	return eFwUpdateOk;
+}
+
+void FwUpdate_Init(void)
+{
+	g_eState = eFwUpdateIdle;
+	g_pbPagePending[0] = false;
+	g_pbPagePending[1] = false;
+}
+
+bool FwUpdate_SysEx(const USBMIDISysExMsg_t *msg)
+{
+	USBMIDISysExReader_t rd;
+	tFwUpdateStatus eStatus;
+	uint16_t ui16Seq;
+	uint8_t b;
+	uint8_t ui8Cmd;
+
+	// F0 7D 46 <cmd>
+	USBMIDISysEx_ReaderInit(&rd, msg);
+	USBMIDISysEx_ReadByte(&rd, &b);
+	if( !USBMIDISysEx_ReadByte(&rd, &b) || b != FWUPDATE_SYSEX_ID )
+		return false;
+	if( !USBMIDISysEx_ReadByte(&rd, &b) || b != FWUPDATE_SYSEX_SUBID )
+		return false;
+	if( !USBMIDISysEx_ReadByte(&rd, &ui8Cmd) )
+		return false;
+
+	switch( ui8Cmd )
+	{
+	case FWUPDATE_CMD_BEGIN:
+		eStatus = FwUpdate_Begin(&rd);
+		break;
+	case FWUPDATE_CMD_DATA:
+		eStatus = FwUpdate_Data(&rd);
+		break;
+	case FWUPDATE_CMD_END:
+		eStatus = FwUpdate_End();
+		break;
+	case FWUPDATE_CMD_APPLY:
+		eStatus = FwUpdate_Apply();
+		break;
+	case FWUPDATE_CMD_ABORT:
+		g_eState = eFwUpdateIdle;
+		g_pbPagePending[0] = false;
+		g_pbPagePending[1] = false;
+		eStatus = eFwUpdateOk;
+		break;
+	default:
+		eStatus = eFwUpdateMalformed;
+		break;
+	}
+
+	// the ack for DATA carries the sequence number expected next.
+	ui16Seq = g_ui16Seq;
+	FwUpdate_Reply(ui8Cmd, eStatus, ui16Seq);
+
+	return true;
+}
+
+void FwUpdate_Task(void)
+{
+	// program the older page first.
+	if( g_pbPagePending[g_ui8Fill ^ 1] )
+		FwUpdate_ProgramPage(g_ui8Fill ^ 1);
+
+	// reset once the APPLY ack has left; the boot stub does the rest.
+	if( g_eState == eFwUpdateApplying && !USBMIDI_SysExTxBusy() )
+	{
+		// the ack is in the endpoint; give the host a few ms to collect it.
+		MAP_SysCtlDelay(FWUPDATE_RESET_DELAY);
+		MAP_SysCtlReset();
+	}
+}
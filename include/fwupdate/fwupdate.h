@@ -0,0 +1,131 @@
+/*
+ * fwupdate.h
+ *
+ * Firmware update over USB-MIDI SysEx.
+ *
+ * Flash layout (see usb_dev_midi_ccs.cmd):
+ *
+ *   0x00000 - 0x007FF  boot stub (fwboot.c). Never rewritten over USB.
+ *   0x00800 - 0x1FFFF  slot A, the running application (APP_BASE).
+ *   0x20000 - 0x3F7FF  slot B, staging area for an incoming image.
+ *   0x3F800 - 0x3FBFF  update record (one flash page).
+ *
+ * The host streams the new image (as linked for APP_BASE) into slot B. Each 1 KB
+ * page is erased and programmed from the main loop while the USB interrupt keeps
+ * receiving the next chunks into the SysEx pool. Slot A is not touched until the
+ * whole image is in slot B and its CRC-32 checks out. The update record is then
+ * marked pending and the board resets. The boot stub copies B to A, checks A's CRC
+ * and marks the record applied. If power fails during the copy, the record is
+ * still pending and the stub simply starts the copy again on the next reset.
+ *
+ * Protocol. All messages are F0 7D 46 <cmd> ... F7 (7D is the non-commercial
+ * manufacturer ID, 46 is 'F'). Multi-byte numbers are sent as 7-bit groups,
+ * least significant first.
+ *
+ *   BEGIN  01 <length: 5 bytes> <crc32: 5 bytes>
+ *   DATA   02 <seq: 2 bytes> <payload in 8-to-7 packing>
+ *   END    03
+ *   APPLY  04
+ *   ABORT  05
+ *
+ * Payload packing: every group of up to 7 bytes is sent as one byte holding
+ * their top bits (bit 0 for the first byte), followed by the bytes' low 7 bits.
+ *
+ * Every command gets a reply F0 7D 46 <7F ack | 7E nak> <cmd> <seq: 2 bytes> <status> F7.
+ * DATA is acked as soon as the chunk is in a page buffer, so the host can send
+ * the next chunk while the page is programmed.
+ *
+ *  Created on: Oct 18, 2026
+ *
+ * MODS:
+ */
+
+#ifndef FWUPDATE_FWUPDATE_H_
+#define FWUPDATE_FWUPDATE_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "usbmidi_sysex.h"
+
+/**
+ * Flash layout.
+ */
+#define FWUPDATE_PAGE_SIZE		(1024)
+#define FWUPDATE_BOOT_BASE		(0x00000000)
+#define FWUPDATE_SLOT_A_BASE	(0x00000800)
+#define FWUPDATE_SLOT_B_BASE	(0x00020000)
+#define FWUPDATE_SLOT_SIZE		(0x0001F800)
+#define FWUPDATE_RECORD_BASE	(0x0003F800)
+
+/**
+ * Protocol constants.
+ */
+#define FWUPDATE_SYSEX_ID		(0x7D)
+#define FWUPDATE_SYSEX_SUBID	(0x46)
+
+#define FWUPDATE_CMD_BEGIN		(0x01)
+#define FWUPDATE_CMD_DATA		(0x02)
+#define FWUPDATE_CMD_END		(0x03)
+#define FWUPDATE_CMD_APPLY		(0x04)
+#define FWUPDATE_CMD_ABORT		(0x05)
+#define FWUPDATE_REPLY_NAK		(0x7E)
+#define FWUPDATE_REPLY_ACK		(0x7F)
+
+/**
+ * Status byte in replies.
+ */
+typedef enum
+{
+	eFwUpdateOk = 0,
+	eFwUpdateBadState,		// command not valid now
+	eFwUpdateBadLength,		// image does not fit in a slot
+	eFwUpdateBadSequence,	// DATA chunk out of order
+	eFwUpdateOverrun,		// more data than announced
+	eFwUpdateFlashError,	// erase or program failed
+	eFwUpdateBadCrc,		// slot B does not match the announced CRC
+	eFwUpdateMalformed		// message too short or not 7-bit clean
+} tFwUpdateStatus;
+
+/**
+ * The update record. Each word is programmed once between erases.
+ */
+typedef struct
+{
+	uint32_t ui32Magic;		//!< FWUPDATE_RECORD_MAGIC once an image is announced
+	uint32_t ui32Length;	//!< image length in bytes
+	uint32_t ui32Crc;		//!< CRC-32 of the image
+	uint32_t ui32Pending;	//!< FWUPDATE_RECORD_PENDING once slot B is verified and should be copied
+	uint32_t ui32Applied;	//!< FWUPDATE_RECORD_APPLIED once slot A holds the image
+} tFwUpdateRecord;
+
+#define FWUPDATE_RECORD_MAGIC	(0x46575550)	// "FWUP"
+#define FWUPDATE_RECORD_PENDING	(0x50454E44)	// "PEND"
+#define FWUPDATE_RECORD_APPLIED	(0x41504C44)	// "APLD"
+#define FWUPDATE_RECORD_ERASED	(0xFFFFFFFF)
+
+/**
+ * CRC-32 (IEEE 802.3, reflected), as the boot stub computes it. The stub keeps
+ * its own copy in .boot, so nothing in the application calls into the stub.
+ * Start with crc = 0 and feed the result of each call into the next.
+ */
+uint32_t FwUpdate_Crc32(uint32_t crc, const uint8_t *data, uint32_t len);
+
+/**
+ * Reset the receiver. Call once at start-up.
+ */
+void FwUpdate_Init(void);
+
+/**
+ * Offer a received SysEx message to the updater.
+ * \returns true if it was a firmware update message (and has been handled).
+ */
+bool FwUpdate_SysEx(const USBMIDISysExMsg_t *msg);
+
+/**
+ * Program any page that is waiting, and reset into the boot stub after APPLY.
+ * Call from the main loop.
+ */
+void FwUpdate_Task(void);
+
+#endif /* FWUPDATE_FWUPDATE_H_ */
@@ -10,38 +10,64 @@
  *  Mods:
  *  2019-10-30 ASP: support multiple instances of a FIFO by requiring a pointer to the FIFO structure
  *  	for each function call. All FIFOs are the same size.
+ *  2026-10-18: wrap indices by mask; the size is a power of two.
+ *  2026-10-18: built on the usbmidi_ring.h ring; only PushBlock is done here.
  */
 
 #include <stdint.h>
 #include <stdbool.h>
+#include <string.h>
 #include "usb_midi.h"
 #include "usb_midi_fifo.h"
 
+#define FIFO_MASK (MIDI_USB_FIFO_SIZE - 1)
+
 /*
  * Initialize the MIDI message FIFO.
  */
 void USBMIDIFIFO_Init(USBMIDIFIFO_t *fifo)
 {
-	fifo->head = 0;
-	fifo->tail = 0;
-	fifo->count = 0;
+	USBMIDIFIFORing_Init(fifo);
 } // MIDIFIFO_Init()
 
 /**
- * Push a new message onto the FIFO.
- * @bug Do what in case of overflow?
+ * Push a new message onto the FIFO. A full FIFO drops it.
  * @param msg The MIDI message to push onto the FIFO.
  */
 void USBMIDIFIFO_Push(USBMIDIFIFO_t *fifo, USBMIDI_Message_t *msg)
 {
-	fifo->msg[fifo->head] = *msg;
-	fifo->head++;
-	if (fifo->head >= MIDI_USB_FIFO_SIZE) {
-		fifo->head = 0;
-	}
-	fifo->count++;
+	USBMIDIFIFORing_Push(fifo, msg);
 } // MIDIFIFO_Push()
 
+/**
+ * Push a block of messages onto the FIFO: the part up to the end of the buffer,
+ * then the part that wraps round to the start.
+ * @returns the number of messages pushed, which is less than n if the FIFO
+ * filled up.
+ */
+uint32_t USBMIDIFIFO_PushBlock(USBMIDIFIFO_t *fifo, const USBMIDI_Message_t *msg, uint32_t n)
+{
+	uint32_t head = fifo->head;
+	uint32_t room = MIDI_USB_FIFO_SIZE - (uint32_t) fifo->count;
+	uint32_t first;
+
+	if (n > room) {
+		n = room;
+	}
+
+	first = MIDI_USB_FIFO_SIZE - head;
+	if (first > n) {
+		first = n;
+	}
+	memcpy(&fifo->item[head], msg, first * sizeof(*msg));
+	memcpy(&fifo->item[0], msg + first, (n - first) * sizeof(*msg));
+
+	fifo->head = (head + n) & FIFO_MASK;
+	fifo->count += n;
+
+	return n;
+} // MIDIFIFO_PushBlock()
+
 /**
  * Pop a message from the USB MIDI FIFO.
  * This fetches a message that was sent from the host on an OUT endpoint.
@@ -51,16 +77,17 @@ void USBMIDIFIFO_Push(USBMIDIFIFO_t *fifo, USBMIDI_Message_t *msg)
  */
 bool USBMIDIFIFO_Pop(USBMIDIFIFO_t *fifo, USBMIDI_Message_t *msg)
 {
-	if (fifo->count == 0)
-		// nothing to pop, so caller doesn't parse any message.
-		return false;
-
-	*msg = fifo->msg[fifo->tail];
-	fifo->tail++;
-	if (fifo->tail >= MIDI_USB_FIFO_SIZE) {
-		fifo->tail = 0;
-	}
-	fifo->count--;
-
-	return true;
+	// nothing to pop if empty, so caller doesn't parse any message.
+	return USBMIDIFIFORing_Pop(fifo, msg);
 } // MIDIFIFO_Pop()
+
+/**
+ * Peek at the oldest message in the FIFO, leaving it in place.
+ * @returns true if there was a message to look at, else false if the FIFO was
+ * empty.
+ * @param msg: this is the message at the tail of the FIFO.
+ */
+bool USBMIDIFIFO_Peek(USBMIDIFIFO_t *fifo, USBMIDI_Message_t *msg)
+{
+	return USBMIDIFIFORing_Peek(fifo, msg);
+} // MIDIFIFO_Peek()
@@ -14,6 +14,10 @@
  *  Mods:
  *  2019-10-30 ASP: support multiple instances of a FIFO by requiring a pointer to the FIFO structure
  *  	for each function call. All FIFOs are the same size. The size is defined as MIDI_USB_FIFO_SIZE.
+ *  2026-10-18: MIDI_USB_FIFO_SIZE must be a power of two; indices wrap by mask and are 16 bits.
+ *  	Queues that want their own size or element type use usbmidi_ring.h, as the timing FIFO does.
+ *  2026-10-18: USBMIDIFIFO_t is a usbmidi_ring.h ring of MIDI_USB_FIFO_SIZE messages; the functions
+ *  	below keep their names and wrap it. Push no longer overwrites a full FIFO.
  */
 
 #ifndef USB_MIDI_USB_MIDI_FIFO_H_
@@ -23,20 +27,32 @@
 #include <stdbool.h>
 
 #include "usb_midi.h"
+#include "usbmidi_ring.h"
 
+/*
+ * Messages in each FIFO. Must be a power of two.
+ */
 #ifndef MIDI_USB_FIFO_SIZE
 #define MIDI_USB_FIFO_SIZE 64
 #endif
 
 /*
- * Define a software FIFO for the MIDI messages.
+ * Timing messages waiting for the head of the next IN packet. A few per
+ * millisecond at most, so this is much shorter than the message FIFOs.
+ */
+#ifndef USBMIDI_RT_FIFO_SIZE
+#define USBMIDI_RT_FIFO_SIZE 16
+#endif
+
+USBMIDI_RING_DEFINE(USBMIDIRtFifo, USBMIDI_Message_t, USBMIDI_RT_FIFO_SIZE);
+
+/*
+ * Define a software FIFO for the MIDI messages: head, tail, count and the
+ * buffer, item[].
  */
-typedef struct {
-	uint8_t head;									/*!< Index of the head of the FIFO  */
-	uint8_t tail;									/*!< Index of the tail of the FIFO  */
-	uint8_t count;									/*!< Number of messages in the FIFO */
-	USBMIDI_Message_t msg[MIDI_USB_FIFO_SIZE];		/*!< the buffer */
-} USBMIDIFIFO_t;
+USBMIDI_RING_DEFINE(USBMIDIFIFORing, USBMIDI_Message_t, MIDI_USB_FIFO_SIZE);
+
+typedef USBMIDIFIFORing_t USBMIDIFIFO_t;
 
 /**
  * Initialize the MIDI message FIFO.
@@ -47,10 +63,16 @@ void USBMIDIFIFO_Init(USBMIDIFIFO_t *fifo);
 /**
  * Push a new message onto the FIFO.
  * \param[in,out] msg: pointer to a USB MIDI message structure.
- * \bug Do what in case of overflow?
+ * A full FIFO is left as it is and the message is lost; callers check count first.
  */
 void USBMIDIFIFO_Push(USBMIDIFIFO_t *fifo, USBMIDI_Message_t *msg);
 
+/**
+ * Push as many of n messages as there is room for, in at most two copies.
+ * \returns the number of messages pushed.
+ */
+uint32_t USBMIDIFIFO_PushBlock(USBMIDIFIFO_t *fifo, const USBMIDI_Message_t *msg, uint32_t n);
+
 /**
  * Pop a message from the MIDI Message FIFO.
  * \returns true if we actually popped something, else false if the FIFO was
@@ -59,4 +81,11 @@ void USBMIDIFIFO_Push(USBMIDIFIFO_t *fifo, USBMIDI_Message_t *msg);
  */
 bool USBMIDIFIFO_Pop(USBMIDIFIFO_t *fifo, USBMIDI_Message_t *msg);
 
+/**
+ * Look at the message at the tail of the FIFO without removing it.
+ * \returns true if there was a message, else false if the FIFO was empty.
+ * \param[in,out] msg: The message is returned in the argument.
+ */
+bool USBMIDIFIFO_Peek(USBMIDIFIFO_t *fifo, USBMIDI_Message_t *msg);
+
 #endif /* USB_MIDI_USB_MIDI_FIFO_H_ */
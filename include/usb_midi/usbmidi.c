@@ -58,11 +58,16 @@
 
 #include <stdbool.h>
 #include <stdint.h>
+#include <string.h>
 #include <usbmidi_types.h>
 
+#include "inc/hw_ints.h"
 #include "inc/hw_memmap.h"
+#include "inc/hw_nvic.h"
 #include "inc/hw_types.h"
 #include "driverlib/debug.h"
+#include "driverlib/interrupt.h"
+#include "driverlib/sysctl.h"
 #include "driverlib/rom.h"
 #include "driverlib/rom_map.h"
 #include "driverlib/usb.h"
@@ -72,10 +77,18 @@
 #include "usblib/usbaudio.h"
 #include "usblib/device/usbdevice.h"
 
+#include "midi.h"
 #include "usbmidi.h"
 #include "usbmidi_types.h"
 #include "usbmidi_descriptors.h"
 #include "usbmidi_handlers.h"
+#include "usbmidi_timestamp.h"
+#include "usbmidi_critical.h"
+#include "usbmidi_budget.h"
+
+// a FIFO that cannot take a whole OUT packet drops from every full one.
+USBMIDI_STATIC_ASSERT(OutEpMsgFifo, MIDI_USB_FIFO_SIZE >= USBMIDI_MAX_PACKET_SIZE / 4);
+USBMIDI_STATIC_ASSERT(OutEpUmpFifo, USBMIDI_UMP_FIFO_WORDS >= USBMIDI_MAX_PACKET_SIZE / 4);
 
 /**
  * Device Descriptor.
@@ -126,7 +139,7 @@ const uint8_t g_pui8AudioMIDIDeviceDescriptor[] =
 /**
  * Configuration Descriptor Header.
  */
-#define USBMIDI_INTERFACEDESCRIPTOR_SIZE (129)
+#define USBMIDI_INTERFACEDESCRIPTOR_SIZE (169)
 //#define USBMIDI_INTERFACEDESCRIPTOR_SIZE (137)
 
 const uint8_t g_pui8MidiDescriptor[] =
@@ -137,7 +150,7 @@ const uint8_t g_pui8MidiDescriptor[] =
     2,                         // bNumInterfaces:  # of interfaces, Audio Control and MIDI Streaming
     1,                         // bConfigurationValue: this is config #1
     5,                         // iConfiguration:  index to descriptive string
-    USB_CONF_ATTR_SELF_PWR,    // bmAttrib:        Self-powered
+    USB_CONF_ATTR_SELF_PWR | USB_CONF_ATTR_RWAKE,	// bmAttrib:        Self-powered, can wake the host
     50                         // bMaxPower:       100 mA from the bus
 };
 
@@ -339,6 +352,91 @@ const uint8_t g_pui8MidiStreamInterface[] =
 	JACK5_EMBIN                      // baAssocJackID 2													121
 };
 
+/*****
+ * Alternate setting 1 of the MIDI streaming interface: USB MIDI 2.0, carrying
+ * Universal MIDI Packets on the same endpoints. Hosts that do not know MIDI 2.0
+ * stay on alternate setting 0. There are no jacks; the endpoints name Group
+ * Terminal Block 1 instead, which the host fetches separately.
+ */
+const uint8_t g_pui8MidiStreamInterfaceUmp[] =
+{
+    // Standard Interface descriptor for a MIDI streaming interface
+    9,                         // bDescriptorSize
+    USB_DTYPE_INTERFACE,       // bDescriptorType
+    1,                         // bInterfaceNumber, MIDI streaming is #1
+    USBMIDI_ALT_UMP,           // bAlternateSetting, USB MIDI 2.0
+    2,                         // bNumEndpoints, the same two
+    USB_CLASS_AUDIO,           // bInteraceClass, Audio Class
+    USB_ASC_MIDI_STREAMING,    // bInterfaceSubClass
+    0,                         // bInterfaceProtocol, none
+    0,                         // iInterface, no string
+
+    // Class-specific descriptor for the MIDI streaming interface.
+    USB_MIDI_CS_MS_IF_DESC_SIZE,   // bLength, size of this class-specific interface descriptor header
+    USB_DTYPE_CS_INTERFACE,        // bDescriptorType: Class-specific interface descriptor
+    MIDI_CS_IF_HEADER,             // bDescriptorSubType
+    USBShort(0x0200),              // bcdMSC, USB MIDI 2.0
+    USBShort(USB_MIDI_CS_MS_IF_DESC_SIZE), // wTotalLength, just this header
+
+	// In Endpoint 1 Standard descriptor
+	7,                            // bLength, endpoint descriptors are 7 bytes
+	USB_DTYPE_ENDPOINT,           // bDescriptorSubType, this is a standard endpoint descriptor
+	USB_EP_DESC_IN | USBMIDI_MS_EP_IN,  // bEndpointAddress is IN Endpoint 1
+	USB_EP_ATTR_BULK,             // bmAttributes, this is a bulk endpoint
+	USBShort(64),                 // wMaxPacketSize, 64 is max for full speed bulk endpoint
+	0,                            // bInterval, must be 0 for bulk endpoint
+
+	// Class-specific IN Endpoint descriptor
+	USB_MIDI2_CS_STREAMING_BULK_ENDPOINT_SIZE(1),  // bLength
+	USB_CS_ENDPOINT_DESCRIPTOR,       // bDescriptorType
+	USB_MIDI_CS_EP_MS_GENERAL_2_0,    // bDescriptorSubType
+	1,                                // bNumGrpTrmBlock
+	USBMIDI_GTB_ID,                   // baAssoGrpTrmBlkID
+
+	// Out Endpoint 1 standard descriptor
+	7,                               // bLength
+	USB_DTYPE_ENDPOINT,              // bDescriptorType, it's an endpoint
+	USB_EP_DESC_OUT | USBMIDI_MS_EP_OUT,    // bEndpointAddress, OUT EP 1
+	USB_EP_ATTR_BULK,                // bmAttributes, bulk endpoint
+	USBShort(64),                    // wMaxPacketSize, 64 is max for full speed bulk endpoint
+	0,                               // bInterval, must be 0 for bulk endpoint
+
+	// Class-specific OUT endpoint descriptor
+	USB_MIDI2_CS_STREAMING_BULK_ENDPOINT_SIZE(1),  // bLength
+	USB_CS_ENDPOINT_DESCRIPTOR,       // bDescriptorType
+	USB_MIDI_CS_EP_MS_GENERAL_2_0,    // bDescriptorSubType
+	1,                                // bNumGrpTrmBlock
+	USBMIDI_GTB_ID                    // baAssoGrpTrmBlkID
+};
+
+/**
+ * Group Terminal Blocks for alternate setting 1. Not part of the configuration
+ * descriptor: HandleGetDescriptor() sends them when asked. One bidirectional
+ * block covers groups 1 and 2, the two cables of alternate setting 0, and
+ * speaks the MIDI 2.0 Protocol.
+ */
+const uint8_t g_pui8MidiGroupTerminalBlocks[USBMIDI_GTB_DESC_SIZE] =
+{
+	// Group Terminal Block header
+	5,                            // bLength
+	USB_DTYPE_CS_GR_TRM_BLOCK,    // bDescriptorType
+	MIDI_GR_TRM_BLOCK_HEADER,     // bDescriptorSubtype
+	USBShort(USBMIDI_GTB_DESC_SIZE),	// wTotalLength, the header and all blocks
+
+	// Group Terminal Block 1
+	13,                           // bLength
+	USB_DTYPE_CS_GR_TRM_BLOCK,    // bDescriptorType
+	MIDI_GR_TRM_BLOCK,            // bDescriptorSubtype
+	USBMIDI_GTB_ID,               // bGrpTrmBlkID
+	MIDI_GR_TRM_BIDIRECTIONAL,    // bGrpTrmBlkType
+	0,                            // nGroupTrm, first group
+	2,                            // nNumGroupTrm, two groups
+	0,                            // iBlockItem, no string
+	MIDI_GR_TRM_PROTOCOL_MIDI2,   // bMIDIProtocol
+	USBShort(0),                  // wMaxInputBandwidth, unknown
+	USBShort(0)                   // wMaxOutputBandwidth, unknown
+};
+
 /**
  * The MIDI device configuration descriptor is defined as three sections.
  * One contains the 9 byte USB configuration descriptor.
@@ -358,6 +456,15 @@ const tConfigSection g_sMidiStreamInterfaceSection =
 	.pui8Data = g_pui8MidiStreamInterface
 };
 
+/**
+ * Then its USB MIDI 2.0 alternate setting.
+ */
+const tConfigSection g_sMidiStreamInterfaceUmpSection =
+{
+	.ui16Size = sizeof(g_pui8MidiStreamInterfaceUmp),
+	.pui8Data = g_pui8MidiStreamInterfaceUmp
+};
+
 /**
  * the third holds the audio control interface.
  */
@@ -376,7 +483,8 @@ const tConfigSection *g_psMidiSections[] =
 	&g_sMidiConfigSection,
 //	&g_sIADMidiConfigSection,
 	&g_sAudioMidiControlInterfaceSection,
-	&g_sMidiStreamInterfaceSection
+	&g_sMidiStreamInterfaceSection,
+	&g_sMidiStreamInterfaceUmpSection
 };
 
 #define NUM_MIDI_SECTIONS (sizeof(g_psMidiSections) / sizeof(g_psMidiSections[0]))
@@ -477,13 +585,13 @@ const uint8_t *const stringDescriptors[] =
  */
 static const tCustomHandlers MidiHandlers =
 {
-	.pfnGetDescriptor     = 0,						// We only deal with standard descriptors
-	.pfnRequestHandler    = HandleRequests,			// There are no EP0 requests in this class
-	.pfnInterfaceChange   = 0,						// We have no alternate interfaces
+	.pfnGetDescriptor     = HandleGetDescriptor,	// USB MIDI 2.0 Group Terminal Blocks
+	.pfnRequestHandler    = HandleRequests,			// Our vendor requests; class requests are stalled
+	.pfnInterfaceChange   = HandleInterfaceChange,	// MIDI 1.0 or MIDI 2.0 alternate setting
 	.pfnConfigChange      = HandleConfigChange,		// Check for the selected configuration, indicate connected
-	.pfnDataReceived      = 0, 						// We do not handle data for EP0
+	.pfnDataReceived      = 0,						// We do not handle data for EP0
 	.pfnDataSent          = 0,						// We do not handle data for EP0
-	.pfnResetHandler      = 0,						// We do not need to handle bus reset (now)
+	.pfnResetHandler      = HandleReset,			// Hold outgoing messages until reconfigured
 	.pfnSuspendHandler    = HandleSuspend,			// Handle USB suspension
 	.pfnResumeHandler     = HandleResume,			// Handle USB resume
 	.pfnDisconnectHandler = HandleDisconnect,		// Indicate no longer connected to bus
@@ -519,14 +627,148 @@ static tUSBMidiDevice g_sUsbMidiDevice;
  */
 void USBMIDI_Init(uint32_t index)
 {
+	uint8_t i;
+
+	memset(&g_sUsbMidiDevice.sStats, 0, sizeof(g_sUsbMidiDevice.sStats));
 	USBMIDIFIFO_Init(&g_sUsbMidiDevice.InEpMsgFifo);
+	USBMIDIRtFifo_Init(&g_sUsbMidiDevice.InEpRtFifo);
 	USBMIDIFIFO_Init(&g_sUsbMidiDevice.OutEpMsgFifo);
+	USBMIDISysEx_Init(&g_sUsbMidiDevice.OutEpSysEx);
+	USBMIDIReplay_Init(&g_sUsbMidiDevice.InEpReplay);
+	USBMIDINotes_Init(&g_sUsbMidiDevice.InEpNotes);
+	USBMIDINotes_Init(&g_sUsbMidiDevice.OutEpNotes);
+	USBMIDIClockIn_Init(&g_sUsbMidiDevice.OutEpClock, MAP_SysCtlClockGet());
+	USBMIDIMtcIn_Init(&g_sUsbMidiDevice.OutEpMtc, MAP_SysCtlClockGet());
+	USBMIDIParamDec_Init(&g_sUsbMidiDevice.OutEpParam);
+	for( i = 0; i < USBMIDI_PARAM_NUM_CABLES; i++ )
+		USBMIDIParamEnc_Init(&g_sUsbMidiDevice.InEpParam[i], i);
+	USBMIDIUmpFifo_Init(&g_sUsbMidiDevice.InEpUmpFifo);
+	USBMIDIUmpFifo_Init(&g_sUsbMidiDevice.OutEpUmpFifo);
+	USBMIDIUmp_XlateInit(&g_sUsbMidiDevice.InEpUmpDown);
+	USBMIDILoopback_Init(&g_sUsbMidiDevice.InEpLoopback);
+	USBMIDI_TimestampInit();
+
+	// BASEPRI only holds the USB interrupt off once it is below 0x00.
+	MAP_IntPrioritySet(INT_USB0, USBMIDI_INT_PRIORITY);
 
 	USBDCDInit(index, 				// index of USB hardware (not base address)
 			&USBMIDIDeviceInfo, 	// tDeviceInfo
 			&g_sUsbMidiDevice);		// "callback data for any device callbacks."
 }
 
+/*
+ * When the outermost critical section started, and whether it is timed.
+ */
+static uint32_t g_ui32CriticalStart;
+static bool g_bCriticalTimed;
+
+/*
+ * True if the code running is below USBMIDI_INT_PRIORITY, so a section it
+ * opens holds the USB interrupt off: the main loop (no active exception), or
+ * an interrupt of lower priority. Reset, NMI and hard fault (1-3) have fixed
+ * priorities above every configurable one.
+ */
+static bool BelowStackPriority(void)
+{
+	uint32_t active = HWREG(NVIC_INT_CTRL) & NVIC_INT_CTRL_VEC_ACT_M;
+
+	if( active == 0 )
+		return true;
+	if( active < 4 )
+		return false;
+	return (uint32_t) MAP_IntPriorityGet(active) > USBMIDI_INT_PRIORITY;
+}
+
+/**
+ * Critical sections for code below USBMIDI_INT_PRIORITY that shares state
+ * with the USB interrupt; see usbmidi_critical.h. A mask already at or above
+ * USBMIDI_INT_PRIORITY is left alone. The outermost section is timed when it
+ * is entered from below USBMIDI_INT_PRIORITY; from the stack's own interrupts
+ * it holds nothing off. The start time needs no protection of its own:
+ * nothing that enters a section can run while one is open.
+ */
+uint32_t USBMIDI_CriticalEnter(void)
+{
+	uint32_t mask;
+	bool wasDisabled;
+
+	mask = MAP_IntPriorityMaskGet();
+	if( (mask == 0) || (mask > USBMIDI_INT_PRIORITY) )
+	{
+		// Cortex-M4 r0p1 erratum 837070: a raised BASEPRI can let one more
+		// interrupt in after the write, unless PRIMASK covers it.
+		wasDisabled = MAP_IntMasterDisable();
+		MAP_IntPriorityMaskSet(USBMIDI_INT_PRIORITY);
+		if( !wasDisabled )
+			MAP_IntMasterEnable();
+
+		g_bCriticalTimed = BelowStackPriority();
+		if( g_bCriticalTimed )
+			g_ui32CriticalStart = USBMIDI_Timestamp();
+	}
+	return mask;
+}
+
+void USBMIDI_CriticalExit(uint32_t mask)
+{
+	uint32_t cycles;
+
+	if( ((mask == 0) || (mask > USBMIDI_INT_PRIORITY)) && g_bCriticalTimed )
+	{
+		cycles = USBMIDI_Timestamp() - g_ui32CriticalStart;
+		g_sUsbMidiDevice.sStats.maskedSections++;
+		if( cycles > g_sUsbMidiDevice.sStats.maskedCyclesMax )
+			g_sUsbMidiDevice.sStats.maskedCyclesMax = cycles;
+	}
+	MAP_IntPriorityMaskSet(mask);
+}
+
+/*
+ * Start a remote wakeup if something is waiting to go out and the bus has been
+ * suspended long enough (USB 2.0 7.1.7.7). usblib refuses if the host has not
+ * enabled remote wakeup; the request is then retried on every tick, and the
+ * queued messages go out whenever the host resumes the bus by itself.
+ */
+static void RemoteWakeup(void)
+{
+	tUSBMidiInstance *psInst = &g_sUsbMidiDevice.sPrivateData;
+
+	if( psInst->bSuspended && psInst->bWakePending &&
+			(psInst->ui32SuspendedMs >= USBMIDI_REMOTE_WAKE_DELAY_MS) )
+	{
+		if( USBDCDRemoteWakeupRequest(0) )
+		{
+			psInst->bWakePending = false;
+			g_sUsbMidiDevice.sStats.remoteWakeups++;
+		}
+	}
+}
+
+/*
+ * Send the IN FIFO now if the endpoint is idle. While the bus is suspended,
+ * ask the host to wake up instead.
+ * Interrupts are masked around both: a timer interrupt writing timing messages
+ * kicks the endpoint too, and only one caller may load it; SysTick requests the
+ * wakeup from USBMIDI_Tick(), and only one caller may count it.
+ */
+static void InEpKick(void)
+{
+	tUSBMidiInstance *psInst = &g_sUsbMidiDevice.sPrivateData;
+	uint32_t mask;
+
+	mask = USBMIDI_CriticalEnter();
+	if( psInst->bSuspended )
+	{
+		psInst->bWakePending = true;
+		RemoteWakeup();
+	}
+	else if( psInst->iUSBMidiTxState == eUsbMidiStateIdle )
+	{
+		USBMIDI_InEpSendMessages();
+	}
+	USBMIDI_CriticalExit(mask);
+}
+
 /**
  * Return true if the USB device is connected to the bus.
  */
@@ -535,6 +777,30 @@ bool USBMIDI_IsConnected(void)
 	return g_sUsbMidiDevice.sPrivateData.bConnected;
 }
 
+/**
+ * Return true while the host has the bus suspended.
+ */
+bool USBMIDI_IsSuspended(void)
+{
+	return g_sUsbMidiDevice.sPrivateData.bSuspended;
+}
+
+/**
+ * Time base for remote wakeup. Call from a periodic interrupt that keeps
+ * running while the CPU sleeps, such as SysTick.
+ */
+void USBMIDI_Tick(uint32_t ui32TimemS)
+{
+	tUSBMidiInstance *psInst = &g_sUsbMidiDevice.sPrivateData;
+
+	g_sUsbMidiDevice.sStats.ms += ui32TimemS;
+	if( psInst->bSuspended )
+	{
+		psInst->ui32SuspendedMs += ui32TimemS;
+		RemoteWakeup();
+	}
+}
+
 /**
  * Functions to access the message FIFOs.
  *
@@ -543,56 +809,665 @@ bool USBMIDI_IsConnected(void)
  */
 bool USBMIDI_OutEpFIFO_Pop(USBMIDI_Message_t *msg)
 {
-	return USBMIDIFIFO_Pop(&g_sUsbMidiDevice.OutEpMsgFifo, msg);
+	uint32_t mask;
+	bool popped;
+
+	// the USB interrupt pushes what the host sends.
+	mask = USBMIDI_CriticalEnter();
+	popped = USBMIDIFIFO_Pop(&g_sUsbMidiDevice.OutEpMsgFifo, msg);
+	USBMIDI_CriticalExit(mask);
+	return popped;
+}
+
+/**
+ * Register the SysEx completion callback.
+ */
+void USBMIDI_SysExCallbackSet(tUSBMIDISysExCallback callback)
+{
+	g_sUsbMidiDevice.pfnSysExCallback = callback;
+}
+
+/**
+ * Hand completed SysEx messages to the application and recycle their pool blocks.
+ */
+void USBMIDI_SysExTask(void)
+{
+	USBMIDISysEx_Dispatch(&g_sUsbMidiDevice.OutEpSysEx, g_sUsbMidiDevice.pfnSysExCallback);
+}
+
+/**
+ * Start sending a SysEx message straight from the caller's buffer.
+ * If the endpoint is idle, kick it; otherwise the fragments go out as each
+ * IN transaction completes.
+ */
+bool USBMIDI_SendSysEx(uint8_t cable, const uint8_t *data, uint32_t len)
+{
+	if( !g_sUsbMidiDevice.sPrivateData.bConnected )
+		return false;
+
+	if( !USBMIDISysEx_TxStart(&g_sUsbMidiDevice.InEpSysEx, cable, data, len) )
+		return false;
+
+	InEpKick();
+	return true;
+}
+
+/**
+ * Register the SysEx transmit completion callback.
+ */
+void USBMIDI_SysExTxCallbackSet(tUSBMIDISysExTxCallback callback)
+{
+	g_sUsbMidiDevice.InEpSysEx.pfnDone = callback;
+}
+
+bool USBMIDI_SysExTxBusy(void)
+{
+	return g_sUsbMidiDevice.InEpSysEx.busy;
+}
+
+/**
+ * Return the SysEx pool counters.
+ */
+void USBMIDI_SysExStatsGet(USBMIDISysExStats_t *stats)
+{
+	USBMIDISysEx_GetStats(&g_sUsbMidiDevice.OutEpSysEx, stats);
+}
+
+/*
+ * Reply to the last loopback command. USBMIDI_SendSysEx() sends straight out of it.
+ */
+static uint8_t g_pui8LoopbackReply[USBMIDI_LOOPBACK_REPORT_SIZE];
+
+/**
+ * Carry out a loopback command from the host and reply to it. The echoes and
+ * histograms are kept by the USB interrupt, so they are changed, or copied for
+ * the report, with interrupts masked. If the reply to an earlier command is
+ * still going out, this one gets none; the host retries.
+ */
+bool USBMIDI_LoopbackSysEx(const USBMIDISysExMsg_t *msg)
+{
+	USBMIDILoopback_t *lb = &g_sUsbMidiDevice.InEpLoopback;
+	USBMIDILoopbackReport_t report;
+	USBMIDISysExReader_t rd;
+	uint32_t len;
+	uint8_t b;
+	uint8_t cmd;
+	bool ok;
+	uint32_t mask;
+
+	// F0 7D 4C <cmd>
+	USBMIDISysEx_ReaderInit(&rd, msg);
+	USBMIDISysEx_ReadByte(&rd, &b);
+	if( !USBMIDISysEx_ReadByte(&rd, &b) || b != USBMIDI_LOOPBACK_SYSEX_ID )
+		return false;
+	if( !USBMIDISysEx_ReadByte(&rd, &b) || b != USBMIDI_LOOPBACK_SYSEX_SUBID )
+		return false;
+	if( !USBMIDISysEx_ReadByte(&rd, &cmd) )
+		return false;
+
+	mask = USBMIDI_CriticalEnter();
+	ok = USBMIDILoopback_Command(lb, cmd);
+	report = lb->report;
+	USBMIDI_CriticalExit(mask);
+
+	if( ok && !USBMIDI_SysExTxBusy() )
+	{
+		len = USBMIDILoopback_Reply(&report, cmd, MAP_SysCtlClockGet(), g_pui8LoopbackReply);
+		USBMIDI_SendSysEx(USBMIDI_LOOPBACK_CABLE, g_pui8LoopbackReply, len);
+	}
+	return true;
+}
+
+/**
+ * Copy the loopback counters and histograms.
+ */
+void USBMIDI_LoopbackReportGet(USBMIDILoopbackReport_t *report)
+{
+	uint32_t mask;
+
+	mask = USBMIDI_CriticalEnter();
+	*report = g_sUsbMidiDevice.InEpLoopback.report;
+	USBMIDI_CriticalExit(mask);
+}
+
+/**
+ * Copy the stack's counters, with the FIFO depths and SysEx pool usage as they
+ * are now. The USB interrupt writes most of them, so the copy is taken with
+ * interrupts masked.
+ */
+void USBMIDI_StatsGet(USBMIDIStats_t *stats)
+{
+	USBMIDISysExStats_t sx;
+	uint32_t mask;
+
+	mask = USBMIDI_CriticalEnter();
+	*stats = g_sUsbMidiDevice.sStats;
+	stats->inMsg.depth = g_sUsbMidiDevice.InEpMsgFifo.count;
+	stats->inRt.depth = g_sUsbMidiDevice.InEpRtFifo.count;
+	stats->inUmp.depth = g_sUsbMidiDevice.InEpUmpFifo.count;
+	stats->outMsg.depth = g_sUsbMidiDevice.OutEpMsgFifo.count;
+	stats->outUmp.depth = g_sUsbMidiDevice.OutEpUmpFifo.count;
+	stats->outParam.depth = g_sUsbMidiDevice.OutEpParam.fifo.count;
+	stats->outParam.drops = g_sUsbMidiDevice.OutEpParam.overflows;
+	USBMIDISysEx_GetStats(&g_sUsbMidiDevice.OutEpSysEx, &sx);
+	USBMIDI_CriticalExit(mask);
+
+	stats->sysExBlocksInUse = sx.blocksInUse;
+	stats->sysExBlocksHighWater = sx.blocksHighWater;
+	stats->sysExMessages = sx.messages;
+	stats->sysExPoolExhausted = sx.poolExhausted;
+	stats->sysExQueueFull = sx.queueFull;
+	stats->sysExAborted = sx.aborted;
+}
+
+/*
+ * Reply to the last statistics query. USBMIDI_SendSysEx() sends straight out of it.
+ */
+static uint8_t g_pui8StatsReply[USBMIDI_STATS_REPLY_SIZE];
+
+/**
+ * Answer a statistics query (see usbmidi_stats.h). The copy is taken when the
+ * query is handled, not when it arrived. If a reply is still going out, this
+ * query gets none; the host retries.
+ * Returns true if the message was the query.
+ */
+bool USBMIDI_StatsSysEx(const USBMIDISysExMsg_t *msg)
+{
+	USBMIDIStats_t stats;
+	USBMIDISysExReader_t rd;
+	uint32_t len;
+	uint8_t b;
+	uint8_t id;
+	uint8_t subId;
+	uint8_t cmd;
+
+	// F0 7D 53 01
+	USBMIDISysEx_ReaderInit(&rd, msg);
+	USBMIDISysEx_ReadByte(&rd, &b);
+	if( !USBMIDISysEx_ReadByte(&rd, &id) || !USBMIDISysEx_ReadByte(&rd, &subId) ||
+			!USBMIDISysEx_ReadByte(&rd, &cmd) )
+		return false;
+	if( !USBMIDIStats_IsQuery(id, subId, cmd) )
+		return false;
+
+	if( !USBMIDI_SysExTxBusy() )
+	{
+		USBMIDI_StatsGet(&stats);
+		len = USBMIDIStats_Reply(&stats, g_pui8StatsReply);
+		USBMIDI_SendSysEx(msg->cable, g_pui8StatsReply, len);
+	}
+	return true;
+}
+
+/**
+ * Turn reconnect-aware mode on or off. While on, messages written when the device
+ * is not configured are held and replayed after the next configuration, and the
+ * FIFOs keep their contents across a bus reset. Note Ons (and timing messages)
+ * held longer than ui32MaxAgeMs are dropped on replay; Note Offs never are.
+ * The age is counted by USBMIDI_Tick(), so any limit up to 49 days works.
+ */
+void USBMIDI_ReplayModeSet(bool bEnable, uint32_t ui32MaxAgeMs)
+{
+	USBMIDIReplay_t *rp = &g_sUsbMidiDevice.InEpReplay;
+	uint32_t mask;
+
+	mask = USBMIDI_CriticalEnter();
+	rp->maxAge = ui32MaxAgeMs;
+	rp->enabled = bEnable;
+	if( !bEnable )
+		rp->count = 0;
+	USBMIDI_CriticalExit(mask);
+}
+
+/**
+ * Return the replay buffer counters.
+ */
+void USBMIDI_ReplayStatsGet(USBMIDIReplayStats_t *stats)
+{
+	USBMIDIReplay_GetStats(&g_sUsbMidiDevice.InEpReplay, stats);
+}
+
+/**
+ * Turn off every note that is on, in both directions, with one Note Off each.
+ * Notes we have on at the host get Note Offs through the IN FIFO; notes the
+ * host has on at us get Note Offs pushed onto the OUT FIFO, as if the host had
+ * sent them, so whatever plays them downstream is silenced too.
+ * If a FIFO fills up, the remaining notes stay marked; call again to finish.
+ */
+void USBMIDI_Panic(void)
+{
+	uint32_t mask;
+
+	// the USB interrupt pushes onto the OUT FIFO and pops the IN FIFO.
+	mask = USBMIDI_CriticalEnter();
+	if( g_sUsbMidiDevice.sPrivateData.bConnected )
+		USBMIDINotes_AllOff(&g_sUsbMidiDevice.InEpNotes, &g_sUsbMidiDevice.InEpMsgFifo);
+	USBMIDINotes_AllOff(&g_sUsbMidiDevice.OutEpNotes, &g_sUsbMidiDevice.OutEpMsgFifo);
+	USBMIDI_CriticalExit(mask);
+
+	if( g_sUsbMidiDevice.sPrivateData.bConnected )
+		InEpKick();
+}
+
+/**
+ * Get the tempo, next tick prediction and transport state of the host's clock.
+ * next is in USBMIDI_Timestamp() cycles.
+ */
+void USBMIDI_ClockInGet(USBMIDIClockInState_t *state)
+{
+	uint32_t mask;
+
+	// the USB interrupt feeds the follower.
+	mask = USBMIDI_CriticalEnter();
+	USBMIDIClockIn_Get(&g_sUsbMidiDevice.OutEpClock, state, USBMIDI_Timestamp());
+	USBMIDI_CriticalExit(mask);
+}
+
+/**
+ * Return the clock follower counters.
+ */
+void USBMIDI_ClockInStatsGet(USBMIDIClockInStats_t *stats)
+{
+	USBMIDIClockIn_GetStats(&g_sUsbMidiDevice.OutEpClock, stats);
+}
+
+/**
+ * Get the host's MIDI Time Code position, interpolated to now.
+ */
+void USBMIDI_MtcInGet(USBMIDIMtcInState_t *state)
+{
+	uint32_t mask;
+
+	// the USB interrupt feeds the decoder.
+	mask = USBMIDI_CriticalEnter();
+	USBMIDIMtcIn_Get(&g_sUsbMidiDevice.OutEpMtc, state, USBMIDI_Timestamp());
+	USBMIDI_CriticalExit(mask);
+}
+
+/**
+ * Return the MTC decoder counters.
+ */
+void USBMIDI_MtcInStatsGet(USBMIDIMtcInStats_t *stats)
+{
+	USBMIDIMtcIn_GetStats(&g_sUsbMidiDevice.OutEpMtc, stats);
+}
+
+/**
+ * Time an input event through to the host. Call right after writing the
+ * message(s) for an event, with the timestamp of the event. The cycles until
+ * the IN packet carrying it has been collected are recorded (last and worst
+ * case) and reported by the vendor GET_STATS request. Only one event is timed
+ * at a time; probes while one is outstanding are ignored.
+ */
+void USBMIDI_LatencyProbe(uint32_t ui32Time)
+{
+	tUSBMidiInstance *psInst = &g_sUsbMidiDevice.sPrivateData;
+	uint32_t mask;
+
+	if( !psInst->bConnected || psInst->iProbeState != eUsbMidiProbeIdle )
+		return;
+
+	mask = USBMIDI_CriticalEnter();
+	psInst->ui32ProbeTime = ui32Time;
+	// USBMIDI_InEpMsgWrite() may have loaded the message into the endpoint already.
+	if( (g_sUsbMidiDevice.InEpMsgFifo.count == 0) && (psInst->iUSBMidiTxState == eUsbMidiStateWaitData) )
+		psInst->iProbeState = eUsbMidiProbeInFlight;
+	else
+		psInst->iProbeState = eUsbMidiProbeArmed;
+	USBMIDI_CriticalExit(mask);
 }
 
 /**
  * Write a new outgoing message back to the host over the IN endpoint, if the USB
- * device is actually connected. Otherwise, just drop the message on the floor.
+ * device is actually connected. Otherwise, hold it in the replay buffer if
+ * reconnect-aware mode is on, or just drop the message on the floor.
  *
  * This writes the message to the outgoing (IN endpoint) FIFO.
  *
  * After pushing the byte to the FIFO, check to see if the endpoint is busy sending
- * a previous USB packet. If it is not, then "prime the pump."
+ * a previous USB packet. If it is not, then "prime the pump." If the bus is
+ * suspended, the message waits in the FIFO and a remote wakeup is requested.
  *
  */
 void USBMIDI_InEpMsgWrite(USBMIDI_Message_t *msg)
 {
-	if( g_sUsbMidiDevice.sPrivateData.bConnected )
+	uint32_t mask;
+	bool connected;
+
+	// the USB interrupt pops the IN FIFO, drains the replay buffer and clears
+	// the note map, as USBMIDI_InEpBatchWrite() masks for.
+	mask = USBMIDI_CriticalEnter();
+	connected = g_sUsbMidiDevice.sPrivateData.bConnected;
+	if( connected )
 	{
-		USBMIDIFIFO_Push(&g_sUsbMidiDevice.InEpMsgFifo, msg);
-		if( g_sUsbMidiDevice.sPrivateData.iUSBMidiTxState == eUsbMidiStateIdle )
+		if( g_sUsbMidiDevice.InEpMsgFifo.count < MIDI_USB_FIFO_SIZE )
+		{
+			USBMIDIFIFO_Push(&g_sUsbMidiDevice.InEpMsgFifo, msg);
+			USBMIDINotes_Track(&g_sUsbMidiDevice.InEpNotes, msg);
+			USBMIDIStats_Depth(&g_sUsbMidiDevice.sStats.inMsg, g_sUsbMidiDevice.InEpMsgFifo.count);
+		}
+		else
 		{
-			USBMIDI_InEpSendMessages();
+			// a lost Note Off leaves its note marked on, for USBMIDI_Panic().
+			g_sUsbMidiDevice.sStats.inMsg.drops++;
 		}
 	}
+	else if( g_sUsbMidiDevice.InEpReplay.enabled )
+	{
+		USBMIDIReplay_Push(&g_sUsbMidiDevice.InEpReplay, msg, g_sUsbMidiDevice.sStats.ms);
+		USBMIDINotes_Track(&g_sUsbMidiDevice.InEpNotes, msg);
+	}
+	USBMIDI_CriticalExit(mask);
+
+	if( connected )
+		InEpKick();
 }
 
 /**
- * Check to see if transmit (IN endpoint) message FIFO has things to send.
- * If it does, repeatedly pop the FIFO and write the message bytes into
- * a buffer which then gets loaded into the endpoint buffer and transmitted.
+ * Send a batch of messages to the host: the same as USBMIDI_InEpMsgWrite() on each
+ * in turn, but with interrupts masked once around the lot, one block copy into
+ * the IN FIFO and one endpoint kick at the end.
  *
- * This is called either by USBMIDI_InEpMsgWrite() after a new message is pushed
- * onto the IN endpoint transmit FIFO, or by the EndpointHandler callback after
- * a previous USB packet has finished transmitting.
+ * Masking makes this safe to call from an interrupt at the USB interrupt's
+ * priority as well as from the main loop, each with its own batch.
  *
- * USB Packet size is 64 bytes and there are 4 bytes per message, so we can
- * put a maximum of 16 messages in one packet. I will eventually change from
- * the magic number 16 to a constant.
+ * Messages that do not fit in the IN FIFO stay in the batch, moved to its start,
+ * for the caller to send again once the endpoint has taken some; they are not
+ * counted as overflows. Returns the number of messages taken, including any
+ * held for replay or dropped because the bus is down.
  */
-void USBMIDI_InEpSendMessages(void)
+uint32_t USBMIDI_InEpBatchWrite(USBMIDIBatch_t *batch)
+{
+	tUSBMidiInstance *psInst = &g_sUsbMidiDevice.sPrivateData;
+	uint32_t taken;
+	uint32_t i;
+	bool connected;
+	uint32_t mask;
+
+	taken = batch->count;
+	if( taken == 0 )
+		return 0;
+
+	mask = USBMIDI_CriticalEnter();
+	connected = psInst->bConnected;
+	if( connected )
+	{
+		taken = USBMIDIFIFO_PushBlock(&g_sUsbMidiDevice.InEpMsgFifo, batch->msg, taken);
+		USBMIDIStats_Depth(&g_sUsbMidiDevice.sStats.inMsg, g_sUsbMidiDevice.InEpMsgFifo.count);
+	}
+	else if( g_sUsbMidiDevice.InEpReplay.enabled )
+	{
+		for( i = 0; i < taken; i++ )
+			USBMIDIReplay_Push(&g_sUsbMidiDevice.InEpReplay, &batch->msg[i], g_sUsbMidiDevice.sStats.ms);
+	}
+	else
+	{
+		// dropped, and not tracked, as USBMIDI_InEpMsgWrite() does.
+		batch->count = 0;
+		USBMIDI_CriticalExit(mask);
+		return taken;
+	}
+
+	for( i = 0; i < taken; i++ )
+		USBMIDINotes_Track(&g_sUsbMidiDevice.InEpNotes, &batch->msg[i]);
+	USBMIDI_CriticalExit(mask);
+
+	if( connected )
+		InEpKick();
+
+	batch->count -= taken;
+	if( batch->count )
+		memmove(&batch->msg[0], &batch->msg[taken], batch->count * sizeof(batch->msg[0]));
+
+	return taken;
+}
+
+#if USBMIDI_BATCH_SIZE < USBMIDI_UMP_MAX_MIDI1
+#error "USBMIDI_UmpWrite() needs a batch to hold a translated UMP"
+#endif
+
+/**
+ * Return true while the host has the USB MIDI 2.0 alternate setting selected.
+ */
+bool USBMIDI_IsUmp(void)
+{
+	return g_sUsbMidiDevice.sPrivateData.ui8AltSetting == USBMIDI_ALT_UMP;
+}
+
+/**
+ * Send a Universal MIDI Packet to the host. On the USB MIDI 2.0 alternate
+ * setting it goes out as it is, through its own FIFO; on alternate setting 0 it
+ * is translated to event packets (see usbmidi_ump.h) and sent as a batch, so
+ * replay and note tracking apply as usual. Either way, packets written here are
+ * kept in order among themselves but not against USBMIDI_InEpMsgWrite().
+ *
+ * Safe from the main loop and from interrupts at the USB interrupt's priority,
+ * but SysEx must come from one context at a time.
+ * Returns false if the packet was dropped, in part or whole, or has no MIDI 1.0
+ * form on alternate setting 0. While the bus is down it is held for replay if
+ * reconnect-aware mode is on, and dropped otherwise.
+ */
+bool USBMIDI_UmpWrite(const uint32_t *ump)
+{
+	tUSBMidiInstance *psInst = &g_sUsbMidiDevice.sPrivateData;
+	USBMIDIBatch_t batch;
+	uint32_t n;
+	uint32_t mask;
+	bool pushed;
+
+	mask = USBMIDI_CriticalEnter();
+	if( psInst->bConnected && (psInst->ui8AltSetting == USBMIDI_ALT_UMP) )
+	{
+		pushed = USBMIDIUmpFifo_Push(&g_sUsbMidiDevice.InEpUmpFifo, ump);
+		if( pushed )
+			USBMIDIStats_Depth(&g_sUsbMidiDevice.sStats.inUmp, g_sUsbMidiDevice.InEpUmpFifo.count);
+		else
+			g_sUsbMidiDevice.sStats.inUmp.drops++;
+		USBMIDI_CriticalExit(mask);
+		InEpKick();
+		return pushed;
+	}
+
+	// nowhere to send it and nowhere to hold it: dropped uncounted, as by
+	// USBMIDI_InEpMsgWrite(), but not reported as taken.
+	if( !psInst->bConnected && !g_sUsbMidiDevice.InEpReplay.enabled )
+	{
+		USBMIDI_CriticalExit(mask);
+		return false;
+	}
+
+	// a SysEx packet may leave all its bytes waiting for the next one.
+	n = USBMIDIUmp_ToMidi1(&g_sUsbMidiDevice.InEpUmpDown, ump, batch.msg);
+	if( n == 0 )
+	{
+		USBMIDI_CriticalExit(mask);
+		return USBMIDI_UMP_MT(ump[0]) == USBMIDI_UMP_MT_SYSEX7;
+	}
+
+	// still masked, so the bus cannot go down between the check and the write.
+	// USBMIDI_InEpBatchWrite() leaves what does not fit in the batch without
+	// counting it; it is dropped here, as by USBMIDI_InEpMsgWrite().
+	batch.count = n;
+	pushed = (USBMIDI_InEpBatchWrite(&batch) == n);
+	if( !pushed )
+		g_sUsbMidiDevice.sStats.inMsg.drops += batch.count;
+	USBMIDI_CriticalExit(mask);
+	return pushed;
+}
+
+/**
+ * Take the oldest Universal MIDI Packet the host sent on the USB MIDI 2.0
+ * alternate setting, at full resolution. The same messages are also translated
+ * onto the OUT FIFO for USBMIDI_OutEpFIFO_Pop(), so an application may read
+ * either; this FIFO just fills up and drops new packets if it is not read.
+ * Returns the size of the packet in words, 0 if there is none.
+ */
+uint32_t USBMIDI_UmpRead(uint32_t *ump)
+{
+	uint32_t size;
+	uint32_t mask;
+
+	mask = USBMIDI_CriticalEnter();
+	size = USBMIDIUmpFifo_Pop(&g_sUsbMidiDevice.OutEpUmpFifo, ump);
+	USBMIDI_CriticalExit(mask);
+	return size;
+}
+
+/**
+ * Take the oldest (N)RPN or 14-bit controller change the host sent, decoded
+ * from its Control Changes (see usbmidi_param.h). The Control Changes are on
+ * the OUT FIFO as well; this FIFO drops new events when it is not read.
+ * Returns false if there is none.
+ */
+bool USBMIDI_ParamRead(USBMIDIParamEvent_t *ev)
+{
+	bool ok;
+	uint32_t mask;
+
+	mask = USBMIDI_CriticalEnter();
+	ok = USBMIDIParamDec_Pop(&g_sUsbMidiDevice.OutEpParam, ev);
+	USBMIDI_CriticalExit(mask);
+	return ok;
+}
+
+/**
+ * Send an RPN, NRPN or 14-bit controller change through the cable's encoder,
+ * which knows what the host already has on each channel and leaves out the
+ * Control Changes that would not change anything (see usbmidi_param.h). Every
+ * (N)RPN the device sends on a cable should come through here, or the
+ * encoder's idea of the selected parameter goes stale.
+ *
+ * If the IN FIFO cannot take the whole change, what it took goes out and the
+ * encoder forgets the cable, so the next change is sent in full.
+ * Returns false if anything was dropped.
+ */
+bool USBMIDI_ParamWrite(uint8_t cable, uint8_t kind, uint8_t channel, uint16_t number, uint16_t value)
+{
+	USBMIDIParamEnc_t *enc;
+	USBMIDIBatch_t batch;
+	uint32_t mask;
+	uint32_t n;
+	bool added;
+
+	if( cable >= USBMIDI_PARAM_NUM_CABLES )
+		return false;
+
+	enc = &g_sUsbMidiDevice.InEpParam[cable];
+	USBMIDIBatch_Init(&batch);
+
+	// HandleConfigChange() forgets the encoders from the USB interrupt.
+	mask = USBMIDI_CriticalEnter();
+	switch( kind )
+	{
+	case USBMIDI_PARAM_RPN:
+		added = USBMIDIParamEnc_Rpn(enc, &batch, channel, number, value);
+		break;
+	case USBMIDI_PARAM_NRPN:
+		added = USBMIDIParamEnc_Nrpn(enc, &batch, channel, number, value);
+		break;
+	case USBMIDI_PARAM_CC14:
+		added = USBMIDIParamEnc_CC14(enc, &batch, channel, number, value);
+		break;
+	default:
+		added = false;
+		break;
+	}
+	USBMIDI_CriticalExit(mask);
+	if( !added )
+		return false;
+
+	n = batch.count;
+	if( USBMIDI_InEpBatchWrite(&batch) == n )
+		return true;
+
+	mask = USBMIDI_CriticalEnter();
+	USBMIDIParamEnc_Forget(enc);
+	USBMIDI_CriticalExit(mask);
+	g_sUsbMidiDevice.sStats.inMsg.drops += batch.count;
+	return false;
+}
+
+/**
+ * Queue a timing message (clock, transport, song position, MTC quarter frame)
+ * to go out at the
+ * head of the next IN packet, ahead of everything in the IN FIFO. If the
+ * endpoint is idle, the packet goes out right away.
+ *
+ * Meant for a timer interrupt at the USB interrupt's priority, which is the
+ * only context that may call it. Timing messages are never held for replay:
+ * while the bus is down or suspended they are dropped and false is returned.
+ */
+bool USBMIDI_RealTimeWrite(USBMIDI_Message_t *msg)
+{
+	tUSBMidiInstance *psInst = &g_sUsbMidiDevice.sPrivateData;
+
+	if( !psInst->bConnected || psInst->bSuspended )
+		return false;
+
+	if( !USBMIDIRtFifo_Push(&g_sUsbMidiDevice.InEpRtFifo, msg) )
+	{
+		g_sUsbMidiDevice.sStats.inRt.drops++;
+		return false;
+	}
+	USBMIDIStats_Depth(&g_sUsbMidiDevice.sStats.inRt, g_sUsbMidiDevice.InEpRtFifo.count);
+
+	InEpKick();
+	return true;
+}
+
+/*
+ * Fill an IN packet with USB-MIDI 1.0 event packets, for alternate setting 0.
+ *
+ * Timing messages from USBMIDI_RealTimeWrite() go at the head of the packet,
+ * then loopback echoes.
+ *
+ * While a SysEx is being sent, FIFO messages for the same cable would cut into
+ * it, so only real-time messages (and other cables) are taken from the FIFO.
+ * The first message that has to wait stops the FIFO drain, so order is kept.
+ * Whatever room is left in the packet is filled with SysEx fragments.
+ */
+static uint32_t InEpFillMidi1(uint8_t *buf)
 {
-	uint8_t buf[64];
 	uint8_t *pbuf;
-	uint8_t msgByteCnt = 0;
+	uint32_t msgByteCnt = 0;
+	uint32_t n;
 	USBMIDI_Message_t msg;
+	USBMIDISysExTx_t *psSysEx;
 
 	pbuf = buf;
+	psSysEx = &g_sUsbMidiDevice.InEpSysEx;
+
+	// Timing messages first, so a clock never waits behind a full FIFO.
+	while( (msgByteCnt < USBMIDI_MAX_PACKET_SIZE) &&
+			USBMIDIRtFifo_Pop(&g_sUsbMidiDevice.InEpRtFifo, &msg) )
+	{
+		msgByteCnt += 4;
+		*pbuf++ = msg.header;
+		*pbuf++ = msg.byte1;
+		*pbuf++ = msg.byte2;
+		*pbuf++ = msg.byte3;
+	}
 
-	// As long as we have messages to send, pop them
-	while( USBMIDIFIFO_Pop(&g_sUsbMidiDevice.InEpMsgFifo, &msg) && (msgByteCnt < 64) )
+	// Then loopback echoes, unless they would cut into a SysEx on their cable.
+	if( USBMIDILoopback_Pending(&g_sUsbMidiDevice.InEpLoopback) &&
+			!(psSysEx->busy && (psSysEx->cable == USBMIDI_LOOPBACK_CABLE)) )
 	{
+		n = USBMIDILoopback_FillMidi1(&g_sUsbMidiDevice.InEpLoopback, pbuf,
+				USBMIDI_MAX_PACKET_SIZE - msgByteCnt, USBMIDI_Timestamp());
+		msgByteCnt += n;
+		pbuf += n;
+	}
+
+	// As long as we have messages to send and room for them, pop them
+	while( (msgByteCnt < USBMIDI_MAX_PACKET_SIZE) &&
+			USBMIDIFIFO_Peek(&g_sUsbMidiDevice.InEpMsgFifo, &msg) )
+	{
+		if( psSysEx->busy &&
+				(USB_MIDI_CABLE_NUMBER(msg.header) == psSysEx->cable) &&
+				(msg.byte1 < MIDI_MSG_TIMINGCLOCK) )
+			break;
+
+		USBMIDIFIFO_Pop(&g_sUsbMidiDevice.InEpMsgFifo, &msg);
 		msgByteCnt += 4;
 		*pbuf++ = msg.header;
 		*pbuf++ = msg.byte1;
@@ -600,13 +1475,120 @@ void USBMIDI_InEpSendMessages(void)
 		*pbuf++ = msg.byte3;
 	}
 
+	// Top up with SysEx.
+	msgByteCnt += USBMIDISysEx_TxFill(psSysEx, pbuf, USBMIDI_MAX_PACKET_SIZE - msgByteCnt);
+
+	return msgByteCnt;
+}
+
+/*
+ * Whether the next SysEx event packet is three data bytes with more to come.
+ * Such a packet finishes at most one UMP, so it still fits when the rest of
+ * the messages would not.
+ */
+static bool InEpSysExPlain(const USBMIDISysExTx_t *tx)
+{
+	return tx->busy && (tx->remaining > 3) && !((tx->next[0] | tx->next[1] | tx->next[2]) & 0x80);
+}
+
+/*
+ * Fill an IN packet with Universal MIDI Packets, for alternate setting 1.
+ *
+ * The sources and their order are as for InEpFillMidi1(), each event packet
+ * translated on its way into the packet, with the UMP from USBMIDI_UmpWrite()
+ * after the IN FIFO. One event packet can become up to four words, so filling
+ * stops once there is less room than that.
+ */
+#define UMP_FILL_LIMIT (USBMIDI_MAX_PACKET_SIZE / 4 - USBMIDI_UMP_MAX_WORDS)
+
+static uint32_t InEpFillUmp(uint32_t *words)
+{
+	uint32_t n = 0;
+	uint32_t size;
+	uint32_t i;
+	uint32_t ump[USBMIDI_UMP_MAX_WORDS];
+	USBMIDI_Message_t msg;
+	USBMIDISysExTx_t *psSysEx;
+
+	psSysEx = &g_sUsbMidiDevice.InEpSysEx;
+
+	while( (n <= UMP_FILL_LIMIT) && USBMIDIRtFifo_Pop(&g_sUsbMidiDevice.InEpRtFifo, &msg) )
+		n += USBMIDIUmp_FromMidi1(&g_sUsbMidiDevice.InEpUmpUp, &msg, &words[n]);
+
+	if( USBMIDILoopback_Pending(&g_sUsbMidiDevice.InEpLoopback) &&
+			!(psSysEx->busy && (psSysEx->cable == USBMIDI_LOOPBACK_CABLE)) )
+		n += USBMIDILoopback_FillUmp(&g_sUsbMidiDevice.InEpLoopback, &words[n],
+				USBMIDI_MAX_PACKET_SIZE / 4 - n, USBMIDI_Timestamp());
+
+	while( (n <= UMP_FILL_LIMIT) && USBMIDIFIFO_Peek(&g_sUsbMidiDevice.InEpMsgFifo, &msg) )
+	{
+		if( psSysEx->busy &&
+				(USB_MIDI_CABLE_NUMBER(msg.header) == psSysEx->cable) &&
+				(msg.byte1 < MIDI_MSG_TIMINGCLOCK) )
+			break;
+
+		USBMIDIFIFO_Pop(&g_sUsbMidiDevice.InEpMsgFifo, &msg);
+		n += USBMIDIUmp_FromMidi1(&g_sUsbMidiDevice.InEpUmpUp, &msg, &words[n]);
+	}
+
+	while( (n <= UMP_FILL_LIMIT) &&
+			((size = USBMIDIUmpFifo_Peek(&g_sUsbMidiDevice.InEpUmpFifo, ump)) != 0) )
+	{
+		if( psSysEx->busy && (USBMIDI_UMP_GROUP(ump[0]) == psSysEx->cable) &&
+				!((USBMIDI_UMP_MT(ump[0]) == USBMIDI_UMP_MT_SYSTEM) &&
+				  (((ump[0] >> 16) & 0xFF) >= MIDI_MSG_TIMINGCLOCK)) )
+			break;
+
+		USBMIDIUmpFifo_Pop(&g_sUsbMidiDevice.InEpUmpFifo, ump);
+		for( i = 0; i < size; i++ )
+			words[n++] = ump[i];
+	}
+
+	// SysEx one event packet at a time, six bytes to a UMP.
+	while( ((n <= UMP_FILL_LIMIT) || ((n <= USBMIDI_MAX_PACKET_SIZE / 4 - 2) && InEpSysExPlain(psSysEx))) &&
+			USBMIDISysEx_TxFill(psSysEx, (uint8_t *) &msg, sizeof(msg)) )
+		n += USBMIDIUmp_FromMidi1(&g_sUsbMidiDevice.InEpSysExUp, &msg, &words[n]);
+
+	return n * 4;
+}
+
+/**
+ * Check to see if transmit (IN endpoint) message FIFO has things to send.
+ * If it does, repeatedly pop the FIFO and write the message bytes into
+ * a buffer which then gets loaded into the endpoint buffer and transmitted.
+ *
+ * This is called either by USBMIDI_InEpMsgWrite() after a new message is pushed
+ * onto the IN endpoint transmit FIFO, or by the EndpointHandler callback after
+ * a previous USB packet has finished transmitting.
+ *
+ * USB Packet size is 64 bytes and there are 4 bytes per message, so we can
+ * put a maximum of 16 messages in one packet. On the USB MIDI 2.0 alternate
+ * setting the messages go out as Universal MIDI Packets instead.
+ */
+void USBMIDI_InEpSendMessages(void)
+{
+	uint32_t buf[USBMIDI_MAX_PACKET_SIZE / 4];
+	uint32_t msgByteCnt;
+
+	if( g_sUsbMidiDevice.sPrivateData.ui8AltSetting == USBMIDI_ALT_UMP )
+		msgByteCnt = InEpFillUmp(buf);
+	else
+		msgByteCnt = InEpFillMidi1((uint8_t *) buf);
+
 	// Load up the endpoint FIFO!
 	// Since this is called only when we know the endpoint FIFO is ready to
 	// accept a new packet.
 	if( msgByteCnt )
 	{
-		g_sUsbMidiDevice.sPrivateData.iUSBMidiTxState == eUsbMidiStateWaitData;
-		USBEndpointDataPut(USB0_BASE, USB_EP_1, buf, msgByteCnt);
+		// a probed message still in the FIFO goes out with a later packet.
+		if( (g_sUsbMidiDevice.sPrivateData.iProbeState == eUsbMidiProbeArmed) &&
+				(g_sUsbMidiDevice.InEpMsgFifo.count == 0) )
+			g_sUsbMidiDevice.sPrivateData.iProbeState = eUsbMidiProbeInFlight;
+
+		g_sUsbMidiDevice.sStats.inPackets++;
+		g_sUsbMidiDevice.sStats.inWords += msgByteCnt / 4;
+		g_sUsbMidiDevice.sPrivateData.iUSBMidiTxState = eUsbMidiStateWaitData;
+		USBEndpointDataPut(USB0_BASE, USB_EP_1, (uint8_t *) buf, msgByteCnt);
 		USBEndpointDataSend(USB0_BASE, USB_EP_1, USB_TRANS_IN );
 	}
 }
@@ -24,6 +24,18 @@ void USBMIDI_Init(uint32_t index);
  */
 bool USBMIDI_IsConnected(void);
 
+/**
+ * return bus suspend status. While suspended, written messages are queued and
+ * a remote wakeup is requested; they are sent once the bus resumes.
+ */
+bool USBMIDI_IsSuspended(void);
+
+/**
+ * Advance the remote wakeup timer. Call every ui32TimemS from a periodic
+ * interrupt that runs while the CPU sleeps.
+ */
+void USBMIDI_Tick(uint32_t ui32TimemS);
+
 /**
  * Functions to access the message FIFOs.
  *
@@ -36,6 +48,107 @@ bool USBMIDI_OutEpFIFO_Pop(USBMIDI_Message_t *msg);
  */
 void USBMIDI_InEpMsgWrite(USBMIDI_Message_t *msg);
 
+/**
+ * Send a batch built with the USBMIDIBatch_ functions (see usbmidi_batch.h) in one
+ * go. Safe from the main loop and from interrupts at the USB interrupt's
+ * priority. Messages the IN FIFO has no room for are left in the batch.
+ * Returns the number of messages taken.
+ */
+uint32_t USBMIDI_InEpBatchWrite(USBMIDIBatch_t *batch);
+
+/**
+ * Return true while the host uses the USB MIDI 2.0 alternate setting, where
+ * messages travel as Universal MIDI Packets.
+ */
+bool USBMIDI_IsUmp(void);
+
+/**
+ * Send a Universal MIDI Packet (1 to 4 words, see usbmidi_ump.h), for MIDI 2.0
+ * resolution and per-note messages. On alternate setting 0 it is translated to
+ * MIDI 1.0. Returns false if it was dropped.
+ */
+bool USBMIDI_UmpWrite(const uint32_t *ump);
+
+/**
+ * Pop a Universal MIDI Packet from the host, received on the USB MIDI 2.0
+ * alternate setting, into ump (room for 4 words). Returns its size in words,
+ * 0 if there is none. Everything received is also translated onto the OUT
+ * FIFO for USBMIDI_OutEpFIFO_Pop().
+ */
+uint32_t USBMIDI_UmpRead(uint32_t *ump);
+
+/**
+ * Pop an RPN, NRPN or 14-bit controller change from the host, reassembled from
+ * its Control Changes. Returns false if there is none.
+ */
+bool USBMIDI_ParamRead(USBMIDIParamEvent_t *ev);
+
+/**
+ * Send an RPN, NRPN or 14-bit controller change (kind USBMIDI_PARAM_RPN, _NRPN
+ * or _CC14; number is the controller for _CC14) on a cable below
+ * USBMIDI_PARAM_NUM_CABLES. The stack keeps one encoder per cable, so the
+ * parameter select pair is only sent when the selection changes. Call from the
+ * main loop. Returns false if any of it was dropped.
+ */
+bool USBMIDI_ParamWrite(uint8_t cable, uint8_t kind, uint8_t channel, uint16_t number, uint16_t value);
+
+/**
+ * Queue a timing message (0xF8-0xFC, Song Position or MTC Quarter Frame) to go at the head of
+ * the next IN packet. Call only from an interrupt at the USB interrupt's
+ * priority. Returns false, dropping the message, if the bus is not up.
+ */
+bool USBMIDI_RealTimeWrite(USBMIDI_Message_t *msg);
+
+/**
+ * Reconnect-aware mode: hold messages written while the device is not configured
+ * and send them after the host configures it again. Note Ons held longer than
+ * ui32MaxAgeMs are dropped; Note Offs and controller state are kept. Ages are
+ * counted by USBMIDI_Tick(): without it nothing is ever too old.
+ * Off by default.
+ */
+void USBMIDI_ReplayModeSet(bool bEnable, uint32_t ui32MaxAgeMs);
+
+/**
+ * Get replay buffer counters.
+ */
+void USBMIDI_ReplayStatsGet(USBMIDIReplayStats_t *stats);
+
+/**
+ * Send exactly one Note Off for every note that is on: to the host for notes
+ * we sent, and onto the OUT FIFO for notes the host sent us. The host's notes
+ * are turned off this way automatically when it disconnects or resets the bus.
+ */
+void USBMIDI_Panic(void);
+
+/**
+ * Follow the host's MIDI clock: smoothed tempo (thousandths of a BPM), the
+ * predicted USBMIDI_Timestamp() of the next Timing Clock, lock status, and
+ * Start/Stop/Song Position. tempo is 0 when no clock is coming in.
+ */
+void USBMIDI_ClockInGet(USBMIDIClockInState_t *state);
+
+/**
+ * Get clock follower counters, including the cycles spent per Timing Clock.
+ */
+void USBMIDI_ClockInStatsGet(USBMIDIClockInStats_t *stats);
+
+/**
+ * Chase the host's MIDI Time Code: the position reassembled from quarter
+ * frames, interpolated to now, and whether quarter frames are still coming.
+ */
+void USBMIDI_MtcInGet(USBMIDIMtcInState_t *state);
+
+/**
+ * Get MTC decoder counters.
+ */
+void USBMIDI_MtcInStatsGet(USBMIDIMtcInStats_t *stats);
+
+/**
+ * Measure input-to-USB latency: call after writing an event's messages, with
+ * the timestamp (USBMIDI_Timestamp()) of the event.
+ */
+void USBMIDI_LatencyProbe(uint32_t ui32Time);
+
 /**
  * Check to see if transmit (IN endpoint) message FIFO has things to send.
  * If it does, repeatedly pop the FIFO and write the message bytes into
@@ -43,4 +156,64 @@ void USBMIDI_InEpMsgWrite(USBMIDI_Message_t *msg);
  */
 void USBMIDI_InEpSendMessages(void);
 
+/**
+ * Set the function called for each complete SysEx message received from the host.
+ * The message is a view into the SysEx pool and is only valid during the call.
+ */
+void USBMIDI_SysExCallbackSet(tUSBMIDISysExCallback callback);
+
+/**
+ * Deliver reassembled SysEx messages to the callback. Call from the main loop.
+ */
+void USBMIDI_SysExTask(void);
+
+/**
+ * Send a SysEx message to the host without blocking. data holds the whole
+ * message, F0 through F7, and is packed straight into IN endpoint packets, so
+ * it must stay untouched until the transmit callback runs.
+ * Messages pushed with USBMIDI_InEpMsgWrite() meanwhile still go out: real-time
+ * messages, and anything on other cables, are slipped in between the fragments.
+ * Returns false if not connected, a SysEx is still being sent, or data is not SysEx.
+ */
+bool USBMIDI_SendSysEx(uint8_t cable, const uint8_t *data, uint32_t len);
+
+/**
+ * Set the function called (from the USB interrupt) when an outgoing SysEx has been sent.
+ */
+void USBMIDI_SysExTxCallbackSet(tUSBMIDISysExTxCallback callback);
+
+/**
+ * Return true while an outgoing SysEx is still being sent.
+ */
+bool USBMIDI_SysExTxBusy(void);
+
+/**
+ * Get SysEx pool usage.
+ */
+void USBMIDI_SysExStatsGet(USBMIDISysExStats_t *stats);
+
+/**
+ * Offer a received SysEx message to the loopback latency mode (see
+ * usbmidi_loopback.h), which answers it.
+ * \returns true if it was a loopback message (and has been handled).
+ */
+bool USBMIDI_LoopbackSysEx(const USBMIDISysExMsg_t *msg);
+
+/**
+ * Get the loopback counters and latency histograms.
+ */
+void USBMIDI_LoopbackReportGet(USBMIDILoopbackReport_t *report);
+
+/**
+ * Get the stack's counters, FIFO depths and SysEx pool usage in one copy.
+ */
+void USBMIDI_StatsGet(USBMIDIStats_t *stats);
+
+/**
+ * Offer a received SysEx message to the statistics query (see
+ * usbmidi_stats.h), which answers it on the cable it came in on.
+ * \returns true if it was the query (and has been handled).
+ */
+bool USBMIDI_StatsSysEx(const USBMIDISysExMsg_t *msg);
+
 #endif /* USB_MIDI_USBMIDI_H_ */
@@ -0,0 +1,138 @@
+/*
+ * usbmidi_batch.h
+ *
+ * Building channel voice messages for the host, and sending them in batches.
+ *
+ * The builders fill in a USBMIDI_Message_t for a cable and channel: the Code
+ * Index Number follows from the status, out of range data is masked to seven
+ * bits, and pitch bend takes the 14-bit value. They are inline and write
+ * straight into the batch, so building an event is a handful of stores.
+ *
+ * A batch is a local array of messages. USBMIDI_InEpBatchWrite() sends the
+ * whole batch with one interrupt mask, one copy into the IN FIFO and one
+ * endpoint kick, where USBMIDI_InEpMsgWrite() costs all three per message.
+ * The batch lives with the caller, so a timer interrupt can build and send
+ * its own while the main loop is in the middle of another.
+ *
+ *		USBMIDIBatch_t batch;
+ *
+ *		USBMIDIBatch_Init(&batch);
+ *		for( note = 48; note < 60; note += 4 )
+ *			USBMIDIBatch_NoteOn(&batch, 0, 0, note, 100);
+ *		USBMIDI_InEpBatchWrite(&batch);
+ *
+ * Nothing here touches hardware.
+ *
+ *  Created on: Oct 18, 2026
+ *
+ * MODS:
+ */
+
+#ifndef USB_MIDI_USBMIDI_BATCH_H_
+#define USB_MIDI_USBMIDI_BATCH_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "midi.h"
+#include "usb_midi.h"
+
+/**
+ * Messages in a batch. The default is one full IN packet.
+ */
+#ifndef USBMIDI_BATCH_SIZE
+#define USBMIDI_BATCH_SIZE 16
+#endif
+
+/**
+ * \typedef USBMIDIBatch_t
+ */
+typedef struct
+{
+	uint32_t count;							//!< messages in msg[]
+	USBMIDI_Message_t msg[USBMIDI_BATCH_SIZE];
+} USBMIDIBatch_t;
+
+/**
+ * Empty the batch.
+ */
+static inline void USBMIDIBatch_Init(USBMIDIBatch_t *b)
+{
+	b->count = 0;
+}
+
+/**
+ * Return true if there is no room for another message.
+ */
+static inline bool USBMIDIBatch_Full(const USBMIDIBatch_t *b)
+{
+	return b->count >= USBMIDI_BATCH_SIZE;
+}
+
+/**
+ * Add a channel voice message. status is the message type (MIDI_MSG_NOTEON
+ * etc.), whose upper nybble is also its CIN.
+ * \returns false, adding nothing, if the batch is full.
+ */
+static inline bool USBMIDIBatch_Voice(USBMIDIBatch_t *b, uint8_t cable, uint8_t status,
+		uint8_t channel, uint8_t data1, uint8_t data2)
+{
+	USBMIDI_Message_t *msg;
+
+	if( b->count >= USBMIDI_BATCH_SIZE )
+		return false;
+
+	msg = &b->msg[b->count++];
+	msg->header = USB_MIDI_HEADER(cable & 0x0F, status >> 4);
+	msg->byte1 = status | (channel & 0x0F);
+	msg->byte2 = data1 & 0x7F;
+	msg->byte3 = data2 & 0x7F;
+	return true;
+}
+
+static inline bool USBMIDIBatch_NoteOff(USBMIDIBatch_t *b, uint8_t cable, uint8_t channel,
+		uint8_t note, uint8_t velocity)
+{
+	return USBMIDIBatch_Voice(b, cable, MIDI_MSG_NOTEOFF, channel, note, velocity);
+}
+
+static inline bool USBMIDIBatch_NoteOn(USBMIDIBatch_t *b, uint8_t cable, uint8_t channel,
+		uint8_t note, uint8_t velocity)
+{
+	return USBMIDIBatch_Voice(b, cable, MIDI_MSG_NOTEON, channel, note, velocity);
+}
+
+static inline bool USBMIDIBatch_PolyPressure(USBMIDIBatch_t *b, uint8_t cable, uint8_t channel,
+		uint8_t note, uint8_t pressure)
+{
+	return USBMIDIBatch_Voice(b, cable, MIDI_MSG_POLYPRESSURE, channel, note, pressure);
+}
+
+static inline bool USBMIDIBatch_ControlChange(USBMIDIBatch_t *b, uint8_t cable, uint8_t channel,
+		uint8_t controller, uint8_t value)
+{
+	return USBMIDIBatch_Voice(b, cable, MIDI_MSG_CTRLCHANGE, channel, controller, value);
+}
+
+static inline bool USBMIDIBatch_ProgramChange(USBMIDIBatch_t *b, uint8_t cable, uint8_t channel,
+		uint8_t program)
+{
+	return USBMIDIBatch_Voice(b, cable, MIDI_MSG_PROGCHANGE, channel, program, 0);
+}
+
+static inline bool USBMIDIBatch_ChannelPressure(USBMIDIBatch_t *b, uint8_t cable, uint8_t channel,
+		uint8_t pressure)
+{
+	return USBMIDIBatch_Voice(b, cable, MIDI_MSG_CHANNELPRESSURE, channel, pressure, 0);
+}
+
+/**
+ * Pitch bend: value is 0-16383, with 8192 the centre.
+ */
+static inline bool USBMIDIBatch_PitchBend(USBMIDIBatch_t *b, uint8_t cable, uint8_t channel,
+		uint16_t value)
+{
+	return USBMIDIBatch_Voice(b, cable, MIDI_MSG_PITCHBEND, channel, value, value >> 7);
+}
+
+#endif /* USB_MIDI_USBMIDI_BATCH_H_ */
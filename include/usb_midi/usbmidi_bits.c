@@ -0,0 +1,19 @@
+/*
+ * usbmidi_bits.c
+ *
+ * The de Bruijn table behind USBMIDI_BIT_INDEX(). See usbmidi_bits.h.
+ *
+ *  Created on: Oct 18, 2026
+ *
+ * MODS:
+ */
+
+#include <stdint.h>
+
+#include "usbmidi_bits.h"
+
+const uint8_t USBMIDIBits_DeBruijn[32] =
+{
+	0, 1, 28, 2, 29, 14, 24, 3, 30, 22, 20, 15, 25, 17, 4, 8,
+	31, 27, 13, 23, 21, 19, 16, 7, 26, 12, 18, 6, 11, 5, 10, 9
+};
@@ -0,0 +1,30 @@
+/*
+ * usbmidi_bits.h
+ *
+ * Bit index of a single set bit, for walking bitmaps one set bit at a time:
+ *
+ *		for( w = word; w; w &= w - 1 )
+ *			use(USBMIDI_BIT_INDEX(w & -w));
+ *
+ * Multiplying the bit by a de Bruijn constant leaves a different pattern in
+ * the top five bits for each of the 32 positions; a table turns it back into
+ * the index. One multiply and one load, the same on any compiler.
+ *
+ *  Created on: Oct 18, 2026
+ *
+ * MODS:
+ */
+
+#ifndef USB_MIDI_USBMIDI_BITS_H_
+#define USB_MIDI_USBMIDI_BITS_H_
+
+#include <stdint.h>
+
+extern const uint8_t USBMIDIBits_DeBruijn[32];
+
+/**
+ * Index, 0-31, of b, which must have exactly one bit set.
+ */
+#define USBMIDI_BIT_INDEX(b)	(USBMIDIBits_DeBruijn[((uint32_t) ((b) * 0x077CB531UL)) >> 27])
+
+#endif /* USB_MIDI_USBMIDI_BITS_H_ */
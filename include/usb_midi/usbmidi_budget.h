@@ -0,0 +1,61 @@
+/*
+ * usbmidi_budget.h
+ *
+ * Compile-time limits on the stack's buffers.
+ *
+ * Every FIFO, queue and pool is sized by a macro that a build may override.
+ * Each size is checked where it is defined, against the width of the indices
+ * and counters that walk it, so a larger buffer fails to compile rather than
+ * wrapping at run time. The whole device structure is checked against
+ * USBMIDI_SRAM_BUDGET in usbmidi_types.h.
+ *
+ * SRAM taken, in bytes, roughly (the SysEx pool dominates):
+ *
+ *   SysEx pool       USBMIDI_SYSEX_NUM_BLOCKS * (USBMIDI_SYSEX_BLOCK_SIZE + 8)
+ *   message FIFOs    2 * 4 * MIDI_USB_FIFO_SIZE
+ *   timing FIFO      4 * USBMIDI_RT_FIFO_SIZE
+ *   UMP FIFOs        2 * 4 * USBMIDI_UMP_FIFO_WORDS
+ *   replay buffer    8 * USBMIDI_REPLAY_SIZE
+ *   parameter FIFO   12 * USBMIDI_PARAM_FIFO_SIZE
+ *   param encoders   610 * USBMIDI_PARAM_NUM_CABLES
+ *   UMP translators  4 * 7 * 16 * USBMIDI_UMP_NUM_GROUPS
+ *   loopback echoes  8 * USBMIDI_LOOPBACK_DEPTH
+ *
+ * tools/ramreport.c reports what the linker actually placed and how deep the
+ * stack can get; see the README.
+ *
+ *  Created on: Oct 18, 2026
+ *
+ * MODS:
+ */
+
+#ifndef USB_MIDI_USBMIDI_BUDGET_H_
+#define USB_MIDI_USBMIDI_BUDGET_H_
+
+/**
+ * Fail to compile, with the name in the error, unless cond holds. C11
+ * compilers (armcl --c11, gcc -std=c11) get _Static_assert; older modes a
+ * negative array size.
+ */
+#if defined(__STDC_VERSION__) && (__STDC_VERSION__ >= 201112L)
+#define USBMIDI_STATIC_ASSERT(Name, cond)	\
+	_Static_assert(cond, #Name)
+#else
+#define USBMIDI_STATIC_ASSERT(Name, cond)	\
+	typedef char Name##_StaticAssert[(cond) ? 1 : -1]
+#endif
+
+/**
+ * True if n is a power of two no larger than max.
+ */
+#define USBMIDI_POW2_UPTO(n, max)	(((n) > 0) && ((n) <= (max)) && (((n) & ((n) - 1)) == 0))
+
+/**
+ * Bytes of SRAM the device structure may take, out of the part's 32 KB. The
+ * rest is the stack, the drivers' buffers and the application's.
+ */
+#ifndef USBMIDI_SRAM_BUDGET
+#define USBMIDI_SRAM_BUDGET	16384
+#endif
+
+#endif /* USB_MIDI_USBMIDI_BUDGET_H_ */
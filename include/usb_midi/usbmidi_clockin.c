@@ -0,0 +1,221 @@
+/*
+ * usbmidi_clockin.c
+ *
+ * MIDI clock follower: an alpha-beta filter on the arrival times of the host's
+ * Timing Clocks. See usbmidi_clockin.h for how it works.
+ *
+ *  Created on: Oct 18, 2026
+ *
+ * MODS:
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "midi.h"
+#include "usb_midi.h"
+#include "usbmidi_clockin.h"
+
+#define PHASE_IDLE		0
+#define PHASE_FIRST		1
+#define PHASE_TRACKING	2
+
+/*
+ * Song Position counts sixteenth notes, six clocks each.
+ */
+#define CLOCKS_PER_SPP	6
+
+void USBMIDIClockIn_Init(USBMIDIClockIn_t *ci, uint32_t unitsPerSec)
+{
+	memset(ci, 0, sizeof(*ci));
+
+	// units per tick = unitsPerSec * 60 / (BPM * 24), in 1/256 units, with
+	// the tempo in thousandths.
+	ci->tempoScale = (uint64_t) unitsPerSec * 60 * 1000 * 256 / 24;
+	ci->periodMin = (uint32_t) (ci->tempoScale / USBMIDI_CLOCKIN_TEMPO_MAX);
+	ci->periodMax = (uint32_t) (ci->tempoScale / USBMIDI_CLOCKIN_TEMPO_MIN);
+}
+
+void USBMIDIClockIn_Reset(USBMIDIClockIn_t *ci)
+{
+	ci->phase = PHASE_IDLE;
+	ci->locked = false;
+	ci->playing = false;
+	ci->position = 0;
+}
+
+/*
+ * One Timing Clock at time now.
+ */
+static void Tick(USBMIDIClockIn_t *ci, uint32_t now)
+{
+	uint32_t diff;
+	uint32_t period;
+	uint32_t abserr;
+	int32_t err;
+	int64_t adjusted;
+	uint8_t alpha;
+	uint8_t beta;
+
+	ci->stats.ticks++;
+	if( ci->playing )
+		ci->position++;
+
+	switch( ci->phase )
+	{
+	case PHASE_IDLE:
+		ci->last = now;
+		ci->phase = PHASE_FIRST;
+		return;
+
+	case PHASE_FIRST:
+		// two ticks give a first guess; one that is out of range is kept as
+		// the start of the next guess.
+		diff = now - ci->last;
+		ci->last = now;
+		if( (diff > (ci->periodMax >> 8)) || (diff < (ci->periodMin >> 8)) )
+			return;
+		ci->period = diff << 8;
+		ci->next = now + diff;
+		ci->phase = PHASE_TRACKING;
+		ci->locked = false;
+		ci->good = 0;
+		ci->poor = 0;
+		ci->outliers = 0;
+		return;
+
+	default:
+		break;
+	}
+
+	period = ci->period >> 8;
+	err = (int32_t) (now - ci->next);
+	abserr = (err < 0) ? -err : err;
+	ci->last = now;
+	ci->stats.errLast = abserr;
+
+	// not a tick we can use: carry on with the prediction, or start over.
+	if( abserr > (period >> 1) )
+	{
+		if( ++ci->outliers >= USBMIDI_CLOCKIN_OUTLIERS )
+		{
+			ci->phase = PHASE_FIRST;
+			ci->locked = false;
+			ci->stats.restarts++;
+		}
+		else
+		{
+			ci->next += period;
+		}
+		return;
+	}
+	ci->outliers = 0;
+
+	if( ci->locked )
+	{
+		alpha = USBMIDI_CLOCKIN_LOCK_ALPHA;
+		beta = USBMIDI_CLOCKIN_LOCK_BETA;
+		if( abserr > ci->stats.errMax )
+			ci->stats.errMax = abserr;
+	}
+	else
+	{
+		alpha = USBMIDI_CLOCKIN_ACQ_ALPHA;
+		beta = USBMIDI_CLOCKIN_ACQ_BETA;
+	}
+
+	// alpha-beta update.
+	adjusted = (int64_t) ci->period + (int64_t) err * (1 << (8 - beta));
+	if( adjusted < ci->periodMin )
+		adjusted = ci->periodMin;
+	else if( adjusted > ci->periodMax )
+		adjusted = ci->periodMax;
+	ci->period = (uint32_t) adjusted;
+	ci->next = ci->next + (err >> alpha) + (ci->period >> 8);
+
+	// lock on a beat of good ticks; unlock on a run of poor ones.
+	if( abserr <= (period >> 3) )
+	{
+		ci->poor = 0;
+		if( !ci->locked && (++ci->good >= USBMIDI_CLOCKIN_LOCK_TICKS) )
+			ci->locked = true;
+	}
+	else
+	{
+		ci->good = 0;
+		if( ci->locked && (++ci->poor >= USBMIDI_CLOCKIN_UNLOCK_TICKS) )
+		{
+			ci->locked = false;
+			ci->poor = 0;
+		}
+	}
+}
+
+bool USBMIDIClockIn_Feed(USBMIDIClockIn_t *ci, const USBMIDI_Message_t *msg, uint32_t now)
+{
+	uint8_t cin = USB_MIDI_CODE_INDEX_NUMBER(msg->header);
+
+	if( cin == USB_MIDI_CIN_SINGLEBYTE )
+	{
+		switch( msg->byte1 )
+		{
+		case MIDI_MSG_TIMINGCLOCK:
+			Tick(ci, now);
+			return true;
+		case MIDI_MSG_START:
+			ci->position = 0;
+			ci->playing = true;
+			break;
+		case MIDI_MSG_CONTINUE:
+			ci->playing = true;
+			break;
+		case MIDI_MSG_STOP:
+			ci->playing = false;
+			break;
+		default:
+			break;
+		}
+	}
+	else if( (cin == USB_MIDI_CIN_SYSCOM3) && (msg->byte1 == MIDI_MSG_SPP) )
+	{
+		ci->position = ((uint32_t) msg->byte2 | ((uint32_t) msg->byte3 << 7)) * CLOCKS_PER_SPP;
+	}
+
+	return false;
+}
+
+void USBMIDIClockIn_Get(USBMIDIClockIn_t *ci, USBMIDIClockInState_t *state, uint32_t now)
+{
+	// three periods without a tick: the clock has stopped.
+	if( (ci->phase == PHASE_TRACKING) && ((now - ci->last) > 3 * (ci->period >> 8)) )
+	{
+		ci->phase = PHASE_IDLE;
+		ci->locked = false;
+	}
+	else if( (ci->phase == PHASE_FIRST) && ((now - ci->last) > (ci->periodMax >> 8)) )
+	{
+		ci->phase = PHASE_IDLE;
+	}
+
+	state->locked = ci->locked;
+	state->playing = ci->playing;
+	state->position = ci->position;
+	if( ci->phase == PHASE_TRACKING )
+	{
+		state->tempo = (uint32_t) (ci->tempoScale / ci->period);
+		state->next = ci->next;
+		state->period = ci->period;
+	}
+	else
+	{
+		state->tempo = 0;
+		state->next = 0;
+		state->period = 0;
+	}
+}
+
+void USBMIDIClockIn_GetStats(const USBMIDIClockIn_t *ci, USBMIDIClockInStats_t *stats)
+{
+	*stats = ci->stats;
+}
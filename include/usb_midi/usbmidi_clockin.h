@@ -0,0 +1,145 @@
+/*
+ * usbmidi_clockin.h
+ *
+ * Following the host's MIDI clock.
+ *
+ * The endpoint handler timestamps every Timing Clock (0xF8) from the host as the
+ * packet carrying it is read, and feeds it here. Those timestamps are noisy:
+ * the host schedules packets on 1 ms USB frames, and its own timing wobbles on
+ * top of that. An alpha-beta filter (a fixed-gain Kalman filter for phase and
+ * period) tracks the tick time and period through the noise:
+ *
+ *     predicted = next                     err    = t - predicted
+ *     tick      = predicted + err * alpha  period = period + err * beta
+ *     next      = tick + period
+ *
+ * alpha and beta are powers of two, so a tick costs a handful of adds and
+ * shifts. Until the clock is locked the gains are high to pull in quickly;
+ * once USBMIDI_CLOCKIN_LOCK_TICKS ticks in a row land within 1/8 period of the
+ * prediction the gains drop, to smooth out the frame jitter. The period is kept
+ * in 1/256 cycles so small corrections are not lost.
+ *
+ *  - The first two ticks give a rough period to start from.
+ *  - A tick more than half a period off is not used. After
+ *    USBMIDI_CLOCKIN_OUTLIERS of those in a row (a jump in tempo, or the host
+ *    restarting its clock) the filter starts over from two ticks.
+ *  - No tick for three periods means the clock stopped; the next one starts over.
+ *
+ * Start, Continue, Stop and Song Position are followed too, to keep a position
+ * in clocks for sequencing.
+ *
+ * Nothing here touches hardware: times are whatever unit the caller uses, so the
+ * filter can be run on a host against recorded clock streams.
+ *
+ *  Created on: Oct 18, 2026
+ *
+ * MODS:
+ */
+
+#ifndef USB_MIDI_USBMIDI_CLOCKIN_H_
+#define USB_MIDI_USBMIDI_CLOCKIN_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "usb_midi.h"
+
+/**
+ * Filter gains, as right shifts: alpha = 2^-ALPHA, beta = 2^-BETA.
+ * BETA must be 8 or less.
+ */
+#define USBMIDI_CLOCKIN_ACQ_ALPHA	1
+#define USBMIDI_CLOCKIN_ACQ_BETA	3
+#define USBMIDI_CLOCKIN_LOCK_ALPHA	3
+#define USBMIDI_CLOCKIN_LOCK_BETA	6
+
+#define USBMIDI_CLOCKIN_LOCK_TICKS	24		//!< good ticks in a row to lock (one beat)
+#define USBMIDI_CLOCKIN_UNLOCK_TICKS	6	//!< poor ticks in a row to unlock
+#define USBMIDI_CLOCKIN_OUTLIERS	4		//!< unusable ticks in a row to start over
+
+/**
+ * Tempos followed, in thousandths of a BPM.
+ */
+#define USBMIDI_CLOCKIN_TEMPO_MIN	20000
+#define USBMIDI_CLOCKIN_TEMPO_MAX	300000
+
+/**
+ * \typedef USBMIDIClockInState_t
+ * What the follower knows, from USBMIDIClockIn_Get().
+ */
+typedef struct
+{
+	bool locked;			//!< tempo and next are good
+	bool playing;			//!< between Start/Continue and Stop
+	uint32_t tempo;			//!< thousandths of a BPM, 0 if no clock
+	uint32_t next;			//!< predicted time of the next tick
+	uint32_t period;		//!< time units per tick, in 1/256 units
+	uint32_t position;		//!< clocks since Start, or from Song Position
+} USBMIDIClockInState_t;
+
+/**
+ * \typedef USBMIDIClockInStats_t
+ */
+typedef struct
+{
+	uint32_t ticks;			//!< Timing Clocks seen
+	uint32_t restarts;		//!< times the filter started over
+	uint32_t errLast;		//!< |t - predicted| of the last tick
+	uint32_t errMax;		//!< worst |t - predicted| while locked
+	uint32_t cycles;		//!< cost of the last tick, filled in by the caller
+	uint32_t cyclesMax;
+} USBMIDIClockInStats_t;
+
+/**
+ * \typedef USBMIDIClockIn_t
+ */
+typedef struct
+{
+	uint64_t tempoScale;	//!< tempo = tempoScale / period
+	uint32_t periodMin;		//!< 1/256 units
+	uint32_t periodMax;
+	uint8_t phase;			//!< idle, one tick seen, tracking
+	bool locked;
+	uint8_t good;			//!< ticks in a row within 1/8 period
+	uint8_t poor;			//!< ticks in a row outside 1/8 period, while locked
+	uint8_t outliers;		//!< ticks in a row more than 1/2 period off
+	uint32_t last;			//!< time of the last tick
+	uint32_t next;			//!< predicted time of the next tick
+	uint32_t period;		//!< 1/256 units
+	bool playing;
+	uint32_t position;
+	USBMIDIClockInStats_t stats;
+} USBMIDIClockIn_t;
+
+/**
+ * Set up a follower for a time base of unitsPerSec (the CPU clock, for
+ * USBMIDI_Timestamp()) and clear everything.
+ */
+void USBMIDIClockIn_Init(USBMIDIClockIn_t *ci, uint32_t unitsPerSec);
+
+/**
+ * Forget the clock and the transport, as after a reconnect. Counters are kept.
+ */
+void USBMIDIClockIn_Reset(USBMIDIClockIn_t *ci);
+
+/**
+ * Look at a message from the host. Timing Clock, Start, Continue, Stop and Song
+ * Position are acted on; anything else is ignored.
+ * \param now: when the packet carrying the message was read.
+ * \returns true if the message was a Timing Clock.
+ */
+bool USBMIDIClockIn_Feed(USBMIDIClockIn_t *ci, const USBMIDI_Message_t *msg, uint32_t now);
+
+/**
+ * Get the tempo, prediction and transport. A clock that has gone silent for
+ * three periods is dropped here.
+ * \param now: current time.
+ */
+void USBMIDIClockIn_Get(USBMIDIClockIn_t *ci, USBMIDIClockInState_t *state, uint32_t now);
+
+/**
+ * Get the counters.
+ */
+void USBMIDIClockIn_GetStats(const USBMIDIClockIn_t *ci, USBMIDIClockInStats_t *stats);
+
+#endif /* USB_MIDI_USBMIDI_CLOCKIN_H_ */
@@ -0,0 +1,58 @@
+/*
+ * usbmidi_critical.h
+ *
+ * Interrupt priority of the USB stack and its critical sections.
+ *
+ * Everything that touches the stack's state from an interrupt runs at
+ * USBMIDI_INT_PRIORITY: the USB interrupt itself, and the timer and SysTick
+ * interrupts that write timing messages or run remote wakeup. Interrupts at
+ * one priority do not preempt each other, so among themselves they need no
+ * masking. Code below that priority, the main loop included, shares the
+ * state through critical sections that raise BASEPRI to USBMIDI_INT_PRIORITY
+ * instead of masking every interrupt: interrupts of higher priority, which
+ * must not call into the stack, still run. See usb_dev_midi.h for the whole
+ * plan.
+ *
+ * The Cortex-M4 in the TM4C123 implements three priority bits, the top three
+ * of the byte, so priorities go in steps of 0x20 and 0x00 is the highest.
+ * Reset leaves every interrupt at 0x00, where BASEPRI masks nothing, so
+ * USBMIDI_Init() moves the USB interrupt to USBMIDI_INT_PRIORITY itself.
+ *
+ *  Created on: Oct 18, 2026
+ *
+ * MODS:
+ */
+
+#ifndef USB_MIDI_USBMIDI_CRITICAL_H_
+#define USB_MIDI_USBMIDI_CRITICAL_H_
+
+#include <stdint.h>
+
+/**
+ * Priority of the USB interrupt and of every interrupt that calls into the
+ * stack. Must not be 0x00.
+ */
+#ifndef USBMIDI_INT_PRIORITY
+#define USBMIDI_INT_PRIORITY	0x40
+#endif
+
+#if (USBMIDI_INT_PRIORITY == 0) || (USBMIDI_INT_PRIORITY & 0x1F) || (USBMIDI_INT_PRIORITY > 0xE0)
+#error "USBMIDI_INT_PRIORITY must be one of 0x20 to 0xE0, in steps of 0x20"
+#endif
+
+/**
+ * Mask interrupts at USBMIDI_INT_PRIORITY and below. Never lowers a mask
+ * already in place, so sections nest.
+ * \returns the mask to give USBMIDI_CriticalExit().
+ */
+uint32_t USBMIDI_CriticalEnter(void);
+
+/**
+ * Put back the mask USBMIDI_CriticalEnter() returned. The outermost section
+ * is timed, for the maskedCycles counters in USBMIDIStats_t, when it was
+ * entered from below USBMIDI_INT_PRIORITY: the main loop or a lower priority
+ * interrupt. From an interrupt at that priority or above, it held nothing off.
+ */
+void USBMIDI_CriticalExit(uint32_t mask);
+
+#endif /* USB_MIDI_USBMIDI_CRITICAL_H_ */
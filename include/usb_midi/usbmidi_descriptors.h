@@ -58,6 +58,28 @@
 
 #define USB_MIDI_CS_STREAMING_BULK_ENDPOINT_SIZE(NumJacks) (4 + NumJacks)
 
+/**
+ * USB MIDI 2.0: the class-specific endpoint descriptor subtype for alternate
+ * setting 1, which lists Group Terminal Blocks instead of jacks.
+ */
+#define USB_MIDI_CS_EP_MS_GENERAL_2_0 0x02
+
+#define USB_MIDI2_CS_STREAMING_BULK_ENDPOINT_SIZE(NumBlocks) (4 + NumBlocks)
+
+/**
+ * USB MIDI 2.0 Group Terminal Block descriptors. The host reads them with a
+ * GET_DESCRIPTOR of type CS_GR_TRM_BLOCK, the index being the alternate setting.
+ */
+#define USB_DTYPE_CS_GR_TRM_BLOCK (0x26)
+#define MIDI_GR_TRM_BLOCK_HEADER  (0x01)
+#define MIDI_GR_TRM_BLOCK         (0x02)
+
+#define MIDI_GR_TRM_BIDIRECTIONAL (0x00)
+#define MIDI_GR_TRM_PROTOCOL_MIDI2 (0x11)	// MIDI 2.0 Protocol, no JR timestamps
+
+#define USBMIDI_GTB_ID            (1)
+#define USBMIDI_GTB_DESC_SIZE     (5 + 13)
+
 /**
  * We use these endpoints.
  * These are different than the parameters for some of the API functions, which have the
@@ -66,4 +88,39 @@
 #define USBMIDI_MS_EP_IN  (0x01)
 #define USBMIDI_MS_EP_OUT (0x01)
 
+/**
+ * \def Max packet size of the bulk endpoints, 64 is max for full speed.
+ */
+#define USBMIDI_MAX_PACKET_SIZE (64)
+
+/**
+ * \def A device may only signal remote wakeup after the bus has been idle this long.
+ */
+#define USBMIDI_REMOTE_WAKE_DELAY_MS (5)
+
+/**
+ * Our interface numbers.
+ */
+#define USBMIDI_IF_AUDIO_CONTROL  (0)
+#define USBMIDI_IF_MIDI_STREAMING (1)
+
+/**
+ * Alternate settings of the MIDI streaming interface: USB-MIDI 1.0 event
+ * packets, or USB MIDI 2.0 Universal MIDI Packets.
+ */
+#define USBMIDI_ALT_MIDI1         (0)
+#define USBMIDI_ALT_UMP           (1)
+
+/**
+ * The Group Terminal Blocks of alternate setting 1, in usbmidi.c.
+ */
+extern const uint8_t g_pui8MidiGroupTerminalBlocks[USBMIDI_GTB_DESC_SIZE];
+
+/**
+ * Vendor requests, device or interface recipient, always device-to-host.
+ * These let a host tool read the stack state without using MIDI bandwidth.
+ */
+#define USBMIDI_VENDOR_GET_STATS  (0x01)	// returns tUSBMidiVendorStats
+#define USBMIDI_VENDOR_GET_CONFIG (0x02)	// returns tUSBMidiVendorConfig
+
 #endif /* DESCRIPTORS_H_ */
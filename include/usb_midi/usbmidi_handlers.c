@@ -11,6 +11,7 @@
 
 #include <stdbool.h>
 #include <stdint.h>
+#include <string.h>
 
 #include "inc/hw_memmap.h"
 #include "inc/hw_ints.h"
@@ -23,6 +24,7 @@
 #include "driverlib/timer.h"
 #include "driverlib/interrupt.h"
 #include "driverlib/uart.h"
+#include "driverlib/sysctl.h"
 
 #include "usblib/usblib.h"
 #include "usblib/usblibpriv.h"
@@ -30,13 +32,274 @@
 #include "usbmidi_handlers.h"
 #include "usbmidi_types.h"
 #include "usbmidi.h"
+#include "usbmidi_descriptors.h"
+#include "usbmidi_timestamp.h"
+
+/*
+ * Replies to EP0 requests. usblib sends straight out of these after
+ * HandleRequests() returns, so they cannot live on the stack.
+ */
+static tUSBMidiVendorStats g_sVendorStats;
+static tUSBMidiVendorConfig g_sVendorConfig;
+
+/*
+ * Send a reply to an IN request, no longer than the host asked for.
+ */
+static void EP0Reply(void *pvData, uint32_t ui32Size, tUSBRequest *pUSBRequest)
+{
+	if( ui32Size > pUSBRequest->wLength )
+		ui32Size = pUSBRequest->wLength;
+
+	// ACK the setup packet without setting last data; there is a data phase.
+	MAP_USBDevEndpointDataAck(USB0_BASE, USB_EP_0, false);
+	USBDCDSendDataEP0(0, (uint8_t *) pvData, ui32Size);
+}
+
+/*
+ * Audio Control / MIDI Streaming class requests.
+ *
+ * This function has no Feature or other Units, and neither its interfaces nor
+ * its endpoints have controls, so every GET or SET names a control that does
+ * not exist. Audio 1.0 (5.2.1) has those stalled. Answering a GET with zeros
+ * would tell the host the control is there and reads zero.
+ */
+static void HandleClassRequest(tUSBMidiDevice *psUSBMidiDevice)
+{
+	psUSBMidiDevice->sStats.stalledRequests++;
+	USBDCDStallEP0(0);
+}
+
+/*
+ * Vendor requests: read-only views of the stack, so a host tool can check on a
+ * running board without touching the MIDI endpoints.
+ */
+static void HandleVendorRequest(tUSBMidiDevice *psUSBMidiDevice, tUSBRequest *pUSBRequest)
+{
+	tUSBMidiInstance *psInst;
+	USBMIDIStats_t *psStats;
+	USBMIDISysExStats_t sSysExStats;
+
+	psInst = &psUSBMidiDevice->sPrivateData;
+	psStats = &psUSBMidiDevice->sStats;
+
+	if( (pUSBRequest->bmRequestType & USB_RTYPE_DIR_M) != USB_RTYPE_DIR_IN )
+	{
+		psStats->stalledRequests++;
+		USBDCDStallEP0(0);
+		return;
+	}
+
+	switch( pUSBRequest->bRequest )
+	{
+		case USBMIDI_VENDOR_GET_STATS:
+			USBMIDISysEx_GetStats(&psUSBMidiDevice->OutEpSysEx, &sSysExStats);
+			g_sVendorStats.ui32Connected = psInst->bConnected;
+			g_sVendorStats.ui32EnumToFirstEvent = psInst->bFirstEventSeen ?
+					(psInst->ui32FirstEventTime - psInst->ui32ConfigTime) : 0;
+			g_sVendorStats.ui32ClassRequests = psStats->classRequests;
+			g_sVendorStats.ui32VendorRequests = psStats->vendorRequests;
+			g_sVendorStats.ui32StalledRequests = psStats->stalledRequests;
+			g_sVendorStats.ui32InFifoCount = psUSBMidiDevice->InEpMsgFifo.count;
+			g_sVendorStats.ui32OutFifoCount = psUSBMidiDevice->OutEpMsgFifo.count;
+			g_sVendorStats.ui32SysExBlocksInUse = sSysExStats.blocksInUse;
+			g_sVendorStats.ui32SysExBlocksHighWater = sSysExStats.blocksHighWater;
+			g_sVendorStats.ui32SysExMessages = sSysExStats.messages;
+			g_sVendorStats.ui32SysExDropped = sSysExStats.poolExhausted + sSysExStats.queueFull;
+			g_sVendorStats.ui32Suspends = psStats->suspends;
+			g_sVendorStats.ui32RemoteWakeups = psStats->remoteWakeups;
+			g_sVendorStats.ui32ResumeToFirstEvent = psInst->ui32ResumeToFirstEvent;
+			g_sVendorStats.ui32InFifoOverflows = psStats->inMsg.drops + psStats->inUmp.drops;
+			g_sVendorStats.ui32OutFifoOverflows = psStats->outMsg.drops;
+			g_sVendorStats.ui32InNotesOn = USBMIDINotes_Count(&psUSBMidiDevice->InEpNotes);
+			g_sVendorStats.ui32OutNotesOn = USBMIDINotes_Count(&psUSBMidiDevice->OutEpNotes);
+			g_sVendorStats.ui32ProbeLatency = psInst->ui32ProbeLatency;
+			g_sVendorStats.ui32ProbeLatencyMax = psInst->ui32ProbeLatencyMax;
+			g_sVendorStats.ui32RtFifoOverflows = psStats->inRt.drops;
+			g_sVendorStats.ui32ClockInCycles = psUSBMidiDevice->OutEpClock.stats.cycles;
+			g_sVendorStats.ui32ClockInCyclesMax = psUSBMidiDevice->OutEpClock.stats.cyclesMax;
+			g_sVendorStats.ui32AltSetting = psInst->ui8AltSetting;
+			EP0Reply(&g_sVendorStats, sizeof(g_sVendorStats), pUSBRequest);
+			break;
+
+		case USBMIDI_VENDOR_GET_CONFIG:
+			g_sVendorConfig.ui32SysClock = MAP_SysCtlClockGet();
+			g_sVendorConfig.ui32FifoSize = MIDI_USB_FIFO_SIZE;
+			g_sVendorConfig.ui32SysExBlockSize = USBMIDI_SYSEX_BLOCK_SIZE;
+			g_sVendorConfig.ui32SysExNumBlocks = USBMIDI_SYSEX_NUM_BLOCKS;
+			g_sVendorConfig.ui32SysExNumCables = USBMIDI_SYSEX_NUM_CABLES;
+			EP0Reply(&g_sVendorConfig, sizeof(g_sVendorConfig), pUSBRequest);
+			break;
+
+		default:
+			psStats->stalledRequests++;
+			USBDCDStallEP0(0);
+			break;
+	}
+}
 
 /**
- * USB MIDI does define some class-specific requests, which we do not handle.
+ * EP0 requests that usblib does not handle itself. Our vendor requests are
+ * answered; class-specific Audio Control requests are counted and stalled, as
+ * HandleClassRequest() explains, and so is everything else.
  */
 void HandleRequests(void *pvMidiDevice, tUSBRequest *pUSBRequest)
 {
-	USBDCDStallEP0(0);
+	tUSBMidiDevice *psUSBMidiDevice;
+
+	psUSBMidiDevice = (tUSBMidiDevice *) pvMidiDevice;
+
+	switch( pUSBRequest->bmRequestType & USB_RTYPE_TYPE_M )
+	{
+		case USB_RTYPE_CLASS:
+			psUSBMidiDevice->sStats.classRequests++;
+			HandleClassRequest(psUSBMidiDevice);
+			break;
+
+		case USB_RTYPE_VENDOR:
+			psUSBMidiDevice->sStats.vendorRequests++;
+			HandleVendorRequest(psUSBMidiDevice, pUSBRequest);
+			break;
+
+		default:
+			psUSBMidiDevice->sStats.stalledRequests++;
+			USBDCDStallEP0(0);
+			break;
+	}
+}
+
+/**
+ * GET_DESCRIPTOR for a descriptor type usblib does not know. The only one is
+ * the USB MIDI 2.0 Group Terminal Block set of our MIDI streaming interface,
+ * asked for by alternate setting. usblib has already ACKed the setup packet.
+ */
+void HandleGetDescriptor(void *pvMidiDevice, tUSBRequest *pUSBRequest)
+{
+	tUSBMidiDevice *psUSBMidiDevice;
+	uint32_t ui32Size;
+
+	psUSBMidiDevice = (tUSBMidiDevice *) pvMidiDevice;
+
+	if( ((pUSBRequest->wValue >> 8) == USB_DTYPE_CS_GR_TRM_BLOCK) &&
+			((pUSBRequest->wValue & 0xFF) == USBMIDI_ALT_UMP) &&
+			((pUSBRequest->wIndex & 0xFF) == USBMIDI_IF_MIDI_STREAMING) )
+	{
+		ui32Size = sizeof(g_pui8MidiGroupTerminalBlocks);
+		if( ui32Size > pUSBRequest->wLength )
+			ui32Size = pUSBRequest->wLength;
+		USBDCDSendDataEP0(0, (uint8_t *) g_pui8MidiGroupTerminalBlocks, ui32Size);
+	}
+	else
+	{
+		psUSBMidiDevice->sStats.stalledRequests++;
+		USBDCDStallEP0(0);
+	}
+}
+
+/*
+ * Forget any UMP and half-translated SysEx, when the stream format changes.
+ */
+static void UmpReset(tUSBMidiDevice *psUSBMidiDevice)
+{
+	USBMIDIUmpFifo_Init(&psUSBMidiDevice->InEpUmpFifo);
+	USBMIDIUmpFifo_Init(&psUSBMidiDevice->OutEpUmpFifo);
+	USBMIDIUmp_XlateInit(&psUSBMidiDevice->InEpUmpUp);
+	USBMIDIUmp_XlateInit(&psUSBMidiDevice->InEpSysExUp);
+	USBMIDIUmp_XlateInit(&psUSBMidiDevice->InEpUmpDown);
+	USBMIDIUmp_XlateInit(&psUSBMidiDevice->OutEpUmpDown);
+}
+
+/**
+ * SET_INTERFACE: the host picked USB-MIDI 1.0 event packets or USB MIDI 2.0
+ * Universal MIDI Packets for the MIDI streaming interface. usblib has set up the
+ * endpoints again, so an IN packet in flight is gone. Messages still queued
+ * are kept; they are translated as they go out.
+ */
+void HandleInterfaceChange(void *pvMidiDevice, uint8_t ui8InterfaceNum, uint8_t ui8AlternateSetting)
+{
+	tUSBMidiDevice *psUSBMidiDevice;
+	tUSBMidiInstance *psInst;
+
+	psUSBMidiDevice = (tUSBMidiDevice *) pvMidiDevice;
+	psInst = &psUSBMidiDevice->sPrivateData;
+
+	if( ui8InterfaceNum != USBMIDI_IF_MIDI_STREAMING )
+		return;
+
+	psInst->ui8AltSetting = ui8AlternateSetting;
+	USBMIDISysEx_Reset(&psUSBMidiDevice->OutEpSysEx);
+	UmpReset(psUSBMidiDevice);
+	USBMIDILoopback_Reset(&psUSBMidiDevice->InEpLoopback);
+
+	psInst->iUSBMidiTxState = eUsbMidiStateIdle;
+	USBMIDI_InEpSendMessages();
+}
+
+/*
+ * One event packet from the host, on either alternate setting: SysEx goes to
+ * the pool, everything else to the OUT FIFO, with the clock and MTC followers
+ * and the parameter decoder watching on the way.
+ */
+static void OutEpMessage(tUSBMidiDevice *psUsbMidiDevice, USBMIDI_Message_t *usbmep, uint32_t rxTime)
+{
+	uint32_t cycles;
+
+	if( USBMIDISysEx_Feed(&psUsbMidiDevice->OutEpSysEx, usbmep) )
+		return;
+
+	// Timing Clocks also go on to the FIFO; the follower only watches.
+	cycles = USBMIDI_Timestamp();
+	if( USBMIDIClockIn_Feed(&psUsbMidiDevice->OutEpClock, usbmep, rxTime) )
+	{
+		cycles = USBMIDI_Timestamp() - cycles;
+		psUsbMidiDevice->OutEpClock.stats.cycles = cycles;
+		if( cycles > psUsbMidiDevice->OutEpClock.stats.cyclesMax )
+			psUsbMidiDevice->OutEpClock.stats.cyclesMax = cycles;
+	}
+	USBMIDIMtcIn_Feed(&psUsbMidiDevice->OutEpMtc, usbmep, rxTime);
+	USBMIDIParamDec_Feed(&psUsbMidiDevice->OutEpParam, usbmep);
+	USBMIDIStats_Depth(&psUsbMidiDevice->sStats.outParam, psUsbMidiDevice->OutEpParam.fifo.count);
+	if( psUsbMidiDevice->OutEpMsgFifo.count < MIDI_USB_FIFO_SIZE )
+	{
+		USBMIDIFIFO_Push(&psUsbMidiDevice->OutEpMsgFifo, usbmep);
+		USBMIDINotes_Track(&psUsbMidiDevice->OutEpNotes, usbmep);
+		USBMIDIStats_Depth(&psUsbMidiDevice->sStats.outMsg, psUsbMidiDevice->OutEpMsgFifo.count);
+	}
+	else
+	{
+		// a lost Note Off leaves its note marked on, for USBMIDI_Panic().
+		psUsbMidiDevice->sStats.outMsg.drops++;
+	}
+}
+
+/*
+ * A packet of UMP from the host. Each UMP is kept for USBMIDI_UmpRead() and
+ * translated to event packets for everything else. A UMP cut off by the end of
+ * the packet is dropped.
+ */
+static void OutEpUmp(tUSBMidiDevice *psUsbMidiDevice, const uint32_t *words, uint32_t count, uint32_t rxTime)
+{
+	USBMIDI_Message_t msg[USBMIDI_UMP_MAX_MIDI1];
+	uint32_t size;
+	uint32_t n;
+	uint32_t i;
+
+	while( count )
+	{
+		size = USBMIDI_UMP_WORDS(words[0]);
+		if( size > count )
+			break;
+
+		if( USBMIDIUmpFifo_Push(&psUsbMidiDevice->OutEpUmpFifo, words) )
+			USBMIDIStats_Depth(&psUsbMidiDevice->sStats.outUmp, psUsbMidiDevice->OutEpUmpFifo.count);
+		else
+			psUsbMidiDevice->sStats.outUmp.drops++;
+		n = USBMIDIUmp_ToMidi1(&psUsbMidiDevice->OutEpUmpDown, words, msg);
+		for( i = 0; i < n; i++ )
+			OutEpMessage(psUsbMidiDevice, &msg[i], rxTime);
+
+		words += size;
+		count -= size;
+	}
 }
 
 /**
@@ -67,12 +330,16 @@ void HandleEndpoints(void *pvMidiDevice, uint32_t ui32Status)
 	tUSBMidiInstance *psInst;
 	uint32_t ui32EPStatus;
 	uint32_t bytecount;
-	uint8_t buf[64];	// read endpoint data into this, which is max packet size
+	uint32_t buf[USBMIDI_MAX_PACKET_SIZE / 4];	// read endpoint data into this, word aligned for UMP
 	uint8_t *pbuf;
 	USBMIDI_Message_t usbmep;			// build a message into this.
+	uint32_t rxTime;
+	uint32_t isrTime;
 
 	ASSERT(pvMidiDevice != 0);
 
+	isrTime = USBMIDI_Timestamp();
+
 	// Get a pointer to our device record.
 	psUsbMidiDevice = (tUSBMidiDevice *) pvMidiDevice;
 	psInst = &psUsbMidiDevice->sPrivateData;
@@ -90,21 +357,51 @@ void HandleEndpoints(void *pvMidiDevice, uint32_t ui32Status)
 		// I suppose that checking the data available amounts to the same thing.
 		if( ui32EPStatus & USB_DEV_RX_PKT_RDY )
 		{
+			// first traffic since the host configured us?
+			if( !psInst->bFirstEventSeen )
+			{
+				psInst->ui32FirstEventTime = USBMIDI_Timestamp();
+				psInst->bFirstEventSeen = true;
+			}
+
+			// arrival time of everything in the packet, for the clock follower and MTC.
+			rxTime = USBMIDI_Timestamp();
+
 			// Data are being sent to us from the host.
-			// Get all bytes in buffer.
-			bytecount = MAP_USBEndpointDataAvail(USB0_BASE, USB_EP_1);
-			MAP_USBEndpointDataGet(USB0_BASE, USB_EP_1, buf, &bytecount);
-			// now take the contents of buf and make a bunch of MIDI packets
-			// and push them to the incoming data FIFO.
-			pbuf = buf;
-			while( bytecount ) {
-				usbmep.header = *pbuf++;
-				usbmep.byte1  = *pbuf++;
-				usbmep.byte2  = *pbuf++;
-				usbmep.byte3  = *pbuf++;
-				USBMIDIFIFO_Push(&psUsbMidiDevice->OutEpMsgFifo, &usbmep);
-				bytecount -= 4;
+			// Get all bytes in buffer, but no more than it holds.
+			// Only whole 4-byte events are parsed: the tail of a malformed
+			// packet is dropped rather than underflowing the count below.
+			bytecount = sizeof(buf);
+			MAP_USBEndpointDataGet(USB0_BASE, USB_EP_1, (uint8_t *) buf, &bytecount);
+			bytecount &= ~3UL;
+			psUsbMidiDevice->sStats.outPackets++;
+			psUsbMidiDevice->sStats.outWords += bytecount / 4;
+			if( psInst->ui8AltSetting == USBMIDI_ALT_UMP )
+			{
+				OutEpUmp(psUsbMidiDevice, buf, bytecount / 4, rxTime);
 			}
+			else
+			{
+				// now take the contents of buf and make a bunch of MIDI packets
+				// and push them to the incoming data FIFO.
+				// SysEx fragments are streamed into the SysEx pool instead.
+				pbuf = (uint8_t *) buf;
+				while( bytecount ) {
+					usbmep.header = *pbuf++;
+					usbmep.byte1  = *pbuf++;
+					usbmep.byte2  = *pbuf++;
+					usbmep.byte3  = *pbuf++;
+					OutEpMessage(psUsbMidiDevice, &usbmep, rxTime);
+					bytecount -= 4;
+				}
+			}
+			// an MSB left waiting at the end of the packet goes out on its own.
+			USBMIDIParamDec_Flush(&psUsbMidiDevice->OutEpParam);
+
+			// measuring latency: echo the packet, now if the IN endpoint is free.
+			if( USBMIDILoopback_Rx(&psUsbMidiDevice->InEpLoopback, rxTime) &&
+					(psInst->iUSBMidiTxState == eUsbMidiStateIdle) )
+				USBMIDI_InEpSendMessages();
 
 			// ack the data, thus freeing the host to send the next packet.
 			MAP_USBDevEndpointDataAck(USB0_BASE, USB_EP_1, true);
@@ -116,10 +413,33 @@ void HandleEndpoints(void *pvMidiDevice, uint32_t ui32Status)
 	// Check to see if there are more MIDI messages to send, and do so if there are.
 	if( ui32Status & USB_INTEP_DEV_IN_1 )
 	{
+		// first packet out since the bus resumed?
+		if( psInst->bResumeTiming )
+		{
+			psInst->ui32ResumeToFirstEvent = USBMIDI_Timestamp() - psInst->ui32ResumeTime;
+			psInst->bResumeTiming = false;
+		}
+
+		// the packet holding the probed message has been collected.
+		if( psInst->iProbeState == eUsbMidiProbeInFlight )
+		{
+			psInst->ui32ProbeLatency = USBMIDI_Timestamp() - psInst->ui32ProbeTime;
+			if( psInst->ui32ProbeLatency > psInst->ui32ProbeLatencyMax )
+				psInst->ui32ProbeLatencyMax = psInst->ui32ProbeLatency;
+			psInst->iProbeState = eUsbMidiProbeIdle;
+		}
+		USBMIDILoopback_Ack(&psUsbMidiDevice->InEpLoopback, USBMIDI_Timestamp());
+
 		// Indicate that the endpoint is ready for new data.
 	    psInst->iUSBMidiTxState = eUsbMidiStateIdle;
 		USBMIDI_InEpSendMessages();
 	}
+
+	isrTime = USBMIDI_Timestamp() - isrTime;
+	psUsbMidiDevice->sStats.isrCalls++;
+	psUsbMidiDevice->sStats.isrCycles = isrTime;
+	if( isrTime > psUsbMidiDevice->sStats.isrCyclesMax )
+		psUsbMidiDevice->sStats.isrCyclesMax = isrTime;
 }
 
 // This should indicate that we are attached to the bus
@@ -127,15 +447,43 @@ void HandleConfigChange(void *pvMidiDevice, uint32_t ui32Status) {
 
 	tUSBMidiDevice *psUSBMidiDevice;
 	tUSBMidiInstance *psInst;
+	uint8_t i;
 
 	psUSBMidiDevice = (tUSBMidiDevice *) pvMidiDevice;
 	psInst = &psUSBMidiDevice->sPrivateData;
     psInst->bConnected = true;
+    psInst->bSuspended = false;
+    psInst->ui32ConfigTime = USBMIDI_Timestamp();
+    psInst->bFirstEventSeen = false;
     psInst->iUSBMidiRxState = eUsbMidiStateIdle;
     psInst->iUSBMidiTxState = eUsbMidiStateIdle;
+    psInst->ui8AltSetting = USBMIDI_ALT_MIDI1;
+    psUSBMidiDevice->sStats.configs++;
 
-	USBMIDIFIFO_Init(&psUSBMidiDevice->InEpMsgFifo);
-	USBMIDIFIFO_Init(&psUSBMidiDevice->OutEpMsgFifo);
+	USBMIDISysEx_Reset(&psUSBMidiDevice->OutEpSysEx);
+	UmpReset(psUSBMidiDevice);
+	psUSBMidiDevice->InEpSysEx.busy = false;
+	USBMIDIRtFifo_Init(&psUSBMidiDevice->InEpRtFifo);
+	USBMIDIClockIn_Reset(&psUSBMidiDevice->OutEpClock);
+	USBMIDIMtcIn_Reset(&psUSBMidiDevice->OutEpMtc);
+	USBMIDIParamDec_Reset(&psUSBMidiDevice->OutEpParam);
+	for( i = 0; i < USBMIDI_PARAM_NUM_CABLES; i++ )
+		USBMIDIParamEnc_Forget(&psUSBMidiDevice->InEpParam[i]);
+	USBMIDILoopback_Reset(&psUSBMidiDevice->InEpLoopback);
+
+	if( psUSBMidiDevice->InEpReplay.enabled )
+	{
+		// keep whatever was queued before the reset, then add what was held since.
+		USBMIDIReplay_Drain(&psUSBMidiDevice->InEpReplay, &psUSBMidiDevice->InEpMsgFifo,
+				psUSBMidiDevice->sStats.ms);
+		USBMIDI_InEpSendMessages();
+	}
+	else
+	{
+		USBMIDIFIFO_Init(&psUSBMidiDevice->InEpMsgFifo);
+		USBMIDIFIFO_Init(&psUSBMidiDevice->OutEpMsgFifo);
+		USBMIDINotes_Init(&psUSBMidiDevice->InEpNotes);
+	}
 
 }
 
@@ -147,12 +495,76 @@ void HandleDisconnect(void *pvMidiDevice) {
 	psUSBMidiDevice = (tUSBMidiDevice *) pvMidiDevice;
 	psInst = &psUSBMidiDevice->sPrivateData;
     psInst->bConnected = false;
+    psUSBMidiDevice->sStats.disconnects++;
+
+    // the host will not turn off what it left on.
+    USBMIDINotes_AllOff(&psUSBMidiDevice->OutEpNotes, &psUSBMidiDevice->OutEpMsgFifo);
 
 }
 
+/**
+ * Bus reset. The host will enumerate us again, so until the next configuration
+ * outgoing messages have to go to the replay buffer (or be dropped).
+ */
+void HandleReset(void *pvMidiDevice) {
+
+	tUSBMidiDevice *psUSBMidiDevice;
+	tUSBMidiInstance *psInst;
+
+	psUSBMidiDevice = (tUSBMidiDevice *) pvMidiDevice;
+	psInst = &psUSBMidiDevice->sPrivateData;
+    psInst->bConnected = false;
+    psInst->bSuspended = false;
+    psInst->iUSBMidiTxState = eUsbMidiStateUnconfigured;
+    psInst->ui8AltSetting = USBMIDI_ALT_MIDI1;
+    psUSBMidiDevice->sStats.resets++;
+
+    // clocks are only good on time.
+    USBMIDIRtFifo_Init(&psUSBMidiDevice->InEpRtFifo);
+
+    USBMIDINotes_AllOff(&psUSBMidiDevice->OutEpNotes, &psUSBMidiDevice->OutEpMsgFifo);
+
+}
+
+/**
+ * The bus went idle. Only note it here: the main loop sees USBMIDI_IsSuspended()
+ * and sleeps, and messages written meanwhile stay in the IN FIFO until resume.
+ * The endpoint and FIFO state is left exactly as it was.
+ */
 void HandleSuspend(void *pvMidiDevice) {
+
+	tUSBMidiDevice *psUSBMidiDevice;
+	tUSBMidiInstance *psInst;
+
+	psUSBMidiDevice = (tUSBMidiDevice *) pvMidiDevice;
+	psInst = &psUSBMidiDevice->sPrivateData;
+    psInst->ui32SuspendedMs = 0;
+    psUSBMidiDevice->sStats.suspends++;
+    psInst->bSuspended = true;
+
 }
 
+/**
+ * The bus is back, whether the host resumed us or answered our remote wakeup.
+ * Nothing was torn down on suspend, so the only work is sending whatever was
+ * queued meanwhile; the time until that first packet is delivered is recorded.
+ */
 void HandleResume(void *pvMidiDevice) {
+
+	tUSBMidiDevice *psUSBMidiDevice;
+	tUSBMidiInstance *psInst;
+
+	psUSBMidiDevice = (tUSBMidiDevice *) pvMidiDevice;
+	psInst = &psUSBMidiDevice->sPrivateData;
+    psInst->bSuspended = false;
+    psInst->bWakePending = false;
+    psInst->ui32ResumeTime = USBMIDI_Timestamp();
+    psInst->bResumeTiming = true;
+
+    if( psInst->iUSBMidiTxState == eUsbMidiStateIdle )
+    {
+    	USBMIDI_InEpSendMessages();
+    }
+
 }
 
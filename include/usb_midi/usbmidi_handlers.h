@@ -15,8 +15,11 @@
 #include "usblib/device/usbdevice.h"
 
 void HandleRequests(void *pvMidiDevice, tUSBRequest *pUSBRequest);
+void HandleGetDescriptor(void *pvMidiDevice, tUSBRequest *pUSBRequest);
+void HandleInterfaceChange(void *pvMidiDevice, uint8_t ui8InterfaceNum, uint8_t ui8AlternateSetting);
 void HandleConfigChange(void *pvMidiDevice, uint32_t ui32Info);
 void HandleDisconnect(void *pvMidiDevice);
+void HandleReset(void *pvMidiDevice);
 void HandleEndpoints(void *pvMidiDevice, uint32_t ui32Status);
 void HandleSuspend(void *pvMidiDevice);
 void HandleResume(void *pvMidiDevice);
@@ -0,0 +1,226 @@
+/*
+ * usbmidi_loopback.c
+ *
+ * Loopback latency measurement. See usbmidi_loopback.h.
+ *
+ *  Created on: Oct 18, 2026
+ *
+ * MODS:
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "midi.h"
+#include "usb_midi.h"
+#include "usbmidi_ump.h"
+#include "usbmidi_loopback.h"
+
+static void Clear(USBMIDILoopback_t *lb)
+{
+	memset(&lb->report, 0, sizeof(lb->report));
+	lb->report.rxToTx.min = UINT32_MAX;
+	lb->report.txToAck.min = UINT32_MAX;
+}
+
+void USBMIDILoopback_Init(USBMIDILoopback_t *lb)
+{
+	lb->enabled = false;
+	lb->seq = 0;
+	lb->inFlight = 0;
+	lb->txTime = 0;
+	USBMIDILoopbackRing_Init(&lb->pending);
+	Clear(lb);
+}
+
+bool USBMIDILoopback_Command(USBMIDILoopback_t *lb, uint8_t cmd)
+{
+	switch( cmd )
+	{
+	case USBMIDI_LOOPBACK_CMD_START:
+		// echoes from before have sequence numbers the host no longer expects.
+		USBMIDILoopbackRing_Init(&lb->pending);
+		lb->inFlight = 0;
+		lb->seq = 0;
+		Clear(lb);
+		lb->enabled = true;
+		return true;
+	case USBMIDI_LOOPBACK_CMD_STOP:
+		lb->enabled = false;
+		return true;
+	case USBMIDI_LOOPBACK_CMD_REPORT:
+		return true;
+	case USBMIDI_LOOPBACK_CMD_CLEAR:
+		Clear(lb);
+		return true;
+	default:
+		return false;
+	}
+}
+
+void USBMIDILoopback_Reset(USBMIDILoopback_t *lb)
+{
+	lb->report.dropped += lb->pending.count + lb->inFlight;
+	USBMIDILoopbackRing_Init(&lb->pending);
+	lb->inFlight = 0;
+}
+
+bool USBMIDILoopback_Rx(USBMIDILoopback_t *lb, uint32_t rxTime)
+{
+	USBMIDILoopbackEcho_t echo;
+
+	if( !lb->enabled )
+		return false;
+
+	// a lost echo still uses its number, so the host sees the gap.
+	echo.rxTime = rxTime;
+	echo.seq = lb->seq;
+	lb->seq = (lb->seq + 1) & 0x3FFF;
+	lb->report.packets++;
+	if( !USBMIDILoopbackRing_Push(&lb->pending, &echo) )
+	{
+		lb->report.dropped++;
+		return false;
+	}
+	return true;
+}
+
+/*
+ * Bucket of a latency: its highest set bit, in five steps.
+ */
+static uint32_t Bucket(uint32_t cycles)
+{
+	uint32_t b = 0;
+
+	if( cycles >= (1UL << 16) ) { cycles >>= 16; b += 16; }
+	if( cycles >= (1UL << 8) ) { cycles >>= 8; b += 8; }
+	if( cycles >= (1UL << 4) ) { cycles >>= 4; b += 4; }
+	if( cycles >= (1UL << 2) ) { cycles >>= 2; b += 2; }
+	if( cycles >= (1UL << 1) ) b += 1;
+
+	return (b < USBMIDI_LOOPBACK_BUCKETS) ? b : USBMIDI_LOOPBACK_BUCKETS - 1;
+}
+
+static void Record(USBMIDILoopbackHist_t *h, uint32_t cycles, uint32_t n)
+{
+	h->count += n;
+	h->bucket[Bucket(cycles)] += n;
+	if( cycles < h->min )
+		h->min = cycles;
+	if( cycles > h->max )
+		h->max = cycles;
+}
+
+/*
+ * An echo goes into a packet being loaded at time now.
+ */
+static void Load(USBMIDILoopback_t *lb, const USBMIDILoopbackEcho_t *echo, uint32_t now)
+{
+	Record(&lb->report.rxToTx, now - echo->rxTime, 1);
+	lb->report.sent++;
+	lb->inFlight++;
+	lb->txTime = now;
+}
+
+uint32_t USBMIDILoopback_FillMidi1(USBMIDILoopback_t *lb, uint8_t *buf, uint32_t room, uint32_t now)
+{
+	USBMIDILoopbackEcho_t echo;
+	uint32_t n = 0;
+
+	while( (room - n >= USBMIDI_LOOPBACK_ECHO_BYTES) && USBMIDILoopbackRing_Pop(&lb->pending, &echo) )
+	{
+		Load(lb, &echo, now);
+		buf[n++] = USB_MIDI_HEADER(USBMIDI_LOOPBACK_CABLE, USB_MIDI_CIN_SYSEXSTART);
+		buf[n++] = MIDI_MSG_SOX;
+		buf[n++] = USBMIDI_LOOPBACK_SYSEX_ID;
+		buf[n++] = USBMIDI_LOOPBACK_SYSEX_SUBID;
+		buf[n++] = USB_MIDI_HEADER(USBMIDI_LOOPBACK_CABLE, USB_MIDI_CIN_SYSEXSTART);
+		buf[n++] = USBMIDI_LOOPBACK_ECHO;
+		buf[n++] = echo.seq & 0x7F;
+		buf[n++] = echo.seq >> 7;
+		buf[n++] = USB_MIDI_HEADER(USBMIDI_LOOPBACK_CABLE, USB_MIDI_CIN_SYSEND1);
+		buf[n++] = MIDI_MSG_EOX;
+		buf[n++] = 0;
+		buf[n++] = 0;
+	}
+	return n;
+}
+
+uint32_t USBMIDILoopback_FillUmp(USBMIDILoopback_t *lb, uint32_t *words, uint32_t room, uint32_t now)
+{
+	USBMIDILoopbackEcho_t echo;
+	uint32_t n = 0;
+
+	// complete in one UMP: status 0, five bytes.
+	while( (room - n >= USBMIDI_LOOPBACK_ECHO_WORDS) && USBMIDILoopbackRing_Pop(&lb->pending, &echo) )
+	{
+		Load(lb, &echo, now);
+		words[n++] = ((uint32_t) USBMIDI_UMP_MT_SYSEX7 << 28) | ((uint32_t) USBMIDI_LOOPBACK_CABLE << 24) |
+				(5UL << 16) | ((uint32_t) USBMIDI_LOOPBACK_SYSEX_ID << 8) | USBMIDI_LOOPBACK_SYSEX_SUBID;
+		words[n++] = ((uint32_t) USBMIDI_LOOPBACK_ECHO << 24) | ((uint32_t) (echo.seq & 0x7F) << 16) |
+				((uint32_t) (echo.seq >> 7) << 8);
+	}
+	return n;
+}
+
+void USBMIDILoopback_Ack(USBMIDILoopback_t *lb, uint32_t now)
+{
+	if( !lb->inFlight )
+		return;
+
+	// every echo in the packet waited the same.
+	Record(&lb->report.txToAck, now - lb->txTime, lb->inFlight);
+	lb->report.acked += lb->inFlight;
+	lb->inFlight = 0;
+}
+
+static uint8_t *Put32(uint8_t *p, uint32_t v)
+{
+	uint32_t i;
+
+	for( i = 0; i < 5; i++ )
+	{
+		*p++ = v & 0x7F;
+		v >>= 7;
+	}
+	return p;
+}
+
+static uint8_t *PutHist(uint8_t *p, const USBMIDILoopbackHist_t *h)
+{
+	uint32_t b;
+
+	p = Put32(p, h->count);
+	p = Put32(p, h->count ? h->min : 0);
+	p = Put32(p, h->max);
+	for( b = 0; b < USBMIDI_LOOPBACK_BUCKETS; b++ )
+		p = Put32(p, h->bucket[b]);
+	return p;
+}
+
+uint32_t USBMIDILoopback_Reply(const USBMIDILoopbackReport_t *report, uint8_t cmd, uint32_t cpuHz,
+		uint8_t *buf)
+{
+	uint8_t *p = buf;
+
+	*p++ = MIDI_MSG_SOX;
+	*p++ = USBMIDI_LOOPBACK_SYSEX_ID;
+	*p++ = USBMIDI_LOOPBACK_SYSEX_SUBID;
+	*p++ = USBMIDI_LOOPBACK_REPLY;
+	*p++ = cmd & 0x7F;
+	if( cmd == USBMIDI_LOOPBACK_CMD_REPORT )
+	{
+		p = Put32(p, cpuHz);
+		p = Put32(p, report->packets);
+		p = Put32(p, report->dropped);
+		p = Put32(p, report->sent);
+		p = Put32(p, report->acked);
+		*p++ = USBMIDI_LOOPBACK_BUCKETS;
+		p = PutHist(p, &report->rxToTx);
+		p = PutHist(p, &report->txToAck);
+	}
+	*p++ = MIDI_MSG_EOX;
+
+	return p - buf;
+}
@@ -0,0 +1,197 @@
+/*
+ * usbmidi_loopback.h
+ *
+ * Loopback latency measurement: the device answers every OUT packet with an
+ * echo, and times each echo through the stack.
+ *
+ * While the mode is on, each OUT packet from the host is stamped as it
+ * arrives in the endpoint interrupt and gets one echo, carrying a 14-bit
+ * sequence number counted from 0 when the mode was started. The packet itself
+ * is handled as usual. Echoes go out at the head of the next IN packet, after
+ * timing messages. Two times are kept for each echo:
+ *
+ * - rx to tx: from the OUT packet's arrival to its echo being loaded into the
+ *   IN endpoint, which includes waiting for the packet in the endpoint ahead
+ *   of it to be collected.
+ * - tx to ack: from the echo being loaded to the host collecting the packet,
+ *   seen as the IN completion interrupt.
+ *
+ * Both go into histograms of CPU cycles with power-of-two buckets. The host
+ * times the whole round trip itself; together these say how much of it is the
+ * device. See tools/loopback.c.
+ *
+ * Protocol. Every message is F0 7D 4C <cmd> ... F7 (7D is the non-commercial
+ * manufacturer ID, 4C is 'L'), on cable 0. Multi-byte numbers are sent as
+ * 7-bit groups, least significant first, as for the firmware updater.
+ *
+ *   START   01		clear everything, sequence to 0, mode on
+ *   STOP    02		mode off; echoes already queued still go out
+ *   REPORT  03		counters and histograms
+ *   CLEAR   04		clear counters and histograms
+ *
+ * Each command is answered with F0 7D 4C 7F <cmd> F7, REPORT with its report
+ * between <cmd> and F7:
+ *
+ *   <cpu Hz: 5> <packets: 5> <dropped: 5> <sent: 5> <acked: 5> <buckets: 1>
+ *   then rx to tx and tx to ack, each <count: 5> <min: 5> <max: 5> and
+ *   <buckets> counts of 5 bytes.
+ *
+ * An echo is F0 7D 4C 10 <seq: 2> F7; on alternate setting 1 the same bytes
+ * as one 7-bit SysEx UMP.
+ *
+ * Nothing here touches hardware.
+ *
+ *  Created on: Oct 18, 2026
+ *
+ * MODS:
+ */
+
+#ifndef USB_MIDI_USBMIDI_LOOPBACK_H_
+#define USB_MIDI_USBMIDI_LOOPBACK_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "usbmidi_ring.h"
+
+/**
+ * Echoes waiting for the IN endpoint. Must be a power of two.
+ */
+#ifndef USBMIDI_LOOPBACK_DEPTH
+#define USBMIDI_LOOPBACK_DEPTH 16
+#endif
+
+/**
+ * Histogram buckets. Bucket 0 counts 0 and 1 cycle, bucket b 2^b up to
+ * 2^(b+1) - 1, and the last one everything longer: 105 ms and more at 80 MHz.
+ */
+#define USBMIDI_LOOPBACK_BUCKETS	24
+
+/**
+ * Protocol constants.
+ */
+#define USBMIDI_LOOPBACK_SYSEX_ID		0x7D
+#define USBMIDI_LOOPBACK_SYSEX_SUBID	0x4C
+
+#define USBMIDI_LOOPBACK_CMD_START		0x01
+#define USBMIDI_LOOPBACK_CMD_STOP		0x02
+#define USBMIDI_LOOPBACK_CMD_REPORT		0x03
+#define USBMIDI_LOOPBACK_CMD_CLEAR		0x04
+#define USBMIDI_LOOPBACK_ECHO			0x10
+#define USBMIDI_LOOPBACK_REPLY			0x7F
+
+#define USBMIDI_LOOPBACK_CABLE			0
+
+/**
+ * Size of the reply to REPORT, F0 to F7.
+ */
+#define USBMIDI_LOOPBACK_REPORT_SIZE	(5 + 5 * 5 + 1 + 2 * (3 + USBMIDI_LOOPBACK_BUCKETS) * 5 + 1)
+
+/**
+ * Bytes of one echo on alternate setting 0, and words on alternate setting 1.
+ */
+#define USBMIDI_LOOPBACK_ECHO_BYTES		12
+#define USBMIDI_LOOPBACK_ECHO_WORDS		2
+
+/**
+ * \typedef USBMIDILoopbackHist_t
+ * Latencies in CPU cycles.
+ */
+typedef struct
+{
+	uint32_t count;
+	uint32_t min;
+	uint32_t max;
+	uint32_t bucket[USBMIDI_LOOPBACK_BUCKETS];
+} USBMIDILoopbackHist_t;
+
+/**
+ * \typedef USBMIDILoopbackReport_t
+ */
+typedef struct
+{
+	uint32_t packets;		//!< OUT packets seen while on
+	uint32_t dropped;		//!< echoes lost to a full queue or a bus reset
+	uint32_t sent;			//!< echoes loaded into the IN endpoint
+	uint32_t acked;			//!< echoes collected by the host
+	USBMIDILoopbackHist_t rxToTx;
+	USBMIDILoopbackHist_t txToAck;
+} USBMIDILoopbackReport_t;
+
+/**
+ * \typedef USBMIDILoopbackEcho_t
+ */
+typedef struct
+{
+	uint32_t rxTime;
+	uint16_t seq;
+} USBMIDILoopbackEcho_t;
+
+USBMIDI_RING_DEFINE(USBMIDILoopbackRing, USBMIDILoopbackEcho_t, USBMIDI_LOOPBACK_DEPTH);
+
+/**
+ * \typedef USBMIDILoopback_t
+ */
+typedef struct
+{
+	bool enabled;
+	uint16_t seq;			//!< of the next echo
+	uint8_t inFlight;		//!< echoes in the IN endpoint
+	uint32_t txTime;		//!< when they were loaded
+	USBMIDILoopbackRing_t pending;
+	USBMIDILoopbackReport_t report;
+} USBMIDILoopback_t;
+
+/**
+ * Off, nothing queued, everything cleared.
+ */
+void USBMIDILoopback_Init(USBMIDILoopback_t *lb);
+
+/**
+ * Carry out START, STOP, REPORT or CLEAR. REPORT changes nothing.
+ * \returns false for any other command.
+ */
+bool USBMIDILoopback_Command(USBMIDILoopback_t *lb, uint8_t cmd);
+
+/**
+ * Drop the echoes queued and in the endpoint, as on a bus reset. The mode,
+ * sequence and histograms are kept.
+ */
+void USBMIDILoopback_Reset(USBMIDILoopback_t *lb);
+
+/**
+ * An OUT packet arrived at rxTime. Nothing happens unless the mode is on.
+ * \returns true if an echo was queued.
+ */
+bool USBMIDILoopback_Rx(USBMIDILoopback_t *lb, uint32_t rxTime);
+
+/**
+ * True if echoes are waiting for the IN endpoint.
+ */
+static inline bool USBMIDILoopback_Pending(const USBMIDILoopback_t *lb)
+{
+	return lb->pending.count != 0;
+}
+
+/**
+ * Put waiting echoes into an IN packet being filled at time now, as event
+ * packets or as UMP, as far as room allows.
+ * \returns bytes or words written.
+ */
+uint32_t USBMIDILoopback_FillMidi1(USBMIDILoopback_t *lb, uint8_t *buf, uint32_t room, uint32_t now);
+uint32_t USBMIDILoopback_FillUmp(USBMIDILoopback_t *lb, uint32_t *words, uint32_t room, uint32_t now);
+
+/**
+ * The IN packet was collected at time now.
+ */
+void USBMIDILoopback_Ack(USBMIDILoopback_t *lb, uint32_t now);
+
+/**
+ * Write the reply to a command, F0 to F7. buf needs
+ * USBMIDI_LOOPBACK_REPORT_SIZE bytes for REPORT and 6 for anything else.
+ * \returns its length.
+ */
+uint32_t USBMIDILoopback_Reply(const USBMIDILoopbackReport_t *report, uint8_t cmd, uint32_t cpuHz,
+		uint8_t *buf);
+
+#endif /* USB_MIDI_USBMIDI_LOOPBACK_H_ */
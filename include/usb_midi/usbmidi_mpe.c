@@ -0,0 +1,342 @@
+/*
+ * usbmidi_mpe.c
+ *
+ * MPE zone manager. See usbmidi_mpe.h.
+ *
+ *  Created on: Oct 18, 2026
+ *
+ * MODS:
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "midi.h"
+#include "usb_midi.h"
+#include "usbmidi_batch.h"
+#include "usbmidi_bits.h"
+#include "usbmidi_mpe.h"
+
+/*
+ * Expression waiting in USBMIDIMpeMember_t.dirty.
+ */
+#define DIRTY_BEND		0x01
+#define DIRTY_PRESSURE	0x02
+#define DIRTY_TIMBRE	0x04
+
+#define RPN_MCM_LSB		6	// MPE Configuration Message is RPN 0/6
+
+/*
+ * MIDI channel of member m.
+ */
+static inline uint8_t Channel(const USBMIDIMpeZone_t *z, uint8_t m)
+{
+	return z->master ? z->master - 1 - m : m + 1;
+}
+
+/*
+ * The free and busy lists are doubly linked through the members, so a
+ * member is taken from anywhere in either in constant time.
+ */
+static void Unlink(USBMIDIMpeZone_t *z, uint8_t *head, uint8_t *tail, uint8_t m)
+{
+	USBMIDIMpeMember_t *mem = &z->member[m];
+
+	if( mem->prev == USBMIDI_MPE_NONE )
+		*head = mem->next;
+	else
+		z->member[mem->prev].next = mem->next;
+
+	if( mem->next == USBMIDI_MPE_NONE )
+		*tail = mem->prev;
+	else
+		z->member[mem->next].prev = mem->prev;
+}
+
+static void Append(USBMIDIMpeZone_t *z, uint8_t *head, uint8_t *tail, uint8_t m)
+{
+	USBMIDIMpeMember_t *mem = &z->member[m];
+
+	mem->prev = *tail;
+	mem->next = USBMIDI_MPE_NONE;
+	if( *tail == USBMIDI_MPE_NONE )
+		*head = m;
+	else
+		z->member[*tail].next = m;
+	*tail = m;
+}
+
+/*
+ * Add the marked expression of member m. Each value is unmarked once it is
+ * in the batch.
+ * \returns false, leaving the rest marked, if the batch could not take one.
+ */
+static bool SendExpression(USBMIDIMpeZone_t *z, USBMIDIBatch_t *b, uint8_t m)
+{
+	USBMIDIMpeMember_t *mem = &z->member[m];
+	uint8_t chan = Channel(z, m);
+
+	if( mem->dirty & DIRTY_BEND )
+	{
+		if( !USBMIDIBatch_PitchBend(b, z->cable, chan, mem->bend) )
+			return false;
+		mem->bendSent = mem->bend;
+		mem->dirty &= ~DIRTY_BEND;
+		z->stats.sent++;
+	}
+	if( mem->dirty & DIRTY_PRESSURE )
+	{
+		if( !USBMIDIBatch_ChannelPressure(b, z->cable, chan, mem->pressure) )
+			return false;
+		mem->pressureSent = mem->pressure;
+		mem->dirty &= ~DIRTY_PRESSURE;
+		z->stats.sent++;
+	}
+	if( mem->dirty & DIRTY_TIMBRE )
+	{
+		if( !USBMIDIBatch_ControlChange(b, z->cable, chan, USBMIDI_MPE_CC_TIMBRE, mem->timbre) )
+			return false;
+		mem->timbreSent = mem->timbre;
+		mem->dirty &= ~DIRTY_TIMBRE;
+		z->stats.sent++;
+	}
+	z->dirty &= ~(1 << m);
+	return true;
+}
+
+/*
+ * End the note on member m and move it to the end of the free list.
+ * \returns false, leaving the note on, if the batch could not take its
+ * messages.
+ */
+static bool Release(USBMIDIMpeZone_t *z, USBMIDIBatch_t *b, uint8_t m, uint8_t velocity)
+{
+	USBMIDIMpeMember_t *mem = &z->member[m];
+
+	if( !SendExpression(z, b, m) )
+		return false;
+	if( !USBMIDIBatch_NoteOff(b, z->cable, Channel(z, m), mem->note, velocity) )
+		return false;
+
+	z->slot[mem->note] = USBMIDI_MPE_NONE;
+	mem->note = USBMIDI_MPE_NONE;
+	Unlink(z, &z->busyHead, &z->busyTail, m);
+	Append(z, &z->freeHead, &z->freeTail, m);
+	return true;
+}
+
+void USBMIDIMpe_Init(USBMIDIMpeZone_t *z, uint8_t cable, uint8_t zone, uint8_t members)
+{
+	USBMIDIMpeMember_t *mem;
+	uint8_t m;
+
+	if( members < 1 )
+		members = 1;
+	if( members > USBMIDI_MPE_MAX_MEMBERS )
+		members = USBMIDI_MPE_MAX_MEMBERS;
+
+	memset(z, 0, sizeof(*z));
+	memset(z->slot, USBMIDI_MPE_NONE, sizeof(z->slot));
+	z->cable = cable & 0x0F;
+	z->master = (zone == USBMIDI_MPE_UPPER) ? 15 : 0;
+	z->members = members;
+	z->freeHead = z->freeTail = USBMIDI_MPE_NONE;
+	z->busyHead = z->busyTail = USBMIDI_MPE_NONE;
+
+	for( m = 0; m < members; m++ )
+	{
+		mem = &z->member[m];
+		mem->note = USBMIDI_MPE_NONE;
+		mem->bend = mem->bendSent = USBMIDI_MPE_BEND_CENTRE;
+		mem->timbre = mem->timbreSent = USBMIDI_MPE_TIMBRE_INIT;
+		Append(z, &z->freeHead, &z->freeTail, m);
+	}
+}
+
+bool USBMIDIMpe_Configure(const USBMIDIMpeZone_t *z, USBMIDIBatch_t *b)
+{
+	if( b->count + 3 > USBMIDI_BATCH_SIZE )
+		return false;
+
+	USBMIDIBatch_ControlChange(b, z->cable, z->master, MIDI_CC_RPN_MSB, 0);
+	USBMIDIBatch_ControlChange(b, z->cable, z->master, MIDI_CC_RPN_LSB, RPN_MCM_LSB);
+	USBMIDIBatch_ControlChange(b, z->cable, z->master, MIDI_CC_DATAENTRY_MSB, z->members);
+	return true;
+}
+
+bool USBMIDIMpe_NoteOn(USBMIDIMpeZone_t *z, USBMIDIBatch_t *b, uint8_t note, uint8_t velocity)
+{
+	USBMIDIMpeMember_t *mem;
+	uint8_t m;
+
+	if( b->count + USBMIDI_MPE_NOTEON_MSGS > USBMIDI_BATCH_SIZE )
+		return false;
+
+	note &= 0x7F;
+	if( z->slot[note] != USBMIDI_MPE_NONE )
+	{
+		if( !Release(z, b, z->slot[note], 0) )
+			return false;
+	}
+
+	// the channel released longest ago, else the oldest note's.
+	m = z->freeHead;
+	if( m == USBMIDI_MPE_NONE )
+	{
+		if( !Release(z, b, z->busyHead, 0) )
+			return false;
+		z->stats.steals++;
+		m = z->freeHead;
+	}
+	mem = &z->member[m];
+
+	// start from neutral expression, sending only what the last note moved.
+	mem->bend = USBMIDI_MPE_BEND_CENTRE;
+	mem->pressure = 0;
+	mem->timbre = USBMIDI_MPE_TIMBRE_INIT;
+	mem->dirty = (mem->bendSent != mem->bend ? DIRTY_BEND : 0) |
+			(mem->pressureSent != mem->pressure ? DIRTY_PRESSURE : 0) |
+			(mem->timbreSent != mem->timbre ? DIRTY_TIMBRE : 0);
+	if( mem->dirty )
+		z->dirty |= 1 << m;
+	if( !SendExpression(z, b, m) )
+		return false;
+	if( !USBMIDIBatch_NoteOn(b, z->cable, Channel(z, m), note, velocity) )
+		return false;
+
+	// the channel is the note's only once the host has its Note On.
+	Unlink(z, &z->freeHead, &z->freeTail, m);
+	Append(z, &z->busyHead, &z->busyTail, m);
+	mem->note = note;
+	z->slot[note] = m;
+	z->stats.notes++;
+	return true;
+}
+
+bool USBMIDIMpe_NoteOff(USBMIDIMpeZone_t *z, USBMIDIBatch_t *b, uint8_t note, uint8_t velocity)
+{
+	uint8_t m = z->slot[note & 0x7F];
+
+	if( m == USBMIDI_MPE_NONE )
+	{
+		z->stats.unknown++;
+		return true;
+	}
+	if( b->count + USBMIDI_MPE_NOTEOFF_MSGS > USBMIDI_BATCH_SIZE )
+		return false;
+
+	return Release(z, b, m, velocity);
+}
+
+/*
+ * Store one expression value of a note, marking it only if it differs from
+ * what the host last got.
+ */
+static inline USBMIDIMpeMember_t *Lookup(USBMIDIMpeZone_t *z, uint8_t note)
+{
+	uint8_t m = z->slot[note & 0x7F];
+
+	if( m == USBMIDI_MPE_NONE )
+	{
+		z->stats.unknown++;
+		return 0;
+	}
+	z->stats.updates++;
+	return &z->member[m];
+}
+
+static inline void Mark(USBMIDIMpeZone_t *z, USBMIDIMpeMember_t *mem, uint8_t bit, bool changed)
+{
+	if( changed )
+		mem->dirty |= bit;
+	else
+		mem->dirty &= ~bit;
+
+	if( mem->dirty )
+		z->dirty |= 1 << (mem - z->member);
+	else
+		z->dirty &= ~(1 << (mem - z->member));
+}
+
+bool USBMIDIMpe_Bend(USBMIDIMpeZone_t *z, uint8_t note, uint16_t bend)
+{
+	USBMIDIMpeMember_t *mem = Lookup(z, note);
+
+	if( !mem )
+		return false;
+	mem->bend = bend & 0x3FFF;
+	Mark(z, mem, DIRTY_BEND, mem->bend != mem->bendSent);
+	return true;
+}
+
+bool USBMIDIMpe_Pressure(USBMIDIMpeZone_t *z, uint8_t note, uint8_t pressure)
+{
+	USBMIDIMpeMember_t *mem = Lookup(z, note);
+
+	if( !mem )
+		return false;
+	mem->pressure = pressure & 0x7F;
+	Mark(z, mem, DIRTY_PRESSURE, mem->pressure != mem->pressureSent);
+	return true;
+}
+
+bool USBMIDIMpe_Timbre(USBMIDIMpeZone_t *z, uint8_t note, uint8_t timbre)
+{
+	USBMIDIMpeMember_t *mem = Lookup(z, note);
+
+	if( !mem )
+		return false;
+	mem->timbre = timbre & 0x7F;
+	Mark(z, mem, DIRTY_TIMBRE, mem->timbre != mem->timbreSent);
+	return true;
+}
+
+bool USBMIDIMpe_Flush(USBMIDIMpeZone_t *z, USBMIDIBatch_t *b)
+{
+	uint32_t d;
+
+	// only members with something to send are visited.
+	for( d = z->dirty; d; d &= d - 1 )
+	{
+		if( b->count + USBMIDI_MPE_EXPRESSION_MSGS > USBMIDI_BATCH_SIZE )
+			return false;
+		if( !SendExpression(z, b, USBMIDI_BIT_INDEX(d & -d)) )
+			return false;
+	}
+	return true;
+}
+
+bool USBMIDIMpe_AllOff(USBMIDIMpeZone_t *z, USBMIDIBatch_t *b)
+{
+	while( z->busyHead != USBMIDI_MPE_NONE )
+	{
+		if( b->count + USBMIDI_MPE_NOTEOFF_MSGS > USBMIDI_BATCH_SIZE )
+			return false;
+		if( !Release(z, b, z->busyHead, 0) )
+			return false;
+	}
+	return true;
+}
+
+uint8_t USBMIDIMpe_Channel(const USBMIDIMpeZone_t *z, uint8_t note)
+{
+	uint8_t m = z->slot[note & 0x7F];
+
+	return (m == USBMIDI_MPE_NONE) ? USBMIDI_MPE_NONE : Channel(z, m);
+}
+
+uint32_t USBMIDIMpe_Count(const USBMIDIMpeZone_t *z)
+{
+	uint32_t n = 0;
+	uint8_t m;
+
+	for( m = z->busyHead; m != USBMIDI_MPE_NONE; m = z->member[m].next )
+		n++;
+	return n;
+}
+
+void USBMIDIMpe_GetStats(const USBMIDIMpeZone_t *z, USBMIDIMpeStats_t *stats)
+{
+	*stats = z->stats;
+}
@@ -0,0 +1,200 @@
+/*
+ * usbmidi_mpe.h
+ *
+ * An MPE (MIDI Polyphonic Expression) zone: each note gets a member channel
+ * of its own, so its pitch bend, pressure and timbre (CC74) move it alone.
+ *
+ * A lower zone has its master channel on channel 1 and members on 2 and up;
+ * an upper zone has its master on 16 and members on 15 and down. The
+ * members are kept on two lists, linked by index:
+ *
+ * - free channels, in the order they were released. A new note takes the
+ *   one released longest ago, so a note still sounding its release keeps its
+ *   channel for as long as possible.
+ * - busy channels, in the order their notes started. When every member is
+ *   busy the oldest note is ended and its channel taken.
+ *
+ * With a note to channel map, note on, note off and every expression update
+ * are O(1) whatever the number of members.
+ *
+ * Expression is not sent as it is set. USBMIDIMpe_Bend() and the others
+ * store the value and mark the channel; USBMIDIMpe_Flush() puts the latest
+ * value of everything marked into a batch. A gesture of ten fingers moving
+ * between two flushes costs at most three messages a finger, however many
+ * updates the sensors made, and goes to the host in one batch write:
+ *
+ *		USBMIDIBatch_Init(&batch);
+ *		while( !USBMIDIMpe_Flush(&zone, &batch) )
+ *		{
+ *			USBMIDI_InEpBatchWrite(&batch);
+ *			USBMIDIBatch_Init(&batch);
+ *		}
+ *		USBMIDI_InEpBatchWrite(&batch);
+ *
+ * Note on and note off go into the caller's batch at once, with any marked
+ * expression of their channel ahead of them. A new note starts from centred
+ * pitch bend, no pressure and the middle timbre; the values that changed
+ * are sent before its Note On.
+ *
+ * A zone belongs to one context; nothing here masks interrupts.
+ *
+ * Nothing here touches hardware.
+ *
+ *  Created on: Oct 18, 2026
+ *
+ * MODS:
+ */
+
+#ifndef USB_MIDI_USBMIDI_MPE_H_
+#define USB_MIDI_USBMIDI_MPE_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "usbmidi_batch.h"
+
+#define USBMIDI_MPE_LOWER		0	//!< master channel 1, members from 2 up
+#define USBMIDI_MPE_UPPER		1	//!< master channel 16, members from 15 down
+
+#define USBMIDI_MPE_MAX_MEMBERS	15
+
+/**
+ * The MPE controller for timbre.
+ */
+#define USBMIDI_MPE_CC_TIMBRE	74
+
+/**
+ * Values a new note starts from.
+ */
+#define USBMIDI_MPE_BEND_CENTRE	8192
+#define USBMIDI_MPE_TIMBRE_INIT	64
+
+/**
+ * Most messages a note on or note off adds to the batch. A channel's marked
+ * expression is at most a bend, a pressure and a timbre. A note off sends its
+ * channel's expression, then the Note Off. A note on may first end a note,
+ * either the same note re-struck or the oldest one when every member is busy,
+ * then sends the new channel's expression and the Note On.
+ */
+#define USBMIDI_MPE_EXPRESSION_MSGS	3
+#define USBMIDI_MPE_NOTEOFF_MSGS	(USBMIDI_MPE_EXPRESSION_MSGS + 1)
+#define USBMIDI_MPE_NOTEON_MSGS		(USBMIDI_MPE_NOTEOFF_MSGS + USBMIDI_MPE_EXPRESSION_MSGS + 1)
+
+/**
+ * \typedef USBMIDIMpeMember_t
+ * One member channel.
+ */
+typedef struct
+{
+	uint8_t note;			//!< sounding note, USBMIDI_MPE_NONE if free
+	uint8_t prev;			//!< links in the free or busy list
+	uint8_t next;
+	uint8_t dirty;			//!< expression set but not sent
+	uint16_t bend;
+	uint16_t bendSent;
+	uint8_t pressure;
+	uint8_t pressureSent;
+	uint8_t timbre;
+	uint8_t timbreSent;
+} USBMIDIMpeMember_t;
+
+/**
+ * \typedef USBMIDIMpeStats_t
+ */
+typedef struct
+{
+	uint32_t notes;			//!< notes started
+	uint32_t steals;		//!< notes ended to free a channel
+	uint32_t updates;		//!< expression values set
+	uint32_t sent;			//!< expression messages sent
+	uint32_t unknown;		//!< expression or note off for a note not on
+} USBMIDIMpeStats_t;
+
+/**
+ * \typedef USBMIDIMpeZone_t
+ * 340 bytes.
+ */
+typedef struct
+{
+	uint8_t cable;
+	uint8_t master;			//!< master channel, 0 or 15
+	uint8_t members;		//!< member channels, 1-15
+	uint8_t freeHead;		//!< released longest ago
+	uint8_t freeTail;
+	uint8_t busyHead;		//!< oldest note
+	uint8_t busyTail;
+	uint16_t dirty;			//!< bit m: member m has expression to send
+	uint8_t slot[128];		//!< member playing each note, or USBMIDI_MPE_NONE
+	USBMIDIMpeMember_t member[USBMIDI_MPE_MAX_MEMBERS];
+	USBMIDIMpeStats_t stats;
+} USBMIDIMpeZone_t;
+
+#define USBMIDI_MPE_NONE		0xFF
+
+/**
+ * Set up a zone with every member free and no notes on. members is clamped
+ * to 1-15. Nothing is sent; see USBMIDIMpe_Configure().
+ */
+void USBMIDIMpe_Init(USBMIDIMpeZone_t *z, uint8_t cable, uint8_t zone, uint8_t members);
+
+/**
+ * Add the MPE Configuration Message (RPN 6 on the master channel) announcing
+ * the zone.
+ * \returns false, adding nothing, if the batch has no room for three messages.
+ */
+bool USBMIDIMpe_Configure(const USBMIDIMpeZone_t *z, USBMIDIBatch_t *b);
+
+/**
+ * Start a note on a member channel of its own. A note already on is ended
+ * first. If every member is busy, the oldest note is ended and its channel
+ * taken.
+ * \returns false, doing nothing, if the batch has no room for
+ * USBMIDI_MPE_NOTEON_MSGS messages. It is also false if the batch refused a
+ * message part way; what went in stays in the batch and in the zone's view of
+ * the host, and the note is not on.
+ */
+bool USBMIDIMpe_NoteOn(USBMIDIMpeZone_t *z, USBMIDIBatch_t *b, uint8_t note, uint8_t velocity);
+
+/**
+ * End a note and free its channel. A note that is not on is ignored.
+ * \returns false, doing nothing, if the batch has no room for
+ * USBMIDI_MPE_NOTEOFF_MSGS messages, or if the batch refused a message part
+ * way, leaving the note on.
+ */
+bool USBMIDIMpe_NoteOff(USBMIDIMpeZone_t *z, USBMIDIBatch_t *b, uint8_t note, uint8_t velocity);
+
+/**
+ * Set the expression of a note, to be sent by the next USBMIDIMpe_Flush().
+ * Bend is 0-16383, with USBMIDI_MPE_BEND_CENTRE the centre.
+ * \returns false if the note is not on.
+ */
+bool USBMIDIMpe_Bend(USBMIDIMpeZone_t *z, uint8_t note, uint16_t bend);
+bool USBMIDIMpe_Pressure(USBMIDIMpeZone_t *z, uint8_t note, uint8_t pressure);
+bool USBMIDIMpe_Timbre(USBMIDIMpeZone_t *z, uint8_t note, uint8_t timbre);
+
+/**
+ * Add the latest value of every expression set since it was last sent.
+ * \returns true if everything was added, false if the batch filled first;
+ * send it and call again for the rest.
+ */
+bool USBMIDIMpe_Flush(USBMIDIMpeZone_t *z, USBMIDIBatch_t *b);
+
+/**
+ * End every note, as far as the batch has room.
+ * \returns true once no notes are on.
+ */
+bool USBMIDIMpe_AllOff(USBMIDIMpeZone_t *z, USBMIDIBatch_t *b);
+
+/**
+ * Member channel a note is playing on, or USBMIDI_MPE_NONE.
+ */
+uint8_t USBMIDIMpe_Channel(const USBMIDIMpeZone_t *z, uint8_t note);
+
+/**
+ * Number of notes on.
+ */
+uint32_t USBMIDIMpe_Count(const USBMIDIMpeZone_t *z);
+
+void USBMIDIMpe_GetStats(const USBMIDIMpeZone_t *z, USBMIDIMpeStats_t *stats);
+
+#endif /* USB_MIDI_USBMIDI_MPE_H_ */
@@ -0,0 +1,253 @@
+/*
+ * usbmidi_mtc.c
+ *
+ * MIDI Time Code arithmetic and the quarter frame chase decoder.
+ * See usbmidi_mtc.h.
+ *
+ *  Created on: Oct 18, 2026
+ *
+ * MODS:
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "midi.h"
+#include "usb_midi.h"
+#include "usbmidi_mtc.h"
+
+/*
+ * 29.97 drop frame: frames in ten minutes, and in each minute but the first of
+ * ten.
+ */
+#define DF_FRAMES_10MIN		17982
+#define DF_FRAMES_MIN		1798
+
+#define WAIT_PIECE0			8
+
+uint32_t USBMIDIMtc_Fps(uint8_t rate)
+{
+	static const uint8_t fps[4] = { 24, 25, 30, 30 };
+
+	return fps[rate & 3];
+}
+
+uint32_t USBMIDIMtc_FramesPerDay(uint8_t rate)
+{
+	if( (rate & 3) == USBMIDI_MTC_30DF )
+		return 144 * DF_FRAMES_10MIN;
+	return 24 * 3600 * USBMIDIMtc_Fps(rate);
+}
+
+uint32_t USBMIDIMtc_ToFrames(const USBMIDIMtcTime_t *time)
+{
+	uint32_t minutes = (uint32_t) time->hours * 60 + time->minutes;
+	uint32_t frames;
+
+	frames = (minutes * 60 + time->seconds) * USBMIDIMtc_Fps(time->rate) + time->frames;
+	if( (time->rate & 3) == USBMIDI_MTC_30DF )
+		frames -= 2 * (minutes - minutes / 10);
+
+	return frames;
+}
+
+void USBMIDIMtc_FromFrames(uint32_t frames, uint8_t rate, USBMIDIMtcTime_t *time)
+{
+	uint32_t fps = USBMIDIMtc_Fps(rate);
+	uint32_t rest;
+
+	// put the dropped frame numbers back, then count as 30 fps.
+	if( (rate & 3) == USBMIDI_MTC_30DF )
+	{
+		rest = frames % DF_FRAMES_10MIN;
+		frames += 18 * (frames / DF_FRAMES_10MIN);
+		if( rest >= 2 )
+			frames += 2 * ((rest - 2) / DF_FRAMES_MIN);
+	}
+
+	time->frames = frames % fps;
+	frames /= fps;
+	time->seconds = frames % 60;
+	frames /= 60;
+	time->minutes = frames % 60;
+	time->hours = frames / 60;
+	time->rate = rate & 3;
+}
+
+uint32_t USBMIDIMtc_QuarterPeriod(uint32_t unitsPerSec, uint8_t rate)
+{
+	uint64_t units = (uint64_t) unitsPerSec * 256;
+
+	if( (rate & 3) == USBMIDI_MTC_30DF )
+		return (uint32_t) (units * 1001 / (4 * 30000));
+	return (uint32_t) (units / (4 * USBMIDIMtc_Fps(rate)));
+}
+
+void USBMIDIMtcIn_Init(USBMIDIMtcIn_t *mi, uint32_t unitsPerSec)
+{
+	memset(mi, 0, sizeof(*mi));
+	mi->unitsPerSec = unitsPerSec;
+	mi->expect = WAIT_PIECE0;
+}
+
+void USBMIDIMtcIn_Reset(USBMIDIMtcIn_t *mi)
+{
+	mi->expect = WAIT_PIECE0;
+	mi->valid = false;
+}
+
+/*
+ * One more quarter frame at time now: move the position on and track the phase.
+ * A quarter frame more than half a period off the prediction (the host paused
+ * and went on) restarts the phase from it.
+ */
+static void Advance(USBMIDIMtcIn_t *mi, uint32_t now)
+{
+	uint32_t period = mi->period >> 8;
+	uint32_t predicted = mi->last + period;
+	uint32_t abserr;
+	int32_t err;
+
+	if( ++mi->position >= 4 * USBMIDIMtc_FramesPerDay(mi->rate) )
+		mi->position = 0;
+
+	err = (int32_t) (now - predicted);
+	abserr = (err < 0) ? -err : err;
+	mi->stats.errLast = abserr;
+
+	if( abserr > (period >> 1) )
+	{
+		mi->last = now;
+		return;
+	}
+	if( abserr > mi->stats.errMax )
+		mi->stats.errMax = abserr;
+
+	// alpha-beta update, the period held within 1/64 of nominal.
+	mi->last = predicted + (err >> USBMIDI_MTC_ALPHA);
+	mi->period += err * (1 << (8 - USBMIDI_MTC_BETA));
+	if( mi->period > mi->nominal + (mi->nominal >> 6) )
+		mi->period = mi->nominal + (mi->nominal >> 6);
+	else if( mi->period < mi->nominal - (mi->nominal >> 6) )
+		mi->period = mi->nominal - (mi->nominal >> 6);
+}
+
+/*
+ * All eight pieces are in: check the timecode against the position.
+ */
+static void Assemble(USBMIDIMtcIn_t *mi, uint32_t now)
+{
+	USBMIDIMtcTime_t time;
+	uint32_t position;
+
+	time.frames = mi->nibble[0] | ((mi->nibble[1] & 0x1) << 4);
+	time.seconds = mi->nibble[2] | ((mi->nibble[3] & 0x3) << 4);
+	time.minutes = mi->nibble[4] | ((mi->nibble[5] & 0x3) << 4);
+	time.hours = mi->nibble[6] | ((mi->nibble[7] & 0x1) << 4);
+	time.rate = (mi->nibble[7] >> 1) & 0x3;
+
+	if( (time.hours > 23) || (time.minutes > 59) || (time.seconds > 59) ||
+			(time.frames >= USBMIDIMtc_Fps(time.rate)) )
+		return;
+
+	mi->stats.timecodes++;
+
+	// the timecode is when piece 0 went out, seven quarter frames ago.
+	position = USBMIDIMtc_ToFrames(&time) * 4 + 7;
+	if( position >= 4 * USBMIDIMtc_FramesPerDay(time.rate) )
+		position -= 4 * USBMIDIMtc_FramesPerDay(time.rate);
+
+	if( mi->valid && (time.rate == mi->rate) && (position == mi->position) )
+		return;
+
+	if( mi->valid )
+		mi->stats.locates++;
+	if( !mi->valid || (time.rate != mi->rate) )
+	{
+		mi->nominal = USBMIDIMtc_QuarterPeriod(mi->unitsPerSec, time.rate);
+		mi->period = mi->nominal;
+		mi->last = now;
+	}
+	mi->rate = time.rate;
+	mi->position = position;
+	mi->valid = true;
+}
+
+bool USBMIDIMtcIn_Feed(USBMIDIMtcIn_t *mi, const USBMIDI_Message_t *msg, uint32_t now)
+{
+	uint8_t piece;
+
+	if( (USB_MIDI_CODE_INDEX_NUMBER(msg->header) != USB_MIDI_CIN_SYSCOM2) ||
+			(msg->byte1 != MIDI_MSG_MTCQF) )
+		return false;
+
+	mi->stats.quarterFrames++;
+	piece = (msg->byte2 >> 4) & 0x7;
+
+	if( mi->valid )
+		Advance(mi, now);
+
+	if( piece == 0 )
+		mi->expect = 0;
+
+	if( piece != mi->expect )
+	{
+		if( mi->expect != WAIT_PIECE0 )
+		{
+			mi->stats.resyncs++;
+			mi->expect = WAIT_PIECE0;
+			mi->valid = false;
+		}
+		return true;
+	}
+
+	mi->nibble[piece] = msg->byte2 & 0x0F;
+	if( piece == 7 )
+	{
+		mi->expect = WAIT_PIECE0;
+		Assemble(mi, now);
+	}
+	else
+	{
+		mi->expect++;
+	}
+
+	return true;
+}
+
+void USBMIDIMtcIn_Get(USBMIDIMtcIn_t *mi, USBMIDIMtcInState_t *state, uint32_t now)
+{
+	uint32_t period = mi->period >> 8;
+	uint32_t elapsed;
+	uint32_t quarters;
+	uint32_t position;
+
+	memset(state, 0, sizeof(*state));
+	state->valid = mi->valid;
+	if( !mi->valid )
+		return;
+
+	// interpolate up to the next quarter frame that is due.
+	elapsed = now - mi->last;
+	state->running = elapsed < 4 * period;
+	quarters = 0;
+	if( state->running )
+	{
+		quarters = elapsed / period;
+		if( quarters > 3 )
+			quarters = 3;
+	}
+
+	position = mi->position + quarters;
+	if( position >= 4 * USBMIDIMtc_FramesPerDay(mi->rate) )
+		position -= 4 * USBMIDIMtc_FramesPerDay(mi->rate);
+
+	USBMIDIMtc_FromFrames(position / 4, mi->rate, &state->time);
+	state->quarter = position % 4;
+}
+
+void USBMIDIMtcIn_GetStats(const USBMIDIMtcIn_t *mi, USBMIDIMtcInStats_t *stats)
+{
+	*stats = mi->stats;
+}
@@ -0,0 +1,159 @@
+/*
+ * usbmidi_mtc.h
+ *
+ * MIDI Time Code: timecode arithmetic, and a chase decoder for the host's
+ * quarter frames.
+ *
+ * A timecode is handled as a count of frames since 00:00:00:00, which makes
+ * stepping and comparing trivial; USBMIDIMtc_ToFrames() and
+ * USBMIDIMtc_FromFrames() convert, including the 29.97 drop-frame numbering
+ * (frames 0 and 1 skipped at the start of each minute, except every tenth).
+ *
+ * The decoder reassembles the eight quarter-frame pieces into a timecode. That
+ * timecode is the time when piece 0 was sent, so when piece 7 arrives the
+ * position is seven quarter frames later. From then on every quarter frame
+ * moves the position on by one, and each new full timecode is checked
+ * against it; a mismatch (the host located) resets the position.
+ *
+ * Quarter frames arrive in 1 ms USB frames, so their timestamps jitter by up
+ * to a quarter of a quarter frame. The decoder runs the arrival times through
+ * an alpha-beta filter seeded with the nominal quarter frame period, and
+ * interpolates the position between quarter frames from the filtered phase.
+ *
+ * Only forward play is followed. Pieces arriving out of order (reverse play,
+ * or a lost message) stop the decoder until the next piece 0.
+ *
+ * Nothing here touches hardware.
+ *
+ *  Created on: Oct 18, 2026
+ *
+ * MODS:
+ */
+
+#ifndef USB_MIDI_USBMIDI_MTC_H_
+#define USB_MIDI_USBMIDI_MTC_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "usb_midi.h"
+
+/**
+ * Frame rates, as coded in quarter frame piece 7 and the Full Frame message.
+ */
+#define USBMIDI_MTC_24		0
+#define USBMIDI_MTC_25		1
+#define USBMIDI_MTC_30DF	2		//!< 29.97 drop frame
+#define USBMIDI_MTC_30		3
+
+/**
+ * Filter gains, as right shifts.
+ */
+#define USBMIDI_MTC_ALPHA	2
+#define USBMIDI_MTC_BETA	6
+
+/**
+ * \typedef USBMIDIMtcTime_t
+ */
+typedef struct
+{
+	uint8_t hours;
+	uint8_t minutes;
+	uint8_t seconds;
+	uint8_t frames;
+	uint8_t rate;			//!< USBMIDI_MTC_xx
+} USBMIDIMtcTime_t;
+
+/**
+ * \typedef USBMIDIMtcInState_t
+ * What the decoder knows, from USBMIDIMtcIn_Get().
+ */
+typedef struct
+{
+	bool valid;				//!< time holds a timecode
+	bool running;			//!< quarter frames are coming in
+	USBMIDIMtcTime_t time;	//!< position now
+	uint8_t quarter;		//!< quarter frames into time.frames, 0-3
+} USBMIDIMtcInState_t;
+
+/**
+ * \typedef USBMIDIMtcInStats_t
+ */
+typedef struct
+{
+	uint32_t quarterFrames;	//!< quarter frames seen
+	uint32_t timecodes;		//!< full timecodes assembled
+	uint32_t resyncs;		//!< pieces out of order
+	uint32_t locates;		//!< timecodes that did not match the position
+	uint32_t errLast;		//!< |t - predicted| of the last quarter frame
+	uint32_t errMax;
+} USBMIDIMtcInStats_t;
+
+/**
+ * \typedef USBMIDIMtcIn_t
+ */
+typedef struct
+{
+	uint32_t unitsPerSec;
+	uint8_t expect;			//!< next piece, or 8 while waiting for piece 0
+	uint8_t nibble[8];
+	bool valid;
+	uint8_t rate;
+	uint32_t position;		//!< quarter frames since 00:00:00:00, at the last quarter frame
+	uint32_t last;			//!< filtered time of the last quarter frame
+	uint32_t period;		//!< time units per quarter frame, in 1/256 units
+	uint32_t nominal;		//!< period at the coded rate
+	USBMIDIMtcInStats_t stats;
+} USBMIDIMtcIn_t;
+
+/**
+ * Frames per second at a rate, rounded (30 for 29.97).
+ */
+uint32_t USBMIDIMtc_Fps(uint8_t rate);
+
+/**
+ * Frames in 24 hours at a rate.
+ */
+uint32_t USBMIDIMtc_FramesPerDay(uint8_t rate);
+
+/**
+ * Convert a timecode to frames since midnight, and back.
+ */
+uint32_t USBMIDIMtc_ToFrames(const USBMIDIMtcTime_t *time);
+void USBMIDIMtc_FromFrames(uint32_t frames, uint8_t rate, USBMIDIMtcTime_t *time);
+
+/**
+ * Time units per quarter frame at a rate, in 1/256 units.
+ */
+uint32_t USBMIDIMtc_QuarterPeriod(uint32_t unitsPerSec, uint8_t rate);
+
+/**
+ * Set up a decoder for a time base of unitsPerSec and clear everything.
+ */
+void USBMIDIMtcIn_Init(USBMIDIMtcIn_t *mi, uint32_t unitsPerSec);
+
+/**
+ * Forget the timecode, as after a reconnect. Counters are kept.
+ */
+void USBMIDIMtcIn_Reset(USBMIDIMtcIn_t *mi);
+
+/**
+ * Look at a message from the host. Quarter frames are decoded; anything else
+ * is ignored.
+ * \param now: when the packet carrying the message was read.
+ * \returns true if the message was a quarter frame.
+ */
+bool USBMIDIMtcIn_Feed(USBMIDIMtcIn_t *mi, const USBMIDI_Message_t *msg, uint32_t now);
+
+/**
+ * Get the position at time now, interpolated from the last quarter frame.
+ * Quarter frames stopping for four periods means the host stopped.
+ */
+void USBMIDIMtcIn_Get(USBMIDIMtcIn_t *mi, USBMIDIMtcInState_t *state, uint32_t now);
+
+/**
+ * Get the counters.
+ */
+void USBMIDIMtcIn_GetStats(const USBMIDIMtcIn_t *mi, USBMIDIMtcInStats_t *stats);
+
+#endif /* USB_MIDI_USBMIDI_MTC_H_ */
@@ -0,0 +1,100 @@
+/*
+ * usbmidi_notes.c
+ *
+ * Active-note tracking. See usbmidi_notes.h.
+ *
+ *  Created on: Oct 18, 2026
+ *
+ * MODS:
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "midi.h"
+#include "usb_midi.h"
+#include "usb_midi_fifo.h"
+#include "usbmidi_bits.h"
+#include "usbmidi_notes.h"
+
+void USBMIDINotes_Init(USBMIDINotes_t *t)
+{
+	memset(t, 0, sizeof(*t));
+}
+
+bool USBMIDINotes_IsOn(const USBMIDINotes_t *t, uint8_t cable, uint8_t chan, uint8_t note)
+{
+	if( cable >= USBMIDI_NOTES_NUM_CABLES )
+		return false;
+	return (t->bits[cable][chan & 0x0F][(note >> 5) & 0x03] >> (note & 0x1F)) & 1;
+}
+
+uint32_t USBMIDINotes_Count(const USBMIDINotes_t *t)
+{
+	uint32_t n = 0;
+	uint32_t w;
+	uint8_t cable;
+	uint8_t chan;
+	uint8_t i;
+
+	for( cable = 0; cable < USBMIDI_NOTES_NUM_CABLES; cable++ )
+	{
+		for( chan = 0; chan < 16; chan++ )
+		{
+			for( i = 0; i < 4; i++ )
+			{
+				// clear the lowest set bit until none are left.
+				for( w = t->bits[cable][chan][i]; w; w &= w - 1 )
+					n++;
+			}
+		}
+	}
+	return n;
+}
+
+uint32_t USBMIDINotes_AllOff(USBMIDINotes_t *t, USBMIDIFIFO_t *fifo)
+{
+	USBMIDI_Message_t msg;
+	uint32_t *word;
+	uint32_t b;
+	uint32_t n = 0;
+	uint16_t pending;
+	uint8_t cable;
+	uint8_t chan;
+	uint8_t i;
+
+	for( cable = 0; cable < USBMIDI_NOTES_NUM_CABLES; cable++ )
+	{
+		pending = t->channels[cable];
+		for( chan = 0; pending; chan++, pending >>= 1 )
+		{
+			if( !(pending & 1) )
+				continue;
+
+			msg.header = USB_MIDI_HEADER(cable, USB_MIDI_CIN_NOTEOFF);
+			msg.byte1 = MIDI_MSG_NOTEOFF | chan;
+			msg.byte3 = 0;
+
+			for( i = 0; i < 4; i++ )
+			{
+				word = &t->bits[cable][chan][i];
+				while( *word )
+				{
+					if( fifo->count >= MIDI_USB_FIFO_SIZE )
+						return n;
+
+					b = *word & (0 - *word);
+					msg.byte2 = (i << 5) | USBMIDI_BIT_INDEX(b);
+					USBMIDIFIFO_Push(fifo, &msg);
+					*word &= ~b;
+					n++;
+				}
+			}
+
+			// every note on this channel is off now.
+			t->channels[cable] &= ~(1 << chan);
+		}
+	}
+	return n;
+}
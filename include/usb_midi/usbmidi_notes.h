@@ -0,0 +1,100 @@
+/*
+ * usbmidi_notes.h
+ *
+ * Active-note tracking, so a panic or a lost host can be cleaned up with exactly
+ * the Note Offs that are needed.
+ *
+ * Each table is a bitmap of 128 notes for every (cable, channel): four words per
+ * channel, plus a mask of channels that may have notes on so an all-notes-off
+ * skips the quiet ones. The device keeps one table per direction. Notes queued
+ * for the host are tracked in USBMIDI_InEpMsgWrite(); notes from the host are
+ * tracked as the endpoint handler queues them on the OUT FIFO.
+ *
+ * USBMIDINotes_Track() is on the hot path, so it is inline and branch-light: one
+ * test to reject anything that is not a note, then a single read-modify-write.
+ *
+ *  Created on: Oct 18, 2026
+ *
+ * MODS:
+ */
+
+#ifndef USB_MIDI_USBMIDI_NOTES_H_
+#define USB_MIDI_USBMIDI_NOTES_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "usb_midi.h"
+#include "usb_midi_fifo.h"
+
+/**
+ * Number of virtual cables tracked. Notes on higher cables are ignored.
+ * Must be a power of two.
+ */
+#ifndef USBMIDI_NOTES_NUM_CABLES
+#define USBMIDI_NOTES_NUM_CABLES 2
+#endif
+
+/**
+ * \typedef USBMIDINotes_t
+ * 512 bytes with two cables.
+ */
+typedef struct
+{
+	uint32_t bits[USBMIDI_NOTES_NUM_CABLES][16][4];	//!< bit n of word w: note 32 * w + n is on
+	uint16_t channels[USBMIDI_NOTES_NUM_CABLES];	//!< bit c: channel c may have notes on
+} USBMIDINotes_t;
+
+/**
+ * Clear the table.
+ */
+void USBMIDINotes_Init(USBMIDINotes_t *t);
+
+/**
+ * Update the table for one message. Anything but Note On and Note Off is ignored;
+ * a Note On with velocity 0 counts as a Note Off.
+ */
+static inline void USBMIDINotes_Track(USBMIDINotes_t *t, const USBMIDI_Message_t *msg)
+{
+	uint8_t cin = USB_MIDI_CODE_INDEX_NUMBER(msg->header);
+	uint8_t cable = USB_MIDI_CABLE_NUMBER(msg->header);
+	uint8_t chan = msg->byte1 & 0x0F;
+	uint32_t *word;
+	uint32_t bit;
+
+	if( ((cin & 0x0E) != USB_MIDI_CIN_NOTEOFF) || (cable >= USBMIDI_NOTES_NUM_CABLES) )
+		return;
+
+	word = &t->bits[cable][chan][(msg->byte2 >> 5) & 0x03];
+	bit = 1UL << (msg->byte2 & 0x1F);
+
+	if( (cin == USB_MIDI_CIN_NOTEON) && msg->byte3 )
+	{
+		*word |= bit;
+		t->channels[cable] |= 1 << chan;
+	}
+	else
+	{
+		*word &= ~bit;
+	}
+}
+
+/**
+ * Return true if a note is on.
+ */
+bool USBMIDINotes_IsOn(const USBMIDINotes_t *t, uint8_t cable, uint8_t chan, uint8_t note);
+
+/**
+ * Count the notes that are on.
+ */
+uint32_t USBMIDINotes_Count(const USBMIDINotes_t *t);
+
+/**
+ * Push a Note Off for every note that is on, as long as the FIFO has room, and
+ * clear those notes. Notes that did not fit stay on, so calling again later
+ * finishes the job.
+ * \returns the number of Note Offs pushed.
+ */
+uint32_t USBMIDINotes_AllOff(USBMIDINotes_t *t, USBMIDIFIFO_t *fifo);
+
+#endif /* USB_MIDI_USBMIDI_NOTES_H_ */
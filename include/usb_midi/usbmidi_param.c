@@ -0,0 +1,293 @@
+/*
+ * usbmidi_param.c
+ *
+ * 14-bit controller and RPN/NRPN encoder and decoder. See usbmidi_param.h.
+ *
+ *  Created on: Oct 18, 2026
+ *
+ * MODS:
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "midi.h"
+#include "usb_midi.h"
+#include "usbmidi_batch.h"
+#include "usbmidi_param.h"
+
+#define UNKNOWN		0xFF
+
+void USBMIDIParamEnc_Init(USBMIDIParamEnc_t *enc, uint8_t cable)
+{
+	enc->cable = cable & 0x0F;
+	USBMIDIParamEnc_Forget(enc);
+}
+
+void USBMIDIParamEnc_Forget(USBMIDIParamEnc_t *enc)
+{
+	uint8_t ch;
+
+	// UNKNOWN is no kind, so the next (N)RPN selects in full.
+	for( ch = 0; ch < 16; ch++ )
+	{
+		enc->chan[ch].kind = UNKNOWN;
+		enc->chan[ch].number = 0;
+		enc->chan[ch].dataMsb = UNKNOWN;
+		memset(enc->chan[ch].ccMsb, UNKNOWN, sizeof(enc->chan[ch].ccMsb));
+	}
+}
+
+/*
+ * Add an MSB/LSB pair, leaving out the MSB the receiver has and the LSB a new
+ * MSB has already zeroed.
+ */
+static void Pair(USBMIDIParamEnc_t *enc, USBMIDIBatch_t *b, uint8_t channel, uint8_t controller,
+		uint8_t *known, uint16_t value)
+{
+	uint8_t msb = (value >> 7) & 0x7F;
+	uint8_t lsb = value & 0x7F;
+
+	if( *known != msb )
+	{
+		USBMIDIBatch_ControlChange(b, enc->cable, channel, controller, msb);
+		*known = msb;
+		if( !lsb )
+			return;
+	}
+	USBMIDIBatch_ControlChange(b, enc->cable, channel, controller + 32, lsb);
+}
+
+bool USBMIDIParamEnc_CC14(USBMIDIParamEnc_t *enc, USBMIDIBatch_t *b, uint8_t channel,
+		uint8_t controller, uint16_t value)
+{
+	if( b->count + 2 > USBMIDI_BATCH_SIZE )
+		return false;
+
+	channel &= 0x0F;
+	controller &= 0x1F;
+	Pair(enc, b, channel, controller, &enc->chan[channel].ccMsb[controller], value);
+	return true;
+}
+
+/*
+ * Select a parameter unless it is already selected; a new selection leaves the
+ * receiver's Data Entry MSB unknown.
+ */
+static void Select(USBMIDIParamEnc_t *enc, USBMIDIBatch_t *b, uint8_t channel, uint8_t kind,
+		uint16_t number)
+{
+	uint8_t cc = (kind == USBMIDI_PARAM_RPN) ? MIDI_CC_RPN_MSB : MIDI_CC_NRPN_MSB;
+
+	number &= 0x3FFF;
+	if( (enc->chan[channel].kind == kind) && (enc->chan[channel].number == number) )
+		return;
+
+	USBMIDIBatch_ControlChange(b, enc->cable, channel, cc, number >> 7);
+	USBMIDIBatch_ControlChange(b, enc->cable, channel, cc - 1, number & 0x7F);
+	enc->chan[channel].kind = kind;
+	enc->chan[channel].number = number;
+	enc->chan[channel].dataMsb = UNKNOWN;
+}
+
+static bool Parameter(USBMIDIParamEnc_t *enc, USBMIDIBatch_t *b, uint8_t channel, uint8_t kind,
+		uint16_t number, uint16_t value)
+{
+	if( b->count + 4 > USBMIDI_BATCH_SIZE )
+		return false;
+
+	channel &= 0x0F;
+	Select(enc, b, channel, kind, number);
+	Pair(enc, b, channel, MIDI_CC_DATAENTRY_MSB, &enc->chan[channel].dataMsb, value);
+	return true;
+}
+
+bool USBMIDIParamEnc_Rpn(USBMIDIParamEnc_t *enc, USBMIDIBatch_t *b, uint8_t channel,
+		uint16_t number, uint16_t value)
+{
+	return Parameter(enc, b, channel, USBMIDI_PARAM_RPN, number, value);
+}
+
+bool USBMIDIParamEnc_Nrpn(USBMIDIParamEnc_t *enc, USBMIDIBatch_t *b, uint8_t channel,
+		uint16_t number, uint16_t value)
+{
+	return Parameter(enc, b, channel, USBMIDI_PARAM_NRPN, number, value);
+}
+
+bool USBMIDIParamEnc_Deselect(USBMIDIParamEnc_t *enc, USBMIDIBatch_t *b, uint8_t channel)
+{
+	if( b->count + 2 > USBMIDI_BATCH_SIZE )
+		return false;
+
+	Select(enc, b, channel & 0x0F, USBMIDI_PARAM_RPN, USBMIDI_PARAM_RPN_NULL);
+	return true;
+}
+
+void USBMIDIParamDec_Init(USBMIDIParamDec_t *dec)
+{
+	USBMIDIParamFifo_Init(&dec->fifo);
+	dec->overflows = 0;
+	USBMIDIParamDec_Reset(dec);
+}
+
+void USBMIDIParamDec_Reset(USBMIDIParamDec_t *dec)
+{
+	uint8_t cable;
+	uint8_t ch;
+
+	for( cable = 0; cable < USBMIDI_PARAM_NUM_CABLES; cable++ )
+	{
+		for( ch = 0; ch < 16; ch++ )
+		{
+			memset(&dec->chan[cable][ch], 0, sizeof(dec->chan[cable][ch]));
+			dec->chan[cable][ch].ccNum = UNKNOWN;
+		}
+	}
+	dec->pending.kind = USBMIDI_PARAM_NONE;
+}
+
+static void Queue(USBMIDIParamDec_t *dec, const USBMIDIParamEvent_t *ev)
+{
+	if( !USBMIDIParamFifo_Push(&dec->fifo, ev) )
+		dec->overflows++;
+}
+
+void USBMIDIParamDec_Flush(USBMIDIParamDec_t *dec)
+{
+	if( dec->pending.kind == USBMIDI_PARAM_NONE )
+		return;
+	Queue(dec, &dec->pending);
+	dec->pending.kind = USBMIDI_PARAM_NONE;
+}
+
+/*
+ * Hold an MSB event for its LSB, queueing whatever was held before.
+ */
+static void Hold(USBMIDIParamDec_t *dec, uint8_t cable, uint8_t channel, uint8_t kind,
+		uint16_t number, uint8_t msb)
+{
+	USBMIDIParamDec_Flush(dec);
+	dec->pending.cable = cable;
+	dec->pending.channel = channel;
+	dec->pending.kind = kind;
+	dec->pending.flags = 0;
+	dec->pending.number = number;
+	dec->pending.value = (uint16_t) msb << 7;
+}
+
+static void Event(USBMIDIParamDec_t *dec, uint8_t cable, uint8_t channel, uint8_t kind,
+		uint8_t flags, uint16_t number, uint16_t value)
+{
+	USBMIDIParamEvent_t ev;
+
+	USBMIDIParamDec_Flush(dec);
+	ev.cable = cable;
+	ev.channel = channel;
+	ev.kind = kind;
+	ev.flags = flags;
+	ev.number = number;
+	ev.value = value;
+	Queue(dec, &ev);
+}
+
+/*
+ * An LSB: completes the held event if it is the same parameter, else makes an
+ * event of its own with the last MSB.
+ */
+static void Complete(USBMIDIParamDec_t *dec, uint8_t cable, uint8_t channel, uint8_t kind,
+		uint16_t number, uint8_t msb, uint8_t lsb)
+{
+	if( (dec->pending.kind == kind) && (dec->pending.cable == cable) &&
+			(dec->pending.channel == channel) && (dec->pending.number == number) )
+	{
+		dec->pending.value |= lsb;
+		dec->pending.flags = USBMIDI_PARAM_FINE;
+		USBMIDIParamDec_Flush(dec);
+		return;
+	}
+	Event(dec, cable, channel, kind, USBMIDI_PARAM_FINE, number, ((uint16_t) msb << 7) | lsb);
+}
+
+void USBMIDIParamDec_Feed(USBMIDIParamDec_t *dec, const USBMIDI_Message_t *msg)
+{
+	uint8_t cable = USB_MIDI_CABLE_NUMBER(msg->header);
+	uint8_t channel = msg->byte1 & 0x0F;
+	uint8_t cc = msg->byte2 & 0x7F;
+	uint8_t value = msg->byte3 & 0x7F;
+	USBMIDIParamDecChan_t *st;
+	uint8_t kind;
+	uint16_t number;
+
+	if( (USB_MIDI_CODE_INDEX_NUMBER(msg->header) != USB_MIDI_CIN_CTRLCHANGE) ||
+			((msg->byte1 & 0xF0) != MIDI_MSG_CTRLCHANGE) ||
+			(cable >= USBMIDI_PARAM_NUM_CABLES) )
+		return;
+
+	st = &dec->chan[cable][channel];
+	number = ((uint16_t) st->numMsb << 7) | st->numLsb;
+
+	switch( cc )
+	{
+	case MIDI_CC_RPN_MSB:
+	case MIDI_CC_RPN_LSB:
+	case MIDI_CC_NRPN_MSB:
+	case MIDI_CC_NRPN_LSB:
+		USBMIDIParamDec_Flush(dec);
+		kind = (cc >= MIDI_CC_RPN_LSB) ? USBMIDI_PARAM_RPN : USBMIDI_PARAM_NRPN;
+		if( st->kind != kind )
+		{
+			// halves left from the other kind mean nothing.
+			st->kind = kind;
+			st->numMsb = 0;
+			st->numLsb = 0;
+		}
+		if( cc & 1 )
+			st->numMsb = value;
+		else
+			st->numLsb = value;
+		st->dataMsb = 0;
+		if( (kind == USBMIDI_PARAM_RPN) && (st->numMsb == 0x7F) && (st->numLsb == 0x7F) )
+			st->kind = USBMIDI_PARAM_NONE;
+		break;
+
+	case MIDI_CC_DATAENTRY_MSB:
+		if( st->kind == USBMIDI_PARAM_NONE )
+			break;
+		st->dataMsb = value;
+		Hold(dec, cable, channel, st->kind, number, value);
+		break;
+
+	case MIDI_CC_DATAENTRY_LSB:
+		if( st->kind == USBMIDI_PARAM_NONE )
+			break;
+		Complete(dec, cable, channel, st->kind, number, st->dataMsb, value);
+		break;
+
+	case MIDI_CC_DATAINCREMENT:
+	case MIDI_CC_DATADECREMENT:
+		if( st->kind == USBMIDI_PARAM_NONE )
+			break;
+		Event(dec, cable, channel, st->kind,
+				(cc == MIDI_CC_DATAINCREMENT) ? USBMIDI_PARAM_INC : USBMIDI_PARAM_DEC, number, value);
+		break;
+
+	default:
+		if( cc < 32 )
+		{
+			st->ccNum = cc;
+			st->ccMsb = value;
+			Hold(dec, cable, channel, USBMIDI_PARAM_CC14, cc, value);
+		}
+		else if( (cc < 64) && (st->ccNum == cc - 32) )
+		{
+			Complete(dec, cable, channel, USBMIDI_PARAM_CC14, cc - 32, st->ccMsb, value);
+		}
+		break;
+	}
+}
+
+bool USBMIDIParamDec_Pop(USBMIDIParamDec_t *dec, USBMIDIParamEvent_t *ev)
+{
+	return USBMIDIParamFifo_Pop(&dec->fifo, ev);
+}
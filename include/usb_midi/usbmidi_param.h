@@ -0,0 +1,197 @@
+/*
+ * usbmidi_param.h
+ *
+ * 14-bit controllers and RPN/NRPN parameters as units, both ways.
+ *
+ * Sending, a USBMIDIParamEnc_t remembers per channel what the receiver
+ * already has, and leaves out what would not change anything:
+ *
+ * - the parameter select pair (CC 101/100 or 99/98) when the same parameter
+ *   is still selected;
+ * - the MSB (of a 14-bit controller, or Data Entry) when it is unchanged,
+ *   since a lone LSB updates the fine value;
+ * - the LSB after a new MSB when it is 0, since a new MSB clears the LSB.
+ *
+ * So an RPN update costs one to four Control Changes instead of four, and a
+ * 14-bit controller one or two instead of two. The encoder assumes it is the
+ * only writer of these controllers on its cable; anything else writing them
+ * should be followed by USBMIDIParamEnc_Forget().
+ *
+ * Receiving, a USBMIDIParamDec_t watches the Control Changes from the host and
+ * turns each (N)RPN Data Entry, Increment or Decrement, and each 14-bit
+ * controller, into a single USBMIDIParamEvent_t. An MSB is held back until
+ * its LSB arrives, anything else parameter-related arrives, or the OUT packet
+ * ends, so an MSB and LSB sent together give one event with the full value.
+ * Only the LSB of the controller whose MSB came last on the channel is
+ * paired; others are left to the OUT FIFO. The Control Changes themselves
+ * still go to the OUT FIFO.
+ *
+ * Nothing here touches hardware.
+ *
+ *  Created on: Oct 18, 2026
+ *
+ * MODS:
+ */
+
+#ifndef USB_MIDI_USBMIDI_PARAM_H_
+#define USB_MIDI_USBMIDI_PARAM_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "usb_midi.h"
+#include "usbmidi_batch.h"
+#include "usbmidi_ring.h"
+
+/**
+ * Number of virtual cables decoded. Control Changes on higher cables are
+ * ignored. Must be a power of two.
+ */
+#ifndef USBMIDI_PARAM_NUM_CABLES
+#define USBMIDI_PARAM_NUM_CABLES 2
+#endif
+
+/**
+ * Decoded events held for USBMIDI_ParamRead(). Must be a power of two.
+ */
+#ifndef USBMIDI_PARAM_FIFO_SIZE
+#define USBMIDI_PARAM_FIFO_SIZE 16
+#endif
+
+/**
+ * USBMIDIParamEvent_t.kind
+ */
+#define USBMIDI_PARAM_NONE		0
+#define USBMIDI_PARAM_CC14		1	//!< number is the MSB controller, 0-31
+#define USBMIDI_PARAM_RPN		2
+#define USBMIDI_PARAM_NRPN		3
+
+/**
+ * USBMIDIParamEvent_t.flags
+ */
+#define USBMIDI_PARAM_FINE		0x01	//!< the value has its LSB
+#define USBMIDI_PARAM_INC		0x02	//!< Data Increment by value
+#define USBMIDI_PARAM_DEC		0x04	//!< Data Decrement by value
+
+/**
+ * The null RPN, which deselects.
+ */
+#define USBMIDI_PARAM_RPN_NULL	0x3FFF
+
+/**
+ * \typedef USBMIDIParamEvent_t
+ */
+typedef struct
+{
+	uint8_t cable;
+	uint8_t channel;
+	uint8_t kind;
+	uint8_t flags;
+	uint16_t number;		//!< 14-bit parameter number, or controller
+	uint16_t value;			//!< 14-bit value; MSB only unless USBMIDI_PARAM_FINE
+} USBMIDIParamEvent_t;
+
+USBMIDI_RING_DEFINE(USBMIDIParamFifo, USBMIDIParamEvent_t, USBMIDI_PARAM_FIFO_SIZE);
+
+/**
+ * \typedef USBMIDIParamEnc_t
+ * What the receiver has, per channel of one cable. 0xFF is not known.
+ */
+typedef struct
+{
+	uint8_t cable;
+	struct
+	{
+		uint8_t kind;		//!< selected: USBMIDI_PARAM_NONE, _RPN, _NRPN
+		uint16_t number;
+		uint8_t dataMsb;
+		uint8_t ccMsb[32];
+	} chan[16];
+} USBMIDIParamEnc_t;
+
+/**
+ * \typedef USBMIDIParamDecChan_t
+ * What the host has sent on one channel.
+ */
+typedef struct
+{
+	uint8_t kind;			//!< selected: USBMIDI_PARAM_NONE, _RPN, _NRPN
+	uint8_t numMsb;
+	uint8_t numLsb;
+	uint8_t dataMsb;
+	uint8_t ccNum;			//!< last 14-bit controller MSB, 0xFF if none
+	uint8_t ccMsb;
+} USBMIDIParamDecChan_t;
+
+/**
+ * \typedef USBMIDIParamDec_t
+ */
+typedef struct
+{
+	USBMIDIParamDecChan_t chan[USBMIDI_PARAM_NUM_CABLES][16];
+	USBMIDIParamEvent_t pending;	//!< held for its LSB if kind is not NONE
+	USBMIDIParamFifo_t fifo;
+	uint32_t overflows;		//!< events lost to a full FIFO
+} USBMIDIParamDec_t;
+
+/**
+ * Start an encoder knowing nothing of the receiver.
+ */
+void USBMIDIParamEnc_Init(USBMIDIParamEnc_t *enc, uint8_t cable);
+
+/**
+ * Forget what the receiver has, so everything is sent in full next time.
+ */
+void USBMIDIParamEnc_Forget(USBMIDIParamEnc_t *enc);
+
+/**
+ * Add a 14-bit controller: controller is the MSB number, 0-31, value 0-16383.
+ * \returns false, adding nothing, if the batch has no room for two messages.
+ */
+bool USBMIDIParamEnc_CC14(USBMIDIParamEnc_t *enc, USBMIDIBatch_t *b, uint8_t channel,
+		uint8_t controller, uint16_t value);
+
+/**
+ * Add an RPN or NRPN change: number and value 0-16383.
+ * \returns false, adding nothing, if the batch has no room for four messages.
+ */
+bool USBMIDIParamEnc_Rpn(USBMIDIParamEnc_t *enc, USBMIDIBatch_t *b, uint8_t channel,
+		uint16_t number, uint16_t value);
+bool USBMIDIParamEnc_Nrpn(USBMIDIParamEnc_t *enc, USBMIDIBatch_t *b, uint8_t channel,
+		uint16_t number, uint16_t value);
+
+/**
+ * Add the null RPN, so later Data Entry on the channel changes nothing.
+ * \returns false, adding nothing, if the batch has no room for two messages.
+ */
+bool USBMIDIParamEnc_Deselect(USBMIDIParamEnc_t *enc, USBMIDIBatch_t *b, uint8_t channel);
+
+/**
+ * Clear the decoder: nothing selected, no events.
+ */
+void USBMIDIParamDec_Init(USBMIDIParamDec_t *dec);
+
+/**
+ * Forget selections and held MSBs, as when the host goes away. Events not yet
+ * read are kept.
+ */
+void USBMIDIParamDec_Reset(USBMIDIParamDec_t *dec);
+
+/**
+ * Watch one message from the host. Anything but a Control Change is ignored.
+ */
+void USBMIDIParamDec_Feed(USBMIDIParamDec_t *dec, const USBMIDI_Message_t *msg);
+
+/**
+ * Give up waiting for an LSB and queue the held event; at the end of each OUT
+ * packet.
+ */
+void USBMIDIParamDec_Flush(USBMIDIParamDec_t *dec);
+
+/**
+ * Take the oldest event.
+ * \returns false if there is none.
+ */
+bool USBMIDIParamDec_Pop(USBMIDIParamDec_t *dec, USBMIDIParamEvent_t *ev);
+
+#endif /* USB_MIDI_USBMIDI_PARAM_H_ */
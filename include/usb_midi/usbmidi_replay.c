@@ -0,0 +1,239 @@
+/*
+ * usbmidi_replay.c
+ *
+ * Bounded replay buffer for outgoing messages written while disconnected.
+ * See usbmidi_replay.h for the policy.
+ *
+ *  Created on: Oct 18, 2026
+ *
+ * MODS:
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "midi.h"
+#include "usb_midi.h"
+#include "usb_midi_fifo.h"
+#include "usbmidi_replay.h"
+
+static bool IsNoteOn(const USBMIDI_Message_t *msg)
+{
+	return (USB_MIDI_CODE_INDEX_NUMBER(msg->header) == USB_MIDI_CIN_NOTEON) && (msg->byte3 != 0);
+}
+
+static bool IsNoteOff(const USBMIDI_Message_t *msg)
+{
+	uint8_t cin = USB_MIDI_CODE_INDEX_NUMBER(msg->header);
+
+	return (cin == USB_MIDI_CIN_NOTEOFF) || ((cin == USB_MIDI_CIN_NOTEON) && (msg->byte3 == 0));
+}
+
+/*
+ * Messages that are worthless once late: Note Ons and the timing messages.
+ */
+static bool IsDroppable(const USBMIDI_Message_t *msg)
+{
+	uint8_t cin = USB_MIDI_CODE_INDEX_NUMBER(msg->header);
+
+	if( IsNoteOn(msg) )
+		return true;
+	if( cin == USB_MIDI_CIN_SINGLEBYTE )
+		return (msg->byte1 == MIDI_MSG_TIMINGCLOCK) || (msg->byte1 == MIDI_MSG_ACTIVESENSING);
+	if( cin == USB_MIDI_CIN_SYSCOM2 )
+		return msg->byte1 == MIDI_MSG_MTCQF;
+	return false;
+}
+
+static void Remove(USBMIDIReplay_t *rp, uint8_t i)
+{
+	rp->count--;
+	memmove(&rp->entry[i], &rp->entry[i + 1], (rp->count - i) * sizeof(rp->entry[0]));
+}
+
+/*
+ * Controllers whose meaning depends on what came before them: Bank Select
+ * only takes effect at the next Program Change, Data Entry and Increment /
+ * Decrement act on the parameter the last (N)RPN select named, and the channel
+ * mode messages are commands rather than state. These are held in order.
+ */
+static bool IsOrdered(uint8_t controller)
+{
+	switch( controller )
+	{
+	case MIDI_CC_BANKSELECT_MSB:
+	case MIDI_CC_BANKSELECT_LSB:
+	case MIDI_CC_DATAENTRY_MSB:
+	case MIDI_CC_DATAENTRY_LSB:
+	case MIDI_CC_DATAINCREMENT:
+	case MIDI_CC_DATADECREMENT:
+	case MIDI_CC_NRPN_LSB:
+	case MIDI_CC_NRPN_MSB:
+	case MIDI_CC_RPN_LSB:
+	case MIDI_CC_RPN_MSB:
+		return true;
+	default:
+		return controller >= MIDI_CC_CMM_ALLSOUNDOFF;
+	}
+}
+
+/*
+ * Drop the held entry a controller update supersedes, so the update goes on
+ * the end in its place and keeps its order against what was written between.
+ * CIN and status byte together name cable, message type and channel;
+ * controller and poly pressure messages also have to match on byte2.
+ */
+static void Coalesce(USBMIDIReplay_t *rp, const USBMIDI_Message_t *msg)
+{
+	const USBMIDI_Message_t *m;
+	uint8_t cin;
+	bool keyed;
+	uint8_t i;
+
+	cin = USB_MIDI_CODE_INDEX_NUMBER(msg->header);
+	switch( cin )
+	{
+	case USB_MIDI_CIN_CTRLCHANGE:
+		if( IsOrdered(msg->byte2) )
+			return;
+		keyed = true;
+		break;
+	case USB_MIDI_CIN_POLYKEYPRESS:
+		keyed = true;
+		break;
+	case USB_MIDI_CIN_PROGCHANGE:
+	case USB_MIDI_CIN_CHANPRESSURE:
+	case USB_MIDI_CIN_PITCHBEND:
+		keyed = false;
+		break;
+	default:
+		return;
+	}
+
+	for( i = 0; i < rp->count; i++ )
+	{
+		m = &rp->entry[i].msg;
+		if( m->header == msg->header && m->byte1 == msg->byte1 &&
+				(!keyed || m->byte2 == msg->byte2) )
+		{
+			Remove(rp, i);
+			rp->stats.coalesced++;
+			return;
+		}
+	}
+}
+
+/*
+ * A Note Off is coming: remove the newest held Note On for that key, if no
+ * Note Off already followed it. The Note Off itself is still held, because an
+ * earlier Note On for the same key may have gone out before the disconnect.
+ */
+static void CancelNoteOn(USBMIDIReplay_t *rp, const USBMIDI_Message_t *msg)
+{
+	const USBMIDI_Message_t *m;
+	uint8_t i;
+
+	for( i = rp->count; i-- > 0; )
+	{
+		m = &rp->entry[i].msg;
+		if( USB_MIDI_CABLE_NUMBER(m->header) != USB_MIDI_CABLE_NUMBER(msg->header) ||
+				(m->byte1 & 0x0F) != (msg->byte1 & 0x0F) || m->byte2 != msg->byte2 )
+			continue;
+		if( IsNoteOn(m) )
+		{
+			Remove(rp, i);
+			rp->stats.cancelled++;
+			return;
+		}
+		if( IsNoteOff(m) )
+			return;
+	}
+}
+
+void USBMIDIReplay_Init(USBMIDIReplay_t *rp)
+{
+	rp->enabled = false;
+	rp->maxAge = 0;
+	rp->count = 0;
+	memset(&rp->stats, 0, sizeof(rp->stats));
+}
+
+void USBMIDIReplay_Push(USBMIDIReplay_t *rp, const USBMIDI_Message_t *msg, uint32_t now)
+{
+	uint8_t i;
+
+	rp->stats.held++;
+
+	Coalesce(rp, msg);
+
+	if( IsNoteOff(msg) )
+		CancelNoteOn(rp, msg);
+
+	if( rp->count == USBMIDI_REPLAY_SIZE )
+	{
+		rp->stats.overflow++;
+
+		// make room with the oldest late-useless message, then the oldest
+		// message that is not a Note Off.
+		for( i = 0; i < rp->count; i++ )
+		{
+			if( IsDroppable(&rp->entry[i].msg) )
+				break;
+		}
+		if( i == rp->count && !IsDroppable(msg) )
+		{
+			for( i = 0; i < rp->count; i++ )
+			{
+				if( !IsNoteOff(&rp->entry[i].msg) )
+					break;
+			}
+		}
+
+		if( i < rp->count )
+			Remove(rp, i);
+		else if( !IsNoteOff(msg) )
+			return;
+		else
+			Remove(rp, 0);
+	}
+
+	rp->entry[rp->count].msg = *msg;
+	rp->entry[rp->count].time = now;
+	rp->count++;
+}
+
+uint32_t USBMIDIReplay_Drain(USBMIDIReplay_t *rp, USBMIDIFIFO_t *fifo, uint32_t now)
+{
+	USBMIDIReplayEntry_t *e;
+	uint32_t n = 0;
+	uint8_t i;
+
+	for( i = 0; i < rp->count; i++ )
+	{
+		e = &rp->entry[i];
+		if( IsDroppable(&e->msg) && (now - e->time) > rp->maxAge )
+		{
+			rp->stats.stale++;
+		}
+		else if( fifo->count < MIDI_USB_FIFO_SIZE )
+		{
+			USBMIDIFIFO_Push(fifo, &e->msg);
+			n++;
+		}
+		else
+		{
+			rp->stats.overflow++;
+		}
+	}
+
+	rp->count = 0;
+	rp->stats.replayed += n;
+
+	return n;
+}
+
+void USBMIDIReplay_GetStats(const USBMIDIReplay_t *rp, USBMIDIReplayStats_t *stats)
+{
+	*stats = rp->stats;
+}
@@ -0,0 +1,124 @@
+/*
+ * usbmidi_replay.h
+ *
+ * Holding outgoing messages across a bus reset or re-enumeration.
+ *
+ * While the device is not configured, USBMIDI_InEpMsgWrite() has nowhere to send
+ * messages. In reconnect-aware mode they are kept here instead, each with the
+ * time it was written, and replayed into the IN FIFO when the host configures
+ * the device again. A glitching hub then costs some latency instead of hanging
+ * notes or lost controller positions.
+ *
+ * The buffer is small and bounded, so it keeps what matters:
+ *
+ *  - Controller state is coalesced. A newer Control Change for the same cable,
+ *    channel and controller replaces the one already held, and goes on the end
+ *    so it stays after anything written in between; the same is done for
+ *    Program Change, Channel Pressure, Pitch Bend and Poly Pressure. A knob
+ *    turned during the outage costs one entry. Bank Select, the (N)RPN selects,
+ *    Data Entry, Increment, Decrement and the channel mode messages only mean
+ *    something in order, and are held as written.
+ *  - A Note Off (or Note On with velocity 0) whose Note On is still held removes
+ *    that Note On. The Note Off is kept, as an earlier Note On for the key may
+ *    have gone out before the disconnect.
+ *  - Note Offs are never dropped for age, and only for room when the buffer
+ *    holds nothing but Note Offs.
+ *  - On replay, Note Ons older than the maximum age are dropped, along with
+ *    stale Timing Clock, Active Sensing and MTC Quarter Frame messages.
+ *  - When the buffer is full, the oldest droppable message makes room, then
+ *    the oldest message that is not a Note Off. A newcomer that would need to
+ *    push out a Note Off is refused, unless it is a Note Off itself.
+ *
+ * Ages are counted in milliseconds, on the clock USBMIDI_Tick() keeps, which
+ * wraps after 49 days. The cycle counter would wrap after 53 s at 80 MHz, and
+ * a disconnect can last longer than that.
+ *
+ * Entries are kept in order in a plain array. It only holds a few dozen entries
+ * and is only touched while disconnected, so linear scans are fine.
+ *
+ *  Created on: Oct 18, 2026
+ *
+ * MODS:
+ */
+
+#ifndef USB_MIDI_USBMIDI_REPLAY_H_
+#define USB_MIDI_USBMIDI_REPLAY_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "usb_midi.h"
+#include "usb_midi_fifo.h"
+#include "usbmidi_budget.h"
+
+/**
+ * Number of messages held while disconnected.
+ */
+#ifndef USBMIDI_REPLAY_SIZE
+#define USBMIDI_REPLAY_SIZE 32
+#endif
+
+// counted in 8 bits.
+USBMIDI_STATIC_ASSERT(USBMIDIReplaySize, (USBMIDI_REPLAY_SIZE > 0) && (USBMIDI_REPLAY_SIZE <= 255));
+
+/**
+ * \typedef USBMIDIReplayEntry_t
+ * A held message and the time of its write, in ms.
+ */
+typedef struct
+{
+	USBMIDI_Message_t msg;
+	uint32_t time;
+} USBMIDIReplayEntry_t;
+
+/**
+ * \typedef USBMIDIReplayStats_t
+ * Counters, for tuning the buffer size and age.
+ */
+typedef struct
+{
+	uint32_t held;			//!< messages taken while disconnected
+	uint32_t coalesced;		//!< controller updates that replaced a held entry
+	uint32_t cancelled;		//!< Note On / Note Off pairs that never left
+	uint32_t stale;			//!< dropped on replay for age
+	uint32_t overflow;		//!< dropped for room
+	uint32_t replayed;		//!< moved to the IN FIFO
+} USBMIDIReplayStats_t;
+
+/**
+ * \typedef USBMIDIReplay_t
+ */
+typedef struct
+{
+	bool enabled;									//!< reconnect-aware mode
+	uint32_t maxAge;								//!< Note On age limit, in ms
+	uint8_t count;									//!< entries in use, oldest first
+	USBMIDIReplayEntry_t entry[USBMIDI_REPLAY_SIZE];
+	USBMIDIReplayStats_t stats;
+} USBMIDIReplay_t;
+
+/**
+ * Empty the buffer and clear the counters. Mode starts disabled.
+ */
+void USBMIDIReplay_Init(USBMIDIReplay_t *rp);
+
+/**
+ * Hold a message written while disconnected.
+ * \param now: current time, in ms.
+ */
+void USBMIDIReplay_Push(USBMIDIReplay_t *rp, const USBMIDI_Message_t *msg, uint32_t now);
+
+/**
+ * Move everything still worth sending onto the FIFO, oldest first, and empty
+ * the buffer. Messages that do not fit in the FIFO count as overflow.
+ * \param now: current time, in ms.
+ * \returns the number of messages moved.
+ */
+uint32_t USBMIDIReplay_Drain(USBMIDIReplay_t *rp, USBMIDIFIFO_t *fifo, uint32_t now);
+
+/**
+ * Get the counters.
+ */
+void USBMIDIReplay_GetStats(const USBMIDIReplay_t *rp, USBMIDIReplayStats_t *stats);
+
+#endif /* USB_MIDI_USBMIDI_REPLAY_H_ */
@@ -0,0 +1,99 @@
+/*
+ * usbmidi_ring.h
+ *
+ * Ring buffers of any element type and size, each size fixed at compile time.
+ *
+ * USBMIDI_RING_DEFINE(Name, Type, Size) makes a ring type Name_t holding Size
+ * elements of Type, and inline Name_Init(), _Push(), _Pop(), _Peek() and
+ * _Full() for it. Size must be a power of two, which is checked when the ring
+ * is defined, so wrapping an index is a mask rather than a compare. Indices
+ * are 16 bits, so a ring may hold up to 32768 elements.
+ *
+ * Each queue gets the element type and depth it needs; USBMIDIFIFO_t is the
+ * one of MIDI_USB_FIFO_SIZE event packets:
+ *
+ *		USBMIDI_RING_DEFINE(TraceRing, uint32_t, 256);
+ *
+ *		TraceRing_t trace;
+ *		TraceRing_Init(&trace);
+ *		TraceRing_Push(&trace, &stamp);
+ *
+ * As with USBMIDIFIFO_t, a ring shared between an interrupt and the main loop
+ * is only touched by the main loop with interrupts masked.
+ *
+ * Nothing here touches hardware.
+ *
+ *  Created on: Oct 18, 2026
+ *
+ * MODS:
+ */
+
+#ifndef USB_MIDI_USBMIDI_RING_H_
+#define USB_MIDI_USBMIDI_RING_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "usbmidi_budget.h"
+
+/**
+ * Fail to compile, with the name in the error, unless size is a power of two
+ * that 16-bit indices can count.
+ */
+#define USBMIDI_RING_CHECK_SIZE(Name, Size)	\
+	USBMIDI_STATIC_ASSERT(Name##_SizeMustBePowerOfTwo, USBMIDI_POW2_UPTO(Size, 32768))
+
+#define USBMIDI_RING_DEFINE(Name, Type, Size)	\
+	USBMIDI_RING_CHECK_SIZE(Name, Size);	\
+	\
+	typedef struct	\
+	{	\
+		uint16_t head;	\
+		uint16_t tail;	\
+		uint16_t count;	\
+		Type item[Size];	\
+	} Name##_t;	\
+	\
+	static inline void Name##_Init(Name##_t *r)	\
+	{	\
+		r->head = 0;	\
+		r->tail = 0;	\
+		r->count = 0;	\
+	}	\
+	\
+	static inline bool Name##_Full(const Name##_t *r)	\
+	{	\
+		return r->count >= (Size);	\
+	}	\
+	\
+	/* false, pushing nothing, if the ring is full. */	\
+	static inline bool Name##_Push(Name##_t *r, const Type *v)	\
+	{	\
+		if( r->count >= (Size) )	\
+			return false;	\
+		r->item[r->head] = *v;	\
+		r->head = (r->head + 1) & ((Size) - 1);	\
+		r->count++;	\
+		return true;	\
+	}	\
+	\
+	/* false if the ring is empty. */	\
+	static inline bool Name##_Pop(Name##_t *r, Type *v)	\
+	{	\
+		if( !r->count )	\
+			return false;	\
+		*v = r->item[r->tail];	\
+		r->tail = (r->tail + 1) & ((Size) - 1);	\
+		r->count--;	\
+		return true;	\
+	}	\
+	\
+	static inline bool Name##_Peek(const Name##_t *r, Type *v)	\
+	{	\
+		if( !r->count )	\
+			return false;	\
+		*v = r->item[r->tail];	\
+		return true;	\
+	}
+
+#endif /* USB_MIDI_USBMIDI_RING_H_ */
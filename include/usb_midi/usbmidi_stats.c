@@ -0,0 +1,48 @@
+/*
+ * usbmidi_stats.c
+ *
+ * The statistics block's SysEx dump. See usbmidi_stats.h.
+ *
+ *  Created on: Oct 18, 2026
+ *
+ * MODS:
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "midi.h"
+#include "usbmidi_stats.h"
+
+uint32_t USBMIDIStats_Reply(const USBMIDIStats_t *stats, uint8_t *buf)
+{
+	const uint32_t *word = (const uint32_t *) stats;
+	uint8_t *p = buf;
+	uint8_t *top = 0;
+	uint32_t i;
+	uint8_t b;
+
+	*p++ = MIDI_MSG_SOX;
+	*p++ = USBMIDI_STATS_SYSEX_ID;
+	*p++ = USBMIDI_STATS_SYSEX_SUBID;
+	*p++ = USBMIDI_STATS_REPLY;
+	*p++ = USBMIDI_STATS_CMD_QUERY;
+	*p++ = USBMIDI_STATS_VERSION;
+	*p++ = USBMIDI_STATS_WORDS;
+
+	// little-endian whatever the CPU, seven bytes to a group.
+	for( i = 0; i < USBMIDI_STATS_WORDS * 4; i++ )
+	{
+		if( i % 7 == 0 )
+		{
+			top = p++;
+			*top = 0;
+		}
+		b = (word[i / 4] >> (8 * (i % 4))) & 0xFF;
+		*top |= (b >> 7) << (i % 7);
+		*p++ = b & 0x7F;
+	}
+	*p++ = MIDI_MSG_EOX;
+
+	return p - buf;
+}
@@ -0,0 +1,142 @@
+/*
+ * usbmidi_stats.h
+ *
+ * The stack's counters, kept together in one block in the device structure,
+ * and its SysEx dump.
+ *
+ * Everything that counts traffic, losses or connection events writes here, so
+ * one copy taken with interrupts masked is a consistent picture of the whole
+ * stack. FIFO depths and SysEx pool usage are read into the copy as it is
+ * taken.
+ *
+ * Protocol, as for the firmware updater and the loopback mode: F0 7D 53 <cmd>
+ * ... F7 (7D is the non-commercial manufacturer ID, 53 is 'S'), on any cable.
+ *
+ *   QUERY   01		the statistics block
+ *
+ * The reply goes back on the cable the query came in on:
+ *
+ *   F0 7D 53 7F 01 <version> <words> <block> F7
+ *
+ * <block> is the USBMIDIStats_t as little-endian 32-bit words, packed 8-to-7
+ * as for the firmware updater: each group of up to 7 bytes is sent as one
+ * byte holding their top bits (bit 0 for the first byte), then the bytes' low
+ * 7 bits. Fields are only ever added at the end, so a reader takes the first
+ * <words> it knows and skips the rest.
+ *
+ * The reply is about 190 bytes and shares IN packets with everything else:
+ * timing messages and other cables go out between its fragments. Messages on
+ * its own cable wait for it, so scrape a running show on a cable it does not
+ * use.
+ *
+ * Nothing here touches hardware.
+ *
+ *  Created on: Oct 18, 2026
+ *
+ * MODS:
+ */
+
+#ifndef USB_MIDI_USBMIDI_STATS_H_
+#define USB_MIDI_USBMIDI_STATS_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * Protocol constants.
+ */
+#define USBMIDI_STATS_SYSEX_ID			0x7D
+#define USBMIDI_STATS_SYSEX_SUBID		0x53
+#define USBMIDI_STATS_CMD_QUERY			0x01
+#define USBMIDI_STATS_REPLY				0x7F
+
+#define USBMIDI_STATS_VERSION			1
+
+/**
+ * \typedef USBMIDIFifoStats_t
+ */
+typedef struct
+{
+	uint32_t depth;			//!< when the copy was taken
+	uint32_t highWater;
+	uint32_t drops;			//!< messages lost to a full FIFO
+} USBMIDIFifoStats_t;
+
+/**
+ * \typedef USBMIDIStats_t
+ * All words, so the block goes out as it is.
+ */
+typedef struct
+{
+	uint32_t ms;					//!< since USBMIDI_Init(), as far as USBMIDI_Tick() has counted
+
+	USBMIDIFifoStats_t inMsg;		//!< IN FIFO, in messages
+	USBMIDIFifoStats_t inRt;		//!< timing messages
+	USBMIDIFifoStats_t inUmp;		//!< UMP from USBMIDI_UmpWrite(), in words
+	USBMIDIFifoStats_t outMsg;		//!< OUT FIFO
+	USBMIDIFifoStats_t outUmp;		//!< the host's UMP, in words
+	USBMIDIFifoStats_t outParam;	//!< decoded (N)RPNs and 14-bit controllers
+
+	uint32_t outPackets;			//!< OUT packets from the host
+	uint32_t outWords;				//!< event packets or UMP words in them
+	uint32_t inPackets;				//!< IN packets loaded
+	uint32_t inWords;
+
+	uint32_t isrCalls;				//!< endpoint interrupts
+	uint32_t isrCycles;				//!< cycles in the last one
+	uint32_t isrCyclesMax;
+
+	uint32_t sysExBlocksInUse;
+	uint32_t sysExBlocksHighWater;
+	uint32_t sysExMessages;			//!< received complete
+	uint32_t sysExPoolExhausted;
+	uint32_t sysExQueueFull;
+	uint32_t sysExAborted;
+
+	uint32_t configs;				//!< SET_CONFIGURATIONs
+	uint32_t resets;				//!< bus resets
+	uint32_t disconnects;
+	uint32_t suspends;
+	uint32_t remoteWakeups;
+
+	uint32_t classRequests;			//!< EP0
+	uint32_t vendorRequests;
+	uint32_t stalledRequests;
+
+	uint32_t maskedSections;		//!< outermost critical sections from below the USB level
+	uint32_t maskedCyclesMax;		//!< longest of them, USB interrupt held off
+} USBMIDIStats_t;
+
+#define USBMIDI_STATS_WORDS		(sizeof(USBMIDIStats_t) / 4)
+
+/**
+ * Size of the reply, F0 to F7.
+ */
+#define USBMIDI_STATS_REPLY_SIZE	(7 + USBMIDI_STATS_WORDS * 4 + (USBMIDI_STATS_WORDS * 4 + 6) / 7 + 1)
+
+/**
+ * Note a FIFO's depth after a push, for its high water mark.
+ */
+static inline void USBMIDIStats_Depth(USBMIDIFifoStats_t *s, uint32_t depth)
+{
+	if( depth > s->highWater )
+		s->highWater = depth;
+}
+
+/**
+ * True if a message with this manufacturer ID, sub-ID and command is the
+ * query.
+ */
+static inline bool USBMIDIStats_IsQuery(uint8_t id, uint8_t subId, uint8_t cmd)
+{
+	return (id == USBMIDI_STATS_SYSEX_ID) && (subId == USBMIDI_STATS_SYSEX_SUBID) &&
+			(cmd == USBMIDI_STATS_CMD_QUERY);
+}
+
+/**
+ * Write the reply, F0 to F7, into USBMIDI_STATS_REPLY_SIZE bytes.
+ * \returns its length.
+ */
+uint32_t USBMIDIStats_Reply(const USBMIDIStats_t *stats, uint8_t *buf);
+
+#endif /* USB_MIDI_USBMIDI_STATS_H_ */
@@ -0,0 +1,385 @@
+/*
+ * usbmidi_sysex.c
+ *
+ * Streaming SysEx reassembly into a static block pool.
+ * See usbmidi_sysex.h for the overall scheme.
+ *
+ *  Created on: Oct 18, 2026
+ *
+ * MODS:
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+
+
+#include "midi.h"
+#include "usb_midi.h"
+#include "usbmidi_sysex.h"
+#include "usbmidi_critical.h"
+
+#define DONE_QUEUE_MASK (USBMIDI_SYSEX_DONE_QUEUE_SIZE - 1)
+
+/*
+ * Number of MIDI bytes carried by each of the SysEx Code Index Numbers.
+ * Indexed by CIN; zero means "not SysEx."
+ */
+static const uint8_t SysExCinBytes[16] =
+{
+	0, 0, 0, 0,
+	3,		// USB_MIDI_CIN_SYSEXSTART
+	1,		// USB_MIDI_CIN_SYSEND1
+	2,		// USB_MIDI_CIN_SYSEND2
+	3,		// USB_MIDI_CIN_SYSEND3
+	0, 0, 0, 0, 0, 0, 0, 0
+};
+
+/*
+ * Take a block off the free list. Only the endpoint handler allocates,
+ * so no locking is needed here.
+ */
+static USBMIDISysExBlock_t *BlockAlloc(USBMIDISysEx_t *sx)
+{
+	USBMIDISysExBlock_t *blk;
+
+	blk = sx->freeList;
+	if( blk )
+	{
+		sx->freeList = blk->next;
+		blk->next = 0;
+		blk->len = 0;
+		sx->stats.blocksInUse++;
+		if( sx->stats.blocksInUse > sx->stats.blocksHighWater )
+			sx->stats.blocksHighWater = sx->stats.blocksInUse;
+	}
+	return blk;
+}
+
+/*
+ * Return a whole chain to the free list in one splice.
+ * Caller is responsible for exclusion against the endpoint handler.
+ */
+static void ChainFree(USBMIDISysEx_t *sx, USBMIDISysExMsg_t *msg)
+{
+	const USBMIDISysExBlock_t *blk;
+	uint16_t n = 0;
+
+	if( msg->first == 0 )
+		return;
+
+	for( blk = msg->first; blk; blk = blk->next )
+		n++;
+
+	msg->last->next = sx->freeList;
+	sx->freeList = (USBMIDISysExBlock_t *) msg->first;
+	sx->stats.blocksInUse -= n;
+
+	msg->first = 0;
+	msg->last = 0;
+	msg->length = 0;
+}
+
+/*
+ * Throw away whatever a cable has collected so far.
+ */
+static void CableAbort(USBMIDISysEx_t *sx, USBMIDISysExCable_t *c)
+{
+	if( c->active && !c->dropping )
+		sx->stats.aborted++;
+	ChainFree(sx, &c->msg);
+	c->active = false;
+	c->dropping = false;
+}
+
+/*
+ * Append one byte to a cable's chain, grabbing a new block when the last one is full.
+ */
+static void CablePutByte(USBMIDISysEx_t *sx, USBMIDISysExCable_t *c, uint8_t b)
+{
+	USBMIDISysExBlock_t *blk;
+
+	if( c->dropping )
+		return;
+
+	blk = c->msg.last;
+	if( blk == 0 || blk->len == USBMIDI_SYSEX_BLOCK_SIZE )
+	{
+		blk = BlockAlloc(sx);
+		if( blk == 0 )
+		{
+			// out of blocks: give back what we have and skip to the F7.
+			sx->stats.poolExhausted++;
+			ChainFree(sx, &c->msg);
+			c->dropping = true;
+			return;
+		}
+		if( c->msg.last )
+			c->msg.last->next = blk;
+		else
+			c->msg.first = blk;
+		c->msg.last = blk;
+	}
+
+	blk->data[blk->len++] = b;
+	c->msg.length++;
+}
+
+/*
+ * The F7 arrived. Move the chain onto the done queue.
+ */
+static void CableFinish(USBMIDISysEx_t *sx, USBMIDISysExCable_t *c)
+{
+	uint8_t head;
+
+	if( c->dropping )
+	{
+		c->active = false;
+		c->dropping = false;
+		return;
+	}
+
+	head = sx->doneHead;
+	if( ((head + 1) & DONE_QUEUE_MASK) == sx->doneTail )
+	{
+		sx->stats.queueFull++;
+		ChainFree(sx, &c->msg);
+	}
+	else
+	{
+		sx->done[head] = c->msg;
+		sx->doneHead = (head + 1) & DONE_QUEUE_MASK;
+		sx->stats.messages++;
+		c->msg.first = 0;
+		c->msg.last = 0;
+		c->msg.length = 0;
+	}
+	c->active = false;
+}
+
+void USBMIDISysEx_Init(USBMIDISysEx_t *sx)
+{
+	uint32_t i;
+
+	for( i = 0; i < USBMIDI_SYSEX_NUM_BLOCKS - 1; i++ )
+		sx->pool[i].next = &sx->pool[i + 1];
+	sx->pool[USBMIDI_SYSEX_NUM_BLOCKS - 1].next = 0;
+	sx->freeList = &sx->pool[0];
+
+	for( i = 0; i < USBMIDI_SYSEX_NUM_CABLES; i++ )
+	{
+		sx->cable[i].msg.cable = i;
+		sx->cable[i].msg.length = 0;
+		sx->cable[i].msg.first = 0;
+		sx->cable[i].msg.last = 0;
+		sx->cable[i].active = false;
+		sx->cable[i].dropping = false;
+	}
+
+	sx->doneHead = 0;
+	sx->doneTail = 0;
+
+	sx->stats.blocksInUse = 0;
+	sx->stats.blocksHighWater = 0;
+	sx->stats.messages = 0;
+	sx->stats.poolExhausted = 0;
+	sx->stats.queueFull = 0;
+	sx->stats.aborted = 0;
+}
+
+void USBMIDISysEx_Reset(USBMIDISysEx_t *sx)
+{
+	uint32_t i;
+
+	for( i = 0; i < USBMIDI_SYSEX_NUM_CABLES; i++ )
+		CableAbort(sx, &sx->cable[i]);
+}
+
+/*
+ * Called from the endpoint handler for every OUT packet.
+ * Only the SysEx CINs are of interest. CIN 0x5 doubles as "single-byte system
+ * common," so it is only claimed when it ends a SysEx in progress.
+ */
+bool USBMIDISysEx_Feed(USBMIDISysEx_t *sx, const USBMIDI_Message_t *msg)
+{
+	USBMIDISysExCable_t *c;
+	uint8_t cin;
+	uint8_t cable;
+	uint8_t nbytes;
+	const uint8_t *p;
+	uint8_t i;
+
+	cin = USB_MIDI_CODE_INDEX_NUMBER(msg->header);
+	nbytes = SysExCinBytes[cin];
+	if( nbytes == 0 )
+		return false;
+
+	cable = USB_MIDI_CABLE_NUMBER(msg->header);
+	if( cable >= USBMIDI_SYSEX_NUM_CABLES )
+		return false;
+	c = &sx->cable[cable];
+
+	p = &msg->byte1;
+
+	if( p[0] == MIDI_MSG_SOX )
+	{
+		// a new message starts; anything unfinished on this cable is lost.
+		CableAbort(sx, c);
+		c->active = true;
+	}
+	else if( !c->active )
+	{
+		// not inside a SysEx. A lone system common byte is not ours;
+		// a stray continuation is swallowed.
+		if( cin == USB_MIDI_CIN_SYSEND1 && p[0] != MIDI_MSG_EOX )
+			return false;
+		return true;
+	}
+
+	// only data bytes between the F0 and the F7, and an end packet ends with
+	// the F7. Anything else from the host cuts the message off.
+	for( i = 0; i < nbytes; i++ )
+	{
+		if( (p[i] & 0x80) && !((i == 0) && (p[i] == MIDI_MSG_SOX)) &&
+				!((i == nbytes - 1) && (cin != USB_MIDI_CIN_SYSEXSTART) && (p[i] == MIDI_MSG_EOX)) )
+		{
+			CableAbort(sx, c);
+			return true;
+		}
+		CablePutByte(sx, c, p[i]);
+	}
+
+	if( cin != USB_MIDI_CIN_SYSEXSTART )
+	{
+		if( p[nbytes - 1] != MIDI_MSG_EOX )
+			CableAbort(sx, c);
+		else
+			CableFinish(sx, c);
+	}
+
+	return true;
+}
+
+uint32_t USBMIDISysEx_Dispatch(USBMIDISysEx_t *sx, tUSBMIDISysExCallback callback)
+{
+	USBMIDISysExMsg_t *msg;
+	uint32_t n = 0;
+	uint32_t mask;
+
+	while( sx->doneTail != sx->doneHead )
+	{
+		msg = &sx->done[sx->doneTail];
+
+		if( callback )
+			callback(msg);
+
+		// the endpoint handler allocates from the same free list.
+		mask = USBMIDI_CriticalEnter();
+		ChainFree(sx, msg);
+		USBMIDI_CriticalExit(mask);
+
+		sx->doneTail = (sx->doneTail + 1) & DONE_QUEUE_MASK;
+		n++;
+	}
+
+	return n;
+}
+
+void USBMIDISysEx_ReaderInit(USBMIDISysExReader_t *rd, const USBMIDISysExMsg_t *msg)
+{
+	rd->blk = msg->first;
+	rd->idx = 0;
+	rd->remaining = msg->length;
+}
+
+bool USBMIDISysEx_ReadByte(USBMIDISysExReader_t *rd, uint8_t *b)
+{
+	if( rd->remaining == 0 )
+		return false;
+
+	if( rd->idx == rd->blk->len )
+	{
+		rd->blk = rd->blk->next;
+		rd->idx = 0;
+	}
+	*b = rd->blk->data[rd->idx++];
+	rd->remaining--;
+
+	return true;
+}
+
+bool USBMIDISysEx_TxStart(USBMIDISysExTx_t *tx, uint8_t cable, const uint8_t *data, uint32_t len)
+{
+	if( tx->busy )
+		return false;
+	if( len < 2 || data[0] != MIDI_MSG_SOX || data[len - 1] != MIDI_MSG_EOX )
+		return false;
+
+	tx->data = data;
+	tx->next = data;
+	tx->len = len;
+	tx->remaining = len;
+	tx->cable = cable;
+	tx->busy = true;
+
+	return true;
+}
+
+/*
+ * Called from USBMIDI_InEpSendMessages() with whatever room is left in the packet.
+ */
+uint32_t USBMIDISysEx_TxFill(USBMIDISysExTx_t *tx, uint8_t *buf, uint32_t space)
+{
+	const uint8_t *p;
+	uint8_t *pbuf;
+	uint8_t start;
+	uint32_t nfull;
+	uint32_t rem;
+
+	if( !tx->busy )
+		return 0;
+
+	p = tx->next;
+	pbuf = buf;
+	start = USB_MIDI_HEADER(tx->cable, USB_MIDI_CIN_SYSEXSTART);
+
+	// full three-byte packets that are not the end of the message.
+	nfull = (tx->remaining - 1) / 3;
+	if( nfull > space / 4 )
+		nfull = space / 4;
+	tx->remaining -= nfull * 3;
+	space -= nfull * 4;
+	while( nfull-- )
+	{
+		*pbuf++ = start;
+		*pbuf++ = *p++;
+		*pbuf++ = *p++;
+		*pbuf++ = *p++;
+	}
+
+	// the tail: one to three bytes, with the CIN saying how many.
+	rem = tx->remaining;
+	if( rem <= 3 && space >= 4 )
+	{
+		*pbuf++ = USB_MIDI_HEADER(tx->cable, (USB_MIDI_CIN_SYSEND1 + rem - 1));
+		*pbuf++ = *p++;
+		*pbuf++ = (rem > 1) ? *p++ : 0;
+		*pbuf++ = (rem > 2) ? *p++ : 0;
+		tx->remaining = 0;
+	}
+
+	tx->next = p;
+
+	if( tx->remaining == 0 )
+	{
+		tx->busy = false;
+		if( tx->pfnDone )
+			tx->pfnDone(tx->cable, tx->data, tx->len);
+	}
+
+	return pbuf - buf;
+}
+
+void USBMIDISysEx_GetStats(const USBMIDISysEx_t *sx, USBMIDISysExStats_t *stats)
+{
+	*stats = sx->stats;
+}
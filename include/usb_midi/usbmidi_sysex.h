@@ -0,0 +1,235 @@
+/*
+ * usbmidi_sysex.h
+ *
+ * Streaming reassembly of System Exclusive messages received on the OUT endpoint.
+ *
+ * SysEx arrives as a run of USB-MIDI event packets (CIN 0x4 for start/continue,
+ * CIN 0x5/0x6/0x7 for the end with one, two or three bytes). Pushing those
+ * fragments through the OUT message FIFO means any dump bigger than about
+ * 3 * MIDI_USB_FIFO_SIZE bytes overflows it, so instead the endpoint handler
+ * streams the payload bytes straight into fixed-size blocks taken from a
+ * static pool. Each cable has its own in-progress chain.
+ *
+ * When the terminating F7 arrives, the finished chain is queued. The main loop
+ * calls USBMIDISysEx_Dispatch(), which hands each message to the application
+ * callback as a chained view into the pool (no copy), then returns the blocks
+ * to the pool when the callback returns.
+ *
+ * The transmit side goes the other way: USBMIDISysEx_TxFill() cuts a caller's
+ * buffer into event packets written straight into the IN endpoint packet
+ * buffer, so a dump costs no FIFO traffic at all.
+ *
+ *  Created on: Oct 18, 2026
+ *
+ * MODS:
+ */
+
+#ifndef USB_MIDI_USBMIDI_SYSEX_H_
+#define USB_MIDI_USBMIDI_SYSEX_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "usb_midi.h"
+#include "usbmidi_budget.h"
+
+/**
+ * Payload bytes per pool block. 64 matches the endpoint packet size.
+ */
+#ifndef USBMIDI_SYSEX_BLOCK_SIZE
+#define USBMIDI_SYSEX_BLOCK_SIZE 64
+#endif
+
+/**
+ * Number of blocks in the pool. With the defaults this is 128 * 72 bytes,
+ * 9 KB of SRAM, which holds an 8 KB dump (or several smaller ones).
+ */
+#ifndef USBMIDI_SYSEX_NUM_BLOCKS
+#define USBMIDI_SYSEX_NUM_BLOCKS 128
+#endif
+
+/**
+ * Number of virtual cables that get their own reassembly state.
+ * The descriptor exposes two embedded jacks per direction.
+ * Packets for higher cable numbers go through the OUT FIFO untouched.
+ */
+#ifndef USBMIDI_SYSEX_NUM_CABLES
+#define USBMIDI_SYSEX_NUM_CABLES 2
+#endif
+
+/**
+ * Number of completed messages that can wait for the main loop.
+ * Must be a power of two.
+ */
+#ifndef USBMIDI_SYSEX_DONE_QUEUE_SIZE
+#define USBMIDI_SYSEX_DONE_QUEUE_SIZE 8
+#endif
+
+// block lengths and the pool counters are 16 bits, the done queue's indices 8.
+USBMIDI_STATIC_ASSERT(USBMIDISysExBlockSize, (USBMIDI_SYSEX_BLOCK_SIZE >= 4) && (USBMIDI_SYSEX_BLOCK_SIZE <= 65535));
+USBMIDI_STATIC_ASSERT(USBMIDISysExNumBlocks, (USBMIDI_SYSEX_NUM_BLOCKS >= USBMIDI_SYSEX_NUM_CABLES) &&
+		(USBMIDI_SYSEX_NUM_BLOCKS <= 65535));
+USBMIDI_STATIC_ASSERT(USBMIDISysExDoneQueue, USBMIDI_POW2_UPTO(USBMIDI_SYSEX_DONE_QUEUE_SIZE, 256));
+
+/**
+ * \typedef USBMIDISysExBlock_t
+ * One block of the pool. Blocks of a message are chained through next.
+ * Every block but the last is full.
+ */
+typedef struct USBMIDISysExBlock
+{
+	struct USBMIDISysExBlock *next;				//!< next block of this message, or 0
+	uint16_t len;								//!< number of valid bytes in data[]
+	uint8_t data[USBMIDI_SYSEX_BLOCK_SIZE];		//!< payload, including the F0 and F7
+} USBMIDISysExBlock_t;
+
+/**
+ * \typedef USBMIDISysExMsg_t
+ * A complete SysEx message, as a view of a chain of pool blocks.
+ * The view is valid only for the duration of the completion callback.
+ */
+typedef struct
+{
+	uint8_t cable;						//!< virtual cable the message arrived on
+	uint32_t length;					//!< total number of bytes, F0 through F7
+	const USBMIDISysExBlock_t *first;	//!< first block in the chain
+	USBMIDISysExBlock_t *last;			//!< last block, so the chain is freed in one step
+} USBMIDISysExMsg_t;
+
+/**
+ * \typedef USBMIDISysExReader_t
+ * Cursor for reading a message byte by byte without copying it out of the pool.
+ */
+typedef struct
+{
+	const USBMIDISysExBlock_t *blk;		//!< block being read
+	uint16_t idx;						//!< next byte within blk
+	uint32_t remaining;					//!< bytes left in the message
+} USBMIDISysExReader_t;
+
+/**
+ * \typedef tUSBMIDISysExCallback
+ * Invoked from the main loop for each complete message.
+ */
+typedef void (*tUSBMIDISysExCallback)(const USBMIDISysExMsg_t *msg);
+
+/**
+ * \typedef USBMIDISysExStats_t
+ * Pool usage and error counters.
+ */
+typedef struct
+{
+	uint16_t blocksInUse;		//!< blocks currently allocated
+	uint16_t blocksHighWater;	//!< most blocks ever allocated at once
+	uint32_t messages;			//!< messages completed and queued
+	uint32_t poolExhausted;		//!< messages dropped because the pool ran dry
+	uint32_t queueFull;			//!< messages dropped because the done queue was full
+	uint32_t aborted;			//!< messages cut off by a new F0, a stray byte or a reset
+} USBMIDISysExStats_t;
+
+/*
+ * Per-cable reassembly state.
+ */
+typedef struct
+{
+	USBMIDISysExMsg_t msg;		//!< message being built
+	bool active;				//!< an F0 has been seen and no F7 yet
+	bool dropping;				//!< pool ran out, discard until the F7
+} USBMIDISysExCable_t;
+
+/*
+ * The reassembler: pool, free list, per-cable state and the completed queue.
+ * The endpoint handler is the only producer; the main loop the only consumer.
+ */
+typedef struct
+{
+	USBMIDISysExBlock_t pool[USBMIDI_SYSEX_NUM_BLOCKS];
+	USBMIDISysExBlock_t *freeList;
+	USBMIDISysExCable_t cable[USBMIDI_SYSEX_NUM_CABLES];
+	USBMIDISysExMsg_t done[USBMIDI_SYSEX_DONE_QUEUE_SIZE];
+	volatile uint8_t doneHead;
+	volatile uint8_t doneTail;
+	USBMIDISysExStats_t stats;
+} USBMIDISysEx_t;
+
+/**
+ * \typedef tUSBMIDISysExTxCallback
+ * Invoked (from the USB interrupt) once the last byte of an outgoing
+ * message has been loaded into the endpoint. The buffer may be reused then.
+ */
+typedef void (*tUSBMIDISysExTxCallback)(uint8_t cable, const uint8_t *data, uint32_t len);
+
+/*
+ * Transmit job: one outgoing SysEx message, sent straight from the caller's buffer.
+ */
+typedef struct
+{
+	const uint8_t *data;		//!< start of the caller's buffer
+	const uint8_t *next;		//!< next byte to send
+	uint32_t len;				//!< total length, F0 through F7
+	uint32_t remaining;			//!< bytes not yet packed
+	uint8_t cable;				//!< virtual cable to send on
+	volatile bool busy;			//!< a message is in flight
+	tUSBMIDISysExTxCallback pfnDone;	//!< completion callback, may be 0
+} USBMIDISysExTx_t;
+
+/**
+ * Put every block on the free list and clear all state.
+ * Only call this when no completed message is being dispatched.
+ */
+void USBMIDISysEx_Init(USBMIDISysEx_t *sx);
+
+/**
+ * Abandon any in-progress messages, e.g. on a configuration change.
+ * Completed messages still waiting for dispatch are kept.
+ */
+void USBMIDISysEx_Reset(USBMIDISysEx_t *sx);
+
+/**
+ * Offer one OUT endpoint packet to the reassembler. Called from the endpoint handler.
+ * \returns true if the packet was SysEx and was consumed, false if the caller
+ * should treat it as an ordinary message.
+ */
+bool USBMIDISysEx_Feed(USBMIDISysEx_t *sx, const USBMIDI_Message_t *msg);
+
+/**
+ * Hand each completed message to the callback, then free its blocks.
+ * Call from the main loop. A null callback just frees the messages.
+ * \returns the number of messages dispatched.
+ */
+uint32_t USBMIDISysEx_Dispatch(USBMIDISysEx_t *sx, tUSBMIDISysExCallback callback);
+
+/**
+ * Point a reader at the first byte (the F0) of a message.
+ */
+void USBMIDISysEx_ReaderInit(USBMIDISysExReader_t *rd, const USBMIDISysExMsg_t *msg);
+
+/**
+ * Fetch the next byte of a message.
+ * \returns false once the whole message has been read.
+ */
+bool USBMIDISysEx_ReadByte(USBMIDISysExReader_t *rd, uint8_t *b);
+
+/**
+ * Start sending a message. data must hold a complete message, F0 through F7,
+ * and must stay valid until the completion callback.
+ * \returns false if a message is already in flight or the buffer is not SysEx.
+ */
+bool USBMIDISysEx_TxStart(USBMIDISysExTx_t *tx, uint8_t cable, const uint8_t *data, uint32_t len);
+
+/**
+ * Pack as much of the message as fits into an endpoint packet buffer.
+ * Each event packet carries three bytes with CIN 0x4, except the last, which uses
+ * CIN 0x5, 0x6 or 0x7 for one, two or three bytes.
+ * \param buf: where to write the event packets.
+ * \param space: bytes available in buf; only whole 4-byte packets are written.
+ * \returns the number of bytes written to buf.
+ */
+uint32_t USBMIDISysEx_TxFill(USBMIDISysExTx_t *tx, uint8_t *buf, uint32_t space);
+
+/**
+ * Copy the pool counters.
+ */
+void USBMIDISysEx_GetStats(const USBMIDISysEx_t *sx, USBMIDISysExStats_t *stats);
+
+#endif /* USB_MIDI_USBMIDI_SYSEX_H_ */
@@ -0,0 +1,49 @@
+/*
+ * usbmidi_timestamp.h
+ *
+ * Cheap timestamps for instrumenting the stack.
+ *
+ * These read the Cortex-M4 DWT cycle counter, so a timestamp is one load from
+ * a core register and costs no peripheral. At 80 MHz the counter wraps every
+ * 53 seconds; differences taken with unsigned subtraction are correct across
+ * one wrap.
+ *
+ *  Created on: Oct 18, 2026
+ *
+ * MODS:
+ */
+
+#ifndef USB_MIDI_USBMIDI_TIMESTAMP_H_
+#define USB_MIDI_USBMIDI_TIMESTAMP_H_
+
+#include <stdint.h>
+
+#include "inc/hw_types.h"
+
+/*
+ * Core debug and DWT registers. These are not in the TivaWare headers.
+ */
+#define USBMIDI_DEMCR			0xE000EDFC		// Debug Exception and Monitor Control
+#define USBMIDI_DEMCR_TRCENA	0x01000000		// enable DWT
+#define USBMIDI_DWT_CTRL		0xE0001000		// DWT control
+#define USBMIDI_DWT_CTRL_CYCCNTENA	0x00000001	// enable the cycle counter
+#define USBMIDI_DWT_CYCCNT		0xE0001004		// the cycle counter
+
+/**
+ * Start the cycle counter. Call once at start-up; harmless to call again.
+ */
+static inline void USBMIDI_TimestampInit(void)
+{
+	HWREG(USBMIDI_DEMCR) |= USBMIDI_DEMCR_TRCENA;
+	HWREG(USBMIDI_DWT_CTRL) |= USBMIDI_DWT_CTRL_CYCCNTENA;
+}
+
+/**
+ * Current time in CPU cycles.
+ */
+static inline uint32_t USBMIDI_Timestamp(void)
+{
+	return HWREG(USBMIDI_DWT_CYCCNT);
+}
+
+#endif /* USB_MIDI_USBMIDI_TIMESTAMP_H_ */
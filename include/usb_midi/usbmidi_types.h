@@ -13,6 +13,17 @@
 #include "usblib/usblib.h"
 #include "usblib/device/usbdevice.h"
 #include "usb_midi_fifo.h"
+#include "usbmidi_sysex.h"
+#include "usbmidi_replay.h"
+#include "usbmidi_notes.h"
+#include "usbmidi_clockin.h"
+#include "usbmidi_mtc.h"
+#include "usbmidi_batch.h"
+#include "usbmidi_ump.h"
+#include "usbmidi_param.h"
+#include "usbmidi_loopback.h"
+#include "usbmidi_stats.h"
+#include "usbmidi_budget.h"
 
 #define USB_BUFFER_SIZE (512)
 
@@ -24,6 +35,14 @@ typedef enum
 	eUsbMidiStateWaitData		// waiting on completion of a send or receive transaction
 } tUSBMidiState;
 
+// progress of a latency probe through the IN endpoint.
+typedef enum
+{
+	eUsbMidiProbeIdle,			// nothing being timed
+	eUsbMidiProbeArmed,			// probed message is in the IN FIFO
+	eUsbMidiProbeInFlight		// probed message is in the endpoint, waiting for the host
+} tUSBMidiProbeState;
+
 // this is the "Device instance" structure
 typedef struct {
 
@@ -42,17 +61,102 @@ typedef struct {
 	// device connection status.
 	volatile bool bConnected;
 
+	// alternate setting of the MIDI streaming interface, USBMIDI_ALT_xxx.
+	volatile uint8_t ui8AltSetting;
+
+	// timestamp of the last configuration change, and of the first OUT packet after it.
+	uint32_t ui32ConfigTime;
+	uint32_t ui32FirstEventTime;
+	bool bFirstEventSeen;
+
+	// bus suspend state. bWakePending is set when something was queued while suspended.
+	volatile bool bSuspended;
+	volatile bool bWakePending;
+	uint32_t ui32SuspendedMs;
+
+	// timestamp of the last resume, and cycles from it to the first IN packet delivered.
+	uint32_t ui32ResumeTime;
+	uint32_t ui32ResumeToFirstEvent;
+	bool bResumeTiming;
+
+	// input-to-USB latency probe, see USBMIDI_LatencyProbe(). In cycles.
+	volatile tUSBMidiProbeState iProbeState;
+	uint32_t ui32ProbeTime;
+	uint32_t ui32ProbeLatency;
+	uint32_t ui32ProbeLatencyMax;
+
 } tUSBMidiInstance;
 
+// Reply to USBMIDI_VENDOR_GET_STATS. All words, little-endian, no padding.
+typedef struct
+{
+	uint32_t ui32Connected;			// 1 if configured
+	uint32_t ui32EnumToFirstEvent;	// cycles from SET_CONFIGURATION to the first OUT packet, 0 if none yet
+	uint32_t ui32ClassRequests;
+	uint32_t ui32VendorRequests;
+	uint32_t ui32StalledRequests;
+	uint32_t ui32InFifoCount;
+	uint32_t ui32OutFifoCount;
+	uint32_t ui32SysExBlocksInUse;
+	uint32_t ui32SysExBlocksHighWater;
+	uint32_t ui32SysExMessages;
+	uint32_t ui32SysExDropped;		// pool exhausted + done queue full
+	uint32_t ui32Suspends;
+	uint32_t ui32RemoteWakeups;
+	uint32_t ui32ResumeToFirstEvent;	// cycles from the last resume to the first IN packet delivered
+	uint32_t ui32InFifoOverflows;
+	uint32_t ui32OutFifoOverflows;
+	uint32_t ui32InNotesOn;			// notes we have on at the host
+	uint32_t ui32OutNotesOn;		// notes the host has on at us
+	uint32_t ui32ProbeLatency;		// cycles from the last probed input to its IN packet delivered
+	uint32_t ui32ProbeLatencyMax;
+	uint32_t ui32RtFifoOverflows;	// timing messages dropped
+	uint32_t ui32ClockInCycles;		// cycles spent on the last Timing Clock from the host
+	uint32_t ui32ClockInCyclesMax;
+	uint32_t ui32AltSetting;		// 1 while the host uses Universal MIDI Packets
+} tUSBMidiVendorStats;
+
+// Reply to USBMIDI_VENDOR_GET_CONFIG.
+typedef struct
+{
+	uint32_t ui32SysClock;			// CPU clock in Hz, the unit of the timestamps
+	uint32_t ui32FifoSize;			// MIDI_USB_FIFO_SIZE
+	uint32_t ui32SysExBlockSize;
+	uint32_t ui32SysExNumBlocks;
+	uint32_t ui32SysExNumCables;
+} tUSBMidiVendorConfig;
+
 // This is the "device structure."
 // Its main purpose is to hold the USB Buffer callback functions and data.
 // Its private structure has the low-level stuff (see above).
 typedef struct
 {
 	USBMIDIFIFO_t InEpMsgFifo;
+	USBMIDIRtFifo_t InEpRtFifo;		// timing messages, sent ahead of InEpMsgFifo
 	USBMIDIFIFO_t OutEpMsgFifo;
+	USBMIDISysEx_t OutEpSysEx;
+	tUSBMIDISysExCallback pfnSysExCallback;
+	USBMIDISysExTx_t InEpSysEx;
+	USBMIDIReplay_t InEpReplay;
+	USBMIDINotes_t InEpNotes;		// notes we have on at the host
+	USBMIDINotes_t OutEpNotes;		// notes the host has on at us
+	USBMIDIClockIn_t OutEpClock;	// the host's MIDI clock
+	USBMIDIMtcIn_t OutEpMtc;		// the host's MIDI Time Code
+	USBMIDIParamDec_t OutEpParam;	// the host's (N)RPNs and 14-bit controllers
+	USBMIDIParamEnc_t InEpParam[USBMIDI_PARAM_NUM_CABLES];	// what the host has of ours
+	USBMIDIUmpFifo_t InEpUmpFifo;	// from USBMIDI_UmpWrite(), on alternate setting 1
+	USBMIDIUmpFifo_t OutEpUmpFifo;	// the host's UMP as received, for USBMIDI_UmpRead()
+	USBMIDIUmpXlate_t InEpUmpUp;	// IN FIFO to UMP
+	USBMIDIUmpXlate_t InEpSysExUp;	// outgoing SysEx to UMP
+	USBMIDIUmpXlate_t InEpUmpDown;	// USBMIDI_UmpWrite() to event packets, on alternate setting 0
+	USBMIDIUmpXlate_t OutEpUmpDown;	// the host's UMP to event packets
+	USBMIDILoopback_t InEpLoopback;	// echoes of the host's packets, while measuring latency
+	USBMIDIStats_t sStats;			// every counter, see usbmidi_stats.h
 	tUSBMidiInstance sPrivateData;
 
 } tUSBMidiDevice;
 
+// every FIFO and the SysEx pool; see usbmidi_budget.h.
+USBMIDI_STATIC_ASSERT(tUSBMidiDevice, sizeof(tUSBMidiDevice) <= USBMIDI_SRAM_BUDGET);
+
 #endif
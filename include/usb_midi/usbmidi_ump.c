@@ -0,0 +1,627 @@
+/*
+ * usbmidi_ump.c
+ *
+ * Universal MIDI Packet FIFO and translation to and from USB-MIDI 1.0.
+ * See usbmidi_ump.h.
+ *
+ *  Created on: Oct 18, 2026
+ *
+ * MODS:
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "midi.h"
+#include "usb_midi.h"
+#include "usbmidi_ump.h"
+
+#define FIFO_MASK (USBMIDI_UMP_FIFO_WORDS - 1)
+
+/*
+ * SysEx7 packet status, bits 23:20 of the first word.
+ */
+#define SYSEX7_COMPLETE		0x0
+#define SYSEX7_START		0x1
+#define SYSEX7_CONTINUE		0x2
+#define SYSEX7_END			0x3
+
+/*
+ * Translator SysEx state: not in a SysEx, in one with nothing sent yet, in one
+ * with its first packet sent.
+ */
+#define XLATE_IDLE			0
+#define XLATE_FIRST			1
+#define XLATE_MORE			2
+
+/*
+ * Words per UMP, by message type.
+ */
+const uint8_t USBMIDIUmp_WordsTable[16] =
+{
+	1, 1, 1, 2, 2, 4, 1, 1, 2, 2, 2, 3, 3, 4, 4, 4
+};
+
+/*
+ * 7-bit values scaled to 32 bits: the value shifted up, and above the centre
+ * the lower six bits repeated down to the bottom.
+ */
+static const uint32_t Scale7To32Table[128] =
+{
+	0x00000000, 0x02000000, 0x04000000, 0x06000000,
+	0x08000000, 0x0A000000, 0x0C000000, 0x0E000000,
+	0x10000000, 0x12000000, 0x14000000, 0x16000000,
+	0x18000000, 0x1A000000, 0x1C000000, 0x1E000000,
+	0x20000000, 0x22000000, 0x24000000, 0x26000000,
+	0x28000000, 0x2A000000, 0x2C000000, 0x2E000000,
+	0x30000000, 0x32000000, 0x34000000, 0x36000000,
+	0x38000000, 0x3A000000, 0x3C000000, 0x3E000000,
+	0x40000000, 0x42000000, 0x44000000, 0x46000000,
+	0x48000000, 0x4A000000, 0x4C000000, 0x4E000000,
+	0x50000000, 0x52000000, 0x54000000, 0x56000000,
+	0x58000000, 0x5A000000, 0x5C000000, 0x5E000000,
+	0x60000000, 0x62000000, 0x64000000, 0x66000000,
+	0x68000000, 0x6A000000, 0x6C000000, 0x6E000000,
+	0x70000000, 0x72000000, 0x74000000, 0x76000000,
+	0x78000000, 0x7A000000, 0x7C000000, 0x7E000000,
+	0x80000000, 0x82082082, 0x84104104, 0x86186186,
+	0x88208208, 0x8A28A28A, 0x8C30C30C, 0x8E38E38E,
+	0x90410410, 0x92492492, 0x94514514, 0x96596596,
+	0x98618618, 0x9A69A69A, 0x9C71C71C, 0x9E79E79E,
+	0xA0820820, 0xA28A28A2, 0xA4924924, 0xA69A69A6,
+	0xA8A28A28, 0xAAAAAAAA, 0xACB2CB2C, 0xAEBAEBAE,
+	0xB0C30C30, 0xB2CB2CB2, 0xB4D34D34, 0xB6DB6DB6,
+	0xB8E38E38, 0xBAEBAEBA, 0xBCF3CF3C, 0xBEFBEFBE,
+	0xC1041041, 0xC30C30C3, 0xC5145145, 0xC71C71C7,
+	0xC9249249, 0xCB2CB2CB, 0xCD34D34D, 0xCF3CF3CF,
+	0xD1451451, 0xD34D34D3, 0xD5555555, 0xD75D75D7,
+	0xD9659659, 0xDB6DB6DB, 0xDD75D75D, 0xDF7DF7DF,
+	0xE1861861, 0xE38E38E3, 0xE5965965, 0xE79E79E7,
+	0xE9A69A69, 0xEBAEBAEB, 0xEDB6DB6D, 0xEFBEFBEF,
+	0xF1C71C71, 0xF3CF3CF3, 0xF5D75D75, 0xF7DF7DF7,
+	0xF9E79E79, 0xFBEFBEFB, 0xFDF7DF7D, 0xFFFFFFFF
+};
+
+/*
+ * What a USB-MIDI 1.0 event packet is, by CIN.
+ */
+enum
+{
+	M1_NONE,
+	M1_SYSTEM,		// system common, as is
+	M1_SYSEX,
+	M1_SYSEX_END1,	// SysEx end or a one-byte system common
+	M1_NOTEOFF,
+	M1_NOTEON,
+	M1_KEYED,		// poly pressure, control change: index and 7-bit value
+	M1_PROGRAM,
+	M1_PRESSURE,
+	M1_PITCHBEND,
+	M1_SINGLE		// real-time
+};
+
+static const uint8_t Midi1Kind[16] =
+{
+	M1_NONE, M1_NONE, M1_SYSTEM, M1_SYSTEM,
+	M1_SYSEX, M1_SYSEX_END1, M1_SYSEX, M1_SYSEX,
+	M1_NOTEOFF, M1_NOTEON, M1_KEYED, M1_KEYED,
+	M1_PROGRAM, M1_PRESSURE, M1_PITCHBEND, M1_SINGLE
+};
+
+/*
+ * SysEx bytes carried by each CIN, as in usbmidi_sysex.c.
+ */
+static const uint8_t SysExCinBytes[16] =
+{
+	0, 0, 0, 0, 3, 1, 2, 3, 0, 0, 0, 0, 0, 0, 0, 0
+};
+
+/*
+ * What a MIDI 2.0 channel voice message becomes, by opcode.
+ */
+enum
+{
+	M2_NONE,
+	M2_NOTE,		// note off, note on, poly pressure: note and a scaled value
+	M2_CONTROL,
+	M2_PROGRAM,
+	M2_PRESSURE,
+	M2_PITCHBEND,
+	M2_RPN,
+	M2_NRPN
+};
+
+static const uint8_t Midi2Kind[16] =
+{
+	M2_NONE, M2_NONE, M2_RPN, M2_NRPN,
+	M2_NONE, M2_NONE, M2_NONE, M2_NONE,
+	M2_NOTE, M2_NOTE, M2_NOTE, M2_CONTROL,
+	M2_PROGRAM, M2_PRESSURE, M2_PITCHBEND, M2_NONE
+};
+
+/*
+ * CIN of a system message carried by a type 1 UMP, by the status' low nybble.
+ * SysEx status bytes and the undefined F4/F5 are not carried.
+ */
+static const uint8_t SystemCin[16] =
+{
+	0, USB_MIDI_CIN_SYSCOM2, USB_MIDI_CIN_SYSCOM3, USB_MIDI_CIN_SYSCOM2,
+	0, 0, USB_MIDI_CIN_SYSEND1, 0,
+	USB_MIDI_CIN_SINGLEBYTE, USB_MIDI_CIN_SINGLEBYTE, USB_MIDI_CIN_SINGLEBYTE, USB_MIDI_CIN_SINGLEBYTE,
+	USB_MIDI_CIN_SINGLEBYTE, USB_MIDI_CIN_SINGLEBYTE, USB_MIDI_CIN_SINGLEBYTE, USB_MIDI_CIN_SINGLEBYTE
+};
+
+void USBMIDIUmpFifo_Init(USBMIDIUmpFifo_t *fifo)
+{
+	fifo->head = 0;
+	fifo->tail = 0;
+	fifo->count = 0;
+}
+
+bool USBMIDIUmpFifo_Push(USBMIDIUmpFifo_t *fifo, const uint32_t *ump)
+{
+	uint32_t n = USBMIDI_UMP_WORDS(ump[0]);
+	uint32_t i;
+
+	if( fifo->count + n > USBMIDI_UMP_FIFO_WORDS )
+		return false;
+
+	for( i = 0; i < n; i++ )
+		fifo->word[(fifo->head + i) & FIFO_MASK] = ump[i];
+	fifo->head = (fifo->head + n) & FIFO_MASK;
+	fifo->count += n;
+	return true;
+}
+
+uint32_t USBMIDIUmpFifo_Peek(const USBMIDIUmpFifo_t *fifo, uint32_t *ump)
+{
+	uint32_t n;
+	uint32_t i;
+
+	if( fifo->count == 0 )
+		return 0;
+
+	n = USBMIDI_UMP_WORDS(fifo->word[fifo->tail]);
+	for( i = 0; i < n; i++ )
+		ump[i] = fifo->word[(fifo->tail + i) & FIFO_MASK];
+	return n;
+}
+
+uint32_t USBMIDIUmpFifo_Pop(USBMIDIUmpFifo_t *fifo, uint32_t *ump)
+{
+	uint32_t n = USBMIDIUmpFifo_Peek(fifo, ump);
+
+	fifo->tail = (fifo->tail + n) & FIFO_MASK;
+	fifo->count -= n;
+	return n;
+}
+
+void USBMIDIUmp_XlateInit(USBMIDIUmpXlate_t *x)
+{
+	x->count = 0;
+	x->sysex = XLATE_IDLE;
+	memset(x->chan, 0, sizeof(x->chan));
+}
+
+uint32_t USBMIDIUmp_Scale7To32(uint8_t value)
+{
+	return Scale7To32Table[value & 0x7F];
+}
+
+uint32_t USBMIDIUmp_Scale14To32(uint16_t value)
+{
+	uint32_t scaled;
+	uint32_t repeat;
+
+	value &= 0x3FFF;
+	scaled = (uint32_t) value << 18;
+	if( value <= 0x2000 )
+		return scaled;
+
+	// repeat the lower 13 bits below the shifted value.
+	for( repeat = (uint32_t) (value & 0x1FFF) << 5; repeat; repeat >>= 13 )
+		scaled |= repeat;
+	return scaled;
+}
+
+/*
+ * Send the SysEx bytes collected so far as one type 3 UMP.
+ */
+static uint32_t SysEx7Packet(USBMIDIUmpXlate_t *x, uint8_t group, uint8_t status, uint32_t *ump)
+{
+	uint8_t *d = x->data;
+	uint32_t i;
+
+	for( i = x->count; i < 6; i++ )
+		d[i] = 0;
+
+	ump[0] = ((uint32_t) USBMIDI_UMP_MT_SYSEX7 << 28) | ((uint32_t) group << 24) |
+			((uint32_t) status << 20) | ((uint32_t) x->count << 16) |
+			((uint32_t) d[0] << 8) | d[1];
+	ump[1] = ((uint32_t) d[2] << 24) | ((uint32_t) d[3] << 16) | ((uint32_t) d[4] << 8) | d[5];
+	x->count = 0;
+	return 2;
+}
+
+/*
+ * SysEx bytes from an event packet. A full chunk of six is only sent once the
+ * next byte shows whether it ends the message.
+ */
+static uint32_t SysExFromMidi1(USBMIDIUmpXlate_t *x, const USBMIDI_Message_t *msg, uint32_t *ump)
+{
+	uint8_t group = USB_MIDI_CABLE_NUMBER(msg->header);
+	uint32_t nbytes = SysExCinBytes[USB_MIDI_CODE_INDEX_NUMBER(msg->header)];
+	const uint8_t *p = &msg->byte1;
+	uint32_t words = 0;
+	uint8_t b;
+
+	while( nbytes-- )
+	{
+		b = *p++;
+		if( b == MIDI_MSG_SOX )
+		{
+			x->sysex = XLATE_FIRST;
+			x->count = 0;
+		}
+		else if( b == MIDI_MSG_EOX )
+		{
+			if( x->sysex != XLATE_IDLE )
+				words += SysEx7Packet(x, group,
+						(x->sysex == XLATE_FIRST) ? SYSEX7_COMPLETE : SYSEX7_END, &ump[words]);
+			x->sysex = XLATE_IDLE;
+		}
+		else if( (b < 0x80) && (x->sysex != XLATE_IDLE) )
+		{
+			if( x->count == 6 )
+			{
+				words += SysEx7Packet(x, group,
+						(x->sysex == XLATE_FIRST) ? SYSEX7_START : SYSEX7_CONTINUE, &ump[words]);
+				x->sysex = XLATE_MORE;
+			}
+			x->data[x->count++] = b;
+		}
+	}
+
+	return words;
+}
+
+/*
+ * A Control Change going to UMP. (N)RPN selects and Bank Select are taken into
+ * the channel's state and send nothing; Data Entry for a selected parameter
+ * sends a Registered or Assignable Controller message with the value so far.
+ * Anything else is a MIDI 2.0 Control Change.
+ */
+static uint32_t ControlFromMidi1(USBMIDIUmpXlate_t *x, const USBMIDI_Message_t *msg, uint32_t voice,
+		uint32_t *ump)
+{
+	uint8_t group = USB_MIDI_CABLE_NUMBER(msg->header);
+	uint8_t cc = msg->byte2 & 0x7F;
+	uint8_t value = msg->byte3 & 0x7F;
+	USBMIDIUmpXlateChan_t *st;
+	uint8_t kind;
+
+	if( (group < USBMIDI_UMP_NUM_GROUPS) && ((msg->byte1 & 0xF0) == MIDI_MSG_CTRLCHANGE) )
+	{
+		st = &x->chan[group][msg->byte1 & 0x0F];
+		switch( cc )
+		{
+		case MIDI_CC_RPN_MSB:
+		case MIDI_CC_RPN_LSB:
+		case MIDI_CC_NRPN_MSB:
+		case MIDI_CC_NRPN_LSB:
+			kind = (cc >= MIDI_CC_RPN_LSB) ? USBMIDI_UMP_OP_RPN : USBMIDI_UMP_OP_NRPN;
+			if( st->kind != kind )
+			{
+				// halves left from the other kind mean nothing.
+				st->kind = kind;
+				st->numMsb = 0;
+				st->numLsb = 0;
+			}
+			if( cc & 1 )
+				st->numMsb = value;
+			else
+				st->numLsb = value;
+			st->dataMsb = 0;
+			if( (kind == USBMIDI_UMP_OP_RPN) && (st->numMsb == 0x7F) && (st->numLsb == 0x7F) )
+				st->kind = 0;
+			return 0;
+
+		case MIDI_CC_DATAENTRY_MSB:
+		case MIDI_CC_DATAENTRY_LSB:
+			if( st->kind == 0 )
+				break;
+			// a new MSB clears the LSB, as in MIDI 1.0.
+			if( cc == MIDI_CC_DATAENTRY_MSB )
+			{
+				st->dataMsb = value;
+				value = 0;
+			}
+			ump[0] = (voice & 0xFF0F0000) | ((uint32_t) st->kind << 20) |
+					((uint32_t) st->numMsb << 8) | st->numLsb;
+			ump[1] = USBMIDIUmp_Scale14To32(((uint16_t) st->dataMsb << 7) | value);
+			return 2;
+
+		case MIDI_CC_BANKSELECT_MSB:
+			st->bankMsb = value;
+			st->bankValid = true;
+			return 0;
+
+		case MIDI_CC_BANKSELECT_LSB:
+			st->bankLsb = value;
+			st->bankValid = true;
+			return 0;
+
+		default:
+			break;
+		}
+	}
+
+	ump[0] = voice | ((uint32_t) cc << 8);
+	ump[1] = Scale7To32Table[value];
+	return 2;
+}
+
+uint32_t USBMIDIUmp_FromMidi1(USBMIDIUmpXlate_t *x, const USBMIDI_Message_t *msg, uint32_t *ump)
+{
+	uint8_t cin = USB_MIDI_CODE_INDEX_NUMBER(msg->header);
+	uint32_t group = USB_MIDI_CABLE_NUMBER(msg->header);
+	USBMIDIUmpXlateChan_t *chan;
+	uint32_t system;
+	uint32_t voice;
+
+	system = ((uint32_t) USBMIDI_UMP_MT_SYSTEM << 28) | (group << 24) |
+			((uint32_t) msg->byte1 << 16) | ((uint32_t) msg->byte2 << 8) | msg->byte3;
+	voice = ((uint32_t) USBMIDI_UMP_MT_MIDI2_CV << 28) | (group << 24) | ((uint32_t) msg->byte1 << 16);
+
+	switch( Midi1Kind[cin] )
+	{
+	case M1_SYSTEM:
+		ump[0] = system;
+		return 1;
+
+	case M1_SYSEX_END1:
+		if( msg->byte1 != MIDI_MSG_EOX )
+		{
+			ump[0] = system & 0xFFFF0000;
+			return 1;
+		}
+		// fall through
+	case M1_SYSEX:
+		return SysExFromMidi1(x, msg, ump);
+
+	case M1_NOTEOFF:
+		ump[0] = voice | ((uint32_t) msg->byte2 << 8);
+		ump[1] = Scale7To32Table[msg->byte3 & 0x7F] & 0xFFFF0000;
+		return 2;
+
+	case M1_NOTEON:
+		// velocity 0 is a Note Off at the default velocity, 64.
+		if( msg->byte3 == 0 )
+		{
+			ump[0] = (voice & 0xFF0FFFFF) | ((uint32_t) MIDI_MSG_NOTEOFF << 16) | ((uint32_t) msg->byte2 << 8);
+			ump[1] = Scale7To32Table[64] & 0xFFFF0000;
+			return 2;
+		}
+		ump[0] = voice | ((uint32_t) msg->byte2 << 8);
+		ump[1] = Scale7To32Table[msg->byte3 & 0x7F] & 0xFFFF0000;
+		return 2;
+
+	case M1_KEYED:
+		if( cin == USB_MIDI_CIN_CTRLCHANGE )
+			return ControlFromMidi1(x, msg, voice, ump);
+		ump[0] = voice | ((uint32_t) msg->byte2 << 8);
+		ump[1] = Scale7To32Table[msg->byte3 & 0x7F];
+		return 2;
+
+	case M1_PROGRAM:
+		// the bank from the last Bank Select on the channel, if there was one.
+		ump[0] = voice;
+		ump[1] = (uint32_t) (msg->byte2 & 0x7F) << 24;
+		if( group < USBMIDI_UMP_NUM_GROUPS )
+		{
+			chan = &x->chan[group][msg->byte1 & 0x0F];
+			if( chan->bankValid )
+			{
+				ump[0] |= 0x01;
+				ump[1] |= ((uint32_t) chan->bankMsb << 8) | chan->bankLsb;
+			}
+		}
+		return 2;
+
+	case M1_PRESSURE:
+		ump[0] = voice;
+		ump[1] = Scale7To32Table[msg->byte2 & 0x7F];
+		return 2;
+
+	case M1_PITCHBEND:
+		ump[0] = voice;
+		ump[1] = USBMIDIUmp_Scale14To32((msg->byte2 & 0x7F) | ((uint16_t) (msg->byte3 & 0x7F) << 7));
+		return 2;
+
+	case M1_SINGLE:
+		if( msg->byte1 < MIDI_MSG_TIMINGCLOCK )
+			return 0;
+		ump[0] = system & 0xFFFF0000;
+		return 1;
+
+	default:
+		return 0;
+	}
+}
+
+/*
+ * Fill in an event packet.
+ */
+static void Midi1Set(USBMIDI_Message_t *msg, uint8_t cable, uint8_t cin,
+		uint8_t b1, uint8_t b2, uint8_t b3)
+{
+	msg->header = USB_MIDI_HEADER(cable, cin);
+	msg->byte1 = b1;
+	msg->byte2 = b2;
+	msg->byte3 = b3;
+}
+
+/*
+ * A type 3 UMP as SysEx event packets. Full packets of three go out as they
+ * fill; up to two bytes wait in the translator for the next UMP.
+ */
+static uint32_t SysExToMidi1(USBMIDIUmpXlate_t *x, const uint32_t *ump, USBMIDI_Message_t *msg)
+{
+	uint8_t cable = USBMIDI_UMP_GROUP(ump[0]);
+	uint8_t status = (ump[0] >> 20) & 0x0F;
+	uint32_t count = (ump[0] >> 16) & 0x0F;
+	uint8_t bytes[8];
+	uint8_t *b = x->data;
+	uint32_t nbytes = 0;
+	uint32_t nmsg = 0;
+	uint32_t i;
+
+	if( count > 6 )
+		count = 6;
+	bytes[0] = ump[0] >> 8;
+	bytes[1] = ump[0];
+	bytes[2] = ump[1] >> 24;
+	bytes[3] = ump[1] >> 16;
+	bytes[4] = ump[1] >> 8;
+	bytes[5] = ump[1];
+
+	if( (status == SYSEX7_COMPLETE) || (status == SYSEX7_START) )
+	{
+		x->count = 0;
+		x->sysex = XLATE_MORE;
+		b[x->count++] = MIDI_MSG_SOX;
+	}
+	else if( (status > SYSEX7_END) || (x->sysex == XLATE_IDLE) )
+	{
+		return 0;
+	}
+
+	nbytes = x->count;
+	for( i = 0; i < count; i++ )
+	{
+		b[nbytes++] = bytes[i] & 0x7F;
+		if( nbytes == 3 )
+		{
+			Midi1Set(&msg[nmsg++], cable, USB_MIDI_CIN_SYSEXSTART, b[0], b[1], b[2]);
+			nbytes = 0;
+		}
+	}
+
+	if( (status == SYSEX7_COMPLETE) || (status == SYSEX7_END) )
+	{
+		b[nbytes++] = MIDI_MSG_EOX;
+		if( nbytes < 3 )
+			b[2] = 0;
+		if( nbytes < 2 )
+			b[1] = 0;
+		Midi1Set(&msg[nmsg++], cable, USB_MIDI_CIN_SYSEND1 + nbytes - 1, b[0], b[1], b[2]);
+		nbytes = 0;
+		x->sysex = XLATE_IDLE;
+	}
+
+	x->count = nbytes;
+	return nmsg;
+}
+
+uint32_t USBMIDIUmp_ToMidi1(USBMIDIUmpXlate_t *x, const uint32_t *ump, USBMIDI_Message_t *msg)
+{
+	uint8_t cable = USBMIDI_UMP_GROUP(ump[0]);
+	uint8_t status = ump[0] >> 16;
+	uint8_t index1 = (ump[0] >> 8) & 0x7F;
+	uint8_t index2 = ump[0] & 0x7F;
+	uint8_t value7;
+	uint8_t cc;
+	uint8_t cin;
+	uint32_t n;
+	uint16_t bend;
+
+	switch( USBMIDI_UMP_MT(ump[0]) )
+	{
+	case USBMIDI_UMP_MT_SYSTEM:
+		cin = SystemCin[status & 0x0F];
+		if( (status < MIDI_MSG_SOX) || (cin == 0) )
+			return 0;
+		Midi1Set(msg, cable, cin, status,
+				(cin == USB_MIDI_CIN_SYSCOM2 || cin == USB_MIDI_CIN_SYSCOM3) ? index1 : 0,
+				(cin == USB_MIDI_CIN_SYSCOM3) ? index2 : 0);
+		return 1;
+
+	case USBMIDI_UMP_MT_MIDI1_CV:
+		if( (status < MIDI_MSG_NOTEOFF) || (status >= MIDI_MSG_SOX) )
+			return 0;
+		cin = status >> 4;
+		Midi1Set(msg, cable, cin, status, index1,
+				(cin == USB_MIDI_CIN_PROGCHANGE || cin == USB_MIDI_CIN_CHANPRESSURE) ? 0 : index2);
+		return 1;
+
+	case USBMIDI_UMP_MT_SYSEX7:
+		return SysExToMidi1(x, ump, msg);
+
+	case USBMIDI_UMP_MT_MIDI2_CV:
+		break;
+
+	default:
+		return 0;
+	}
+
+	// MIDI 2.0 channel voice: status is opcode and channel. Only this type is
+	// known to have a second word to read.
+	value7 = ump[1] >> 25;
+	switch( Midi2Kind[status >> 4] )
+	{
+	case M2_NOTE:
+		// a MIDI 2.0 Note On may have velocity 0, which MIDI 1.0 reads as off.
+		if( ((status & 0xF0) == MIDI_MSG_NOTEON) && (value7 == 0) )
+			value7 = 1;
+		Midi1Set(msg, cable, status >> 4, status, index1, value7);
+		return 1;
+
+	case M2_CONTROL:
+		Midi1Set(msg, cable, USB_MIDI_CIN_CTRLCHANGE, status, index1, value7);
+		return 1;
+
+	case M2_PROGRAM:
+		n = 0;
+		if( ump[0] & 0x01 )
+		{
+			Midi1Set(&msg[n++], cable, USB_MIDI_CIN_CTRLCHANGE, MIDI_MSG_CTRLCHANGE | (status & 0x0F),
+					MIDI_CC_BANKSELECT_MSB, (ump[1] >> 8) & 0x7F);
+			Midi1Set(&msg[n++], cable, USB_MIDI_CIN_CTRLCHANGE, MIDI_MSG_CTRLCHANGE | (status & 0x0F),
+					MIDI_CC_BANKSELECT_LSB, ump[1] & 0x7F);
+		}
+		Midi1Set(&msg[n++], cable, USB_MIDI_CIN_PROGCHANGE, status, (ump[1] >> 24) & 0x7F, 0);
+		return n;
+
+	case M2_PRESSURE:
+		Midi1Set(msg, cable, USB_MIDI_CIN_CHANPRESSURE, status, value7, 0);
+		return 1;
+
+	case M2_PITCHBEND:
+		bend = ump[1] >> 18;
+		Midi1Set(msg, cable, USB_MIDI_CIN_PITCHBEND, status, bend & 0x7F, bend >> 7);
+		return 1;
+
+	case M2_RPN:
+	case M2_NRPN:
+		// bank and index select the parameter; the value is 14 bits of data entry.
+		cc = MIDI_MSG_CTRLCHANGE | (status & 0x0F);
+		bend = ump[1] >> 18;
+		if( Midi2Kind[status >> 4] == M2_RPN )
+		{
+			Midi1Set(&msg[0], cable, USB_MIDI_CIN_CTRLCHANGE, cc, MIDI_CC_RPN_MSB, index1);
+			Midi1Set(&msg[1], cable, USB_MIDI_CIN_CTRLCHANGE, cc, MIDI_CC_RPN_LSB, index2);
+		}
+		else
+		{
+			Midi1Set(&msg[0], cable, USB_MIDI_CIN_CTRLCHANGE, cc, MIDI_CC_NRPN_MSB, index1);
+			Midi1Set(&msg[1], cable, USB_MIDI_CIN_CTRLCHANGE, cc, MIDI_CC_NRPN_LSB, index2);
+		}
+		Midi1Set(&msg[2], cable, USB_MIDI_CIN_CTRLCHANGE, cc, MIDI_CC_DATAENTRY_MSB, bend >> 7);
+		Midi1Set(&msg[3], cable, USB_MIDI_CIN_CTRLCHANGE, cc, MIDI_CC_DATAENTRY_LSB, bend & 0x7F);
+		return 4;
+
+	default:
+		return 0;
+	}
+}
@@ -0,0 +1,221 @@
+/*
+ * usbmidi_ump.h
+ *
+ * Universal MIDI Packets, for the USB MIDI 2.0 alternate setting of the MIDI
+ * Streaming interface.
+ *
+ * A UMP is one, two, three or four 32-bit words; the message type in the top
+ * nybble of the first word says how many. The UMP FIFO holds whole packets of
+ * any size in a ring of words, so a packet is pushed or popped in one go or not
+ * at all.
+ *
+ * Translation between UMP and USB-MIDI 1.0 event packets goes both ways:
+ *
+ * - USBMIDIUmp_FromMidi1() turns an event packet into the MIDI 2.0 Protocol
+ *   message the Group Terminal Block advertises: channel voice messages become
+ *   MIDI 2.0 channel voice (type 4) with their values scaled up by the spec's
+ *   min-centre-max rule, system messages become type 1, SysEx becomes 7-bit
+ *   SysEx (type 3) six bytes at a time. As the UMP specification's MIDI 1.0 to
+ *   2.0 translation has it, (N)RPN and Bank Select Control Changes are not
+ *   passed on: CC 101/100 and 99/98 select a parameter, and Data Entry (CC 6
+ *   and 38) then becomes a Registered or Assignable Controller message
+ *   (opcode 0x2 or 0x3) with the 14-bit value scaled up, sent on each of the
+ *   MSB and the LSB. Bank Select (CC 0 and 32) is held for the next Program
+ *   Change, which goes with the bank valid flag set. Data Entry with no
+ *   parameter selected, or the null RPN, stays a Control Change.
+ * - USBMIDIUmp_ToMidi1() goes the other way: values are scaled down, a
+ *   Program Change with a bank becomes Bank Select MSB/LSB and Program Change,
+ *   and RPN and NRPN messages become their four-controller sequences. Per-note
+ *   controllers, per-note pitch bend, relative (N)RPN and utility messages have
+ *   no MIDI 1.0 form and are dropped.
+ *
+ * Both are driven by tables indexed by the CIN or the MIDI 2.0 opcode, and
+ * 7-bit values are scaled up by table lookup, so there is no per-message
+ * branching on the message kind beyond one switch.
+ *
+ * SysEx crosses packet boundaries, so each direction of each stream keeps a
+ * USBMIDIUmpXlate_t. Groups and cables map one to one.
+ *
+ * Nothing here touches hardware.
+ *
+ *  Created on: Oct 18, 2026
+ *
+ * MODS:
+ */
+
+#ifndef USB_MIDI_USBMIDI_UMP_H_
+#define USB_MIDI_USBMIDI_UMP_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "usb_midi.h"
+#include "usbmidi_budget.h"
+
+/**
+ * Words in the UMP FIFO. Must be a power of two.
+ */
+#ifndef USBMIDI_UMP_FIFO_WORDS
+#define USBMIDI_UMP_FIFO_WORDS 64
+#endif
+
+// 16-bit indices, and room for the largest packet.
+USBMIDI_STATIC_ASSERT(USBMIDIUmpFifoWords, USBMIDI_POW2_UPTO(USBMIDI_UMP_FIFO_WORDS, 32768) &&
+		(USBMIDI_UMP_FIFO_WORDS >= 4));
+
+/**
+ * Largest UMP, in words.
+ */
+#define USBMIDI_UMP_MAX_WORDS 4
+
+/**
+ * Most event packets USBMIDIUmp_ToMidi1() makes from one UMP.
+ */
+#define USBMIDI_UMP_MAX_MIDI1 4
+
+/**
+ * Message types, the top nybble of the first word.
+ */
+#define USBMIDI_UMP_MT_UTILITY		0x0
+#define USBMIDI_UMP_MT_SYSTEM		0x1
+#define USBMIDI_UMP_MT_MIDI1_CV		0x2
+#define USBMIDI_UMP_MT_SYSEX7		0x3
+#define USBMIDI_UMP_MT_MIDI2_CV		0x4
+
+#define USBMIDI_UMP_MT(word0)		((word0) >> 28)
+#define USBMIDI_UMP_GROUP(word0)	(((word0) >> 24) & 0x0F)
+
+/**
+ * Packet size in words from the first word.
+ */
+extern const uint8_t USBMIDIUmp_WordsTable[16];
+#define USBMIDI_UMP_WORDS(word0)	(USBMIDIUmp_WordsTable[(word0) >> 28])
+
+/**
+ * MIDI 2.0 channel voice opcodes that have no status byte of their own.
+ */
+#define USBMIDI_UMP_OP_PERNOTE_RCC	0x0
+#define USBMIDI_UMP_OP_PERNOTE_ACC	0x1
+#define USBMIDI_UMP_OP_RPN			0x2
+#define USBMIDI_UMP_OP_NRPN			0x3
+#define USBMIDI_UMP_OP_REL_RPN		0x4
+#define USBMIDI_UMP_OP_REL_NRPN		0x5
+#define USBMIDI_UMP_OP_PERNOTE_PB	0x6
+#define USBMIDI_UMP_OP_PERNOTE_MGMT	0xF
+
+/**
+ * The first word of a MIDI 2.0 channel voice message, for USBMIDI_UmpWrite().
+ * op is the status nybble (MIDI_MSG_xxx >> 4) or a USBMIDI_UMP_OP_ value. The
+ * second word is the value: 32 bits of controller, pressure or pitch bend, or
+ * velocity in the upper 16 bits.
+ */
+#define USBMIDI_UMP_MIDI2_CV(group, op, channel, index1, index2)	\
+	(((uint32_t) USBMIDI_UMP_MT_MIDI2_CV << 28) | ((uint32_t) ((group) & 0x0F) << 24) |	\
+	 ((uint32_t) ((op) & 0x0F) << 20) | ((uint32_t) ((channel) & 0x0F) << 16) |	\
+	 ((uint32_t) ((index1) & 0xFF) << 8) | ((uint32_t) ((index2) & 0xFF)))
+
+/**
+ * Groups (cables) whose (N)RPN and Bank Select Control Changes
+ * USBMIDIUmp_FromMidi1() translates; on the others they stay Control Changes.
+ */
+#ifndef USBMIDI_UMP_NUM_GROUPS
+#define USBMIDI_UMP_NUM_GROUPS 2
+#endif
+
+USBMIDI_STATIC_ASSERT(USBMIDIUmpNumGroups, (USBMIDI_UMP_NUM_GROUPS >= 1) && (USBMIDI_UMP_NUM_GROUPS <= 16));
+
+/**
+ * \typedef USBMIDIUmpFifo_t
+ */
+typedef struct
+{
+	uint16_t head;
+	uint16_t tail;
+	uint16_t count;								//!< words in the FIFO
+	uint32_t word[USBMIDI_UMP_FIFO_WORDS];
+} USBMIDIUmpFifo_t;
+
+/**
+ * \typedef USBMIDIUmpXlateChan_t
+ * What a translator to UMP has seen of one channel's (N)RPN and Bank Select.
+ */
+typedef struct
+{
+	uint8_t kind;			//!< selected: USBMIDI_UMP_OP_RPN, _NRPN, or 0 for none
+	uint8_t numMsb;
+	uint8_t numLsb;
+	uint8_t dataMsb;
+	uint8_t bankValid;		//!< a Bank Select came since the translator started
+	uint8_t bankMsb;
+	uint8_t bankLsb;
+} USBMIDIUmpXlateChan_t;
+
+/**
+ * \typedef USBMIDIUmpXlate_t
+ * SysEx carried between packets by the translators, and, going to UMP, the
+ * (N)RPN and bank selected on each channel.
+ */
+typedef struct
+{
+	uint8_t data[6];		//!< bytes not yet sent on
+	uint8_t count;
+	uint8_t sysex;			//!< where in a SysEx we are
+	USBMIDIUmpXlateChan_t chan[USBMIDI_UMP_NUM_GROUPS][16];
+} USBMIDIUmpXlate_t;
+
+/**
+ * Empty the FIFO.
+ */
+void USBMIDIUmpFifo_Init(USBMIDIUmpFifo_t *fifo);
+
+/**
+ * Push a whole UMP, its size from its first word.
+ * \returns false, pushing nothing, if it does not fit.
+ */
+bool USBMIDIUmpFifo_Push(USBMIDIUmpFifo_t *fifo, const uint32_t *ump);
+
+/**
+ * Look at the oldest UMP without removing it.
+ * \returns its size in words, 0 if the FIFO is empty.
+ */
+uint32_t USBMIDIUmpFifo_Peek(const USBMIDIUmpFifo_t *fifo, uint32_t *ump);
+
+/**
+ * Remove the oldest UMP.
+ * \returns its size in words, 0 if the FIFO was empty.
+ */
+uint32_t USBMIDIUmpFifo_Pop(USBMIDIUmpFifo_t *fifo, uint32_t *ump);
+
+/**
+ * Clear translation state, as at the start of a stream: no SysEx, and no
+ * parameter or bank selected.
+ */
+void USBMIDIUmp_XlateInit(USBMIDIUmpXlate_t *x);
+
+/**
+ * Translate a USB-MIDI 1.0 event packet to MIDI 2.0 Protocol UMP, the cable
+ * number becoming the group.
+ * \param ump: room for USBMIDI_UMP_MAX_WORDS words.
+ * \returns words written: 0 (nothing to send yet, nothing to translate, or
+ * an (N)RPN select or Bank Select taken into the translator), 1, 2 or, when
+ * a SysEx packet completes one six-byte chunk and ends the message, 4.
+ */
+uint32_t USBMIDIUmp_FromMidi1(USBMIDIUmpXlate_t *x, const USBMIDI_Message_t *msg, uint32_t *ump);
+
+/**
+ * Translate a UMP to USB-MIDI 1.0 event packets, the group becoming the cable
+ * number.
+ * \param msg: room for USBMIDI_UMP_MAX_MIDI1 packets.
+ * \returns packets written; 0 if the UMP has no MIDI 1.0 equivalent.
+ */
+uint32_t USBMIDIUmp_ToMidi1(USBMIDIUmpXlate_t *x, const uint32_t *ump, USBMIDI_Message_t *msg);
+
+/**
+ * MIDI 2.0 min-centre-max scaling of a 7-bit value to 32 bits, and of a
+ * 14-bit value to 32 bits. The upper 16 bits of the former are the 16-bit
+ * (velocity) scaling.
+ */
+uint32_t USBMIDIUmp_Scale7To32(uint8_t value);
+uint32_t USBMIDIUmp_Scale14To32(uint16_t value);
+
+#endif /* USB_MIDI_USBMIDI_UMP_H_ */
@@ -59,6 +59,10 @@ extern uint32_t __STACK_TOP;
 extern void SysTickIntHandler(void);
 extern void UARTStdioIntHandler(void);
 extern void USB0DeviceIntHandler(void);
+extern void InputScanIntHandler(void);
+extern void FadersIntHandler(void);
+extern void MidiClockIntHandler(void);
+extern void MtcGenIntHandler(void);
 
 //*****************************************************************************
 //
@@ -101,16 +105,16 @@ void (* const g_pfnVectors[])(void) =
     IntDefaultHandler,                      // PWM Generator 1
     IntDefaultHandler,                      // PWM Generator 2
     IntDefaultHandler,                      // Quadrature Encoder 0
-    IntDefaultHandler,                      // ADC Sequence 0
+    FadersIntHandler,                       // ADC Sequence 0
     IntDefaultHandler,                      // ADC Sequence 1
     IntDefaultHandler,                      // ADC Sequence 2
     IntDefaultHandler,                      // ADC Sequence 3
     IntDefaultHandler,                      // Watchdog timer
-    IntDefaultHandler,                      // Timer 0 subtimer A
+    InputScanIntHandler,                    // Timer 0 subtimer A
     IntDefaultHandler,                      // Timer 0 subtimer B
     IntDefaultHandler,                      // Timer 1 subtimer A
     IntDefaultHandler,                      // Timer 1 subtimer B
-    IntDefaultHandler,                      // Timer 2 subtimer A
+    MidiClockIntHandler,                    // Timer 2 subtimer A
     IntDefaultHandler,                      // Timer 2 subtimer B
     IntDefaultHandler,                      // Analog Comparator 0
     IntDefaultHandler,                      // Analog Comparator 1
@@ -122,7 +126,7 @@ void (* const g_pfnVectors[])(void) =
     IntDefaultHandler,                      // GPIO Port H
     IntDefaultHandler,                      // UART2 Rx and Tx
     IntDefaultHandler,                      // SSI1 Rx and Tx
-    IntDefaultHandler,                      // Timer 3 subtimer A
+    MtcGenIntHandler,                       // Timer 3 subtimer A
     IntDefaultHandler,                      // Timer 3 subtimer B
     IntDefaultHandler,                      // I2C1 Master and Slave
     IntDefaultHandler,                      // Quadrature Encoder 1
@@ -241,6 +245,13 @@ void (* const g_pfnVectors[])(void) =
 void
 ResetISR(void)
 {
+    //
+    // The vector table is at APP_BASE, behind the firmware update boot stub.
+    // The stub points VTABLE here before jumping, but a debugger load starts
+    // at _c_int00 directly, so set it again.
+    //
+    HWREG(NVIC_VTABLE) = (uint32_t)g_pfnVectors;
+
     //
     // Jump to the CCS C initialization routine.  This will enable the
     // floating-point unit as well, so that does not need to be done here.
@@ -0,0 +1,580 @@
+/*
+ * fwsend.c
+ *
+ * Host side of the SysEx firmware update (see fwupdate.h): turn a build into a
+ * slot image and send it to the board.
+ *
+ * The image is the application as linked for APP_BASE (slot A), as a raw
+ * binary. A binary of the whole flash, boot stub included, is cut down with
+ * -o 0x800. Before anything is sent the tool checks the image's vector table:
+ * the initial stack pointer must be in SRAM and the reset vector a Thumb
+ * address inside the image, or it was not linked for slot A and the board
+ * would not start it. The CRC-32 is the firmware's own FwUpdate_Crc32().
+ *
+ * The tool sends BEGIN, the DATA chunks, END and APPLY, one message at a time,
+ * and waits for each reply. A chunk is sent again if its ack does not come;
+ * a nak for the sequence number after it means the ack was lost and the chunk
+ * had arrived.
+ *
+ * With -d the messages go to a raw MIDI device, such as /dev/snd/midiC1D0 on
+ * Linux. Without it they go to the firmware's updater, fwupdate.c, running on
+ * the simulated controller in tools/sim/ behind the firmware's own USB stack,
+ * with the top half of flash simulated. After APPLY the tool checks what the
+ * boot stub will find on the next reset: the update record marked pending,
+ * slot B holding the image, and a reset requested. The stub's copy of slot B
+ * over slot A is not run on the host. -e flips one bit of a chunk on its way,
+ * and then expects END to be refused for the bad CRC and nothing left pending.
+ *
+ * Build from the top of the tree:
+ *
+ *		cc -O2 -o fwsend -Itools/sim -Iinclude/midi -Iinclude/usb_midi -Iinclude/fwupdate \
+ *			tools/fwsend.c tools/sim/usbsim.c include/usb_midi/usb*.c include/fwupdate/fwupdate.c
+ *
+ *		./fwsend [-d device] [-o offset] [-c chunk] [-t timeout] [-e] image.bin
+ *
+ * It exits non-zero if the image is not a slot A image or the board did not
+ * take it.
+ *
+ *  Created on: Oct 18, 2026
+ *
+ * MODS:
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+
+#include "midi.h"
+#include "usb_midi.h"
+#include "usbmidi_types.h"
+#include "usbmidi.h"
+#include "usbmidi_descriptors.h"
+#include "fwupdate.h"
+#include "usbsim.h"
+
+#define SRAM_BASE		0x20000000
+#define SRAM_SIZE		0x00008000
+#define MAX_CHUNK		1024		// payload bytes per DATA message
+#define MAX_MESSAGE		(8 + (MAX_CHUNK / 7 + 1) * 8)
+#define REPLY_SIZE		9
+#define REPLY_TRIES		3
+
+/*
+ * The device, real or simulated.
+ */
+typedef struct
+{
+	void (*send)(const uint8_t *data, uint32_t len);
+	uint32_t (*recv)(uint8_t *buf, uint32_t room, uint64_t deadline);	// waits until deadline
+	uint64_t (*now)(void);												// ns
+} Port_t;
+
+static const Port_t *g_psPort;
+
+/*
+ * A raw MIDI device.
+ */
+static int g_iFd = -1;
+
+static uint64_t RealNow(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void RealSend(const uint8_t *data, uint32_t len)
+{
+	if( write(g_iFd, data, len) != (ssize_t) len )
+		perror("write");
+}
+
+static uint32_t RealRecv(uint8_t *buf, uint32_t room, uint64_t deadline)
+{
+	struct pollfd pfd;
+	uint64_t now = RealNow();
+	ssize_t n;
+
+	pfd.fd = g_iFd;
+	pfd.events = POLLIN;
+	if( (now >= deadline) || (poll(&pfd, 1, (int) ((deadline - now + 999999) / 1000000)) <= 0) )
+		return 0;
+	n = read(g_iFd, buf, room);
+	return (n > 0) ? (uint32_t) n : 0;
+}
+
+static const Port_t g_sRealPort = { RealSend, RealRecv, RealNow };
+
+/*
+ * The simulated board: the firmware's stack and updater. Each message goes out
+ * as OUT transfers of event packets, then the main loop runs once, as on the
+ * board, and the host collects whatever the device loaded into the IN endpoint.
+ */
+#define SIM_FRAME_CYCLES	80000		// 1 ms at 80 MHz
+
+static const uint8_t CinBytes[16] = { 0, 0, 2, 3, 3, 1, 2, 3, 3, 3, 3, 3, 2, 2, 3, 1 };
+
+static uint8_t g_pui8SimRx[USBMIDI_MAX_PACKET_SIZE * 4];
+static uint32_t g_ui32SimRxLen;
+static uint32_t g_ui32SimFrames;
+
+static void SimSysEx(const USBMIDISysExMsg_t *msg)
+{
+	FwUpdate_SysEx(msg);
+}
+
+static uint64_t SimNow(void)
+{
+	return g_ui32SimFrames * 1000000ULL;
+}
+
+static void SimSend(const uint8_t *data, uint32_t len)
+{
+	uint8_t buf[USBMIDI_MAX_PACKET_SIZE];
+	uint32_t size = 0;
+	uint32_t n;
+	uint32_t i;
+
+	while( len )
+	{
+		n = (len > 3) ? 3 : len;
+		buf[size] = USB_MIDI_HEADER(0, (len > 3) ? USB_MIDI_CIN_SYSEXSTART : USB_MIDI_CIN_SYSEND1 + n - 1);
+		for( i = 0; i < 3; i++ )
+			buf[size + 1 + i] = (i < n) ? data[i] : 0;
+		size += 4;
+		data += n;
+		len -= n;
+		if( (size == sizeof(buf)) || (len == 0) )
+		{
+			if( !UsbSim_Out(buf, size) )
+				fprintf(stderr, "fwsend: the device did not take an OUT packet\n");
+			size = 0;
+		}
+	}
+
+	// the main loop, then the host's next frame.
+	USBMIDI_SysExTask();
+	FwUpdate_Task();
+	UsbSim_Advance(SIM_FRAME_CYCLES);
+	g_ui32SimFrames++;
+	while( UsbSim_InPending() )
+	{
+		n = UsbSim_In(buf);
+		for( i = 0; i < n; i += 4 )
+		{
+			if( g_ui32SimRxLen + 3 > sizeof(g_pui8SimRx) )
+				break;
+			memcpy(&g_pui8SimRx[g_ui32SimRxLen], &buf[i + 1], CinBytes[USB_MIDI_CODE_INDEX_NUMBER(buf[i])]);
+			g_ui32SimRxLen += CinBytes[USB_MIDI_CODE_INDEX_NUMBER(buf[i])];
+		}
+	}
+}
+
+static uint32_t SimRecv(uint8_t *buf, uint32_t room, uint64_t deadline)
+{
+	uint32_t n = (g_ui32SimRxLen < room) ? g_ui32SimRxLen : room;
+
+	(void) deadline;
+	memcpy(buf, g_pui8SimRx, n);
+	memmove(g_pui8SimRx, &g_pui8SimRx[n], g_ui32SimRxLen - n);
+	g_ui32SimRxLen -= n;
+	return n;
+}
+
+static const Port_t g_sSimPort = { SimSend, SimRecv, SimNow };
+
+static bool SimInit(void)
+{
+	if( !UsbSim_FlashInit() )
+	{
+		fprintf(stderr, "fwsend: cannot map the simulated flash at 0x%05X\n", FWUPDATE_SLOT_B_BASE);
+		return false;
+	}
+	USBMIDI_Init(0);
+	USBMIDI_SysExCallbackSet(SimSysEx);
+	FwUpdate_Init();
+	UsbSim_Configure();
+	return true;
+}
+
+/*
+ * Replies from the device, picked out of the byte stream.
+ */
+static uint8_t g_pui8Reply[REPLY_SIZE];
+
+static bool Receive(uint64_t deadline)
+{
+	static uint8_t buf[256];
+	static uint32_t len;
+	static uint32_t pos;
+	static uint32_t n;
+	static bool inMsg;
+	uint8_t b;
+
+	for( ;; )
+	{
+		if( pos == len )
+		{
+			pos = 0;
+			len = g_psPort->recv(buf, sizeof(buf), deadline);
+			if( !len )
+				return false;
+		}
+		b = buf[pos++];
+		if( b >= MIDI_MSG_TIMINGCLOCK )
+			continue;
+		if( b == MIDI_MSG_SOX )
+		{
+			inMsg = true;
+			n = 0;
+		}
+		else if( (b & 0x80) && (b != MIDI_MSG_EOX) )
+		{
+			inMsg = false;
+		}
+		if( !inMsg )
+			continue;
+		if( n < sizeof(g_pui8Reply) )
+			g_pui8Reply[n] = b;
+		n++;
+		if( b == MIDI_MSG_EOX )
+		{
+			inMsg = false;
+			if( (n == REPLY_SIZE) && (g_pui8Reply[1] == FWUPDATE_SYSEX_ID) &&
+					(g_pui8Reply[2] == FWUPDATE_SYSEX_SUBID) )
+				return true;
+		}
+	}
+}
+
+static uint8_t *PutNumber(uint8_t *p, uint32_t value, uint32_t groups)
+{
+	while( groups-- )
+	{
+		*p++ = value & 0x7F;
+		value >>= 7;
+	}
+	return p;
+}
+
+/*
+ * 8-to-7 packing: each group of up to seven bytes goes out as their top bits,
+ * then their low seven bits.
+ */
+static uint8_t *Pack(uint8_t *p, const uint8_t *data, uint32_t len)
+{
+	uint8_t *msbs = p;
+	uint32_t i;
+
+	for( i = 0; i < len; i++ )
+	{
+		if( (i % 7) == 0 )
+		{
+			msbs = p++;
+			*msbs = 0;
+		}
+		*msbs |= (data[i] >> 7) << (i % 7);
+		*p++ = data[i] & 0x7F;
+	}
+	return p;
+}
+
+static const char *StatusName(uint8_t status)
+{
+	static const char *names[] =
+	{
+		"ok", "bad state", "bad length", "bad sequence", "overrun", "flash error", "bad CRC", "malformed"
+	};
+
+	return (status < sizeof(names) / sizeof(names[0])) ? names[status] : "unknown";
+}
+
+/*
+ * Send one message and wait for its reply, which is left in g_pui8Reply.
+ * \returns the reply's status, or -1 if none came.
+ */
+static int Command(const uint8_t *msg, uint32_t len, uint32_t timeoutMs, uint32_t *retries)
+{
+	uint64_t deadline;
+	uint32_t tries;
+
+	for( tries = 0; tries < REPLY_TRIES; tries++ )
+	{
+		if( tries )
+			(*retries)++;
+		g_psPort->send(msg, len);
+		deadline = g_psPort->now() + timeoutMs * 1000000ULL;
+		while( Receive(deadline) )
+		{
+			if( g_pui8Reply[4] == msg[3] )
+				return (g_pui8Reply[3] == FWUPDATE_REPLY_ACK) ? eFwUpdateOk : g_pui8Reply[7];
+		}
+	}
+	return -1;
+}
+
+/*
+ * Send a command with no arguments; report a refusal.
+ */
+static int Simple(uint8_t cmd, const char *name, uint32_t timeoutMs, uint32_t *retries)
+{
+	uint8_t msg[5] = { MIDI_MSG_SOX, FWUPDATE_SYSEX_ID, FWUPDATE_SYSEX_SUBID, 0, MIDI_MSG_EOX };
+	int status;
+
+	msg[3] = cmd;
+	status = Command(msg, sizeof(msg), timeoutMs, retries);
+	if( status < 0 )
+		fprintf(stderr, "fwsend: no reply to %s\n", name);
+	else if( status != eFwUpdateOk )
+		fprintf(stderr, "fwsend: %s refused: %s\n", name, StatusName(status));
+	return status;
+}
+
+/*
+ * The image must start with a vector table for slot A.
+ */
+static bool CheckImage(const uint8_t *image, uint32_t len)
+{
+	uint32_t sp;
+	uint32_t reset;
+
+	if( (len < 8) || (len > FWUPDATE_SLOT_SIZE) )
+	{
+		fprintf(stderr, "fwsend: %u bytes does not fit slot A (%u bytes)\n", len, FWUPDATE_SLOT_SIZE);
+		return false;
+	}
+	sp = image[0] | (image[1] << 8) | (image[2] << 16) | ((uint32_t) image[3] << 24);
+	reset = image[4] | (image[5] << 8) | (image[6] << 16) | ((uint32_t) image[7] << 24);
+	if( (sp <= SRAM_BASE) || (sp > SRAM_BASE + SRAM_SIZE) )
+	{
+		fprintf(stderr, "fwsend: initial stack pointer 0x%08X is not in SRAM: not a vector table\n", sp);
+		return false;
+	}
+	if( !(reset & 1) || (reset < FWUPDATE_SLOT_A_BASE) || (reset >= FWUPDATE_SLOT_A_BASE + len) )
+	{
+		fprintf(stderr, "fwsend: reset vector 0x%08X is not in the image at 0x%05X: "
+				"not linked for slot A, or -o is wrong\n", reset, FWUPDATE_SLOT_A_BASE);
+		return false;
+	}
+	return true;
+}
+
+/*
+ * What the boot stub will find on the next reset.
+ */
+static bool SimCheck(const uint8_t *image, uint32_t len, uint32_t crc, bool bApplied)
+{
+	const tFwUpdateRecord *psRec = (const tFwUpdateRecord *) FWUPDATE_RECORD_BASE;
+	bool bPending;
+	bool bSlotB;
+	bool bReset;
+
+	bPending = (psRec->ui32Magic == FWUPDATE_RECORD_MAGIC) && (psRec->ui32Length == len) &&
+			(psRec->ui32Crc == crc) && (psRec->ui32Pending == FWUPDATE_RECORD_PENDING) &&
+			(psRec->ui32Applied == FWUPDATE_RECORD_ERASED);
+	bSlotB = memcmp((const void *) FWUPDATE_SLOT_B_BASE, image, len) == 0;
+
+	FwUpdate_Task();
+	bReset = UsbSim_ResetCalled();
+
+	printf("  update record %s, slot B %s, reset %s\n", bPending ? "pending" : "not pending",
+			bSlotB ? "matches the image" : "differs from the image", bReset ? "requested" : "not requested");
+	if( bApplied )
+		return bPending && bSlotB && bReset;
+	return !bPending && !bReset;
+}
+
+/*
+ * Send the image, with the chunk starting at corruptAt sent with a bit flipped.
+ * \returns the exit status.
+ */
+static int Send(uint8_t *image, uint32_t len, uint32_t chunk, uint32_t timeoutMs, uint32_t corruptAt)
+{
+	uint8_t msg[MAX_MESSAGE];
+	uint8_t *p;
+	uint32_t retries = 0;
+	uint32_t chunks = 0;
+	uint32_t crc;
+	uint32_t pos;
+	uint32_t n;
+	uint16_t seq = 0;
+	bool ok;
+	int status;
+	double start;
+
+	crc = FwUpdate_Crc32(0, image, len);
+	start = g_psPort->now() * 1e-9;
+
+	p = msg;
+	*p++ = MIDI_MSG_SOX;
+	*p++ = FWUPDATE_SYSEX_ID;
+	*p++ = FWUPDATE_SYSEX_SUBID;
+	*p++ = FWUPDATE_CMD_BEGIN;
+	p = PutNumber(p, len, 5);
+	p = PutNumber(p, crc, 5);
+	*p++ = MIDI_MSG_EOX;
+	status = Command(msg, p - msg, timeoutMs, &retries);
+	if( status != eFwUpdateOk )
+	{
+		fprintf(stderr, "fwsend: BEGIN %s\n", (status < 0) ? "got no reply" : StatusName(status));
+		return 1;
+	}
+
+	for( pos = 0; pos < len; pos += n )
+	{
+		n = (len - pos < chunk) ? len - pos : chunk;
+
+		// -e: the first byte of a chunk in the middle goes out with bit 0 flipped.
+		image[pos] ^= (pos == corruptAt);
+		p = msg;
+		*p++ = MIDI_MSG_SOX;
+		*p++ = FWUPDATE_SYSEX_ID;
+		*p++ = FWUPDATE_SYSEX_SUBID;
+		*p++ = FWUPDATE_CMD_DATA;
+		p = PutNumber(p, seq, 2);
+		p = Pack(p, &image[pos], n);
+		*p++ = MIDI_MSG_EOX;
+		image[pos] ^= (pos == corruptAt);
+
+		status = Command(msg, p - msg, timeoutMs, &retries);
+		// the ack carries the next sequence number; a lost ack shows up as a nak for it.
+		if( (status == eFwUpdateBadSequence) &&
+				((g_pui8Reply[5] | (g_pui8Reply[6] << 7)) == ((seq + 1) & 0x3FFF)) )
+			status = eFwUpdateOk;
+		if( status != eFwUpdateOk )
+		{
+			fprintf(stderr, "fwsend: chunk %u at %u %s\n", seq, pos, (status < 0) ? "got no reply" : StatusName(status));
+			Simple(FWUPDATE_CMD_ABORT, "ABORT", timeoutMs, &retries);
+			return 1;
+		}
+		seq = (seq + 1) & 0x3FFF;
+		chunks++;
+	}
+
+	status = Simple(FWUPDATE_CMD_END, "END", timeoutMs * 10, &retries);
+	if( corruptAt != UINT32_MAX )
+	{
+		ok = (status == eFwUpdateBadCrc) && SimCheck(image, len, crc, false);
+		printf("  corrupted chunk %s\n", ok ? "refused, nothing applied" : "NOT caught");
+		return ok ? 0 : 1;
+	}
+	if( (status != eFwUpdateOk) || (Simple(FWUPDATE_CMD_APPLY, "APPLY", timeoutMs, &retries) != eFwUpdateOk) )
+		return 1;
+
+	printf("  %u chunks, %u sent again, %.3f s%s\n", chunks, retries, g_psPort->now() * 1e-9 - start,
+			(g_iFd >= 0) ? "" : " simulated (flash programming time not modelled)");
+	if( g_iFd < 0 )
+		return SimCheck(image, len, crc, true) ? 0 : 1;
+	printf("  the board copies the image into slot A on its next reset\n");
+	return 0;
+}
+
+static void Usage(void)
+{
+	fprintf(stderr,
+			"usage: fwsend [-d device] [-o offset] [-c chunk] [-t timeout] [-e] image.bin\n"
+			"  -d  raw MIDI device, else the simulated board\n"
+			"  -o  bytes to skip at the start of the file, 0x800 for a whole-flash binary\n"
+			"  -c  payload bytes per DATA message (default 256, at most 1024)\n"
+			"  -t  ms to wait for a reply (default 500; END gets ten times that)\n"
+			"  -e  simulated: corrupt one chunk and expect END to refuse the image\n");
+	exit(2);
+}
+
+int main(int argc, char **argv)
+{
+	const char *device = NULL;
+	uint8_t *image;
+	uint32_t offset = 0;
+	uint32_t chunk = 256;
+	uint32_t timeoutMs = 500;
+	uint32_t len;
+	uint32_t corruptAt = UINT32_MAX;
+	bool corrupt = false;
+	int status;
+	int opt;
+	long size;
+	FILE *f;
+
+	while( (opt = getopt(argc, argv, "d:o:c:t:e")) != -1 )
+	{
+		switch( opt )
+		{
+		case 'd':
+			device = optarg;
+			break;
+		case 'o':
+			offset = strtoul(optarg, NULL, 0);
+			break;
+		case 'c':
+			chunk = strtoul(optarg, NULL, 0);
+			break;
+		case 't':
+			timeoutMs = strtoul(optarg, NULL, 0);
+			break;
+		case 'e':
+			corrupt = true;
+			break;
+		default:
+			Usage();
+		}
+	}
+	if( (optind != argc - 1) || !chunk || (chunk > MAX_CHUNK) || !timeoutMs || (corrupt && device) )
+		Usage();
+
+	f = fopen(argv[optind], "rb");
+	if( !f || fseek(f, 0, SEEK_END) || ((size = ftell(f)) < 0) || fseek(f, offset, SEEK_SET) )
+	{
+		perror(argv[optind]);
+		return 1;
+	}
+	len = ((uint32_t) size > offset) ? (uint32_t) size - offset : 0;
+	image = malloc(len ? len : 1);
+	if( !image || (fread(image, 1, len, f) != len) )
+	{
+		perror(argv[optind]);
+		return 1;
+	}
+	fclose(f);
+	if( !CheckImage(image, len) )
+	{
+		free(image);
+		return 1;
+	}
+	printf("%s: %u bytes for slot A, CRC-32 %08X\n", argv[optind], len, FwUpdate_Crc32(0, image, len));
+
+	if( device )
+	{
+		g_iFd = open(device, O_RDWR);
+		if( g_iFd < 0 )
+		{
+			perror(device);
+			free(image);
+			return 1;
+		}
+		g_psPort = &g_sRealPort;
+	}
+	else
+	{
+		if( !SimInit() )
+		{
+			free(image);
+			return 1;
+		}
+		g_psPort = &g_sSimPort;
+		if( corrupt )
+			corruptAt = (len / chunk / 2) * chunk;
+	}
+	status = Send(image, len, chunk, timeoutMs, corruptAt);
+	free(image);
+	return status;
+}
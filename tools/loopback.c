@@ -0,0 +1,663 @@
+/*
+ * loopback.c
+ *
+ * Host side of the loopback latency mode (see usbmidi_loopback.h): measure
+ * the full round trip to the board and back, and fetch the board's own share
+ * of it.
+ *
+ * The tool starts the mode, then sends -n pings, one at a time. A ping is one
+ * Active Sensing byte, so the device gets it as an OUT packet of its own and
+ * the main loop can ignore it. The device answers each OUT packet with an echo
+ * numbered from 0, which matches the ping's own number because the next ping
+ * is only sent once the echo is back, or after -t ms without it. Before each
+ * ping the tool waits a random time of up to -g microseconds, so pings land
+ * anywhere in the USB frame. At the end it stops the mode and reads the
+ * device's report.
+ *
+ * Reported: the round trip measured on the host, as percentiles, pings lost
+ * and late, and the device's histograms of arrival to echo loaded (rx to tx)
+ * and loaded to collected by the host (tx to ack). What the round trip has on
+ * top of those is the host's USB stack, its scheduling of the bus, and the
+ * bus itself.
+ *
+ * With -d the pings go to a raw MIDI device, such as /dev/snd/midiC1D0 on
+ * Linux. Without it, they go to a simulated endpoint running the firmware's
+ * own loopback code: the host starts a transfer at the first frame start after
+ * it is asked to, and sees IN data at the frame start after the device's
+ * packet is collected, plus -l microseconds for its stack. With -u the echoes
+ * go through the UMP path (alternate setting 1) and back.
+ *
+ * With -s it then reads the device's statistics (see usbmidi_stats.h) and
+ * reports the stack's share of the worst-case interrupt latency: the longest
+ * critical section entered from below the USB interrupt's priority, and the
+ * longest endpoint interrupt. Run it while the clock, time code and console
+ * are busy on the board for the combined-load figure. The simulated endpoint
+ * keeps no statistics and answers with an empty block.
+ *
+ * Build from the top of the tree:
+ *
+ *		cc -O2 -o loopback -Iinclude/midi -Iinclude/usb_midi tools/loopback.c \
+ *			include/usb_midi/usbmidi_loopback.c include/usb_midi/usbmidi_ump.c \
+ *			include/usb_midi/usbmidi_stats.c
+ *
+ *		./loopback [-d device] [-u] [-s] [-n pings] [-g gap] [-t timeout] [-l latency]
+ *
+ * It exits non-zero if the device does not answer or any ping was lost.
+ *
+ *  Created on: Oct 18, 2026
+ *
+ * MODS:
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+
+#include "midi.h"
+#include "usb_midi.h"
+#include "usbmidi_ump.h"
+#include "usbmidi_loopback.h"
+#include "usbmidi_stats.h"
+
+#define SIM_CPU_HZ		80000000UL	// timestamps count CPU cycles, as on the board
+#define FRAME_NS		1000000ULL
+#define OUT_NS			6000		// OUT transaction of a short packet, and the interrupt
+#define FILL_NS			4000		// endpoint handler up to the IN packet being loaded
+#define IN_JITTER_NS	30000		// until the host controller next polls the IN endpoint
+#define MAIN_LOOP_NS	100000		// main loop getting round to a SysEx command
+#define REPLY_TRIES		3
+#define MAX_PINGS		16384		// sequence numbers are 14 bits
+#define MSG_SIZE		(USBMIDI_LOOPBACK_REPORT_SIZE > USBMIDI_STATS_REPLY_SIZE ?	\
+							USBMIDI_LOOPBACK_REPORT_SIZE : USBMIDI_STATS_REPLY_SIZE)
+
+/*
+ * The device, real or simulated.
+ */
+typedef struct
+{
+	void (*send)(const uint8_t *data, uint32_t len);
+	uint32_t (*recv)(uint8_t *buf, uint32_t room, uint64_t deadline);	// waits until deadline
+	uint64_t (*now)(void);												// ns
+	void (*wait)(uint64_t ns);
+} Port_t;
+
+static const Port_t *g_psPort;
+
+/*
+ * A raw MIDI device.
+ */
+static int g_iFd = -1;
+
+static uint64_t RealNow(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void RealSend(const uint8_t *data, uint32_t len)
+{
+	if( write(g_iFd, data, len) != (ssize_t) len )
+		perror("write");
+}
+
+static uint32_t RealRecv(uint8_t *buf, uint32_t room, uint64_t deadline)
+{
+	struct pollfd pfd;
+	uint64_t now = RealNow();
+	ssize_t n;
+
+	pfd.fd = g_iFd;
+	pfd.events = POLLIN;
+	if( (now >= deadline) || (poll(&pfd, 1, (int) ((deadline - now + 999999) / 1000000)) <= 0) )
+		return 0;
+	n = read(g_iFd, buf, room);
+	return (n > 0) ? (uint32_t) n : 0;
+}
+
+static void RealWait(uint64_t ns)
+{
+	struct timespec ts;
+
+	ts.tv_sec = ns / 1000000000ULL;
+	ts.tv_nsec = ns % 1000000000ULL;
+	nanosleep(&ts, NULL);
+}
+
+static const Port_t g_sRealPort = { RealSend, RealRecv, RealNow, RealWait };
+
+/*
+ * The simulated endpoint: the firmware's loopback code on a virtual clock.
+ * Bytes for the host are queued with the time it sees them.
+ */
+typedef struct
+{
+	uint64_t time;
+	uint32_t len;
+	uint8_t data[MSG_SIZE];
+} SimRx_t;
+
+#define SIM_RX_DEPTH	8
+
+static USBMIDILoopback_t g_sLoopback;
+static USBMIDIStats_t g_sSimStats;
+static USBMIDIUmpXlate_t g_sUmpDown;
+static bool g_bUmp;
+static uint64_t g_ui64SimNow;
+static uint64_t g_ui64HostNs;
+static SimRx_t g_psSimRx[SIM_RX_DEPTH];
+static uint32_t g_ui32SimRxHead;
+static uint32_t g_ui32SimRxCount;
+
+static const uint8_t CinBytes[16] = { 0, 0, 2, 3, 3, 1, 2, 3, 3, 3, 3, 3, 2, 2, 3, 1 };
+
+static uint32_t Cycles(uint64_t ns)
+{
+	return (uint32_t) (ns * (SIM_CPU_HZ / 1000000) / 1000);
+}
+
+static uint64_t NextFrame(uint64_t ns)
+{
+	return (ns / FRAME_NS + 1) * FRAME_NS;
+}
+
+static void SimDeliver(uint64_t time, const uint8_t *data, uint32_t len)
+{
+	SimRx_t *rx;
+
+	if( (g_ui32SimRxCount == SIM_RX_DEPTH) || (len > sizeof(rx->data)) )
+		return;
+	rx = &g_psSimRx[(g_ui32SimRxHead + g_ui32SimRxCount) % SIM_RX_DEPTH];
+	rx->time = time;
+	rx->len = len;
+	memcpy(rx->data, data, len);
+	g_ui32SimRxCount++;
+}
+
+/*
+ * The raw MIDI bytes of event packets, as the host's driver passes them on.
+ */
+static uint32_t PacketBytes(const uint8_t *packets, uint32_t count, uint8_t *out)
+{
+	uint32_t n = 0;
+	uint32_t i;
+	uint32_t k;
+
+	for( i = 0; i < count; i++, packets += 4 )
+		for( k = 0; k < CinBytes[USB_MIDI_CODE_INDEX_NUMBER(packets[0])]; k++ )
+			out[n++] = packets[1 + k];
+	return n;
+}
+
+/*
+ * Load the IN endpoint at loadNs with the waiting echoes, through the
+ * firmware's fill routine for the alternate setting, and hand them to the
+ * host once collected.
+ */
+static void SimInPacket(uint64_t loadNs)
+{
+	uint8_t packet[64];
+	uint32_t words[16];
+	USBMIDI_Message_t msg[USBMIDI_UMP_MAX_MIDI1];
+	uint8_t bytes[64];
+	uint32_t len = 0;
+	uint32_t count;
+	uint32_t size;
+	uint32_t w;
+	uint32_t i;
+	uint64_t collectNs;
+
+	if( g_bUmp )
+	{
+		count = USBMIDILoopback_FillUmp(&g_sLoopback, words, 16, Cycles(loadNs));
+		for( w = 0; w < count; w += size )
+		{
+			size = USBMIDI_UMP_WORDS(words[w]);
+			i = USBMIDIUmp_ToMidi1(&g_sUmpDown, &words[w], msg);
+			memcpy(packet, msg, i * 4);
+			len += PacketBytes(packet, i, &bytes[len]);
+		}
+	}
+	else
+	{
+		count = USBMIDILoopback_FillMidi1(&g_sLoopback, packet, sizeof(packet), Cycles(loadNs));
+		len = PacketBytes(packet, count / 4, bytes);
+	}
+	if( !count )
+		return;
+
+	collectNs = loadNs + (uint64_t) rand() % IN_JITTER_NS;
+	USBMIDILoopback_Ack(&g_sLoopback, Cycles(collectNs));
+	SimDeliver(NextFrame(collectNs) + g_ui64HostNs, bytes, len);
+}
+
+static uint64_t SimNow(void)
+{
+	return g_ui64SimNow;
+}
+
+static void SimWait(uint64_t ns)
+{
+	g_ui64SimNow += ns;
+}
+
+/*
+ * One write from the host is one OUT packet.
+ */
+static void SimSend(const uint8_t *data, uint32_t len)
+{
+	uint8_t reply[MSG_SIZE];
+	uint64_t rxNs = NextFrame(g_ui64SimNow) + OUT_NS;
+	uint64_t mainNs;
+	uint32_t n;
+
+	if( USBMIDILoopback_Rx(&g_sLoopback, Cycles(rxNs)) )
+		SimInPacket(rxNs + FILL_NS);
+
+	// F0 7D 4C <cmd> F7: the main loop answers it.
+	if( (len == 5) && (data[0] == MIDI_MSG_SOX) && (data[1] == USBMIDI_LOOPBACK_SYSEX_ID) &&
+			(data[2] == USBMIDI_LOOPBACK_SYSEX_SUBID) && (data[4] == MIDI_MSG_EOX) &&
+			USBMIDILoopback_Command(&g_sLoopback, data[3]) )
+	{
+		mainNs = rxNs + MAIN_LOOP_NS;
+		n = USBMIDILoopback_Reply(&g_sLoopback.report, data[3], SIM_CPU_HZ, reply);
+		SimDeliver(NextFrame(mainNs) + g_ui64HostNs, reply, n);
+	}
+
+	// F0 7D 53 01 F7: the statistics query, answered from an empty block.
+	if( (len == 5) && (data[0] == MIDI_MSG_SOX) && (data[1] == USBMIDI_STATS_SYSEX_ID) &&
+			USBMIDIStats_IsQuery(data[1], data[2], data[3]) && (data[4] == MIDI_MSG_EOX) )
+	{
+		mainNs = rxNs + MAIN_LOOP_NS;
+		n = USBMIDIStats_Reply(&g_sSimStats, reply);
+		SimDeliver(NextFrame(mainNs) + g_ui64HostNs, reply, n);
+	}
+}
+
+static uint32_t SimRecv(uint8_t *buf, uint32_t room, uint64_t deadline)
+{
+	SimRx_t *rx = &g_psSimRx[g_ui32SimRxHead];
+
+	if( !g_ui32SimRxCount || (rx->time > deadline) )
+	{
+		if( deadline > g_ui64SimNow )
+			g_ui64SimNow = deadline;
+		return 0;
+	}
+	if( rx->time > g_ui64SimNow )
+		g_ui64SimNow = rx->time;
+	if( rx->len < room )
+		room = rx->len;
+	memcpy(buf, rx->data, room);
+	g_ui32SimRxHead = (g_ui32SimRxHead + 1) % SIM_RX_DEPTH;
+	g_ui32SimRxCount--;
+	return room;
+}
+
+static const Port_t g_sSimPort = { SimSend, SimRecv, SimNow, SimWait };
+
+/*
+ * SysEx from the device, picked out of the byte stream. Real-time bytes may
+ * come in the middle; anything else from the device is skipped.
+ */
+static uint8_t g_pui8Msg[MSG_SIZE];
+static uint32_t g_ui32MsgLen;
+static bool g_bInMsg;
+
+/*
+ * Next loopback or statistics message from the device, by the deadline.
+ * \returns its length, F0 to F7, or 0.
+ */
+static uint32_t Receive(uint64_t deadline)
+{
+	static uint8_t buf[MSG_SIZE];
+	static uint32_t len;
+	static uint32_t pos;
+	uint8_t b;
+
+	for( ;; )
+	{
+		if( pos == len )
+		{
+			pos = 0;
+			len = g_psPort->recv(buf, sizeof(buf), deadline);
+			if( !len )
+				return 0;
+		}
+		b = buf[pos++];
+		if( b >= MIDI_MSG_TIMINGCLOCK )
+			continue;
+		if( b == MIDI_MSG_SOX )
+		{
+			g_bInMsg = true;
+			g_ui32MsgLen = 0;
+		}
+		else if( (b & 0x80) && (b != MIDI_MSG_EOX) )
+		{
+			g_bInMsg = false;
+		}
+		if( !g_bInMsg )
+			continue;
+		if( g_ui32MsgLen < sizeof(g_pui8Msg) )
+			g_pui8Msg[g_ui32MsgLen++] = b;
+		if( b == MIDI_MSG_EOX )
+		{
+			g_bInMsg = false;
+			if( (g_ui32MsgLen >= 5) && (g_pui8Msg[1] == USBMIDI_LOOPBACK_SYSEX_ID) &&
+					((g_pui8Msg[2] == USBMIDI_LOOPBACK_SYSEX_SUBID) ||
+					(g_pui8Msg[2] == USBMIDI_STATS_SYSEX_SUBID)) )
+				return g_ui32MsgLen;
+		}
+	}
+}
+
+/*
+ * Send a command, F0 7D <subId> <cmd> F7, and wait for its reply, F0 7D <subId>
+ * 7F <cmd> ..., which is left in g_pui8Msg. The loopback mode and the
+ * statistics both answer this way.
+ */
+static bool Command(uint8_t subId, uint8_t cmd, uint32_t timeoutMs)
+{
+	uint8_t msg[5] = { MIDI_MSG_SOX, USBMIDI_LOOPBACK_SYSEX_ID, 0, 0, MIDI_MSG_EOX };
+	uint64_t deadline;
+	uint32_t tries;
+
+	msg[2] = subId;
+	msg[3] = cmd;
+	for( tries = 0; tries < REPLY_TRIES; tries++ )
+	{
+		g_psPort->send(msg, sizeof(msg));
+		deadline = g_psPort->now() + timeoutMs * 1000000ULL;
+		while( Receive(deadline) )
+		{
+			if( (g_pui8Msg[2] == subId) && (g_pui8Msg[3] == USBMIDI_LOOPBACK_REPLY) && (g_pui8Msg[4] == cmd) )
+				return true;
+		}
+	}
+	fprintf(stderr, "loopback: no reply to command %u\n", cmd);
+	return false;
+}
+
+static const uint8_t *Get32(const uint8_t *p, uint32_t *v)
+{
+	uint32_t i;
+
+	*v = 0;
+	for( i = 0; i < 5; i++ )
+		*v |= (uint32_t) (*p++ & 0x7F) << (7 * i);
+	return p;
+}
+
+static const uint8_t *GetHist(const uint8_t *p, USBMIDILoopbackHist_t *h, uint32_t buckets)
+{
+	uint32_t b;
+
+	memset(h, 0, sizeof(*h));
+	p = Get32(p, &h->count);
+	p = Get32(p, &h->min);
+	p = Get32(p, &h->max);
+	for( b = 0; b < buckets; b++ )
+		p = Get32(p, &h->bucket[b < USBMIDI_LOOPBACK_BUCKETS ? b : USBMIDI_LOOPBACK_BUCKETS - 1]);
+	return p;
+}
+
+static int CompareU64(const void *a, const void *b)
+{
+	uint64_t x = *(const uint64_t *) a;
+	uint64_t y = *(const uint64_t *) b;
+
+	return (x > y) - (x < y);
+}
+
+static double Us(uint32_t cycles, uint32_t hz)
+{
+	return cycles * 1e6 / hz;
+}
+
+static void PrintHist(const char *name, const USBMIDILoopbackHist_t *h, uint32_t hz)
+{
+	uint64_t seen = 0;
+	uint32_t b;
+
+	printf("  device %s: %u, min %.1f us, max %.1f us\n", name, h->count,
+			h->count ? Us(h->min, hz) : 0.0, Us(h->max, hz));
+	for( b = 0; b < USBMIDI_LOOPBACK_BUCKETS; b++ )
+	{
+		if( !h->bucket[b] )
+			continue;
+		seen += h->bucket[b];
+		if( b == USBMIDI_LOOPBACK_BUCKETS - 1 )
+			printf("    %10.3f us and up  %8u  %5.1f%%\n", Us(1UL << b, hz), h->bucket[b],
+					100.0 * seen / h->count);
+		else
+			printf("    under %10.3f us  %8u  %5.1f%%\n", Us(2UL << b, hz), h->bucket[b],
+					100.0 * seen / h->count);
+	}
+}
+
+static bool Report(uint32_t *pHz)
+{
+	USBMIDILoopbackReport_t r;
+	const uint8_t *p;
+	uint32_t hz;
+	uint32_t buckets;
+
+	if( !Command(USBMIDI_LOOPBACK_SYSEX_SUBID, USBMIDI_LOOPBACK_CMD_REPORT, 500) || (g_ui32MsgLen < 5 + 5 * 5 + 1) )
+		return false;
+
+	p = &g_pui8Msg[5];
+	p = Get32(p, &hz);
+	p = Get32(p, &r.packets);
+	p = Get32(p, &r.dropped);
+	p = Get32(p, &r.sent);
+	p = Get32(p, &r.acked);
+	buckets = *p++;
+	if( !hz || (g_ui32MsgLen != 5 + 5 * 5 + 1 + 2 * (3 + buckets) * 5 + 1) )
+	{
+		fprintf(stderr, "loopback: malformed report\n");
+		return false;
+	}
+	p = GetHist(p, &r.rxToTx, buckets);
+	p = GetHist(p, &r.txToAck, buckets);
+	*pHz = hz;
+
+	printf("  device at %.1f MHz: %u packets, %u echoes dropped, %u sent, %u collected\n",
+			hz / 1e6, r.packets, r.dropped, r.sent, r.acked);
+	PrintHist("rx to tx", &r.rxToTx, hz);
+	PrintHist("tx to ack", &r.txToAck, hz);
+	return true;
+}
+
+/*
+ * Read the statistics block and report the stack's share of the interrupt
+ * latency bound: a USB-level interrupt waits for the longer of a critical
+ * section opened below it and an endpoint interrupt already running. The key
+ * scan interrupt, above the USB level, comes on top and is not counted here.
+ */
+static bool Stats(uint32_t hz)
+{
+	USBMIDIStats_t st;
+	uint8_t bytes[USBMIDI_STATS_WORDS * 4];
+	const uint8_t *p;
+	uint32_t words;
+	uint32_t i;
+	uint8_t top = 0;
+	uint32_t bound;
+
+	if( !Command(USBMIDI_STATS_SYSEX_SUBID, USBMIDI_STATS_CMD_QUERY, 500) || (g_ui32MsgLen < 8) )
+		return false;
+	words = g_pui8Msg[6];
+	if( (g_pui8Msg[5] != USBMIDI_STATS_VERSION) || (words * 4 > sizeof(g_pui8Msg)) ||
+			(g_ui32MsgLen != 7 + words * 4 + (words * 4 + 6) / 7 + 1) )
+	{
+		fprintf(stderr, "loopback: malformed statistics\n");
+		return false;
+	}
+
+	// 8-to-7: a byte of top bits, then up to seven low parts; little-endian words.
+	memset(&st, 0, sizeof(st));
+	memset(bytes, 0, sizeof(bytes));
+	p = &g_pui8Msg[7];
+	for( i = 0; i < words * 4; i++ )
+	{
+		if( i % 7 == 0 )
+			top = *p++;
+		if( i < sizeof(bytes) )
+			bytes[i] = *p | (((top >> (i % 7)) & 1) << 7);
+		p++;
+	}
+	for( i = 0; (i < words) && (i < USBMIDI_STATS_WORDS); i++ )
+		((uint32_t *) &st)[i] = bytes[4 * i] | (bytes[4 * i + 1] << 8) | (bytes[4 * i + 2] << 16) |
+				((uint32_t) bytes[4 * i + 3] << 24);
+
+	bound = (st.maskedCyclesMax > st.isrCyclesMax) ? st.maskedCyclesMax : st.isrCyclesMax;
+	printf("  device statistics after %u ms:\n", st.ms);
+	printf("    critical sections below the USB level: %u, longest %u cycles (%.1f us)\n",
+			st.maskedSections, st.maskedCyclesMax, Us(st.maskedCyclesMax, hz));
+	printf("    endpoint interrupts: %u, longest %u cycles (%.1f us)\n", st.isrCalls, st.isrCyclesMax,
+			Us(st.isrCyclesMax, hz));
+	printf("    a USB-level interrupt waits at most %.1f us, plus the key scan interrupt\n", Us(bound, hz));
+	return true;
+}
+
+static void Usage(void)
+{
+	fprintf(stderr,
+			"usage: loopback [-d device] [-u] [-s] [-n pings] [-g gap] [-t timeout] [-l latency]\n"
+			"  -d  raw MIDI device, else a simulated endpoint\n"
+			"  -u  simulated: echo through Universal MIDI Packets (alternate setting 1)\n"
+			"  -s  then read the device's statistics for the interrupt latency bound\n"
+			"  -n  pings (default 1000, at most 16384)\n"
+			"  -g  most microseconds between an echo and the next ping (default 1000)\n"
+			"  -t  ms to wait for an echo (default 100)\n"
+			"  -l  simulated: microseconds for the host stack to pass on IN data (default 125)\n");
+	exit(2);
+}
+
+int main(int argc, char **argv)
+{
+	static const uint8_t ping = MIDI_MSG_ACTIVESENSING;
+	const char *device = NULL;
+	uint32_t pings = 1000;
+	uint32_t gapUs = 1000;
+	uint32_t timeoutMs = 100;
+	uint32_t hz = SIM_CPU_HZ;
+	uint64_t *rtt;
+	uint64_t sent;
+	uint64_t deadline;
+	uint32_t got = 0;
+	uint32_t late = 0;
+	uint32_t seq;
+	uint32_t i;
+	bool stats = false;
+	bool ok;
+	int opt;
+
+	g_ui64HostNs = 125000;
+	while( (opt = getopt(argc, argv, "d:usn:g:t:l:")) != -1 )
+	{
+		switch( opt )
+		{
+		case 'd':
+			device = optarg;
+			break;
+		case 'u':
+			g_bUmp = true;
+			break;
+		case 's':
+			stats = true;
+			break;
+		case 'n':
+			pings = strtoul(optarg, NULL, 0);
+			break;
+		case 'g':
+			gapUs = strtoul(optarg, NULL, 0);
+			break;
+		case 't':
+			timeoutMs = strtoul(optarg, NULL, 0);
+			break;
+		case 'l':
+			g_ui64HostNs = strtoull(optarg, NULL, 0) * 1000;
+			break;
+		default:
+			Usage();
+		}
+	}
+	if( (optind != argc) || !pings || (pings > MAX_PINGS) || !timeoutMs )
+		Usage();
+
+	if( device )
+	{
+		g_iFd = open(device, O_RDWR);
+		if( g_iFd < 0 )
+		{
+			perror(device);
+			return 1;
+		}
+		g_psPort = &g_sRealPort;
+	}
+	else
+	{
+		USBMIDILoopback_Init(&g_sLoopback);
+		USBMIDIUmp_XlateInit(&g_sUmpDown);
+		g_psPort = &g_sSimPort;
+	}
+	srand(1);
+
+	rtt = calloc(pings, sizeof(*rtt));
+	if( !rtt || !Command(USBMIDI_LOOPBACK_SYSEX_SUBID, USBMIDI_LOOPBACK_CMD_START, 500) )
+		return 1;
+
+	for( i = 0; i < pings; i++ )
+	{
+		if( gapUs )
+			g_psPort->wait((uint64_t) (rand() % gapUs) * 1000);
+		sent = g_psPort->now();
+		g_psPort->send(&ping, 1);
+
+		// an echo with an earlier number is one that timed out.
+		deadline = sent + timeoutMs * 1000000ULL;
+		while( Receive(deadline) )
+		{
+			if( (g_pui8Msg[2] != USBMIDI_LOOPBACK_SYSEX_SUBID) || (g_pui8Msg[3] != USBMIDI_LOOPBACK_ECHO) ||
+					(g_ui32MsgLen != 7) )
+				continue;
+			seq = g_pui8Msg[4] | (g_pui8Msg[5] << 7);
+			if( seq == i )
+			{
+				rtt[got++] = g_psPort->now() - sent;
+				break;
+			}
+			late++;
+		}
+	}
+
+	ok = Command(USBMIDI_LOOPBACK_SYSEX_SUBID, USBMIDI_LOOPBACK_CMD_STOP, 500);
+
+	printf("%s\n", device ? device : (g_bUmp ? "simulated endpoint, UMP" : "simulated endpoint"));
+	printf("  %u pings, %u echoed, %u lost, %u late\n", pings, got, pings - got, late);
+	if( got )
+	{
+		qsort(rtt, got, sizeof(*rtt), CompareU64);
+		printf("  round trip: min %.1f us, p50 %.1f us, p90 %.1f us, p99 %.1f us, max %.1f us\n",
+				rtt[0] / 1e3, rtt[got / 2] / 1e3, rtt[got * 9 / 10] / 1e3, rtt[got * 99 / 100] / 1e3,
+				rtt[got - 1] / 1e3);
+	}
+	ok = ok && Report(&hz);
+	if( stats )
+		ok = ok && Stats(hz);
+
+	free(rtt);
+	if( g_iFd >= 0 )
+		close(g_iFd);
+	return (ok && (got == pings)) ? 0 : 1;
+}
@@ -0,0 +1,510 @@
+/*
+ * outfuzz.c
+ *
+ * Fuzz the stack's USB side on the host: arbitrary bytes become what a host
+ * can do to the device, OUT packets of any size and content, IN polls, EP0
+ * requests, alternate setting changes and bus events, mixed with what the
+ * main loop does, and all of it runs through the real handlers in
+ * include/usb_midi/ on the simulated controller in tools/sim/. OUT packets
+ * take the firmware's own path: HandleEndpoints(), OutEpMessage() or
+ * OutEpUmp(), the SysEx pool, the followers and the OUT FIFO.
+ *
+ * Each input is a list of operations, one byte each, with their arguments
+ * after them; see RunOne(). Between operations the harness checks what must
+ * always hold: FIFO depths within their sizes, the SysEx pool within its
+ * blocks, IN packets made of whole event packets or UMP, every completed
+ * SysEx message F0 to F7 with only data bytes between. The simulator checks
+ * the rest (see usbsim.h). A failed check aborts, which is what fuzzers look
+ * for; build with the sanitizers so memory errors abort too.
+ *
+ * LLVMFuzzerTestOneInput() is the entry point for libFuzzer. Built without
+ * -DOUTFUZZ_NO_MAIN, main() runs each file given once, or stdin with no
+ * files, which suits AFL; with -r it runs random inputs instead. Build from
+ * the top of the tree:
+ *
+ *		cc -g -O1 -fsanitize=address,undefined -fno-sanitize-recover=all \
+ *			-o outfuzz -Itools/sim -Iinclude/midi -Iinclude/usb_midi \
+ *			tools/outfuzz.c tools/sim/usbsim.c include/usb_midi/usb*.c
+ *
+ *		./outfuzz [-r seed] [-n inputs] [-b packets] [file ...]
+ *
+ * -b times the endpoint handler on the host instead: full OUT packets of
+ * Note Ons, with the host's cycle counter behind the stack's isrCycles.
+ * For libFuzzer, build with clang, -DOUTFUZZ_NO_MAIN and
+ * -fsanitize=fuzzer,address,undefined instead.
+ *
+ *  Created on: Oct 18, 2026
+ *
+ * MODS:
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "inc/hw_ints.h"
+#include "driverlib/interrupt.h"
+#include "midi.h"
+#include "usb_midi.h"
+#include "usbmidi_types.h"
+#include "usbmidi.h"
+#include "usbmidi_critical.h"
+#include "usbmidi_descriptors.h"
+#include "usbsim.h"
+
+#define MAX_INPUT		65536
+#define RANDOM_INPUT	4096
+#define EP0_DATA_SIZE	512
+
+/*
+ * The input, read front to back. Past its end every byte is 0.
+ */
+static const uint8_t *g_pui8In;
+static size_t g_szLeft;
+
+static uint8_t Next(void)
+{
+	if( g_szLeft == 0 )
+		return 0;
+	g_szLeft--;
+	return *g_pui8In++;
+}
+
+static void Check(bool bOk, const char *pcWhat)
+{
+	if( !bOk )
+	{
+		fprintf(stderr, "outfuzz: %s\n", pcWhat);
+		abort();
+	}
+}
+
+/*
+ * Completed SysEx messages, as the main loop's callback gets them. A loopback
+ * or statistics command is carried out, as usb_dev_midi.c does.
+ */
+static void SysExReceived(const USBMIDISysExMsg_t *msg)
+{
+	const USBMIDISysExBlock_t *blk;
+	uint32_t total = 0;
+	uint32_t i;
+	uint8_t last = 0;
+
+	Check(msg->first && (msg->first->len > 0) && (msg->first->data[0] == MIDI_MSG_SOX),
+			"SysEx message does not start with F0");
+	for( blk = msg->first; blk; blk = blk->next )
+	{
+		Check(blk->len <= USBMIDI_SYSEX_BLOCK_SIZE, "SysEx block overfilled");
+		Check((blk->next == 0) || (blk->len == USBMIDI_SYSEX_BLOCK_SIZE), "SysEx block short but not last");
+		for( i = 0; i < blk->len; i++ )
+		{
+			if( (total > 0) && (total + 1 < msg->length) )
+				Check(blk->data[i] < 0x80, "status byte inside a SysEx message");
+			last = blk->data[i];
+			total++;
+		}
+	}
+	Check(total == msg->length, "SysEx message length does not match its blocks");
+	Check(last == MIDI_MSG_EOX, "SysEx message does not end with F7");
+
+	if( USBMIDI_LoopbackSysEx(msg) )
+		return;
+	USBMIDI_StatsSysEx(msg);
+}
+
+/*
+ * The SysTick interrupt, at the USB interrupt's priority.
+ */
+static void SysTick(void)
+{
+	USBMIDI_Tick(1);
+}
+
+/*
+ * A timing message from the clock generator's timer, also at that priority.
+ */
+static USBMIDI_Message_t g_sRtMsg;
+
+static void RealTime(void)
+{
+	USBMIDI_RealTimeWrite(&g_sRtMsg);
+}
+
+static void CheckFifo(const USBMIDIFifoStats_t *s, uint32_t size, const char *pcWhat)
+{
+	Check((s->depth <= size) && (s->highWater <= size), pcWhat);
+}
+
+static void CheckInvariants(void)
+{
+	USBMIDIStats_t st;
+
+	USBMIDI_StatsGet(&st);
+	CheckFifo(&st.inMsg, MIDI_USB_FIFO_SIZE, "IN FIFO deeper than its size");
+	CheckFifo(&st.outMsg, MIDI_USB_FIFO_SIZE, "OUT FIFO deeper than its size");
+	CheckFifo(&st.inRt, USBMIDI_RT_FIFO_SIZE, "timing FIFO deeper than its size");
+	CheckFifo(&st.inUmp, USBMIDI_UMP_FIFO_WORDS, "IN UMP FIFO deeper than its size");
+	CheckFifo(&st.outUmp, USBMIDI_UMP_FIFO_WORDS, "OUT UMP FIFO deeper than its size");
+	CheckFifo(&st.outParam, USBMIDI_PARAM_FIFO_SIZE, "parameter FIFO deeper than its size");
+	Check(st.sysExBlocksInUse <= USBMIDI_SYSEX_NUM_BLOCKS, "SysEx pool uses more blocks than it has");
+	Check(st.sysExBlocksHighWater <= USBMIDI_SYSEX_NUM_BLOCKS, "SysEx pool high water past its blocks");
+	Check(st.outWords <= st.outPackets * (USBMIDI_MAX_PACKET_SIZE / 4), "more OUT words than packets hold");
+	Check(st.inWords <= st.inPackets * (USBMIDI_MAX_PACKET_SIZE / 4), "more IN words than packets hold");
+}
+
+/*
+ * Collect an IN packet and check it is whole event packets or whole UMP.
+ */
+static void InPoll(void)
+{
+	uint8_t buf[USBMIDI_MAX_PACKET_SIZE];
+	uint32_t size;
+	uint32_t word;
+	uint32_t i;
+	bool bUmp = USBMIDI_IsUmp();
+
+	size = UsbSim_In(buf);
+	Check((size % 4) == 0, "IN packet not a whole number of words");
+	if( !bUmp )
+		return;
+	for( i = 0; i < size; i += 4 * USBMIDI_UMP_WORDS(word) )
+	{
+		memcpy(&word, &buf[i], 4);
+		Check(i + 4 * USBMIDI_UMP_WORDS(word) <= size, "UMP cut off by the end of an IN packet");
+	}
+}
+
+/*
+ * The host sends a SysEx message of ui32Len data bytes, in as few OUT packets
+ * as it fits, as a class driver does.
+ */
+static void SysExOut(uint8_t ui8Cable, uint32_t ui32Len)
+{
+	uint8_t buf[USBMIDI_MAX_PACKET_SIZE];
+	uint8_t b[3];
+	uint32_t total = ui32Len + 2;
+	uint32_t sent = 0;
+	uint32_t size = 0;
+	uint32_t n;
+	uint32_t i;
+
+	while( sent < total )
+	{
+		n = (total - sent > 3) ? 3 : total - sent;
+		for( i = 0; i < n; i++, sent++ )
+			b[i] = (sent == 0) ? MIDI_MSG_SOX : (sent == total - 1) ? MIDI_MSG_EOX : (Next() & 0x7F);
+		buf[size++] = USB_MIDI_HEADER(ui8Cable, (sent < total) ? USB_MIDI_CIN_SYSEXSTART : USB_MIDI_CIN_SYSEND1 + n - 1);
+		for( i = 0; i < 3; i++ )
+			buf[size++] = (i < n) ? b[i] : 0;
+		if( (size == sizeof(buf)) || (sent == total) )
+		{
+			UsbSim_Out(buf, size);
+			size = 0;
+		}
+	}
+}
+
+/*
+ * What the main loop does with what the host sent.
+ */
+static void MainLoop(void)
+{
+	USBMIDI_Message_t msg;
+	USBMIDIParamEvent_t ev;
+	uint32_t ump[USBMIDI_UMP_MAX_WORDS];
+	uint32_t size;
+
+	while( USBMIDI_OutEpFIFO_Pop(&msg) )
+		;
+	while( (size = USBMIDI_UmpRead(ump)) != 0 )
+		Check(size == USBMIDI_UMP_WORDS(ump[0]), "UMP read with the wrong size");
+	while( USBMIDI_ParamRead(&ev) )
+		;
+	USBMIDI_SysExTask();
+}
+
+/*
+ * One input, from a freshly initialised stack.
+ */
+static void RunOne(const uint8_t *pui8Data, size_t szSize)
+{
+	uint8_t buf[EP0_DATA_SIZE];
+	tUSBRequest req;
+	USBMIDI_Message_t msg;
+	uint32_t ump[USBMIDI_UMP_MAX_WORDS];
+	uint32_t size;
+	uint32_t i;
+
+	g_pui8In = pui8Data;
+	g_szLeft = szSize;
+
+	USBMIDI_Init(0);
+	USBMIDI_SysExCallbackSet(SysExReceived);
+	IntPrioritySet(FAULT_SYSTICK, USBMIDI_INT_PRIORITY);
+	UsbSim_Configure();
+
+	while( g_szLeft )
+	{
+		switch( Next() % 16 )
+		{
+			case 0:
+			case 1:
+			case 2:
+				// the host's OUT packets, the most common operation.
+				size = Next() % (USBMIDI_MAX_PACKET_SIZE + 1);
+				for( i = 0; i < size; i++ )
+					buf[i] = Next();
+				UsbSim_Out(buf, size);
+				break;
+
+			case 3:
+				// now and then one long enough to run the pool dry.
+				size = Next();
+				SysExOut(size & 0x0F, ((size & 0xF0) == 0xF0) ? (uint32_t) Next() << 6 : Next());
+				break;
+
+			case 4:
+				InPoll();
+				break;
+
+			case 5:
+				MainLoop();
+				break;
+
+			case 6:
+				UsbSim_SetInterface(USBMIDI_IF_MIDI_STREAMING, Next() & 1);
+				break;
+
+			case 7:
+				switch( Next() % 6 )
+				{
+					case 0: UsbSim_Configure(); break;
+					case 1: UsbSim_Reset(); break;
+					case 2: UsbSim_Suspend(); break;
+					case 3: UsbSim_Resume(); break;
+					case 4: UsbSim_Disconnect(); break;
+					default: UsbSim_RemoteWakeEnable(Next() & 1); break;
+				}
+				break;
+
+			case 8:
+				// any class or vendor request; standard ones are usblib's.
+				for( i = 0; i < sizeof(req); i++ )
+					((uint8_t *) &req)[i] = Next();
+				req.wLength %= EP0_DATA_SIZE + 1;
+				if( (req.bmRequestType & USB_RTYPE_DIR_M) != USB_RTYPE_DIR_IN )
+					for( i = 0; i < req.wLength; i++ )
+						buf[i] = Next();
+				UsbSim_Request(&req, buf, &size);
+				break;
+
+			case 9:
+				msg.header = Next();
+				msg.byte1 = Next();
+				msg.byte2 = Next();
+				msg.byte3 = Next();
+				USBMIDI_InEpMsgWrite(&msg);
+				break;
+
+			case 10:
+				for( i = 0; i < USBMIDI_UMP_MAX_WORDS; i++ )
+					ump[i] = Next() | (Next() << 8) | (Next() << 16) | ((uint32_t) Next() << 24);
+				USBMIDI_UmpWrite(ump);
+				break;
+
+			case 11:
+				// F0, data, F7, as an application sends.
+				size = Next() % (sizeof(buf) - 2);
+				buf[0] = MIDI_MSG_SOX;
+				for( i = 1; i <= size; i++ )
+					buf[i] = Next() & 0x7F;
+				buf[i] = MIDI_MSG_EOX;
+				USBMIDI_SendSysEx(Next() & 0x0F, buf, size + 2);
+				break;
+
+			case 12:
+				UsbSim_Advance((uint32_t) Next() << 12);
+				UsbSim_Interrupt(FAULT_SYSTICK, SysTick);
+				break;
+
+			case 13:
+				g_sRtMsg.header = Next() & 0xF0;
+				g_sRtMsg.byte1 = MIDI_MSG_TIMINGCLOCK + (Next() & 7);
+				g_sRtMsg.header |= USB_MIDI_CIN_SINGLEBYTE;
+				g_sRtMsg.byte2 = 0;
+				g_sRtMsg.byte3 = 0;
+				UsbSim_Interrupt(FAULT_SYSTICK, RealTime);
+				break;
+
+			case 14:
+				USBMIDI_ReplayModeSet(Next() & 1, Next() * 10);
+				break;
+
+			default:
+				USBMIDI_Panic();
+				break;
+		}
+		UsbSim_Advance(Next());
+		CheckInvariants();
+	}
+
+	// whatever is left goes out, and the host takes it.
+	MainLoop();
+	for( i = 0; (i < 4096) && UsbSim_InPending(); i++ )
+		InPoll();
+	CheckInvariants();
+}
+
+int LLVMFuzzerTestOneInput(const uint8_t *pui8Data, size_t szSize)
+{
+	RunOne(pui8Data, szSize);
+	return 0;
+}
+
+#ifndef OUTFUZZ_NO_MAIN
+
+static void Usage(void)
+{
+	fprintf(stderr, "usage: outfuzz [-r seed] [-n inputs] [-b packets] [file ...]\n");
+	exit(2);
+}
+
+static int CompareCycles(const void *a, const void *b)
+{
+	uint32_t x = *(const uint32_t *) a;
+	uint32_t y = *(const uint32_t *) b;
+
+	return (x > y) - (x < y);
+}
+
+/*
+ * Time the endpoint handler on full OUT packets of Note Ons, with the host's
+ * cycle counter behind the stack's timestamps, so its own isrCycles counter
+ * does the measuring. Host cycles, not the board's.
+ */
+static void Bench(uint32_t ui32Packets)
+{
+	uint8_t buf[USBMIDI_MAX_PACKET_SIZE];
+	uint32_t *pui32Cycles;
+	uint64_t ui64Total = 0;
+	USBMIDI_Message_t msg;
+	USBMIDIStats_t st;
+	uint32_t i;
+
+	pui32Cycles = malloc(ui32Packets * sizeof(uint32_t));
+	if( (pui32Cycles == 0) || (ui32Packets == 0) )
+		Usage();
+
+	for( i = 0; i < sizeof(buf); i += 4 )
+	{
+		buf[i] = USB_MIDI_HEADER(0, USB_MIDI_CIN_NOTEON);
+		buf[i + 1] = MIDI_MSG_NOTEON;
+		buf[i + 2] = 60 + i / 4;
+		buf[i + 3] = 100;
+	}
+
+	USBMIDI_Init(0);
+	UsbSim_ClockSet(UsbSim_HostCycles);
+	UsbSim_Configure();
+	for( i = 0; i < ui32Packets; i++ )
+	{
+		UsbSim_Out(buf, sizeof(buf));
+		USBMIDI_StatsGet(&st);
+		pui32Cycles[i] = st.isrCycles;
+		ui64Total += st.isrCycles;
+		while( USBMIDI_OutEpFIFO_Pop(&msg) )
+			;
+	}
+	UsbSim_ClockSet(0);
+
+	qsort(pui32Cycles, ui32Packets, sizeof(uint32_t), CompareCycles);
+	printf("%u packets of %u events: host cycles per packet median %u, mean %.0f, 10%% %u, 90%% %u\n",
+			ui32Packets, (unsigned) (sizeof(buf) / 4), pui32Cycles[ui32Packets / 2],
+			(double) ui64Total / ui32Packets, pui32Cycles[ui32Packets / 10],
+			pui32Cycles[ui32Packets * 9 / 10]);
+	free(pui32Cycles);
+}
+
+static size_t ReadAll(FILE *f, uint8_t *pui8Buf)
+{
+	size_t szSize = 0;
+	size_t n;
+
+	while( (szSize < MAX_INPUT) && ((n = fread(&pui8Buf[szSize], 1, MAX_INPUT - szSize, f)) > 0) )
+		szSize += n;
+	return szSize;
+}
+
+int main(int argc, char **argv)
+{
+	static uint8_t pui8Buf[MAX_INPUT];
+	unsigned long ulSeed = 0;
+	unsigned long ulInputs = 1000;
+	bool bRandom = false;
+	unsigned long n;
+	size_t szSize;
+	size_t i;
+	FILE *f;
+	int opt;
+
+	while( (opt = getopt(argc, argv, "r:n:b:")) != -1 )
+	{
+		switch( opt )
+		{
+			case 'b':
+				Bench(strtoul(optarg, 0, 0));
+				return 0;
+			case 'r':
+				bRandom = true;
+				ulSeed = strtoul(optarg, 0, 0);
+				break;
+			case 'n':
+				ulInputs = strtoul(optarg, 0, 0);
+				break;
+			default:
+				Usage();
+		}
+	}
+
+	if( bRandom )
+	{
+		srand((unsigned) ulSeed);
+		for( n = 0; n < ulInputs; n++ )
+		{
+			szSize = (size_t) rand() % RANDOM_INPUT;
+			for( i = 0; i < szSize; i++ )
+				pui8Buf[i] = (uint8_t) rand();
+			RunOne(pui8Buf, szSize);
+		}
+		printf("%lu random inputs, seed %lu: no failures\n", ulInputs, ulSeed);
+		return 0;
+	}
+
+	if( optind == argc )
+	{
+		szSize = ReadAll(stdin, pui8Buf);
+		RunOne(pui8Buf, szSize);
+		return 0;
+	}
+
+	for( ; optind < argc; optind++ )
+	{
+		f = fopen(argv[optind], "rb");
+		if( f == 0 )
+		{
+			perror(argv[optind]);
+			return 1;
+		}
+		szSize = ReadAll(f, pui8Buf);
+		fclose(f);
+		RunOne(pui8Buf, szSize);
+	}
+	return 0;
+}
+
+#endif // OUTFUZZ_NO_MAIN
@@ -0,0 +1,895 @@
+/*
+ * ramreport.c
+ *
+ * SRAM budget report: where the linker put the RAM, and how deep the stack
+ * can get.
+ *
+ * Sections. With -m, the TI linker's map file (--map_file, usb_dev_bulk_ccs.map
+ * in the build directory) gives each memory region's use, the output sections
+ * placed in the writable ones, and their largest input sections: the FIFOs and
+ * the SysEx pool in g_sUsbMidiDevice, the drivers' buffers, the stack.
+ *
+ * Stack. The .ci files GCC writes with -fcallgraph-info=su hold every
+ * function's frame and its direct calls. From them the tool finds the deepest
+ * path from each interrupt handler and from main. An interrupt can only be
+ * preempted by one of higher priority, so the worst case for the whole stack
+ * is the deepest thread path, plus for each priority level in use its deepest
+ * handler and the exception frame the core pushes to enter it. What the call
+ * graph cannot see comes from a spec file (-s, tools/ramstack.txt): the
+ * handlers and their priorities, calls through function pointers, and frames
+ * for functions with no source, such as usblib's interrupt handler.
+ * Recursion, frames of unbounded size and unresolved indirect calls are
+ * errors.
+ *
+ * The frames are GCC's for the Cortex-M4, not the TI compiler's; expect them
+ * to be close, not equal.
+ *
+ * Baseline. With -b, every figure is compared with a file the tool wrote
+ * earlier with -w; anything larger, or not in the file at all, is flagged.
+ * Rewrite the file when growth is intended.
+ *
+ * Build from the top of the tree:
+ *
+ *		cc -O2 -o ramreport tools/ramreport.c
+ *
+ *		./ramreport [-m map] [-s spec] [-b baseline [-w]] [-n top] [file.ci ...]
+ *
+ * It exits non-zero if a region or the stack overflows, the stack analysis
+ * is incomplete, or anything grew past the baseline.
+ *
+ *  Created on: Oct 18, 2026
+ *
+ * MODS:
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <unistd.h>
+
+#define MAX_LINE		4096
+#define MAX_REGIONS		16
+#define MAX_SECTIONS	64
+#define MAX_INPUTS		4096
+#define MAX_FUNCS		8192
+#define MAX_ROOTS		64
+#define MAX_FIGURES		128
+#define NAME_LEN		128
+
+/*
+ * The map file.
+ */
+typedef struct
+{
+	char name[NAME_LEN];
+	uint32_t origin;
+	uint32_t length;
+	uint32_t used;
+	bool writable;
+} Region_t;
+
+typedef struct
+{
+	char name[NAME_LEN];
+	uint32_t origin;
+	uint32_t length;
+	int32_t region;
+} Section_t;
+
+typedef struct
+{
+	char desc[NAME_LEN * 2];
+	uint32_t length;
+	int32_t section;
+} Input_t;
+
+static Region_t g_psRegions[MAX_REGIONS];
+static uint32_t g_ui32Regions;
+static Section_t g_psSections[MAX_SECTIONS];
+static uint32_t g_ui32Sections;
+static Input_t g_psInputs[MAX_INPUTS];
+static uint32_t g_ui32Inputs;
+
+/*
+ * The call graph. Static functions are titled "file:name" by GCC, so two of
+ * the same name stay apart; base is the name alone, without GCC's clone
+ * suffixes, for the spec to refer to.
+ */
+typedef struct
+{
+	char *title;
+	char *base;
+	int32_t bytes;			// own frame, -1 if no .ci defines it
+	bool unbounded;
+	bool indirect;			// makes a call through a pointer
+	bool resolved;			// the spec says where it goes
+	char *indirectAt;
+	uint32_t *callee;
+	uint32_t callees;
+	uint32_t room;
+	uint8_t state;			// 0 not visited, 1 on the path, 2 done
+	uint32_t depth;
+	int32_t next;			// callee on the deepest path
+} Func_t;
+
+static Func_t g_psFuncs[MAX_FUNCS];
+static uint32_t g_ui32Funcs;
+
+/*
+ * The spec.
+ */
+typedef struct
+{
+	uint32_t func;
+	uint32_t priority;		// 0x100 for thread mode
+} Root_t;
+
+#define THREAD_PRIORITY	0x100
+
+static Root_t g_psRoots[MAX_ROOTS];
+static uint32_t g_ui32Roots;
+static uint32_t g_ui32StackSize;
+static uint32_t g_ui32ExceptionFrame = 104;	// 26 words, FPU lazy stacking on
+static uint32_t g_ui32DefaultFrame = 32;
+
+/*
+ * Figures compared with the baseline.
+ */
+typedef struct
+{
+	char key[NAME_LEN];
+	uint32_t value;
+} Figure_t;
+
+static Figure_t g_psFigures[MAX_FIGURES];
+static uint32_t g_ui32Figures;
+
+static uint32_t g_ui32Errors;
+
+static void Error(const char *fmt, const char *arg)
+{
+	fprintf(stderr, "ramreport: ");
+	fprintf(stderr, fmt, arg);
+	fprintf(stderr, "\n");
+	g_ui32Errors++;
+}
+
+static char *Dup(const char *s, size_t n)
+{
+	char *d = malloc(n + 1);
+
+	if( !d )
+	{
+		perror("malloc");
+		exit(1);
+	}
+	memcpy(d, s, n);
+	d[n] = 0;
+	return d;
+}
+
+static void Figure(const char *key, uint32_t value)
+{
+	if( g_ui32Figures == MAX_FIGURES )
+		return;
+	snprintf(g_psFigures[g_ui32Figures].key, NAME_LEN, "%.*s", NAME_LEN - 1, key);
+	g_psFigures[g_ui32Figures].value = value;
+	g_ui32Figures++;
+}
+
+/*
+ * Whitespace-separated tokens of a line, in place.
+ */
+static uint32_t Split(char *line, char **tok, uint32_t max)
+{
+	uint32_t n = 0;
+
+	while( n < max )
+	{
+		while( isspace((unsigned char) *line) )
+			line++;
+		if( !*line )
+			break;
+		tok[n++] = line;
+		while( *line && !isspace((unsigned char) *line) )
+			line++;
+		if( *line )
+			*line++ = 0;
+	}
+	return n;
+}
+
+static bool Hex(const char *s, uint32_t *v)
+{
+	char *end;
+
+	*v = strtoul(s, &end, 16);
+	return (end != s) && !*end;
+}
+
+/*
+ * ------------------------------------------------------------------------
+ * The map file
+ * ------------------------------------------------------------------------
+ */
+
+static int32_t RegionOf(uint32_t addr)
+{
+	uint32_t i;
+
+	for( i = 0; i < g_ui32Regions; i++ )
+		if( (addr >= g_psRegions[i].origin) && (addr - g_psRegions[i].origin < g_psRegions[i].length) )
+			return i;
+	return -1;
+}
+
+static bool ReadMap(const char *path)
+{
+	enum { NONE, MEMORY, SECTIONS } part = NONE;
+	char line[MAX_LINE];
+	char copy[MAX_LINE];
+	char *tok[8];
+	uint32_t n;
+	uint32_t origin;
+	uint32_t length;
+	uint32_t used;
+	char *desc;
+	FILE *f;
+
+	f = fopen(path, "r");
+	if( !f )
+	{
+		perror(path);
+		return false;
+	}
+
+	while( fgets(line, sizeof(line), f) )
+	{
+		line[strcspn(line, "\r\n")] = 0;
+		if( !strncmp(line, "MEMORY CONFIGURATION", 20) )
+		{
+			part = MEMORY;
+			continue;
+		}
+		if( !strncmp(line, "SECTION ALLOCATION MAP", 22) )
+		{
+			part = SECTIONS;
+			continue;
+		}
+		if( isupper((unsigned char) line[0]) )
+		{
+			part = NONE;
+			continue;
+		}
+		strcpy(copy, line);
+		n = Split(copy, tok, 8);
+
+		if( part == MEMORY )
+		{
+			// name origin length used unused attr
+			if( (n < 6) || !Hex(tok[1], &origin) || !Hex(tok[2], &length) || !Hex(tok[3], &used) ||
+					(g_ui32Regions == MAX_REGIONS) )
+				continue;
+			snprintf(g_psRegions[g_ui32Regions].name, NAME_LEN, "%s", tok[0]);
+			g_psRegions[g_ui32Regions].origin = origin;
+			g_psRegions[g_ui32Regions].length = length;
+			g_psRegions[g_ui32Regions].used = used;
+			g_psRegions[g_ui32Regions].writable = (strchr(tok[5], 'W') != NULL);
+			g_ui32Regions++;
+		}
+		else if( (part == SECTIONS) && (n >= 4) && !isspace((unsigned char) line[0]) )
+		{
+			// name page origin length [attributes]
+			if( !Hex(tok[2], &origin) || !Hex(tok[3], &length) || (g_ui32Sections == MAX_SECTIONS) )
+				continue;
+			snprintf(g_psSections[g_ui32Sections].name, NAME_LEN, "%s", tok[0]);
+			g_psSections[g_ui32Sections].origin = origin;
+			g_psSections[g_ui32Sections].length = length;
+			g_psSections[g_ui32Sections].region = RegionOf(origin);
+			g_ui32Sections++;
+		}
+		else if( (part == SECTIONS) && (n >= 3) && g_ui32Sections )
+		{
+			// origin length file (input section)
+			if( !Hex(tok[0], &origin) || !Hex(tok[1], &length) || (g_ui32Inputs == MAX_INPUTS) )
+				continue;
+			desc = line + (tok[1] - copy) + strlen(tok[1]);
+			while( isspace((unsigned char) *desc) )
+				desc++;
+			snprintf(g_psInputs[g_ui32Inputs].desc, sizeof(g_psInputs[0].desc), "%s", desc);
+			g_psInputs[g_ui32Inputs].length = length;
+			g_psInputs[g_ui32Inputs].section = g_ui32Sections - 1;
+			g_ui32Inputs++;
+		}
+	}
+	fclose(f);
+
+	if( !g_ui32Regions || !g_ui32Sections )
+	{
+		Error("%s: no memory configuration or section map", path);
+		return false;
+	}
+	return true;
+}
+
+static int CompareInputs(const void *a, const void *b)
+{
+	const Input_t *x = a;
+	const Input_t *y = b;
+
+	return (x->length < y->length) - (x->length > y->length);
+}
+
+static void ReportMap(uint32_t top)
+{
+	char key[NAME_LEN];
+	uint32_t r;
+	uint32_t s;
+	uint32_t i;
+	uint32_t shown;
+
+	qsort(g_psInputs, g_ui32Inputs, sizeof(g_psInputs[0]), CompareInputs);
+
+	for( r = 0; r < g_ui32Regions; r++ )
+	{
+		Region_t *reg = &g_psRegions[r];
+
+		printf("%-8s %08X  %6u of %6u bytes (%u%%), %u free\n", reg->name, reg->origin, reg->used,
+				reg->length, reg->length ? (reg->used * 100 + reg->length / 2) / reg->length : 0,
+				reg->length - reg->used);
+		Figure(reg->name, reg->used);
+		if( reg->used > reg->length )
+			Error("%s overflows", reg->name);
+		if( !reg->writable )
+			continue;
+
+		for( s = 0; s < g_ui32Sections; s++ )
+		{
+			if( g_psSections[s].region != (int32_t) r )
+				continue;
+			printf("  %-20s %6u\n", g_psSections[s].name, g_psSections[s].length);
+			snprintf(key, sizeof(key), "%.60s%.60s", reg->name, g_psSections[s].name);
+			Figure(key, g_psSections[s].length);
+			if( !strcmp(g_psSections[s].name, ".stack") && !g_ui32StackSize )
+				g_ui32StackSize = g_psSections[s].length;
+		}
+
+		printf("  largest:\n");
+		for( i = 0, shown = 0; (i < g_ui32Inputs) && (shown < top); i++ )
+		{
+			s = g_psInputs[i].section;
+			if( (g_psSections[s].region != (int32_t) r) || strstr(g_psInputs[i].desc, "--HOLE--") )
+				continue;
+			printf("    %6u  %-8s %s\n", g_psInputs[i].length, g_psSections[s].name, g_psInputs[i].desc);
+			shown++;
+		}
+	}
+}
+
+/*
+ * ------------------------------------------------------------------------
+ * The call graph
+ * ------------------------------------------------------------------------
+ */
+
+static int32_t FindTitle(const char *title)
+{
+	uint32_t i;
+
+	for( i = 0; i < g_ui32Funcs; i++ )
+		if( !strcmp(g_psFuncs[i].title, title) )
+			return i;
+	return -1;
+}
+
+static uint32_t Func(const char *title)
+{
+	int32_t i = FindTitle(title);
+	const char *base;
+	Func_t *fn;
+
+	if( i >= 0 )
+		return i;
+	if( g_ui32Funcs == MAX_FUNCS )
+	{
+		fprintf(stderr, "ramreport: more than %u functions\n", MAX_FUNCS);
+		exit(1);
+	}
+
+	fn = &g_psFuncs[g_ui32Funcs];
+	memset(fn, 0, sizeof(*fn));
+	fn->title = Dup(title, strlen(title));
+	base = strrchr(title, ':');
+	base = base ? base + 1 : title;
+	fn->base = Dup(base, strcspn(base, "."));
+	fn->bytes = -1;
+	fn->next = -1;
+	return g_ui32Funcs++;
+}
+
+static void Call(uint32_t from, uint32_t to)
+{
+	Func_t *fn = &g_psFuncs[from];
+	uint32_t i;
+
+	for( i = 0; i < fn->callees; i++ )
+		if( fn->callee[i] == to )
+			return;
+	if( fn->callees == fn->room )
+	{
+		fn->room = fn->room ? fn->room * 2 : 8;
+		fn->callee = realloc(fn->callee, fn->room * sizeof(fn->callee[0]));
+		if( !fn->callee )
+		{
+			perror("realloc");
+			exit(1);
+		}
+	}
+	fn->callee[fn->callees++] = to;
+}
+
+/*
+ * The quoted string after key in a .ci line, NUL-terminated in place.
+ */
+static char *Quoted(char *line, const char *key)
+{
+	char *p = strstr(line, key);
+	char *end;
+
+	if( !p )
+		return NULL;
+	p = strchr(p + strlen(key), '"');
+	if( !p )
+		return NULL;
+	end = strchr(++p, '"');
+	if( !end )
+		return NULL;
+	*end = 0;
+	return p;
+}
+
+static bool ReadCallGraph(const char *path)
+{
+	char line[MAX_LINE];
+	char qual[32];
+	char *title;
+	char *label;
+	char *target;
+	char *size;
+	uint32_t bytes;
+	uint32_t from;
+	FILE *f;
+
+	f = fopen(path, "r");
+	if( !f )
+	{
+		perror(path);
+		return false;
+	}
+
+	while( fgets(line, sizeof(line), f) )
+	{
+		if( !strncmp(line, "node:", 5) )
+		{
+			// label: "name\nfile:line:col\nN bytes (static)", the size only where defined.
+			label = strstr(line, "label:");
+			title = Quoted(line, "title:");
+			if( !title || !label || !strcmp(title, "__indirect_call") )
+				continue;
+			from = Func(title);
+			label = Quoted(label, "label:");
+			size = label ? strstr(label, "\\n") : NULL;
+			size = size ? strstr(size + 2, "\\n") : NULL;
+			if( size && (sscanf(size + 2, "%u bytes (%31[^)])", &bytes, qual) == 2) )
+			{
+				g_psFuncs[from].bytes = bytes;
+				g_psFuncs[from].unbounded = !strcmp(qual, "dynamic");
+			}
+		}
+		else if( !strncmp(line, "edge:", 5) )
+		{
+			target = strstr(line, "targetname:");
+			label = target ? strstr(target, "label:") : NULL;
+			title = Quoted(line, "sourcename:");
+			if( !title || !target )
+				continue;
+			from = Func(title);
+			target = Quoted(target, "targetname:");
+			if( !target )
+				continue;
+			if( !strcmp(target, "__indirect_call") )
+			{
+				g_psFuncs[from].indirect = true;
+				label = label ? Quoted(label, "label:") : NULL;
+				if( label && !g_psFuncs[from].indirectAt )
+					g_psFuncs[from].indirectAt = Dup(label, strlen(label));
+			}
+			else
+			{
+				Call(from, Func(target));
+			}
+		}
+	}
+	fclose(f);
+	return true;
+}
+
+/*
+ * Every function a spec name means: its own title, or static functions and
+ * clones of that name. Names nothing defines become functions of their own,
+ * with the default frame.
+ */
+static uint32_t Lookup(const char *name, uint32_t *out, uint32_t max)
+{
+	uint32_t n = 0;
+	uint32_t i;
+
+	for( i = 0; (i < g_ui32Funcs) && (n < max); i++ )
+		if( !strcmp(g_psFuncs[i].title, name) || !strcmp(g_psFuncs[i].base, name) )
+			out[n++] = i;
+	if( n == 0 )
+		out[n++] = Func(name);
+	return n;
+}
+
+static bool ReadSpec(const char *path)
+{
+	char line[MAX_LINE];
+	char *tok[64];
+	uint32_t from[16];
+	uint32_t to[16];
+	uint32_t nFrom;
+	uint32_t nTo;
+	uint32_t n;
+	uint32_t i;
+	uint32_t j;
+	uint32_t k;
+	uint32_t priority;
+	FILE *f;
+
+	f = fopen(path, "r");
+	if( !f )
+	{
+		perror(path);
+		return false;
+	}
+
+	while( fgets(line, sizeof(line), f) )
+	{
+		line[strcspn(line, "#")] = 0;
+		n = Split(line, tok, 64);
+		if( n == 0 )
+			continue;
+
+		if( !strcmp(tok[0], "stack") && (n == 2) )
+		{
+			g_ui32StackSize = strtoul(tok[1], NULL, 0);
+		}
+		else if( !strcmp(tok[0], "exception") && (n == 2) )
+		{
+			g_ui32ExceptionFrame = strtoul(tok[1], NULL, 0);
+		}
+		else if( !strcmp(tok[0], "default") && (n == 2) )
+		{
+			g_ui32DefaultFrame = strtoul(tok[1], NULL, 0);
+		}
+		else if( (!strcmp(tok[0], "thread") && (n >= 2)) || (!strcmp(tok[0], "isr") && (n >= 3)) )
+		{
+			priority = THREAD_PRIORITY;
+			i = 1;
+			if( tok[0][0] == 'i' )
+				priority = strtoul(tok[i++], NULL, 0);
+			for( ; (i < n) && (g_ui32Roots < MAX_ROOTS); i++ )
+			{
+				Lookup(tok[i], from, 1);
+				g_psRoots[g_ui32Roots].func = from[0];
+				g_psRoots[g_ui32Roots].priority = priority;
+				g_ui32Roots++;
+			}
+		}
+		else if( !strcmp(tok[0], "call") && (n >= 2) )
+		{
+			nFrom = Lookup(tok[1], from, 16);
+			for( j = 0; j < nFrom; j++ )
+				g_psFuncs[from[j]].resolved = true;
+			for( i = 2; i < n; i++ )
+			{
+				nTo = Lookup(tok[i], to, 16);
+				for( j = 0; j < nFrom; j++ )
+					for( k = 0; k < nTo; k++ )
+						Call(from[j], to[k]);
+			}
+		}
+		else if( !strcmp(tok[0], "cost") && (n == 3) )
+		{
+			nFrom = Lookup(tok[1], from, 16);
+			for( j = 0; j < nFrom; j++ )
+				if( g_psFuncs[from[j]].bytes < 0 )
+					g_psFuncs[from[j]].bytes = strtoul(tok[2], NULL, 0);
+		}
+		else
+		{
+			Error("%s: bad line", path);
+		}
+	}
+	fclose(f);
+	return true;
+}
+
+static uint32_t Frame(const Func_t *fn)
+{
+	return (fn->bytes >= 0) ? (uint32_t) fn->bytes : g_ui32DefaultFrame;
+}
+
+/*
+ * Deepest path from a function, in bytes, its own frame included.
+ */
+static uint32_t Depth(uint32_t f)
+{
+	Func_t *fn = &g_psFuncs[f];
+	uint32_t deepest = 0;
+	uint32_t d;
+	uint32_t i;
+
+	if( fn->state == 2 )
+		return fn->depth;
+	if( fn->state == 1 )
+	{
+		Error("recursion through %s", fn->base);
+		return 0;
+	}
+
+	fn->state = 1;
+	if( fn->unbounded )
+		Error("%s has a frame of unbounded size", fn->base);
+	if( fn->indirect && !fn->resolved )
+	{
+		fprintf(stderr, "ramreport: %s calls through a pointer at %s\n", fn->base,
+				fn->indirectAt ? fn->indirectAt : "?");
+		Error("add a 'call %s ...' line to the spec", fn->base);
+	}
+	for( i = 0; i < fn->callees; i++ )
+	{
+		d = Depth(fn->callee[i]);
+		if( d > deepest )
+		{
+			deepest = d;
+			fn->next = fn->callee[i];
+		}
+	}
+	fn->depth = Frame(fn) + deepest;
+	fn->state = 2;
+	return fn->depth;
+}
+
+static void PrintPath(uint32_t f)
+{
+	int32_t i = f;
+
+	printf("     ");
+	while( i >= 0 )
+	{
+		printf(" %s(%u)", g_psFuncs[i].base, Frame(&g_psFuncs[i]));
+		i = g_psFuncs[i].next;
+	}
+	printf("\n");
+}
+
+static void ReportStack(void)
+{
+	char key[NAME_LEN];
+	uint32_t priority;
+	uint32_t levelMax;
+	uint32_t thread = 0;
+	uint32_t total;
+	uint32_t levels = 0;
+	uint32_t r;
+	uint32_t d;
+
+	printf("stack, deepest path from each root:\n");
+
+	// thread mode first, then the levels from the lowest priority up.
+	total = 0;
+	for( priority = THREAD_PRIORITY + 1; priority-- > 0; )
+	{
+		levelMax = 0;
+		for( r = 0; r < g_ui32Roots; r++ )
+		{
+			if( g_psRoots[r].priority != priority )
+				continue;
+			d = Depth(g_psRoots[r].func);
+			if( priority == THREAD_PRIORITY )
+				printf("  thread %-26s %5u\n", g_psFuncs[g_psRoots[r].func].base, d);
+			else
+				printf("  0x%02X   %-26s %5u\n", priority, g_psFuncs[g_psRoots[r].func].base, d);
+			PrintPath(g_psRoots[r].func);
+			snprintf(key, sizeof(key), "stack:%.100s", g_psFuncs[g_psRoots[r].func].base);
+			Figure(key, d);
+			if( d > levelMax )
+				levelMax = d;
+		}
+		if( priority == THREAD_PRIORITY )
+		{
+			thread = levelMax;
+			total = levelMax;
+		}
+		else if( levelMax )
+		{
+			total += g_ui32ExceptionFrame + levelMax;
+			levels++;
+		}
+	}
+
+	printf("  worst case %u bytes: thread %u, and %u levels of interrupts at %u bytes of exception"
+			" frame each\n", total, thread, levels, g_ui32ExceptionFrame);
+	Figure("stack:worst", total);
+	if( g_ui32StackSize )
+	{
+		printf("  stack %u bytes, %d to spare\n", g_ui32StackSize, (int) (g_ui32StackSize - total));
+		if( total > g_ui32StackSize )
+			Error("%s", "the stack can overflow");
+	}
+}
+
+/*
+ * ------------------------------------------------------------------------
+ * The baseline
+ * ------------------------------------------------------------------------
+ */
+
+static bool WriteBaseline(const char *path)
+{
+	FILE *f;
+	uint32_t i;
+
+	f = fopen(path, "w");
+	if( !f )
+	{
+		perror(path);
+		return false;
+	}
+	fprintf(f, "# ramreport baseline: bytes per region, section and stack root\n");
+	for( i = 0; i < g_ui32Figures; i++ )
+		fprintf(f, "%s %u\n", g_psFigures[i].key, g_psFigures[i].value);
+	fclose(f);
+	return true;
+}
+
+static bool CompareBaseline(const char *path)
+{
+	static bool seen[MAX_FIGURES];
+	char line[MAX_LINE];
+	char *tok[4];
+	uint32_t old;
+	uint32_t i;
+	bool grew = false;
+	FILE *f;
+
+	f = fopen(path, "r");
+	if( !f )
+	{
+		perror(path);
+		return false;
+	}
+
+	printf("against %s:\n", path);
+	memset(seen, 0, sizeof(seen));
+	while( fgets(line, sizeof(line), f) )
+	{
+		line[strcspn(line, "#")] = 0;
+		if( Split(line, tok, 4) != 2 )
+			continue;
+		old = strtoul(tok[1], NULL, 0);
+		for( i = 0; i < g_ui32Figures; i++ )
+			if( !strcmp(g_psFigures[i].key, tok[0]) )
+				break;
+		if( i == g_ui32Figures )
+		{
+			printf("  %-40s %6u  gone\n", tok[0], old);
+			continue;
+		}
+		seen[i] = true;
+		if( g_psFigures[i].value != old )
+		{
+			printf("  %-40s %6u  -> %6u  %+d%s\n", tok[0], old, g_psFigures[i].value,
+					(int) (g_psFigures[i].value - old), (g_psFigures[i].value > old) ? "  GREW" : "");
+			grew |= (g_psFigures[i].value > old);
+		}
+	}
+	fclose(f);
+
+	// a section or root the baseline never had grew from nothing.
+	for( i = 0; i < g_ui32Figures; i++ )
+	{
+		if( seen[i] )
+			continue;
+		printf("  %-40s    new  -> %6u  GREW\n", g_psFigures[i].key, g_psFigures[i].value);
+		grew = true;
+	}
+
+	if( grew )
+		Error("%s", "grew past the baseline; rewrite it with -w if that is intended");
+	return true;
+}
+
+static void Usage(void)
+{
+	fprintf(stderr,
+			"usage: ramreport [-m map] [-s spec] [-b baseline [-w]] [-n top] [file.ci ...]\n"
+			"  -m  TI linker map file\n"
+			"  -s  stack spec: roots, priorities, indirect calls (default tools/ramstack.txt)\n"
+			"  -b  compare with this baseline\n"
+			"  -w  write the baseline instead\n"
+			"  -n  largest input sections to list per region (default 12)\n"
+			"  .ci files from GCC's -fcallgraph-info=su, for the stack analysis\n");
+	exit(2);
+}
+
+int main(int argc, char **argv)
+{
+	const char *map = NULL;
+	const char *spec = "tools/ramstack.txt";
+	const char *baseline = NULL;
+	uint32_t top = 12;
+	bool write = false;
+	int opt;
+	int i;
+
+	while( (opt = getopt(argc, argv, "m:s:b:wn:")) != -1 )
+	{
+		switch( opt )
+		{
+		case 'm':
+			map = optarg;
+			break;
+		case 's':
+			spec = optarg;
+			break;
+		case 'b':
+			baseline = optarg;
+			break;
+		case 'w':
+			write = true;
+			break;
+		case 'n':
+			top = strtoul(optarg, NULL, 0);
+			break;
+		default:
+			Usage();
+		}
+	}
+	if( (!map && (optind == argc)) || (write && !baseline) )
+		Usage();
+
+	if( map )
+	{
+		if( !ReadMap(map) )
+			return 1;
+		ReportMap(top);
+	}
+
+	if( optind < argc )
+	{
+		for( i = optind; i < argc; i++ )
+			if( !ReadCallGraph(argv[i]) )
+				return 1;
+		if( !ReadSpec(spec) )
+			return 1;
+		if( !g_ui32Roots )
+			Error("%s: no roots", spec);
+		ReportStack();
+	}
+
+	if( baseline )
+	{
+		if( write ? !WriteBaseline(baseline) : !CompareBaseline(baseline) )
+			return 1;
+	}
+
+	return g_ui32Errors ? 1 : 0;
+}
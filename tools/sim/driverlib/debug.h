@@ -0,0 +1,12 @@
+/*
+ * driverlib/debug.h, for host builds of the stack (see usbsim.h).
+ */
+
+#ifndef __DRIVERLIB_DEBUG_H__
+#define __DRIVERLIB_DEBUG_H__
+
+#include <assert.h>
+
+#define ASSERT(expr)	assert(expr)
+
+#endif // __DRIVERLIB_DEBUG_H__
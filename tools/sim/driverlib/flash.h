@@ -0,0 +1,13 @@
+/*
+ * driverlib/flash.h, for host builds of the stack (see usbsim.h).
+ */
+
+#ifndef __DRIVERLIB_FLASH_H__
+#define __DRIVERLIB_FLASH_H__
+
+#include <stdint.h>
+
+int32_t FlashErase(uint32_t ui32Address);
+int32_t FlashProgram(uint32_t *pui32Data, uint32_t ui32Address, uint32_t ui32Count);
+
+#endif // __DRIVERLIB_FLASH_H__
@@ -0,0 +1,9 @@
+/*
+ * driverlib/gpio.h, for host builds of the stack (see usbsim.h). The stack
+ * uses nothing from it.
+ */
+
+#ifndef __DRIVERLIB_GPIO_H__
+#define __DRIVERLIB_GPIO_H__
+
+#endif // __DRIVERLIB_GPIO_H__
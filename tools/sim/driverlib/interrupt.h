@@ -0,0 +1,19 @@
+/*
+ * driverlib/interrupt.h, for host builds of the stack (see usbsim.h).
+ * PRIMASK, BASEPRI and the priorities are kept by the simulator.
+ */
+
+#ifndef __DRIVERLIB_INTERRUPT_H__
+#define __DRIVERLIB_INTERRUPT_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+bool IntMasterEnable(void);
+bool IntMasterDisable(void);
+void IntPrioritySet(uint32_t ui32Interrupt, uint8_t ui8Priority);
+int32_t IntPriorityGet(uint32_t ui32Interrupt);
+void IntPriorityMaskSet(uint32_t ui32PriorityMask);
+uint32_t IntPriorityMaskGet(void);
+
+#endif // __DRIVERLIB_INTERRUPT_H__
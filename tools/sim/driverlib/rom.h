@@ -0,0 +1,9 @@
+/*
+ * driverlib/rom.h, for host builds of the stack (see usbsim.h). The stack
+ * uses nothing from it.
+ */
+
+#ifndef __DRIVERLIB_ROM_H__
+#define __DRIVERLIB_ROM_H__
+
+#endif // __DRIVERLIB_ROM_H__
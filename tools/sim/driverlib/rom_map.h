@@ -0,0 +1,25 @@
+/*
+ * driverlib/rom_map.h, for host builds of the stack (see usbsim.h).
+ * There is no ROM: every MAP_ call goes to the simulator.
+ */
+
+#ifndef __DRIVERLIB_ROM_MAP_H__
+#define __DRIVERLIB_ROM_MAP_H__
+
+#define MAP_IntMasterEnable				IntMasterEnable
+#define MAP_IntMasterDisable			IntMasterDisable
+#define MAP_IntPrioritySet				IntPrioritySet
+#define MAP_IntPriorityGet				IntPriorityGet
+#define MAP_IntPriorityMaskSet			IntPriorityMaskSet
+#define MAP_IntPriorityMaskGet			IntPriorityMaskGet
+#define MAP_SysCtlClockGet				SysCtlClockGet
+#define MAP_SysCtlDelay					SysCtlDelay
+#define MAP_SysCtlReset					SysCtlReset
+#define MAP_FlashErase					FlashErase
+#define MAP_FlashProgram				FlashProgram
+#define MAP_USBEndpointStatus			USBEndpointStatus
+#define MAP_USBDevEndpointStatusClear	USBDevEndpointStatusClear
+#define MAP_USBEndpointDataGet			USBEndpointDataGet
+#define MAP_USBDevEndpointDataAck		USBDevEndpointDataAck
+
+#endif // __DRIVERLIB_ROM_MAP_H__
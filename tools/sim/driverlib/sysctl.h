@@ -0,0 +1,14 @@
+/*
+ * driverlib/sysctl.h, for host builds of the stack (see usbsim.h).
+ */
+
+#ifndef __DRIVERLIB_SYSCTL_H__
+#define __DRIVERLIB_SYSCTL_H__
+
+#include <stdint.h>
+
+uint32_t SysCtlClockGet(void);
+void SysCtlDelay(uint32_t ui32Count);
+void SysCtlReset(void);
+
+#endif // __DRIVERLIB_SYSCTL_H__
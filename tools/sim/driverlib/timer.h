@@ -0,0 +1,9 @@
+/*
+ * driverlib/timer.h, for host builds of the stack (see usbsim.h). The stack
+ * uses nothing from it.
+ */
+
+#ifndef __DRIVERLIB_TIMER_H__
+#define __DRIVERLIB_TIMER_H__
+
+#endif // __DRIVERLIB_TIMER_H__
@@ -0,0 +1,9 @@
+/*
+ * driverlib/uart.h, for host builds of the stack (see usbsim.h). The stack
+ * uses nothing from it.
+ */
+
+#ifndef __DRIVERLIB_UART_H__
+#define __DRIVERLIB_UART_H__
+
+#endif // __DRIVERLIB_UART_H__
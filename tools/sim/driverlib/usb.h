@@ -0,0 +1,30 @@
+/*
+ * driverlib/usb.h, for host builds of the stack (see usbsim.h).
+ * Endpoint 1 and EP0 of the simulated controller.
+ */
+
+#ifndef __DRIVERLIB_USB_H__
+#define __DRIVERLIB_USB_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define USB_EP_0				0x00000000
+#define USB_EP_1				0x00000010
+
+#define USB_TRANS_IN			0x00000102
+
+#define USB_DEV_RX_PKT_RDY		0x00010000
+#define USB_DEV_TX_TXPKTRDY		0x00000001
+
+#define USB_INTEP_DEV_IN_1		0x00000002
+#define USB_INTEP_DEV_OUT_1		0x00020000
+
+uint32_t USBEndpointStatus(uint32_t ui32Base, uint32_t ui32Endpoint);
+void USBDevEndpointStatusClear(uint32_t ui32Base, uint32_t ui32Endpoint, uint32_t ui32Flags);
+int32_t USBEndpointDataGet(uint32_t ui32Base, uint32_t ui32Endpoint, uint8_t *pui8Data, uint32_t *pui32Size);
+void USBDevEndpointDataAck(uint32_t ui32Base, uint32_t ui32Endpoint, bool bIsLastPacket);
+int32_t USBEndpointDataPut(uint32_t ui32Base, uint32_t ui32Endpoint, uint8_t *pui8Data, uint32_t ui32Size);
+int32_t USBEndpointDataSend(uint32_t ui32Base, uint32_t ui32Endpoint, uint32_t ui32TransType);
+
+#endif // __DRIVERLIB_USB_H__
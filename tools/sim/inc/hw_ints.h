@@ -0,0 +1,14 @@
+/*
+ * inc/hw_ints.h, for host builds of the stack (see usbsim.h). Exception
+ * numbers as on the TM4C123.
+ */
+
+#ifndef __HW_INTS_H__
+#define __HW_INTS_H__
+
+#define FAULT_SYSTICK	15
+#define INT_USB0		60
+
+#define NUM_INTERRUPTS	155
+
+#endif // __HW_INTS_H__
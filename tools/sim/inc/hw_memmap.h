@@ -0,0 +1,10 @@
+/*
+ * inc/hw_memmap.h, for host builds of the stack (see usbsim.h).
+ */
+
+#ifndef __HW_MEMMAP_H__
+#define __HW_MEMMAP_H__
+
+#define USB0_BASE		0x40050000
+
+#endif // __HW_MEMMAP_H__
@@ -0,0 +1,12 @@
+/*
+ * inc/hw_nvic.h, for host builds of the stack (see usbsim.h). Only the
+ * registers the stack reads; the simulator answers them in UsbSim_Reg().
+ */
+
+#ifndef __HW_NVIC_H__
+#define __HW_NVIC_H__
+
+#define NVIC_INT_CTRL			0xE000ED04	// Interrupt Control and State
+#define NVIC_INT_CTRL_VEC_ACT_M	0x000000FF	// Active Exception Number
+
+#endif // __HW_NVIC_H__
@@ -0,0 +1,18 @@
+/*
+ * inc/hw_types.h, for host builds of the stack (see usbsim.h).
+ *
+ * Register accesses go to the simulator, which keeps the few core registers
+ * the stack reads: the DWT cycle counter and the active exception number.
+ */
+
+#ifndef __HW_TYPES_H__
+#define __HW_TYPES_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+volatile uint32_t *UsbSim_Reg(uint32_t ui32Addr);
+
+#define HWREG(x)	(*UsbSim_Reg(x))
+
+#endif // __HW_TYPES_H__
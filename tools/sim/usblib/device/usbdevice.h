@@ -0,0 +1,53 @@
+/*
+ * usblib/device/usbdevice.h, for host builds of the stack (see usbsim.h):
+ * the device callbacks and the EP0 calls the stack makes, answered by the
+ * simulator.
+ */
+
+#ifndef __USBDEVICE_H__
+#define __USBDEVICE_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "usblib/usblib.h"
+
+typedef void (*tStdRequest)(void *pvCBData, tUSBRequest *psRequest);
+typedef void (*tInfoCallback)(void *pvCBData, uint32_t ui32Info);
+typedef void (*tInterfaceCallback)(void *pvCBData, uint8_t ui8InterfaceNum, uint8_t ui8AlternateSetting);
+typedef void (*tUSBCallback)(void *pvCBData);
+typedef void (*tUSBEPIntHandler)(void *pvCBData, uint32_t ui32Status);
+typedef void (*tUSBDeviceHandler)(void *pvCBData, uint32_t ui32Request, void *pvRequestData);
+
+typedef struct
+{
+	tStdRequest pfnGetDescriptor;
+	tStdRequest pfnRequestHandler;
+	tInterfaceCallback pfnInterfaceChange;
+	tInfoCallback pfnConfigChange;
+	tInfoCallback pfnDataReceived;
+	tInfoCallback pfnDataSent;
+	tUSBCallback pfnResetHandler;
+	tUSBCallback pfnSuspendHandler;
+	tUSBCallback pfnResumeHandler;
+	tUSBCallback pfnDisconnectHandler;
+	tUSBEPIntHandler pfnEndpointHandler;
+	tUSBDeviceHandler pfnDeviceHandler;
+} tCustomHandlers;
+
+typedef struct
+{
+	const tCustomHandlers *psCallbacks;
+	const uint8_t *pui8DeviceDescriptor;
+	const tConfigHeader * const *ppsConfigDescriptors;
+	const uint8_t * const *ppui8StringDescriptors;
+	uint32_t ui32NumStringDescriptors;
+} tDeviceInfo;
+
+void USBDCDInit(uint32_t ui32Index, tDeviceInfo *psDevice, void *pvDCDCBData);
+void USBDCDStallEP0(uint32_t ui32Index);
+void USBDCDSendDataEP0(uint32_t ui32Index, uint8_t *pui8Data, uint32_t ui32Size);
+void USBDCDRequestDataEP0(uint32_t ui32Index, uint8_t *pui8Data, uint32_t ui32Size);
+bool USBDCDRemoteWakeupRequest(uint32_t ui32Index);
+
+#endif // __USBDEVICE_H__
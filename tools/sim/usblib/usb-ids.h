@@ -0,0 +1,11 @@
+/*
+ * usblib/usb-ids.h, for host builds of the stack (see usbsim.h).
+ */
+
+#ifndef __USBIDS_H__
+#define __USBIDS_H__
+
+#define USB_VID_TI_1CBE		0x1cbe
+#define USB_PID_BULK		0x0003
+
+#endif // __USBIDS_H__
@@ -0,0 +1,11 @@
+/*
+ * usblib/usbaudio.h, for host builds of the stack (see usbsim.h).
+ */
+
+#ifndef __USBAUDIO_H__
+#define __USBAUDIO_H__
+
+#define USB_ASC_AUDIO_CONTROL		0x01
+#define USB_ASC_MIDI_STREAMING		0x03
+
+#endif // __USBAUDIO_H__
@@ -0,0 +1,78 @@
+/*
+ * usblib/usblib.h, for host builds of the stack (see usbsim.h): the
+ * descriptor and request definitions the stack uses, as in usblib.
+ */
+
+#ifndef __USBLIB_H__
+#define __USBLIB_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define USBShort(ui16Value)			((ui16Value) & 0xff), ((ui16Value) >> 8)
+
+#define MAX_PACKET_SIZE_EP0			64
+
+#define USB_DTYPE_DEVICE			1
+#define USB_DTYPE_CONFIGURATION		2
+#define USB_DTYPE_STRING			3
+#define USB_DTYPE_INTERFACE			4
+#define USB_DTYPE_ENDPOINT			5
+#define USB_DTYPE_INTERFACE_ASC		11
+#define USB_DTYPE_CS_INTERFACE		36
+
+#define USB_CONF_ATTR_SELF_PWR		0xC0
+#define USB_CONF_ATTR_BUS_PWR		0x80
+#define USB_CONF_ATTR_RWAKE			0xA0
+
+#define USB_CLASS_AUDIO				0x01
+#define USB_SUBCLASS_UNDEFINED		0x00
+#define USB_PROTOCOL_UNDEFINED		0x00
+
+#define USB_EP_DESC_OUT				0x00
+#define USB_EP_DESC_IN				0x80
+#define USB_EP_ATTR_BULK			0x02
+
+#define USB_LANG_EN_US				0x0409
+
+#define USB_RTYPE_DIR_IN			0x80
+#define USB_RTYPE_DIR_OUT			0x00
+#define USB_RTYPE_DIR_M				0x80
+#define USB_RTYPE_TYPE_M			0x60
+#define USB_RTYPE_STANDARD			0x00
+#define USB_RTYPE_CLASS				0x20
+#define USB_RTYPE_VENDOR			0x40
+#define USB_RTYPE_RECIPIENT_M		0x1f
+#define USB_RTYPE_DEVICE			0x00
+#define USB_RTYPE_INTERFACE			0x01
+#define USB_RTYPE_ENDPOINT			0x02
+
+#define USBREQ_GET_DESCRIPTOR		0x06
+
+typedef struct
+{
+	uint8_t bmRequestType;
+	uint8_t bRequest;
+	uint16_t wValue;
+	uint16_t wIndex;
+	uint16_t wLength;
+} tUSBRequest;
+
+typedef struct
+{
+	uint16_t ui16Size;
+	const uint8_t *pui8Data;
+} tConfigSection;
+
+typedef struct
+{
+	uint8_t ui8NumSections;
+	const tConfigSection * const *psSections;
+} tConfigHeader;
+
+typedef enum
+{
+	eUSBModeForceDevice = 3
+} tUSBMode;
+
+#endif // __USBLIB_H__
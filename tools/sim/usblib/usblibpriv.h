@@ -0,0 +1,9 @@
+/*
+ * usblib/usblibpriv.h, for host builds of the stack (see usbsim.h). The
+ * stack uses nothing from it.
+ */
+
+#ifndef __USBLIBPRIV_H__
+#define __USBLIBPRIV_H__
+
+#endif // __USBLIBPRIV_H__
@@ -0,0 +1,701 @@
+/*
+ * usbsim.c
+ *
+ * The host model of the USB controller and core registers; see usbsim.h.
+ *
+ *  Created on: Oct 18, 2026
+ *
+ * MODS:
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include "inc/hw_types.h"
+#include "inc/hw_ints.h"
+#include "driverlib/flash.h"
+#include "driverlib/interrupt.h"
+#include "driverlib/sysctl.h"
+#include "driverlib/usb.h"
+#include "usblib/usblib.h"
+#include "usblib/device/usbdevice.h"
+
+#include "usbsim.h"
+
+#define SIM_CPU_HZ			80000000UL
+#define SIM_PACKET_SIZE		64
+#define SIM_DWT_CYCCNT		0xE0001004
+#define SIM_NVIC_INT_CTRL	0xE000ED04
+#define SIM_FLASH_BASE		0x00020000	// the top half of the 256 KB flash
+#define SIM_FLASH_SIZE		0x00020000
+#define SIM_FLASH_PAGE		1024
+
+/*
+ * EP0 as the stack leaves it after a request.
+ */
+typedef enum
+{
+	eEP0Idle,
+	eEP0Stalled,
+	eEP0Acked,			// no data stage
+	eEP0Sent,			// IN data stage loaded
+	eEP0Requested		// OUT data stage asked for
+} tEP0State;
+
+/*
+ * The model.
+ */
+static struct
+{
+	// core
+	uint32_t ui32Cycles;
+	tUsbSimClock pfnClock;
+	uint32_t ui32Active;				// VECTACTIVE
+	uint32_t ui32BasePri;
+	bool bPriMask;
+	uint8_t pui8Priority[NUM_INTERRUPTS];
+	uint32_t ui32Scratch;
+	uint32_t ui32Reg;
+	bool bResetCalled;
+
+	// flash, mapped at its own addresses
+	uint8_t *pui8Flash;
+
+	// usblib
+	tDeviceInfo *psDevice;
+	void *pvCBData;
+	bool bRemoteWake;
+
+	// endpoint 1
+	uint8_t pui8Rx[SIM_PACKET_SIZE];
+	uint32_t ui32RxSize;
+	bool bRxReady;
+	bool bRxAcked;
+	uint8_t pui8Tx[SIM_PACKET_SIZE];
+	uint32_t ui32TxSize;
+	bool bTxReady;
+
+	// EP0
+	tEP0State iEP0State;
+	bool bEP0Acked;
+	const uint8_t *pui8EP0Data;
+	uint8_t *pui8EP0Buf;
+	uint32_t ui32EP0Size;
+} g_sSim;
+
+static void Fail(const char *pcWhat)
+{
+	fprintf(stderr, "usbsim: %s\n", pcWhat);
+	abort();
+}
+
+/*
+ * Core registers.
+ */
+volatile uint32_t *UsbSim_Reg(uint32_t ui32Addr)
+{
+	switch( ui32Addr )
+	{
+		case SIM_DWT_CYCCNT:
+			g_sSim.ui32Reg = g_sSim.pfnClock ? g_sSim.pfnClock() : g_sSim.ui32Cycles;
+			return &g_sSim.ui32Reg;
+
+		case SIM_NVIC_INT_CTRL:
+			g_sSim.ui32Reg = g_sSim.ui32Active;
+			return &g_sSim.ui32Reg;
+
+		default:
+			// enable bits and the like, which nothing reads back.
+			return &g_sSim.ui32Scratch;
+	}
+}
+
+void UsbSim_ClockSet(tUsbSimClock pfnClock)
+{
+	g_sSim.pfnClock = pfnClock;
+}
+
+uint32_t UsbSim_HostCycles(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+	return (uint32_t) __rdtsc();
+#else
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint32_t) (ts.tv_sec * 1000000000ULL + ts.tv_nsec);
+#endif
+}
+
+void UsbSim_Advance(uint32_t ui32Cycles)
+{
+	g_sSim.ui32Cycles += ui32Cycles;
+}
+
+bool IntMasterEnable(void)
+{
+	bool bWas = g_sSim.bPriMask;
+
+	g_sSim.bPriMask = false;
+	return bWas;
+}
+
+bool IntMasterDisable(void)
+{
+	bool bWas = g_sSim.bPriMask;
+
+	g_sSim.bPriMask = true;
+	return bWas;
+}
+
+void IntPrioritySet(uint32_t ui32Interrupt, uint8_t ui8Priority)
+{
+	if( ui32Interrupt >= NUM_INTERRUPTS )
+		Fail("IntPrioritySet: no such interrupt");
+	g_sSim.pui8Priority[ui32Interrupt] = ui8Priority & 0xE0;
+}
+
+int32_t IntPriorityGet(uint32_t ui32Interrupt)
+{
+	if( ui32Interrupt >= NUM_INTERRUPTS )
+		return -1;
+	return g_sSim.pui8Priority[ui32Interrupt];
+}
+
+void IntPriorityMaskSet(uint32_t ui32PriorityMask)
+{
+	g_sSim.ui32BasePri = ui32PriorityMask & 0xE0;
+}
+
+uint32_t IntPriorityMaskGet(void)
+{
+	return g_sSim.ui32BasePri;
+}
+
+uint32_t SysCtlClockGet(void)
+{
+	return SIM_CPU_HZ;
+}
+
+void SysCtlDelay(uint32_t ui32Count)
+{
+	// three cycles a loop.
+	g_sSim.ui32Cycles += 3 * ui32Count;
+}
+
+void SysCtlReset(void)
+{
+	g_sSim.bResetCalled = true;
+}
+
+bool UsbSim_ResetCalled(void)
+{
+	bool bWas = g_sSim.bResetCalled;
+
+	g_sSim.bResetCalled = false;
+	return bWas;
+}
+
+/*
+ * Take interrupt ui32Interrupt, from the main loop.
+ */
+static bool Enter(uint32_t ui32Interrupt)
+{
+	uint32_t ui32Priority = g_sSim.pui8Priority[ui32Interrupt];
+
+	if( g_sSim.ui32Active )
+		Fail("interrupt delivered from an interrupt");
+	if( g_sSim.bPriMask )
+		Fail("interrupt delivered with PRIMASK set: a critical section was left open");
+	if( g_sSim.ui32BasePri && (ui32Priority >= g_sSim.ui32BasePri) )
+		Fail("interrupt delivered with BASEPRI holding it off: a critical section was left open");
+	g_sSim.ui32Active = ui32Interrupt;
+	return true;
+}
+
+static void Leave(void)
+{
+	if( g_sSim.bPriMask || g_sSim.ui32BasePri )
+		Fail("interrupt handler returned with interrupts masked");
+	g_sSim.ui32Active = 0;
+}
+
+void UsbSim_Interrupt(uint32_t ui32Interrupt, void (*pfnHandler)(void))
+{
+	if( ui32Interrupt >= NUM_INTERRUPTS )
+		Fail("UsbSim_Interrupt: no such interrupt");
+	Enter(ui32Interrupt);
+	pfnHandler();
+	Leave();
+}
+
+/*
+ * The stack's callbacks, from the USB interrupt.
+ */
+static const tCustomHandlers *Handlers(void)
+{
+	if( g_sSim.psDevice == 0 )
+		Fail("USBMIDI_Init() has not run");
+	return g_sSim.psDevice->psCallbacks;
+}
+
+static void Callback(void (*pfnHandler)(void *))
+{
+	if( pfnHandler )
+	{
+		Enter(INT_USB0);
+		pfnHandler(g_sSim.pvCBData);
+		Leave();
+	}
+}
+
+/*
+ * The controller starts afresh, detached, with nothing in its endpoints.
+ */
+void USBDCDInit(uint32_t ui32Index, tDeviceInfo *psDevice, void *pvDCDCBData)
+{
+	(void) ui32Index;
+	g_sSim.bRxReady = false;
+	g_sSim.ui32TxSize = 0;
+	g_sSim.bTxReady = false;
+	g_sSim.bRemoteWake = false;
+	g_sSim.iEP0State = eEP0Idle;
+	g_sSim.psDevice = psDevice;
+	g_sSim.pvCBData = pvDCDCBData;
+}
+
+bool USBDCDRemoteWakeupRequest(uint32_t ui32Index)
+{
+	(void) ui32Index;
+	return g_sSim.bRemoteWake;
+}
+
+void UsbSim_RemoteWakeEnable(bool bEnable)
+{
+	g_sSim.bRemoteWake = bEnable;
+}
+
+/*
+ * usblib sets the endpoints up again on these, losing whatever was in them.
+ */
+static void EndpointsReset(void)
+{
+	g_sSim.bRxReady = false;
+	g_sSim.ui32TxSize = 0;
+	g_sSim.bTxReady = false;
+}
+
+void UsbSim_Reset(void)
+{
+	EndpointsReset();
+	Callback(Handlers()->pfnResetHandler);
+}
+
+void UsbSim_Configure(void)
+{
+	const tCustomHandlers *psHandlers = Handlers();
+
+	UsbSim_Reset();
+	if( psHandlers->pfnConfigChange )
+	{
+		Enter(INT_USB0);
+		psHandlers->pfnConfigChange(g_sSim.pvCBData, 1);
+		Leave();
+	}
+}
+
+void UsbSim_SetInterface(uint8_t ui8Interface, uint8_t ui8AltSetting)
+{
+	const tCustomHandlers *psHandlers = Handlers();
+
+	EndpointsReset();
+	if( psHandlers->pfnInterfaceChange )
+	{
+		Enter(INT_USB0);
+		psHandlers->pfnInterfaceChange(g_sSim.pvCBData, ui8Interface, ui8AltSetting);
+		Leave();
+	}
+}
+
+void UsbSim_Suspend(void)
+{
+	Callback(Handlers()->pfnSuspendHandler);
+}
+
+void UsbSim_Resume(void)
+{
+	Callback(Handlers()->pfnResumeHandler);
+}
+
+void UsbSim_Disconnect(void)
+{
+	EndpointsReset();
+	Callback(Handlers()->pfnDisconnectHandler);
+}
+
+/*
+ * Endpoint 1.
+ */
+uint32_t USBEndpointStatus(uint32_t ui32Base, uint32_t ui32Endpoint)
+{
+	(void) ui32Base;
+	if( ui32Endpoint != USB_EP_1 )
+		return 0;
+	return (g_sSim.bRxReady ? USB_DEV_RX_PKT_RDY : 0) | (g_sSim.bTxReady ? USB_DEV_TX_TXPKTRDY : 0);
+}
+
+void USBDevEndpointStatusClear(uint32_t ui32Base, uint32_t ui32Endpoint, uint32_t ui32Flags)
+{
+	// the error and stall flags; the model raises none.
+	(void) ui32Base;
+	(void) ui32Endpoint;
+	(void) ui32Flags;
+}
+
+int32_t USBEndpointDataGet(uint32_t ui32Base, uint32_t ui32Endpoint, uint8_t *pui8Data, uint32_t *pui32Size)
+{
+	(void) ui32Base;
+	if( (ui32Endpoint != USB_EP_1) || !g_sSim.bRxReady )
+	{
+		*pui32Size = 0;
+		return -1;
+	}
+	if( *pui32Size > g_sSim.ui32RxSize )
+		*pui32Size = g_sSim.ui32RxSize;
+	memcpy(pui8Data, g_sSim.pui8Rx, *pui32Size);
+	return 0;
+}
+
+void USBDevEndpointDataAck(uint32_t ui32Base, uint32_t ui32Endpoint, bool bIsLastPacket)
+{
+	(void) ui32Base;
+	if( ui32Endpoint == USB_EP_1 )
+	{
+		if( !g_sSim.bRxReady )
+			Fail("OUT packet acknowledged twice");
+		g_sSim.bRxReady = false;
+		g_sSim.bRxAcked = true;
+	}
+	else if( ui32Endpoint == USB_EP_0 )
+	{
+		if( g_sSim.bEP0Acked )
+			Fail("EP0 setup packet acknowledged twice");
+		g_sSim.bEP0Acked = true;
+		if( bIsLastPacket )
+			g_sSim.iEP0State = eEP0Acked;
+	}
+}
+
+int32_t USBEndpointDataPut(uint32_t ui32Base, uint32_t ui32Endpoint, uint8_t *pui8Data, uint32_t ui32Size)
+{
+	(void) ui32Base;
+	if( ui32Endpoint != USB_EP_1 )
+		Fail("data put into an endpoint the stack does not have");
+	if( g_sSim.bTxReady )
+		Fail("IN packet loaded over one the host has not collected");
+	if( g_sSim.ui32TxSize + ui32Size > SIM_PACKET_SIZE )
+		Fail("IN packet larger than the endpoint");
+	memcpy(&g_sSim.pui8Tx[g_sSim.ui32TxSize], pui8Data, ui32Size);
+	g_sSim.ui32TxSize += ui32Size;
+	return 0;
+}
+
+int32_t USBEndpointDataSend(uint32_t ui32Base, uint32_t ui32Endpoint, uint32_t ui32TransType)
+{
+	(void) ui32Base;
+	if( (ui32Endpoint != USB_EP_1) || (ui32TransType != USB_TRANS_IN) )
+		Fail("send on an endpoint the stack does not have");
+	if( g_sSim.bTxReady )
+		Fail("IN packet sent twice");
+	g_sSim.bTxReady = true;
+	return 0;
+}
+
+bool UsbSim_Out(const uint8_t *pui8Data, uint32_t ui32Size)
+{
+	const tCustomHandlers *psHandlers = Handlers();
+
+	if( ui32Size > SIM_PACKET_SIZE )
+		Fail("OUT packet larger than the endpoint");
+
+	memcpy(g_sSim.pui8Rx, pui8Data, ui32Size);
+	g_sSim.ui32RxSize = ui32Size;
+	g_sSim.bRxReady = true;
+	g_sSim.bRxAcked = false;
+
+	Enter(INT_USB0);
+	psHandlers->pfnEndpointHandler(g_sSim.pvCBData, USB_INTEP_DEV_OUT_1);
+	Leave();
+
+	// a packet left unacknowledged holds the endpoint; the next one replaces it.
+	g_sSim.bRxReady = false;
+	return g_sSim.bRxAcked;
+}
+
+bool UsbSim_InPending(void)
+{
+	return g_sSim.bTxReady;
+}
+
+uint32_t UsbSim_In(uint8_t *pui8Buf)
+{
+	const tCustomHandlers *psHandlers = Handlers();
+	uint32_t ui32Size;
+
+	if( !g_sSim.bTxReady )
+		return 0;
+
+	ui32Size = g_sSim.ui32TxSize;
+	memcpy(pui8Buf, g_sSim.pui8Tx, ui32Size);
+	g_sSim.ui32TxSize = 0;
+	g_sSim.bTxReady = false;
+
+	Enter(INT_USB0);
+	psHandlers->pfnEndpointHandler(g_sSim.pvCBData, USB_INTEP_DEV_IN_1);
+	Leave();
+	return ui32Size;
+}
+
+/*
+ * EP0.
+ */
+void USBDCDStallEP0(uint32_t ui32Index)
+{
+	(void) ui32Index;
+	if( g_sSim.iEP0State != eEP0Idle )
+		Fail("EP0 stalled after it was answered");
+	g_sSim.iEP0State = eEP0Stalled;
+}
+
+void USBDCDSendDataEP0(uint32_t ui32Index, uint8_t *pui8Data, uint32_t ui32Size)
+{
+	(void) ui32Index;
+	if( g_sSim.iEP0State != eEP0Idle )
+		Fail("EP0 answered twice");
+	g_sSim.iEP0State = eEP0Sent;
+	g_sSim.pui8EP0Data = pui8Data;
+	g_sSim.ui32EP0Size = ui32Size;
+}
+
+void USBDCDRequestDataEP0(uint32_t ui32Index, uint8_t *pui8Data, uint32_t ui32Size)
+{
+	(void) ui32Index;
+	if( g_sSim.iEP0State != eEP0Idle )
+		Fail("EP0 answered twice");
+	g_sSim.iEP0State = eEP0Requested;
+	g_sSim.pui8EP0Buf = pui8Data;
+	g_sSim.ui32EP0Size = ui32Size;
+}
+
+/*
+ * The standard descriptors, which usblib serves from the tDeviceInfo.
+ */
+static bool StandardDescriptor(const tUSBRequest *psRequest, uint8_t *pui8Data, uint32_t *pui32Size)
+{
+	const tConfigHeader *psConfig;
+	const uint8_t *pui8Desc;
+	uint32_t ui32Size = 0;
+	uint32_t ui32Index = psRequest->wValue & 0xFF;
+	uint32_t i;
+
+	switch( psRequest->wValue >> 8 )
+	{
+		case USB_DTYPE_DEVICE:
+			pui8Desc = g_sSim.psDevice->pui8DeviceDescriptor;
+			ui32Size = pui8Desc[0];
+			break;
+
+		case USB_DTYPE_CONFIGURATION:
+			if( ui32Index != 0 )
+				return false;
+			psConfig = g_sSim.psDevice->ppsConfigDescriptors[0];
+			for( i = 0; i < psConfig->ui8NumSections; i++ )
+			{
+				if( ui32Size + psConfig->psSections[i]->ui16Size <= psRequest->wLength )
+					memcpy(&pui8Data[ui32Size], psConfig->psSections[i]->pui8Data,
+							psConfig->psSections[i]->ui16Size);
+				else if( ui32Size < psRequest->wLength )
+					memcpy(&pui8Data[ui32Size], psConfig->psSections[i]->pui8Data,
+							psRequest->wLength - ui32Size);
+				ui32Size += psConfig->psSections[i]->ui16Size;
+			}
+			*pui32Size = (ui32Size < psRequest->wLength) ? ui32Size : psRequest->wLength;
+			return true;
+
+		case USB_DTYPE_STRING:
+			if( ui32Index >= g_sSim.psDevice->ui32NumStringDescriptors )
+				return false;
+			pui8Desc = g_sSim.psDevice->ppui8StringDescriptors[ui32Index];
+			ui32Size = pui8Desc[0];
+			break;
+
+		default:
+			return false;
+	}
+
+	if( ui32Size > psRequest->wLength )
+		ui32Size = psRequest->wLength;
+	memcpy(pui8Data, pui8Desc, ui32Size);
+	*pui32Size = ui32Size;
+	return true;
+}
+
+bool UsbSim_Request(const tUSBRequest *psRequest, uint8_t *pui8Data, uint32_t *pui32Size)
+{
+	const tCustomHandlers *psHandlers = Handlers();
+	tUSBRequest sRequest = *psRequest;
+	bool bIn = (psRequest->bmRequestType & USB_RTYPE_DIR_M) == USB_RTYPE_DIR_IN;
+	bool bDescriptor;
+	bool bResult;
+
+	*pui32Size = 0;
+	bDescriptor = ((psRequest->bmRequestType & USB_RTYPE_TYPE_M) == USB_RTYPE_STANDARD) &&
+			(psRequest->bRequest == USBREQ_GET_DESCRIPTOR) && bIn;
+	if( bDescriptor && StandardDescriptor(psRequest, pui8Data, pui32Size) )
+		return true;
+	if( ((psRequest->bmRequestType & USB_RTYPE_TYPE_M) == USB_RTYPE_STANDARD) && !bDescriptor )
+		return false;
+
+	g_sSim.iEP0State = eEP0Idle;
+	g_sSim.bEP0Acked = false;
+
+	Enter(INT_USB0);
+	if( bDescriptor )
+	{
+		// usblib ACKs the setup packet before it asks for other descriptors.
+		g_sSim.bEP0Acked = true;
+		if( psHandlers->pfnGetDescriptor )
+			psHandlers->pfnGetDescriptor(g_sSim.pvCBData, &sRequest);
+		else
+			USBDCDStallEP0(0);
+	}
+	else if( psHandlers->pfnRequestHandler )
+	{
+		psHandlers->pfnRequestHandler(g_sSim.pvCBData, &sRequest);
+	}
+	else
+	{
+		USBDCDStallEP0(0);
+	}
+	Leave();
+
+	switch( g_sSim.iEP0State )
+	{
+		case eEP0Stalled:
+			bResult = false;
+			break;
+
+		case eEP0Acked:
+			if( psRequest->wLength && bIn )
+				Fail("IN request answered with no data stage");
+			bResult = true;
+			break;
+
+		case eEP0Sent:
+			if( !bIn || !g_sSim.bEP0Acked )
+				Fail("EP0 data sent without the setup packet acknowledged, or for an OUT request");
+			if( g_sSim.ui32EP0Size > psRequest->wLength )
+				Fail("EP0 reply longer than the host asked for");
+			memcpy(pui8Data, g_sSim.pui8EP0Data, g_sSim.ui32EP0Size);
+			*pui32Size = g_sSim.ui32EP0Size;
+			bResult = true;
+			break;
+
+		case eEP0Requested:
+			if( bIn || !g_sSim.bEP0Acked )
+				Fail("EP0 data requested without the setup packet acknowledged, or for an IN request");
+			if( g_sSim.ui32EP0Size != psRequest->wLength )
+				Fail("EP0 data stage of the wrong length requested");
+			memcpy(g_sSim.pui8EP0Buf, pui8Data, g_sSim.ui32EP0Size);
+			if( psHandlers->pfnDataReceived )
+			{
+				Enter(INT_USB0);
+				psHandlers->pfnDataReceived(g_sSim.pvCBData, g_sSim.ui32EP0Size);
+				Leave();
+			}
+			bResult = true;
+			break;
+
+		default:
+			Fail("EP0 request neither answered nor stalled");
+			return false;
+	}
+	return bResult;
+}
+
+/*
+ * Flash. Only the top half is modelled, at its own addresses, so code that
+ * reads flash through a pointer reads the model. The bottom half holds the
+ * program that is running, which must not write there.
+ */
+bool UsbSim_FlashInit(void)
+{
+	void *pvMap;
+	int fd;
+
+	if( g_sSim.pui8Flash == 0 )
+	{
+		fd = open("/dev/zero", O_RDWR);
+		if( fd < 0 )
+			return false;
+		pvMap = mmap((void *) SIM_FLASH_BASE, SIM_FLASH_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+		close(fd);
+		if( pvMap == MAP_FAILED )
+			return false;
+		if( pvMap != (void *) SIM_FLASH_BASE )
+		{
+			munmap(pvMap, SIM_FLASH_SIZE);
+			return false;
+		}
+		g_sSim.pui8Flash = pvMap;
+	}
+	memset(g_sSim.pui8Flash, 0xFF, SIM_FLASH_SIZE);
+	return true;
+}
+
+static void FlashCheck(uint32_t ui32Address, uint32_t ui32Count)
+{
+	if( g_sSim.pui8Flash == 0 )
+		Fail("flash used before UsbSim_FlashInit()");
+	if( (ui32Address < SIM_FLASH_BASE) || (ui32Address - SIM_FLASH_BASE + ui32Count > SIM_FLASH_SIZE) )
+		Fail("flash write outside the top half: over the running program");
+}
+
+int32_t FlashErase(uint32_t ui32Address)
+{
+	FlashCheck(ui32Address, SIM_FLASH_PAGE);
+	if( ui32Address & (SIM_FLASH_PAGE - 1) )
+		Fail("FlashErase: not a page address");
+	memset(&g_sSim.pui8Flash[ui32Address - SIM_FLASH_BASE], 0xFF, SIM_FLASH_PAGE);
+	return 0;
+}
+
+int32_t FlashProgram(uint32_t *pui32Data, uint32_t ui32Address, uint32_t ui32Count)
+{
+	uint32_t *pui32Word;
+	uint32_t i;
+
+	FlashCheck(ui32Address, ui32Count);
+	if( (ui32Address & 3) || (ui32Count & 3) )
+		Fail("FlashProgram: not whole words");
+	pui32Word = (uint32_t *) &g_sSim.pui8Flash[ui32Address - SIM_FLASH_BASE];
+	for( i = 0; i < ui32Count / 4; i++ )
+	{
+		if( pui32Word[i] != 0xFFFFFFFF )
+			Fail("FlashProgram: word programmed twice between erases");
+		pui32Word[i] = pui32Data[i];
+	}
+	return 0;
+}
@@ -0,0 +1,130 @@
+/*
+ * usbsim.h
+ *
+ * A host model of what the USB MIDI stack sees of the board, so the stack in
+ * include/usb_midi/ can be built and driven on the host as it is: the USB
+ * controller's endpoint 1 and EP0 as usblib presents them, and the core
+ * registers the stack reads, the DWT cycle counter, BASEPRI, PRIMASK, the
+ * interrupt priorities and the active exception number. For the firmware
+ * updater there is also the top half of flash and SysCtlReset().
+ *
+ * The headers under tools/sim/ stand in for TivaWare's, so put this directory
+ * first on the include path and build the stack's sources with it:
+ *
+ *		cc -Itools/sim -Iinclude/midi -Iinclude/usb_midi tool.c \
+ *			tools/sim/usbsim.c include/usb_midi/usb*.c
+ *
+ * A tool calls USBMIDI_Init(0), then plays the host with the calls below. Bus
+ * events and packets run the stack's handlers as the USB interrupt would, at
+ * the priority USBMIDI_Init() gave INT_USB0, and everything else the tool
+ * calls runs as the main loop. The model aborts on anything the hardware
+ * would not take or the stack must not do:
+ * - more than a packet loaded into an endpoint, or a packet loaded over one
+ *   the host has not collected;
+ * - an interrupt delivered while BASEPRI or PRIMASK holds it off, which from
+ *   the main loop means a critical section was left open;
+ * - an EP0 request the stack neither answered nor stalled;
+ * - flash written below 0x20000, or a word programmed twice between erases.
+ *
+ * Timestamps count a virtual cycle counter, which only moves on
+ * UsbSim_Advance(), so runs repeat exactly. UsbSim_ClockSet() puts a real
+ * clock behind it instead, for timing the stack on the host.
+ *
+ *  Created on: Oct 18, 2026
+ *
+ * MODS:
+ */
+
+#ifndef TOOLS_SIM_USBSIM_H_
+#define TOOLS_SIM_USBSIM_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "usblib/usblib.h"
+
+/**
+ * A source for the DWT cycle counter.
+ */
+typedef uint32_t (*tUsbSimClock)(void);
+
+/**
+ * Put pfnClock behind the cycle counter, or the virtual counter back with 0.
+ */
+void UsbSim_ClockSet(tUsbSimClock pfnClock);
+
+/**
+ * The host's own cycle counter, for UsbSim_ClockSet(): the time stamp counter
+ * on x86, nanoseconds elsewhere.
+ */
+uint32_t UsbSim_HostCycles(void);
+
+/**
+ * Move the virtual cycle counter on.
+ */
+void UsbSim_Advance(uint32_t ui32Cycles);
+
+/**
+ * Run pfnHandler as interrupt ui32Interrupt, at the priority it was given with
+ * IntPrioritySet(): for the timer and SysTick handlers that call into the
+ * stack.
+ */
+void UsbSim_Interrupt(uint32_t ui32Interrupt, void (*pfnHandler)(void));
+
+/**
+ * Bus events: a bus reset, then SET_CONFIGURATION 1, as a host enumerating the
+ * device does; SET_INTERFACE; and the rest of the bus states.
+ */
+void UsbSim_Configure(void);
+void UsbSim_SetInterface(uint8_t ui8Interface, uint8_t ui8AltSetting);
+void UsbSim_Reset(void);
+void UsbSim_Suspend(void);
+void UsbSim_Resume(void);
+void UsbSim_Disconnect(void);
+
+/**
+ * Whether a remote wakeup request succeeds: the host has enabled it.
+ */
+void UsbSim_RemoteWakeEnable(bool bEnable);
+
+/**
+ * The host sends an OUT packet of up to 64 bytes on endpoint 1.
+ * \returns true if the stack took it and acknowledged it.
+ */
+bool UsbSim_Out(const uint8_t *pui8Data, uint32_t ui32Size);
+
+/**
+ * The host polls the IN endpoint: collect the packet loaded there, if any,
+ * and run the transmit interrupt that follows.
+ * \returns the packet's size, 0 if there was none.
+ */
+uint32_t UsbSim_In(uint8_t *pui8Buf);
+
+/**
+ * Whether a packet is waiting in the IN endpoint.
+ */
+bool UsbSim_InPending(void);
+
+/**
+ * An EP0 request. An IN request's reply goes to pui8Data, at most wLength
+ * bytes, and its size to *pui32Size; an OUT request's data stage comes from
+ * pui8Data. Standard GET_DESCRIPTOR requests for the device, configuration
+ * and string descriptors are answered from the tDeviceInfo, as usblib does;
+ * other standard requests are stalled.
+ * \returns false if the request was stalled.
+ */
+bool UsbSim_Request(const tUSBRequest *psRequest, uint8_t *pui8Data, uint32_t *pui32Size);
+
+/**
+ * Map the top half of flash, 0x20000 to 0x3FFFF, at those addresses on the
+ * host and erase it. FlashErase() and FlashProgram() work on it from then on.
+ * \returns false if the host would not map it there.
+ */
+bool UsbSim_FlashInit(void);
+
+/**
+ * Whether SysCtlReset() was called since the last time this was asked.
+ */
+bool UsbSim_ResetCalled(void);
+
+#endif /* TOOLS_SIM_USBSIM_H_ */
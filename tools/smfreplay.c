@@ -0,0 +1,685 @@
+/*
+ * smfreplay.c
+ *
+ * Host load test: play a Standard MIDI File through the firmware's OUT path,
+ * without the board.
+ *
+ * The file (format 0 or 1) is parsed, its tracks merged and its ticks turned
+ * into microseconds through the tempo map. Each event becomes USB-MIDI event
+ * packets, exactly as a host driver would send them, and the packets are cut
+ * into 64-byte OUT transfers, up to -p of them per 1 ms USB frame. The
+ * whole stack runs on the simulated controller in tools/sim/, so each
+ * transfer goes through the firmware's own endpoint handler: SysEx to the
+ * pool, everything else to the clock and MTC followers, the parameter decoder,
+ * note tracking and the OUT FIFO (and, with -u, the UMP path of alternate
+ * setting 1). A simulated main loop pops up to -c messages from the OUT FIFO
+ * every frame and dispatches the SysEx that has arrived.
+ *
+ * Reported: event and transfer counts, OUT FIFO drops and peak depth, SysEx
+ * messages and drops, the latency from when a message was due to when the
+ * main loop popped it, and how fast the host ran the whole thing. With -r the
+ * file plays in real time; otherwise as fast as the host can.
+ *
+ * Build from the top of the tree:
+ *
+ *		cc -O2 -o smfreplay -Itools/sim -Iinclude/midi -Iinclude/usb_midi \
+ *			tools/smfreplay.c tools/sim/usbsim.c include/usb_midi/usb*.c
+ *
+ *		./smfreplay [-r] [-u] [-p packets] [-c consume] [-n cable] file.mid ...
+ *
+ * It exits non-zero if a file cannot be read or any message was dropped, so
+ * a set of show files makes a regression suite.
+ *
+ *  Created on: Oct 18, 2026
+ *
+ * MODS:
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "inc/hw_ints.h"
+#include "driverlib/interrupt.h"
+#include "midi.h"
+#include "usb_midi.h"
+#include "usbmidi_types.h"
+#include "usbmidi.h"
+#include "usbmidi_critical.h"
+#include "usbmidi_descriptors.h"
+#include "usbsim.h"
+
+#define CPU_HZ				80000000UL	// timestamps count CPU cycles, as on the board
+#define FRAME_US			1000
+#define EVENTS_PER_TRANSFER	16			// event packets in a 64-byte full-speed bulk transfer
+#define TRANSFER_WORDS		(USBMIDI_MAX_PACKET_SIZE / 4)
+#define LATENCY_BUCKETS		64			// in frames; the last counts everything later
+
+/*
+ * One USB-MIDI event packet of the file, in play order.
+ */
+typedef struct
+{
+	uint32_t tick;
+	uint32_t order;			// ties on tick keep file order
+	uint64_t us;
+	USBMIDI_Message_t msg;
+} Event_t;
+
+typedef struct
+{
+	uint32_t tick;
+	uint32_t order;
+	uint32_t usPerQuarter;
+} Tempo_t;
+
+static Event_t *g_psEvents;
+static uint32_t g_ui32Events;
+static uint32_t g_ui32EventsMax;
+static Tempo_t *g_psTempos;
+static uint32_t g_ui32Tempos;
+static uint32_t g_ui32TemposMax;
+static uint32_t g_ui32Order;
+
+/*
+ * SysEx bytes not yet packed, carried across F0 and F7 events.
+ */
+static uint8_t g_pui8SysEx[3];
+static uint32_t g_ui32SysExCount;
+static bool g_bInSysEx;
+
+/*
+ * The host's side of the simulated device: its translation to UMP for -u, and
+ * when each message in the OUT FIFO was due, in FIFO order.
+ */
+static USBMIDIUmpXlate_t g_sUmpUp;
+static uint32_t g_pui32DueFrame[MIDI_USB_FIFO_SIZE];
+static uint32_t g_ui32DueHead;
+static uint32_t g_ui32DueTail;
+static uint32_t g_ui32Depth;
+
+typedef struct
+{
+	uint32_t events;
+	uint32_t transfers;
+	uint32_t sysex;
+	uint32_t params;
+	uint32_t popped;
+	uint64_t latencySum;
+	uint32_t latencyMax;
+	uint32_t latency[LATENCY_BUCKETS];
+} Stats_t;
+
+static Stats_t g_sStats;
+
+static void AddEvent(uint32_t tick, uint8_t cable, uint8_t cin, uint8_t b1, uint8_t b2, uint8_t b3)
+{
+	Event_t *e;
+
+	if( g_ui32Events == g_ui32EventsMax )
+	{
+		g_ui32EventsMax = g_ui32EventsMax ? 2 * g_ui32EventsMax : 4096;
+		g_psEvents = realloc(g_psEvents, g_ui32EventsMax * sizeof(*g_psEvents));
+		if( !g_psEvents )
+		{
+			perror("smfreplay");
+			exit(2);
+		}
+	}
+	e = &g_psEvents[g_ui32Events++];
+	e->tick = tick;
+	e->order = g_ui32Order++;
+	e->msg.header = USB_MIDI_HEADER(cable, cin);
+	e->msg.byte1 = b1;
+	e->msg.byte2 = b2;
+	e->msg.byte3 = b3;
+}
+
+static void AddTempo(uint32_t tick, uint32_t usPerQuarter)
+{
+	if( g_ui32Tempos == g_ui32TemposMax )
+	{
+		g_ui32TemposMax = g_ui32TemposMax ? 2 * g_ui32TemposMax : 64;
+		g_psTempos = realloc(g_psTempos, g_ui32TemposMax * sizeof(*g_psTempos));
+		if( !g_psTempos )
+		{
+			perror("smfreplay");
+			exit(2);
+		}
+	}
+	g_psTempos[g_ui32Tempos].tick = tick;
+	g_psTempos[g_ui32Tempos].order = g_ui32Order++;
+	g_psTempos[g_ui32Tempos].usPerQuarter = usPerQuarter;
+	g_ui32Tempos++;
+}
+
+/*
+ * Pack SysEx bytes three to an event packet; F7 ends the message with CIN 5-7.
+ */
+static void SysExBytes(uint32_t tick, uint8_t cable, const uint8_t *data, uint32_t len)
+{
+	uint8_t *b = g_pui8SysEx;
+	uint8_t cin;
+	uint8_t c;
+
+	while( len-- )
+	{
+		c = *data++;
+		if( c == MIDI_MSG_SOX )
+		{
+			g_bInSysEx = true;
+			g_ui32SysExCount = 0;
+		}
+		if( !g_bInSysEx )
+			continue;
+
+		b[g_ui32SysExCount++] = c;
+		if( c == MIDI_MSG_EOX )
+		{
+			cin = USB_MIDI_CIN_SYSEND1 + g_ui32SysExCount - 1;
+			while( g_ui32SysExCount < 3 )
+				b[g_ui32SysExCount++] = 0;
+			AddEvent(tick, cable, cin, b[0], b[1], b[2]);
+			g_ui32SysExCount = 0;
+			g_bInSysEx = false;
+		}
+		else if( g_ui32SysExCount == 3 )
+		{
+			AddEvent(tick, cable, USB_MIDI_CIN_SYSEXSTART, b[0], b[1], b[2]);
+			g_ui32SysExCount = 0;
+		}
+	}
+}
+
+static uint32_t ReadVlq(const uint8_t **p, const uint8_t *end)
+{
+	uint32_t v = 0;
+	uint32_t i;
+
+	for( i = 0; (i < 4) && (*p < end); i++ )
+	{
+		v = (v << 7) | (**p & 0x7F);
+		if( !(*(*p)++ & 0x80) )
+			break;
+	}
+	return v;
+}
+
+/*
+ * Bytes that follow a channel status.
+ */
+static const uint8_t DataBytes[8] = { 2, 2, 2, 2, 1, 1, 2, 0 };
+
+static bool ParseTrack(const uint8_t *p, const uint8_t *end, uint8_t cable)
+{
+	uint32_t tick = 0;
+	uint32_t len;
+	uint8_t status = 0;
+	uint8_t d1;
+	uint8_t d2;
+	uint8_t type;
+
+	g_bInSysEx = false;
+	while( p < end )
+	{
+		tick += ReadVlq(&p, end);
+		if( p >= end )
+			return false;
+
+		if( *p & 0x80 )
+			status = *p++;
+		else if( !status )
+			return false;			// data with no running status
+
+		if( status == 0xFF )
+		{
+			if( p >= end )
+				return false;
+			type = *p++;
+			len = ReadVlq(&p, end);
+			if( len > (uint32_t) (end - p) )
+				return false;
+			if( (type == 0x51) && (len == 3) )
+				AddTempo(tick, ((uint32_t) p[0] << 16) | ((uint32_t) p[1] << 8) | p[2]);
+			p += len;
+			if( type == 0x2F )
+				return true;
+			status = 0;
+		}
+		else if( (status == MIDI_MSG_SOX) || (status == MIDI_MSG_EOX) )
+		{
+			len = ReadVlq(&p, end);
+			if( len > (uint32_t) (end - p) )
+				return false;
+			if( status == MIDI_MSG_SOX )
+				SysExBytes(tick, cable, &status, 1);
+			SysExBytes(tick, cable, p, len);
+			p += len;
+			status = 0;
+		}
+		else if( status >= MIDI_MSG_NOTEOFF && status < MIDI_MSG_SOX )
+		{
+			if( DataBytes[(status >> 4) & 7] > (uint32_t) (end - p) )
+				return false;
+			d1 = *p++ & 0x7F;
+			d2 = (DataBytes[(status >> 4) & 7] == 2) ? *p++ & 0x7F : 0;
+			AddEvent(tick, cable, status >> 4, status, d1, d2);
+		}
+		else
+		{
+			return false;			// system messages are not allowed bare in a file
+		}
+	}
+	return true;
+}
+
+static int CompareEvents(const void *a, const void *b)
+{
+	const Event_t *x = a;
+	const Event_t *y = b;
+
+	if( x->tick != y->tick )
+		return x->tick < y->tick ? -1 : 1;
+	return x->order < y->order ? -1 : x->order > y->order;
+}
+
+static int CompareTempos(const void *a, const void *b)
+{
+	const Tempo_t *x = a;
+	const Tempo_t *y = b;
+
+	if( x->tick != y->tick )
+		return x->tick < y->tick ? -1 : 1;
+	return x->order < y->order ? -1 : x->order > y->order;
+}
+
+/*
+ * Read a file into the event list, in play order with times in microseconds.
+ */
+static bool LoadSmf(const char *path, uint8_t cable)
+{
+	FILE *f;
+	uint8_t *data;
+	const uint8_t *p;
+	const uint8_t *end;
+	long size;
+	uint32_t len;
+	uint16_t format;
+	uint16_t tracks;
+	uint16_t division;
+	uint32_t t;
+	uint32_t i;
+	uint32_t lastTick;
+	uint32_t usPerQuarter;
+	uint64_t us;
+
+	g_ui32Events = 0;
+	g_ui32Tempos = 0;
+	g_ui32Order = 0;
+
+	f = fopen(path, "rb");
+	if( !f )
+	{
+		perror(path);
+		return false;
+	}
+	fseek(f, 0, SEEK_END);
+	size = ftell(f);
+	fseek(f, 0, SEEK_SET);
+	data = malloc(size > 0 ? size : 1);
+	if( !data || (fread(data, 1, size, f) != (size_t) size) )
+	{
+		fprintf(stderr, "%s: cannot read\n", path);
+		fclose(f);
+		free(data);
+		return false;
+	}
+	fclose(f);
+
+	p = data;
+	end = data + size;
+	if( (size < 14) || memcmp(p, "MThd", 4) )
+	{
+		fprintf(stderr, "%s: not a Standard MIDI File\n", path);
+		free(data);
+		return false;
+	}
+	len = ((uint32_t) p[4] << 24) | ((uint32_t) p[5] << 16) | ((uint32_t) p[6] << 8) | p[7];
+	format = (p[8] << 8) | p[9];
+	tracks = (p[10] << 8) | p[11];
+	division = (p[12] << 8) | p[13];
+	if( (format > 1) || (len < 6) || (len > (uint32_t) size - 8) || !division )
+	{
+		fprintf(stderr, "%s: format %u not supported\n", path, format);
+		free(data);
+		return false;
+	}
+	p += 8 + len;
+
+	for( t = 0; (t < tracks) && (end - p >= 8); t++ )
+	{
+		len = ((uint32_t) p[4] << 24) | ((uint32_t) p[5] << 16) | ((uint32_t) p[6] << 8) | p[7];
+		if( len > (uint32_t) (end - p) - 8 )
+			break;
+		if( !memcmp(p, "MTrk", 4) && !ParseTrack(p + 8, p + 8 + len, cable) )
+			fprintf(stderr, "%s: track %u is damaged, played up to the damage\n", path, t);
+		p += 8 + len;
+	}
+	free(data);
+
+	qsort(g_psEvents, g_ui32Events, sizeof(*g_psEvents), CompareEvents);
+	qsort(g_psTempos, g_ui32Tempos, sizeof(*g_psTempos), CompareTempos);
+
+	// walk the tempo map alongside the events. SMPTE division ignores tempo.
+	us = 0;
+	lastTick = 0;
+	usPerQuarter = 500000;
+	for( i = 0, t = 0; i < g_ui32Events; i++ )
+	{
+		while( (t < g_ui32Tempos) && (g_psTempos[t].tick <= g_psEvents[i].tick) )
+		{
+			if( !(division & 0x8000) )
+				us += (uint64_t) (g_psTempos[t].tick - lastTick) * usPerQuarter / division;
+			lastTick = g_psTempos[t].tick;
+			usPerQuarter = g_psTempos[t].usPerQuarter;
+			t++;
+		}
+		if( division & 0x8000 )
+			g_psEvents[i].us = (uint64_t) g_psEvents[i].tick * 1000000 /
+					((uint32_t) (uint8_t) -(int8_t) (division >> 8) * (division & 0xFF));
+		else
+			g_psEvents[i].us = us + (uint64_t) (g_psEvents[i].tick - lastTick) * usPerQuarter / division;
+	}
+
+	return true;
+}
+
+/*
+ * What the device's OUT FIFO holds now.
+ */
+static uint32_t FifoDepth(void)
+{
+	USBMIDIStats_t st;
+
+	USBMIDI_StatsGet(&st);
+	return st.outMsg.depth;
+}
+
+/*
+ * One OUT transfer of n event packets, or of their UMP with ump. The messages
+ * the endpoint handler put on the OUT FIFO were all due in this frame.
+ */
+static void OutEpTransfer(const Event_t *ev, uint32_t n, uint32_t frame, bool ump)
+{
+	uint32_t words[EVENTS_PER_TRANSFER * USBMIDI_UMP_MAX_WORDS];
+	uint32_t count = 0;
+	uint32_t depth;
+	uint32_t size;
+	uint32_t i;
+
+	for( i = 0; i < n; i++ )
+	{
+		if( ump )
+		{
+			count += USBMIDIUmp_FromMidi1(&g_sUmpUp, &ev[i].msg, &words[count]);
+		}
+		else
+		{
+			memcpy(&words[count], &ev[i].msg, 4);
+			count++;
+		}
+	}
+
+	// a UMP that would cross the end of the transfer starts the next one.
+	i = 0;
+	while( i < count )
+	{
+		for( n = 0; i + n < count; n += size )
+		{
+			size = ump ? USBMIDI_UMP_WORDS(words[i + n]) : 1;
+			if( n + size > TRANSFER_WORDS )
+				break;
+		}
+		UsbSim_Out((const uint8_t *) &words[i], n * 4);
+		g_sStats.transfers++;
+		i += n;
+
+		for( depth = FifoDepth(); g_ui32Depth < depth; g_ui32Depth++ )
+			g_pui32DueFrame[g_ui32DueHead++ % MIDI_USB_FIFO_SIZE] = frame;
+	}
+}
+
+/*
+ * Completed SysEx messages, from the main loop.
+ */
+static void SysExReceived(const USBMIDISysExMsg_t *msg)
+{
+	(void) msg;
+	g_sStats.sysex++;
+}
+
+static void SysTick(void)
+{
+	USBMIDI_Tick(FRAME_US / 1000);
+}
+
+static void DeviceInit(bool ump)
+{
+	USBMIDI_Init(0);
+	USBMIDI_SysExCallbackSet(SysExReceived);
+	IntPrioritySet(FAULT_SYSTICK, USBMIDI_INT_PRIORITY);
+	UsbSim_Configure();
+	if( ump )
+		UsbSim_SetInterface(USBMIDI_IF_MIDI_STREAMING, USBMIDI_ALT_UMP);
+	USBMIDIUmp_XlateInit(&g_sUmpUp);
+	g_ui32DueHead = 0;
+	g_ui32DueTail = 0;
+	g_ui32Depth = 0;
+	memset(&g_sStats, 0, sizeof(g_sStats));
+}
+
+static double Seconds(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void SleepUntil(double start, uint32_t frame)
+{
+	struct timespec ts;
+	double due = start + frame * (FRAME_US * 1e-6);
+	double now = Seconds();
+
+	if( due <= now )
+		return;
+	ts.tv_sec = (time_t) (due - now);
+	ts.tv_nsec = (long) ((due - now - ts.tv_sec) * 1e9);
+	nanosleep(&ts, NULL);
+}
+
+static uint32_t Percentile(uint32_t pct)
+{
+	uint64_t want = ((uint64_t) g_sStats.popped * pct + 99) / 100;
+	uint64_t seen = 0;
+	uint32_t b;
+
+	for( b = 0; b < LATENCY_BUCKETS; b++ )
+	{
+		seen += g_sStats.latency[b];
+		if( seen >= want )
+			return b;
+	}
+	return LATENCY_BUCKETS - 1;
+}
+
+/*
+ * The device's count of notes the host left on, through its vendor request.
+ */
+static uint32_t NotesOn(void)
+{
+	tUSBMidiVendorStats vs;
+	tUSBRequest req;
+	uint32_t size;
+
+	req.bmRequestType = USB_RTYPE_DIR_IN | USB_RTYPE_VENDOR | USB_RTYPE_DEVICE;
+	req.bRequest = USBMIDI_VENDOR_GET_STATS;
+	req.wValue = 0;
+	req.wIndex = 0;
+	req.wLength = sizeof(vs);
+	if( !UsbSim_Request(&req, (uint8_t *) &vs, &size) || (size != sizeof(vs)) )
+		return 0;
+	return vs.ui32OutNotesOn;
+}
+
+/*
+ * Play the loaded file, frame by frame.
+ */
+static bool Play(const char *path, bool realtime, bool ump, uint32_t perFrame, uint32_t consume)
+{
+	USBMIDI_Message_t msg;
+	USBMIDIParamEvent_t pev;
+	USBMIDIClockInState_t clock;
+	USBMIDIStats_t st;
+	double start;
+	double elapsed;
+	uint32_t frame;
+	uint32_t latency;
+	uint32_t i;
+	uint32_t n;
+	uint32_t sent;
+	uint32_t k;
+
+	DeviceInit(ump);
+	start = Seconds();
+	i = 0;
+	for( frame = 0; (i < g_ui32Events) || g_ui32Depth; frame++ )
+	{
+		if( realtime )
+			SleepUntil(start, frame);
+		if( frame )
+			UsbSim_Advance(CPU_HZ / 1000);
+		UsbSim_Interrupt(FAULT_SYSTICK, SysTick);
+
+		// the host sends what is due by the end of this frame.
+		for( sent = 0; (sent < perFrame) && (i < g_ui32Events) &&
+				(g_psEvents[i].us < (uint64_t) (frame + 1) * FRAME_US); sent++ )
+		{
+			for( n = 0; (n < EVENTS_PER_TRANSFER) && (i + n < g_ui32Events) &&
+					(g_psEvents[i + n].us < (uint64_t) (frame + 1) * FRAME_US); n++ )
+				;
+			OutEpTransfer(&g_psEvents[i], n, frame, ump);
+			g_sStats.events += n;
+			i += n;
+		}
+
+		// the main loop takes its share.
+		for( k = 0; (k < consume) && USBMIDI_OutEpFIFO_Pop(&msg); k++ )
+		{
+			latency = frame - g_pui32DueFrame[g_ui32DueTail++ % MIDI_USB_FIFO_SIZE];
+			g_ui32Depth--;
+			g_sStats.popped++;
+			g_sStats.latencySum += latency;
+			if( latency > g_sStats.latencyMax )
+				g_sStats.latencyMax = latency;
+			g_sStats.latency[latency < LATENCY_BUCKETS ? latency : LATENCY_BUCKETS - 1]++;
+		}
+		while( USBMIDI_ParamRead(&pev) )
+			g_sStats.params++;
+		USBMIDI_SysExTask();
+	}
+	elapsed = Seconds() - start;
+
+	USBMIDI_ClockInGet(&clock);
+	USBMIDI_StatsGet(&st);
+
+	printf("%s\n", path);
+	printf("  %u events in %u transfers over %.3f s of music, %u SysEx messages\n",
+			g_sStats.events, g_sStats.transfers, frame * (FRAME_US * 1e-6), g_sStats.sysex);
+	printf("  host: %.3f s, %.0f events/s\n", elapsed, elapsed > 0 ? g_sStats.events / elapsed : 0.0);
+	printf("  OUT FIFO: %u dropped, peak depth %u of %u\n", st.outMsg.drops, st.outMsg.highWater,
+			MIDI_USB_FIFO_SIZE);
+	printf("  SysEx: %u dropped, %u aborted, peak %u of %u blocks\n",
+			st.sysExPoolExhausted + st.sysExQueueFull, st.sysExAborted, st.sysExBlocksHighWater,
+			USBMIDI_SYSEX_NUM_BLOCKS);
+	printf("  latency, frames: mean %.2f, p50 %u, p99 %u, max %u\n",
+			g_sStats.popped ? (double) g_sStats.latencySum / g_sStats.popped : 0.0,
+			Percentile(50), Percentile(99), g_sStats.latencyMax);
+	printf("  notes left on %u, parameter events %u", NotesOn(), g_sStats.params);
+	if( clock.locked )
+		printf(", clock %.3f BPM", clock.tempo / 1000.0);
+	printf("\n");
+
+	return (st.outMsg.drops == 0) && (st.sysExPoolExhausted + st.sysExQueueFull == 0);
+}
+
+static void Usage(void)
+{
+	fprintf(stderr,
+			"usage: smfreplay [-r] [-u] [-p packets] [-c consume] [-n cable] file.mid ...\n"
+			"  -r  play in real time, else as fast as possible\n"
+			"  -u  send as Universal MIDI Packets (alternate setting 1)\n"
+			"  -p  most OUT transfers per 1 ms frame (default 16)\n"
+			"  -c  messages the main loop takes per frame (default 64)\n"
+			"  -n  virtual cable (default 0)\n");
+	exit(2);
+}
+
+int main(int argc, char **argv)
+{
+	bool realtime = false;
+	bool ump = false;
+	uint32_t perFrame = 16;
+	uint32_t consume = 64;
+	uint8_t cable = 0;
+	int status = 0;
+	int opt;
+
+	while( (opt = getopt(argc, argv, "rup:c:n:")) != -1 )
+	{
+		switch( opt )
+		{
+		case 'r':
+			realtime = true;
+			break;
+		case 'u':
+			ump = true;
+			break;
+		case 'p':
+			perFrame = strtoul(optarg, NULL, 0);
+			break;
+		case 'c':
+			consume = strtoul(optarg, NULL, 0);
+			break;
+		case 'n':
+			cable = strtoul(optarg, NULL, 0) & 0x0F;
+			break;
+		default:
+			Usage();
+		}
+	}
+	if( (optind >= argc) || !perFrame || !consume )
+		Usage();
+
+	for( ; optind < argc; optind++ )
+	{
+		if( !LoadSmf(argv[optind], cable) )
+		{
+			status = 2;
+			continue;
+		}
+		if( !Play(argv[optind], realtime, ump, perFrame, consume) && !status )
+			status = 1;
+	}
+
+	free(g_psEvents);
+	free(g_psTempos);
+	return status;
+}
@@ -0,0 +1,995 @@
+/*
+ * stackbench.c
+ *
+ * Benchmarks of the USB MIDI stack on the host, run on the simulated
+ * controller in tools/sim/ with the firmware's own code. Each one drives the
+ * stack the way a host and the main loop would, checks what comes out, and
+ * reports what the stack did: packets, bytes, FIFO use and the stack's own
+ * cycle counters. Cycle figures are the host's, from its cycle counter put
+ * behind the stack's timestamps, not the board's; the same counters read on
+ * the board (vendor GET_STATS, the statistics SysEx) give the real ones.
+ *
+ *		sysex	send one SysEx dump with USBMIDI_SendSysEx() and collect it
+ *				as a full-speed host would, at most 19 bulk packets a frame.
+ *		chord	send chords note by note with USBMIDI_InEpMsgWrite() and in
+ *				batches with USBMIDI_InEpBatchWrite(), and compare.
+ *		clock	replay Timing Clock streams, recorded or made up, into the OUT
+ *				endpoint and check how the clock follower tracks them, and
+ *				what each tick costs.
+ *		mpe		play gestures through an MPE zone: notes on, expression
+ *				moving, flushes, notes off; time each and check that no two
+ *				sounding notes ever share a channel.
+ *
+ * Build from the top of the tree:
+ *
+ *		cc -O2 -o stackbench -Itools/sim -Iinclude/midi -Iinclude/usb_midi \
+ *			tools/stackbench.c tools/sim/usbsim.c include/usb_midi/usb*.c
+ *
+ *		./stackbench sysex [-s bytes] [-u]
+ *		./stackbench chord [-n notes] [-c chords]
+ *		./stackbench clock [-b bpm] [-j us] [-n ticks] [-r seed] [-w file] [file ...]
+ *		./stackbench mpe [-m members] [-f fingers] [-u updates] [-g gestures] [-r seed]
+ *
+ * It exits non-zero if what came out was not what went in.
+ *
+ *  Created on: Oct 18, 2026
+ *
+ * MODS:
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "inc/hw_ints.h"
+#include "driverlib/interrupt.h"
+#include "driverlib/sysctl.h"
+#include "midi.h"
+#include "usb_midi.h"
+#include "usbmidi_types.h"
+#include "usbmidi.h"
+#include "usbmidi_batch.h"
+#include "usbmidi_critical.h"
+#include "usbmidi_descriptors.h"
+#include "usbmidi_clockin.h"
+#include "usbmidi_mpe.h"
+#include "usbmidi_ump.h"
+#include "usbsim.h"
+
+#define FS_BULK_PER_FRAME	19		// most 64-byte bulk packets in a full-speed frame
+#define SYSEX_MANUFACTURER	0x7D	// non-commercial
+#define FRAME_US			1000	// a full-speed frame
+#define CLOCK_TOLERANCE		0.1		// mean tempo error allowed while locked, %
+
+/*
+ * The device, configured, on alternate setting 1 with ump.
+ */
+static void DeviceInit(bool ump)
+{
+	USBMIDI_Init(0);
+	IntPrioritySet(FAULT_SYSTICK, USBMIDI_INT_PRIORITY);
+	UsbSim_Configure();
+	if( ump )
+		UsbSim_SetInterface(USBMIDI_IF_MIDI_STREAMING, USBMIDI_ALT_UMP);
+}
+
+static int CompareCycles(const void *a, const void *b)
+{
+	uint32_t x = *(const uint32_t *) a;
+	uint32_t y = *(const uint32_t *) b;
+
+	return (x > y) - (x < y);
+}
+
+/*
+ * The host's side: IN packets turned back into event packets.
+ */
+static USBMIDIUmpXlate_t g_sHostDown;
+
+static uint32_t InMessages(const uint8_t *buf, uint32_t size, bool ump, USBMIDI_Message_t *msg)
+{
+	uint32_t words[USBMIDI_MAX_PACKET_SIZE / 4];
+	uint32_t n = 0;
+	uint32_t i;
+
+	if( !ump )
+	{
+		memcpy(msg, buf, size);
+		return size / 4;
+	}
+	memcpy(words, buf, size);
+	for( i = 0; i < size / 4; i += USBMIDI_UMP_WORDS(words[i]) )
+		n += USBMIDIUmp_ToMidi1(&g_sHostDown, &words[i], &msg[n]);
+	return n;
+}
+
+/*
+ * A Timing Clock stream: when each tick reached the device, in microseconds,
+ * and the tempo it was sent at, in thousandths of a BPM.
+ */
+typedef struct
+{
+	const char *pcName;
+	uint64_t *pui64Us;
+	uint32_t *pui32Tempo;
+	uint32_t ui32Ticks;
+	uint32_t ui32Size;
+} ClockStream_t;
+
+static uint32_t g_ui32Seed = 1;
+
+static uint32_t Rand(void)
+{
+	// xorshift32
+	g_ui32Seed ^= g_ui32Seed << 13;
+	g_ui32Seed ^= g_ui32Seed >> 17;
+	g_ui32Seed ^= g_ui32Seed << 5;
+	return g_ui32Seed;
+}
+
+static bool StreamAdd(ClockStream_t *cs, uint64_t ui64Us, uint32_t ui32Tempo)
+{
+	uint64_t *pui64Us;
+	uint32_t *pui32Tempo;
+
+	if( cs->ui32Ticks == cs->ui32Size )
+	{
+		cs->ui32Size = cs->ui32Size ? cs->ui32Size * 2 : 1024;
+		pui64Us = realloc(cs->pui64Us, cs->ui32Size * sizeof(uint64_t));
+		if( pui64Us )
+			cs->pui64Us = pui64Us;
+		pui32Tempo = realloc(cs->pui32Tempo, cs->ui32Size * sizeof(uint32_t));
+		if( pui32Tempo )
+			cs->pui32Tempo = pui32Tempo;
+		if( !pui64Us || !pui32Tempo )
+			return false;
+	}
+	cs->pui64Us[cs->ui32Ticks] = ui64Us;
+	cs->pui32Tempo[cs->ui32Ticks] = ui32Tempo;
+	cs->ui32Ticks++;
+	return true;
+}
+
+static void StreamFree(ClockStream_t *cs)
+{
+	free(cs->pui64Us);
+	free(cs->pui32Tempo);
+	memset(cs, 0, sizeof(*cs));
+}
+
+/*
+ * A host sending a clock: each tick is due at the tempo, wobbles by up to
+ * +/-ui32JitterUs on the host, and goes out in the frame after that. The tempo
+ * moves to ui32Bpm2 halfway through.
+ */
+static bool StreamMake(ClockStream_t *cs, const char *pcName, uint32_t ui32Bpm, uint32_t ui32Bpm2,
+		uint32_t ui32JitterUs, uint32_t ui32Ticks)
+{
+	double due = 10000.0;
+	double t;
+	uint64_t ui64Us;
+	uint64_t ui64Last = 0;
+	uint32_t ui32Tempo;
+	uint32_t i;
+
+	memset(cs, 0, sizeof(*cs));
+	cs->pcName = pcName;
+	for( i = 0; i < ui32Ticks; i++ )
+	{
+		ui32Tempo = ((i < ui32Ticks / 2) ? ui32Bpm : ui32Bpm2) * 1000;
+		due += 60e9 / (24.0 * ui32Tempo);
+		t = due;
+		if( ui32JitterUs )
+			t += (double) (Rand() % (2 * ui32JitterUs + 1)) - ui32JitterUs;
+		ui64Us = ((uint64_t) t / FRAME_US + 1) * FRAME_US;
+		if( ui64Us < ui64Last )
+			ui64Us = ui64Last;
+		ui64Last = ui64Us;
+		if( !StreamAdd(cs, ui64Us, ui32Tempo) )
+			return false;
+	}
+	return true;
+}
+
+/*
+ * A recorded stream. Either one arrival time in microseconds a line, as -w
+ * writes, or a usbmon text capture (Documentation/usb/usbmon.rst), where the
+ * Timing Clocks are taken from the submissions on bulk OUT endpoints. '#'
+ * starts a comment. The stream is taken to be at one tempo, its average.
+ */
+static bool StreamRead(ClockStream_t *cs, const char *pcFile)
+{
+	char pcLine[512];
+	char pcType[8];
+	char pcAddr[32];
+	char *pcData;
+	char *pcEnd;
+	unsigned long long ullUs;
+	uint32_t ui32Word;
+	uint32_t ui32Tempo;
+	uint32_t i;
+	FILE *f;
+	bool ok = true;
+
+	memset(cs, 0, sizeof(*cs));
+	cs->pcName = pcFile;
+	f = fopen(pcFile, "r");
+	if( !f )
+	{
+		perror(pcFile);
+		return false;
+	}
+	while( ok && fgets(pcLine, sizeof(pcLine), f) )
+	{
+		if( (pcLine[0] == '#') || (strspn(pcLine, " \t\r\n") == strlen(pcLine)) )
+			continue;
+		if( sscanf(pcLine, "%*s %llu %7s %31s", &ullUs, pcType, pcAddr) == 3 )
+		{
+			// usbmon: tag, time, S or C, then Bo:bus:device:endpoint.
+			pcData = strchr(pcLine, '=');
+			if( (strcmp(pcType, "S") != 0) || (strncmp(pcAddr, "Bo:", 3) != 0) || !pcData )
+				continue;
+			for( pcData++; ok && *pcData; pcData = pcEnd )
+			{
+				ui32Word = strtoul(pcData, &pcEnd, 16);
+				if( pcEnd == pcData )
+					break;
+				if( ((ui32Word >> 24) & 0x0F) == USB_MIDI_CIN_SINGLEBYTE && ((ui32Word >> 16) & 0xFF) == MIDI_MSG_TIMINGCLOCK )
+					ok = StreamAdd(cs, ullUs, 0);
+			}
+		}
+		else if( isdigit((unsigned char) pcLine[0]) )
+		{
+			ok = StreamAdd(cs, strtoull(pcLine, 0, 10), 0);
+		}
+	}
+	fclose(f);
+	if( !ok || (cs->ui32Ticks < 3) )
+	{
+		fprintf(stderr, "stackbench: %s: %s\n", pcFile, ok ? "fewer than 3 Timing Clocks" : "out of memory");
+		return false;
+	}
+
+	ui32Tempo = (uint32_t) (60e9 * (cs->ui32Ticks - 1) / (24.0 * (cs->pui64Us[cs->ui32Ticks - 1] - cs->pui64Us[0])));
+	for( i = 0; i < cs->ui32Ticks; i++ )
+		cs->pui32Tempo[i] = ui32Tempo;
+	return true;
+}
+
+static bool StreamWrite(const ClockStream_t *cs, const char *pcFile)
+{
+	uint32_t i;
+	FILE *f;
+
+	f = fopen(pcFile, "w");
+	if( !f )
+	{
+		perror(pcFile);
+		return false;
+	}
+	fprintf(f, "# %s: Timing Clock arrival times, us\n", cs->pcName);
+	for( i = 0; i < cs->ui32Ticks; i++ )
+		fprintf(f, "%llu\n", (unsigned long long) cs->pui64Us[i]);
+	return fclose(f) == 0;
+}
+
+static void Usage(void)
+{
+	fprintf(stderr,
+			"usage: stackbench sysex [-s bytes] [-u]\n"
+			"       stackbench chord [-n notes] [-c chords]\n"
+			"       stackbench clock [-b bpm] [-j us] [-n ticks] [-r seed] [-w file] [file ...]\n"
+			"       stackbench mpe [-m members] [-f fingers] [-u updates] [-g gestures] [-r seed]\n"
+			"  -s  size of the dump, F0 to F7 (default 65536)\n"
+			"  -u  on alternate setting 1, as Universal MIDI Packets\n"
+			"  -n  notes in a chord, 1 to 128 (default 128)\n"
+			"  -c  chords each way, alternately on and off (default 1000)\n"
+			"  -b  one clock at this tempo instead of the built-in set; -j, -n as for it\n"
+			"  -j  host wobble, +/- us, before the 1 ms frame (default 100)\n"
+			"  -n  ticks (default 2400)\n"
+			"  -r  seed for the wobble (default 1)\n"
+			"  -w  write the -b stream to file, in the form clock reads\n"
+			"  file  recorded streams to replay instead: arrival times in us, one a\n"
+			"        line, or a usbmon text capture\n"
+			"  -m  member channels of the zone, 1 to 15 (default 15)\n"
+			"  -f  notes held in a gesture, 1 to 48 (default 10)\n"
+			"  -u  expression updates a note between flushes (default 8)\n"
+			"  -g  gestures (default 1000)\n");
+	exit(2);
+}
+
+/*
+ * A SysEx dump out of the IN endpoint. The host collects one packet at a time,
+ * at most FS_BULK_PER_FRAME a frame, so the frame count is the shortest time
+ * the dump can take on a full-speed bus.
+ */
+static int BenchSysEx(int argc, char **argv)
+{
+	USBMIDI_Message_t msg[USBMIDI_MAX_PACKET_SIZE / 4 * USBMIDI_UMP_MAX_MIDI1];
+	uint8_t buf[USBMIDI_MAX_PACKET_SIZE];
+	uint8_t *pui8Dump;
+	uint8_t *pui8Rx;
+	uint32_t *pui32Cycles;
+	uint32_t ui32Size = 65536;
+	uint32_t ui32Rx = 0;
+	uint32_t ui32Packets = 0;
+	uint32_t ui32UsbBytes = 0;
+	uint32_t ui32Frames = 0;
+	uint32_t ui32Max;
+	uint32_t size;
+	uint32_t n;
+	uint32_t i;
+	uint32_t k;
+	USBMIDIStats_t st;
+	bool ump = false;
+	bool ok;
+	int opt;
+
+	while( (opt = getopt(argc, argv, "s:u")) != -1 )
+	{
+		switch( opt )
+		{
+			case 's':
+				ui32Size = strtoul(optarg, 0, 0);
+				break;
+			case 'u':
+				ump = true;
+				break;
+			default:
+				Usage();
+		}
+	}
+	if( ui32Size < 3 )
+		Usage();
+
+	pui8Dump = malloc(ui32Size);
+	pui8Rx = malloc(ui32Size);
+	ui32Max = ui32Size / 3 + 2;
+	pui32Cycles = malloc(ui32Max * sizeof(uint32_t));
+	if( !pui8Dump || !pui8Rx || !pui32Cycles )
+	{
+		perror("stackbench");
+		return 2;
+	}
+	pui8Dump[0] = MIDI_MSG_SOX;
+	pui8Dump[1] = SYSEX_MANUFACTURER;
+	for( i = 2; i < ui32Size - 1; i++ )
+		pui8Dump[i] = (i * 7) & 0x7F;
+	pui8Dump[ui32Size - 1] = MIDI_MSG_EOX;
+
+	DeviceInit(ump);
+	USBMIDIUmp_XlateInit(&g_sHostDown);
+	UsbSim_ClockSet(UsbSim_HostCycles);
+	if( !USBMIDI_SendSysEx(0, pui8Dump, ui32Size) )
+	{
+		fprintf(stderr, "stackbench: USBMIDI_SendSysEx() refused the dump\n");
+		return 1;
+	}
+
+	// the first packet was loaded by USBMIDI_SendSysEx(); each IN interrupt loads the next.
+	while( UsbSim_InPending() && (ui32Packets < ui32Max) )
+	{
+		if( (ui32Packets % FS_BULK_PER_FRAME) == 0 )
+			ui32Frames++;
+		size = UsbSim_In(buf);
+		USBMIDI_StatsGet(&st);
+		pui32Cycles[ui32Packets++] = st.isrCycles;
+		ui32UsbBytes += size;
+
+		n = InMessages(buf, size, ump, msg);
+		for( i = 0; i < n; i++ )
+		{
+			k = USB_MIDI_CODE_INDEX_NUMBER(msg[i].header);
+			k = (k == USB_MIDI_CIN_SYSEXSTART) ? 3 : (k >= USB_MIDI_CIN_SYSEND1) && (k <= USB_MIDI_CIN_SYSEND3) ?
+					k - USB_MIDI_CIN_SYSEND1 + 1 : 0;
+			if( ui32Rx + k > ui32Size )
+				k = 0;
+			memcpy(&pui8Rx[ui32Rx], &msg[i].byte1, k);
+			ui32Rx += k;
+		}
+	}
+	UsbSim_ClockSet(0);
+
+	ok = (ui32Rx == ui32Size) && (memcmp(pui8Rx, pui8Dump, ui32Size) == 0) && !USBMIDI_SysExTxBusy();
+	qsort(pui32Cycles, ui32Packets, sizeof(uint32_t), CompareCycles);
+
+	printf("SysEx dump of %u bytes, %s\n", ui32Size, ump ? "UMP (alternate setting 1)" : "event packets");
+	printf("  %u IN packets, %u bytes on the bus, %.1f%% of it SysEx\n", ui32Packets, ui32UsbBytes,
+			ui32UsbBytes ? 100.0 * ui32Size / ui32UsbBytes : 0.0);
+	printf("  %u full-speed frames at %u packets each: %u ms, %.1f KB/s of SysEx\n", ui32Frames,
+			FS_BULK_PER_FRAME, ui32Frames, ui32Frames ? ui32Size / (double) ui32Frames : 0.0);
+	printf("  IN interrupt, host cycles: median %u, max %u\n",
+			ui32Packets ? pui32Cycles[ui32Packets / 2] : 0, ui32Packets ? pui32Cycles[ui32Packets - 1] : 0);
+	printf("  received %s\n", ok ? "intact" : "DIFFERENT from what was sent");
+
+	free(pui8Dump);
+	free(pui8Rx);
+	free(pui32Cycles);
+	return ok ? 0 : 1;
+}
+
+/*
+ * Collect every IN packet waiting, as the host would. Returns the messages.
+ */
+static uint32_t InDrain(void)
+{
+	uint8_t buf[USBMIDI_MAX_PACKET_SIZE];
+	uint32_t n = 0;
+
+	while( UsbSim_InPending() )
+		n += UsbSim_In(buf) / 4;
+	return n;
+}
+
+/*
+ * One chord, note by note: each message is masked, copied, tracked and kicked
+ * on its own, and is dropped if the IN FIFO is full.
+ */
+static uint32_t ChordMessages(uint32_t ui32Notes, bool on, uint32_t *pui32Cycles)
+{
+	USBMIDI_Message_t msg;
+	uint32_t c;
+	uint32_t i;
+
+	c = UsbSim_HostCycles();
+	for( i = 0; i < ui32Notes; i++ )
+	{
+		msg.header = USB_MIDI_HEADER(0, on ? USB_MIDI_CIN_NOTEON : USB_MIDI_CIN_NOTEOFF);
+		msg.byte1 = (on ? MIDI_MSG_NOTEON : MIDI_MSG_NOTEOFF) | 0;
+		msg.byte2 = i;
+		msg.byte3 = on ? 100 : 0;
+		USBMIDI_InEpMsgWrite(&msg);
+	}
+	*pui32Cycles = UsbSim_HostCycles() - c;
+	return InDrain();
+}
+
+/*
+ * The same chord in batches. What the IN FIFO cannot take stays in the batch;
+ * the host collects a packet and the rest is sent again. Only the writing is
+ * timed. Returns the messages collected; *pui32Waits counts the packets the
+ * host had to collect before the chord was all in.
+ */
+static uint32_t ChordBatches(uint32_t ui32Notes, bool on, uint32_t *pui32Cycles, uint32_t *pui32Waits)
+{
+	uint8_t buf[USBMIDI_MAX_PACKET_SIZE];
+	USBMIDIBatch_t batch;
+	uint32_t ui32Rx = 0;
+	uint32_t c;
+	uint32_t i;
+
+	*pui32Cycles = 0;
+	*pui32Waits = 0;
+	USBMIDIBatch_Init(&batch);
+	for( i = 0; (i < ui32Notes) || batch.count; )
+	{
+		c = UsbSim_HostCycles();
+		for( ; (i < ui32Notes) && !USBMIDIBatch_Full(&batch); i++ )
+		{
+			if( on )
+				USBMIDIBatch_NoteOn(&batch, 0, 0, i, 100);
+			else
+				USBMIDIBatch_NoteOff(&batch, 0, 0, i, 0);
+		}
+		USBMIDI_InEpBatchWrite(&batch);
+		*pui32Cycles += UsbSim_HostCycles() - c;
+
+		if( batch.count )
+		{
+			if( !UsbSim_InPending() )
+				break;
+			ui32Rx += UsbSim_In(buf) / 4;
+			(*pui32Waits)++;
+		}
+	}
+	return ui32Rx + InDrain();
+}
+
+/*
+ * A chord, as a keyboard's full release or a panic sends it, written both
+ * ways to an idle IN endpoint: the FIFO's MIDI_USB_FIFO_SIZE entries and one
+ * packet in the endpoint.
+ */
+static int BenchChord(int argc, char **argv)
+{
+	uint32_t *pui32Msg;
+	uint32_t *pui32Batch;
+	uint32_t ui32Notes = 128;
+	uint32_t ui32Chords = 1000;
+	uint32_t ui32MsgRx = 0;
+	uint32_t ui32BatchRx = 0;
+	uint32_t ui32Waits = 0;
+	uint32_t w;
+	uint32_t i;
+	bool ok;
+	int opt;
+
+	while( (opt = getopt(argc, argv, "n:c:")) != -1 )
+	{
+		switch( opt )
+		{
+			case 'n':
+				ui32Notes = strtoul(optarg, 0, 0);
+				break;
+			case 'c':
+				ui32Chords = strtoul(optarg, 0, 0);
+				break;
+			default:
+				Usage();
+		}
+	}
+	if( (ui32Notes < 1) || (ui32Notes > 128) || (ui32Chords < 1) )
+		Usage();
+
+	pui32Msg = malloc(ui32Chords * sizeof(uint32_t));
+	pui32Batch = malloc(ui32Chords * sizeof(uint32_t));
+	if( !pui32Msg || !pui32Batch )
+	{
+		perror("stackbench");
+		return 2;
+	}
+
+	DeviceInit(false);
+	for( i = 0; i < ui32Chords; i++ )
+	{
+		ui32MsgRx += ChordMessages(ui32Notes, !(i & 1), &pui32Msg[i]);
+		ui32BatchRx += ChordBatches(ui32Notes, !(i & 1), &pui32Batch[i], &w);
+		ui32Waits += w;
+	}
+	qsort(pui32Msg, ui32Chords, sizeof(uint32_t), CompareCycles);
+	qsort(pui32Batch, ui32Chords, sizeof(uint32_t), CompareCycles);
+
+	ok = ui32BatchRx == ui32Notes * ui32Chords;
+	printf("%u chords of %u notes, into %u IN FIFO entries and a %u-message packet\n", ui32Chords, ui32Notes,
+			MIDI_USB_FIFO_SIZE, USBMIDI_MAX_PACKET_SIZE / 4);
+	printf("  note by note: host cycles a chord median %u, max %u; %u of %u notes a chord dropped\n",
+			pui32Msg[ui32Chords / 2], pui32Msg[ui32Chords - 1], ui32Notes - ui32MsgRx / ui32Chords, ui32Notes);
+	printf("  in batches of %u: host cycles a chord median %u, max %u; %u packets a chord collected to make "
+			"room, nothing dropped%s\n", USBMIDI_BATCH_SIZE, pui32Batch[ui32Chords / 2], pui32Batch[ui32Chords - 1],
+			ui32Waits / ui32Chords, ok ? "" : " (NOT SO)");
+	printf("  batches %.2fx the speed\n", pui32Batch[ui32Chords / 2] ?
+			(double) pui32Msg[ui32Chords / 2] / pui32Batch[ui32Chords / 2] : 0.0);
+
+	free(pui32Msg);
+	free(pui32Batch);
+	return ok ? 0 : 1;
+}
+
+/*
+ * The stack's clock while a stream plays: the stream's time on the virtual
+ * counter, plus the host cycles since the current tick went in. Timestamps
+ * stay within a few microseconds of the stream's, and the stack's own timing
+ * of the follower counts real cycles.
+ */
+static uint32_t g_ui32ClockVirtual;
+static uint32_t g_ui32ClockHost;
+
+static uint32_t ClockTicking(void)
+{
+	return g_ui32ClockVirtual + (UsbSim_HostCycles() - g_ui32ClockHost);
+}
+
+/*
+ * The device's counters through its vendor request, as a host reads them.
+ */
+static bool VendorStats(tUSBMidiVendorStats *vs)
+{
+	tUSBRequest req;
+	uint32_t size;
+
+	req.bmRequestType = USB_RTYPE_DIR_IN | USB_RTYPE_VENDOR | USB_RTYPE_DEVICE;
+	req.bRequest = USBMIDI_VENDOR_GET_STATS;
+	req.wValue = 0;
+	req.wIndex = 0;
+	req.wLength = sizeof(*vs);
+	return UsbSim_Request(&req, (uint8_t *) vs, &size) && (size == sizeof(*vs));
+}
+
+/*
+ * Replay one stream into the OUT endpoint, a Timing Clock a packet, and watch
+ * the follower. The cost of each tick is the follower's, as the endpoint
+ * handler times it, read back with GET_STATS (ui32ClockInCycles) the way a
+ * host reads it from the board.
+ */
+static bool ClockReplay(const ClockStream_t *cs)
+{
+	static const uint8_t pui8Tick[4] = { USB_MIDI_CIN_SINGLEBYTE, MIDI_MSG_TIMINGCLOCK, 0, 0 };
+	USBMIDIClockInState_t st;
+	USBMIDIClockInStats_t stats;
+	USBMIDI_Message_t msg;
+	tUSBMidiVendorStats vs;
+	uint32_t *pui32Cycles;
+	uint32_t ui32UsCycles = SysCtlClockGet() / 1000000;
+	uint32_t ui32LockTick = 0;
+	uint32_t ui32Losses = 0;
+	uint32_t ui32Locked = 0;
+	uint32_t ui32CyclesMax = 0;
+	uint32_t i;
+	double err;
+	double errSum = 0.0;
+	double errMax = 0.0;
+	bool locked = false;
+	bool ok;
+
+	pui32Cycles = malloc(cs->ui32Ticks * sizeof(uint32_t));
+	if( !pui32Cycles )
+	{
+		perror("stackbench");
+		return false;
+	}
+
+	DeviceInit(false);
+	UsbSim_ClockSet(ClockTicking);
+	for( i = 0; i < cs->ui32Ticks; i++ )
+	{
+		g_ui32ClockVirtual = (uint32_t) ((cs->pui64Us[i] - cs->pui64Us[0]) * ui32UsCycles);
+		g_ui32ClockHost = UsbSim_HostCycles();
+		UsbSim_Out(pui8Tick, sizeof(pui8Tick));
+		while( USBMIDI_OutEpFIFO_Pop(&msg) )
+		{
+		}
+		pui32Cycles[i] = VendorStats(&vs) ? vs.ui32ClockInCycles : 0;
+		ui32CyclesMax = vs.ui32ClockInCyclesMax;
+
+		USBMIDI_ClockInGet(&st);
+		if( st.locked && !locked && !ui32LockTick )
+			ui32LockTick = i + 1;
+		else if( !st.locked && locked )
+			ui32Losses++;
+		locked = st.locked;
+		if( !locked )
+			continue;
+
+		err = 100.0 * ((double) st.tempo - cs->pui32Tempo[i]) / cs->pui32Tempo[i];
+		if( err < 0.0 )
+			err = -err;
+		errSum += err;
+		if( err > errMax )
+			errMax = err;
+		ui32Locked++;
+	}
+	USBMIDI_ClockInStatsGet(&stats);
+	UsbSim_ClockSet(0);
+	qsort(pui32Cycles, cs->ui32Ticks, sizeof(uint32_t), CompareCycles);
+
+	ok = ui32LockTick && !stats.restarts && (errSum / ui32Locked <= CLOCK_TOLERANCE);
+	printf("%s: %u ticks, %.3f BPM\n", cs->pcName, cs->ui32Ticks, cs->pui32Tempo[0] / 1000.0);
+	if( ui32LockTick )
+		printf("  locked at tick %u, lost lock %u times, %u restarts\n", ui32LockTick, ui32Losses, stats.restarts);
+	else
+		printf("  never locked, %u restarts\n", stats.restarts);
+	if( ui32Locked )
+	{
+		printf("  tempo while locked: mean error %.4f%%, worst %.4f%%\n", errSum / ui32Locked, errMax);
+		printf("  tick against prediction while locked: worst %u us\n", stats.errMax / ui32UsCycles);
+	}
+	printf("  follower per tick, host cycles: median %u, max %u\n", pui32Cycles[cs->ui32Ticks / 2], ui32CyclesMax);
+	printf("  %s\n", ok ? "ok" : "FAILED");
+
+	free(pui32Cycles);
+	return ok;
+}
+
+/*
+ * The clock follower against jittery Timing Clock streams: recorded ones given
+ * as files, one made with -b, or else a built-in set. Each must lock, never
+ * restart, and keep its tempo within CLOCK_TOLERANCE on average while locked.
+ */
+static int BenchClock(int argc, char **argv)
+{
+	static const struct
+	{
+		const char *pcName;
+		uint32_t ui32Bpm;
+		uint32_t ui32Bpm2;
+		uint32_t ui32JitterUs;
+	}
+	psSet[] =
+	{
+		{ "120 BPM, +/-100 us", 120, 120, 100 },
+		{ "120 BPM, +/-1 ms (a busy host)", 120, 120, 1000 },
+		{ "120 to 126 BPM halfway, +/-100 us", 120, 126, 100 },
+		{ "40 BPM, +/-100 us", 40, 40, 100 },
+		{ "240 BPM, +/-100 us", 240, 240, 100 },
+	};
+	ClockStream_t cs;
+	const char *pcWrite = 0;
+	uint32_t ui32Bpm = 0;
+	uint32_t ui32JitterUs = 100;
+	uint32_t ui32Ticks = 2400;
+	uint32_t i;
+	bool ok = true;
+	int opt;
+
+	while( (opt = getopt(argc, argv, "b:j:n:r:w:")) != -1 )
+	{
+		switch( opt )
+		{
+			case 'b':
+				ui32Bpm = strtoul(optarg, 0, 0);
+				break;
+			case 'j':
+				ui32JitterUs = strtoul(optarg, 0, 0);
+				break;
+			case 'n':
+				ui32Ticks = strtoul(optarg, 0, 0);
+				break;
+			case 'r':
+				g_ui32Seed = strtoul(optarg, 0, 0);
+				break;
+			case 'w':
+				pcWrite = optarg;
+				break;
+			default:
+				Usage();
+		}
+	}
+	if( (ui32Ticks < 3) || !g_ui32Seed || (pcWrite && !ui32Bpm) ||
+			(ui32Bpm && ((ui32Bpm < USBMIDI_CLOCKIN_TEMPO_MIN / 1000) || (ui32Bpm > USBMIDI_CLOCKIN_TEMPO_MAX / 1000))) )
+		Usage();
+
+	if( optind < argc )
+	{
+		for( i = optind; i < (uint32_t) argc; i++ )
+		{
+			ok = StreamRead(&cs, argv[i]) && ClockReplay(&cs) && ok;
+			StreamFree(&cs);
+		}
+	}
+	else if( ui32Bpm )
+	{
+		ok = StreamMake(&cs, "-b", ui32Bpm, ui32Bpm, ui32JitterUs, ui32Ticks) &&
+				(!pcWrite || StreamWrite(&cs, pcWrite)) && ClockReplay(&cs);
+		StreamFree(&cs);
+	}
+	else
+	{
+		for( i = 0; i < sizeof(psSet) / sizeof(psSet[0]); i++ )
+		{
+			ok = StreamMake(&cs, psSet[i].pcName, psSet[i].ui32Bpm, psSet[i].ui32Bpm2,
+					psSet[i].ui32JitterUs, ui32Ticks) && ClockReplay(&cs) && ok;
+			StreamFree(&cs);
+		}
+	}
+	return ok ? 0 : 1;
+}
+
+/*
+ * The host's view of the zone: the note sounding on each channel, and what
+ * came in. A Note On on a channel already sounding a note is a clash.
+ */
+typedef struct
+{
+	uint8_t pui8Note[16];
+	uint32_t ui32Notes;
+	uint32_t ui32Expression;
+	uint32_t ui32Clashes;
+} MpeHost_t;
+
+static void MpeCollect(MpeHost_t *h)
+{
+	uint8_t buf[USBMIDI_MAX_PACKET_SIZE];
+	USBMIDI_Message_t msg[USBMIDI_MAX_PACKET_SIZE / 4];
+	uint32_t n;
+	uint32_t i;
+	uint8_t chan;
+
+	while( UsbSim_InPending() )
+	{
+		n = InMessages(buf, UsbSim_In(buf), false, msg);
+		for( i = 0; i < n; i++ )
+		{
+			chan = msg[i].byte1 & 0x0F;
+			switch( msg[i].byte1 & 0xF0 )
+			{
+				case MIDI_MSG_NOTEON:
+					if( h->pui8Note[chan] != USBMIDI_MPE_NONE )
+						h->ui32Clashes++;
+					h->pui8Note[chan] = msg[i].byte2;
+					h->ui32Notes++;
+					break;
+				case MIDI_MSG_NOTEOFF:
+					if( h->pui8Note[chan] == msg[i].byte2 )
+						h->pui8Note[chan] = USBMIDI_MPE_NONE;
+					break;
+				case MIDI_MSG_PITCHBEND:
+				case MIDI_MSG_CHANNELPRESSURE:
+				case MIDI_MSG_CTRLCHANGE:
+					h->ui32Expression++;
+					break;
+			}
+		}
+	}
+}
+
+/*
+ * Write a batch, letting the host collect until the IN FIFO has taken all of
+ * it.
+ */
+static void MpeWrite(USBMIDIBatch_t *b, MpeHost_t *h)
+{
+	for( ;; )
+	{
+		USBMIDI_InEpBatchWrite(b);
+		MpeCollect(h);
+		if( !b->count )
+			break;
+	}
+	USBMIDIBatch_Init(b);
+}
+
+/*
+ * Gestures on a keyboard with per-note expression: a hand goes down, every
+ * finger moves its bend, pressure and timbre a few times between flushes, as
+ * a sensor scan faster than the flush would, and the hand lifts. More fingers
+ * than members makes the zone steal. Only the zone's calls are timed; the
+ * batch writes and the host are not.
+ */
+static int BenchMpe(int argc, char **argv)
+{
+	USBMIDIMpeZone_t zone;
+	USBMIDIMpeStats_t stats;
+	USBMIDIBatch_t batch;
+	MpeHost_t host;
+	uint32_t *pui32On;
+	uint32_t *pui32Off;
+	uint32_t *pui32Set;
+	uint32_t *pui32Flush;
+	uint8_t pui8Finger[48];
+	uint32_t ui32Members = 15;
+	uint32_t ui32Fingers = 10;
+	uint32_t ui32Updates = 8;
+	uint32_t ui32Gestures = 1000;
+	uint32_t ui32Sets;
+	uint32_t c;
+	uint32_t g;
+	uint32_t u;
+	uint32_t f;
+	bool ok;
+	int opt;
+
+	while( (opt = getopt(argc, argv, "m:f:u:g:r:")) != -1 )
+	{
+		switch( opt )
+		{
+			case 'm':
+				ui32Members = strtoul(optarg, 0, 0);
+				break;
+			case 'f':
+				ui32Fingers = strtoul(optarg, 0, 0);
+				break;
+			case 'u':
+				ui32Updates = strtoul(optarg, 0, 0);
+				break;
+			case 'g':
+				ui32Gestures = strtoul(optarg, 0, 0);
+				break;
+			case 'r':
+				g_ui32Seed = strtoul(optarg, 0, 0) | 1;
+				break;
+			default:
+				Usage();
+		}
+	}
+	if( (ui32Members < 1) || (ui32Members > USBMIDI_MPE_MAX_MEMBERS) || (ui32Fingers < 1) ||
+			(ui32Fingers > 48) || (ui32Updates < 1) || (ui32Gestures < 1) )
+		Usage();
+
+	ui32Sets = ui32Gestures * ui32Fingers;
+	pui32On = malloc(ui32Sets * sizeof(uint32_t));
+	pui32Off = malloc(ui32Sets * sizeof(uint32_t));
+	pui32Set = malloc(ui32Sets * sizeof(uint32_t));
+	pui32Flush = malloc(ui32Gestures * sizeof(uint32_t));
+	if( !pui32On || !pui32Off || !pui32Set || !pui32Flush )
+	{
+		perror("stackbench");
+		return 2;
+	}
+
+	DeviceInit(false);
+	memset(&host, 0, sizeof(host));
+	memset(host.pui8Note, USBMIDI_MPE_NONE, sizeof(host.pui8Note));
+	USBMIDIMpe_Init(&zone, 0, USBMIDI_MPE_LOWER, ui32Members);
+	USBMIDIBatch_Init(&batch);
+	USBMIDIMpe_Configure(&zone, &batch);
+	MpeWrite(&batch, &host);
+	host.ui32Expression = 0;
+
+	for( g = 0; g < ui32Gestures; g++ )
+	{
+		// a hand of distinct keys, from C2 up four octaves
+		for( f = 0; f < ui32Fingers; f++ )
+		{
+			pui8Finger[f] = 36 + (f * 48 / ui32Fingers) + (Rand() % (48 / ui32Fingers));
+			c = UsbSim_HostCycles();
+			USBMIDIMpe_NoteOn(&zone, &batch, pui8Finger[f], 1 + (Rand() % 127));
+			pui32On[(g * ui32Fingers) + f] = UsbSim_HostCycles() - c;
+			MpeWrite(&batch, &host);
+		}
+
+		// every finger moves, a few scans to a flush; time a finger's scans
+		for( f = 0; f < ui32Fingers; f++ )
+		{
+			c = UsbSim_HostCycles();
+			for( u = 0; u < ui32Updates; u++ )
+			{
+				USBMIDIMpe_Bend(&zone, pui8Finger[f], Rand() & 0x3FFF);
+				USBMIDIMpe_Pressure(&zone, pui8Finger[f], Rand() & 0x7F);
+				USBMIDIMpe_Timbre(&zone, pui8Finger[f], Rand() & 0x7F);
+			}
+			pui32Set[(g * ui32Fingers) + f] = UsbSim_HostCycles() - c;
+		}
+
+		pui32Flush[g] = 0;
+		for( ;; )
+		{
+			c = UsbSim_HostCycles();
+			ok = USBMIDIMpe_Flush(&zone, &batch);
+			pui32Flush[g] += UsbSim_HostCycles() - c;
+			MpeWrite(&batch, &host);
+			if( ok )
+				break;
+		}
+
+		for( f = 0; f < ui32Fingers; f++ )
+		{
+			c = UsbSim_HostCycles();
+			USBMIDIMpe_NoteOff(&zone, &batch, pui8Finger[f], 64);
+			pui32Off[(g * ui32Fingers) + f] = UsbSim_HostCycles() - c;
+			MpeWrite(&batch, &host);
+		}
+	}
+	USBMIDIMpe_GetStats(&zone, &stats);
+	for( f = 0; f < 16; f++ )
+	{
+		if( host.pui8Note[f] != USBMIDI_MPE_NONE )
+			host.ui32Clashes++;
+	}
+
+	qsort(pui32On, ui32Sets, sizeof(uint32_t), CompareCycles);
+	qsort(pui32Off, ui32Sets, sizeof(uint32_t), CompareCycles);
+	qsort(pui32Set, ui32Sets, sizeof(uint32_t), CompareCycles);
+	qsort(pui32Flush, ui32Gestures, sizeof(uint32_t), CompareCycles);
+
+	ok = (host.ui32Clashes == 0) && (host.ui32Notes == stats.notes) && (host.ui32Expression == stats.sent) &&
+			(USBMIDIMpe_Count(&zone) == 0);
+	printf("%u gestures of %u fingers on %u member channels, %u expression updates a finger a flush\n",
+			ui32Gestures, ui32Fingers, ui32Members, ui32Updates * 3);
+	printf("  host cycles median/max: note on %u/%u, note off %u/%u, a finger's updates %u/%u, flush %u/%u\n",
+			pui32On[ui32Sets / 2], pui32On[ui32Sets - 1], pui32Off[ui32Sets / 2], pui32Off[ui32Sets - 1],
+			pui32Set[ui32Sets / 2], pui32Set[ui32Sets - 1], pui32Flush[ui32Gestures / 2],
+			pui32Flush[ui32Gestures - 1]);
+	printf("  %u expression values set, %u messages sent, new notes' resets included (%.1f%%); %u notes, "
+			"%u stolen\n", stats.updates, stats.sent, stats.updates ? 100.0 * stats.sent / stats.updates : 0.0,
+			stats.notes, stats.steals);
+	printf("  host saw %u Note Ons and %u expression messages, %u channel clashes%s\n", host.ui32Notes,
+			host.ui32Expression, host.ui32Clashes, ok ? "" : " (NOT SO)");
+
+	free(pui32On);
+	free(pui32Off);
+	free(pui32Set);
+	free(pui32Flush);
+	return ok ? 0 : 1;
+}
+
+int main(int argc, char **argv)
+{
+	if( argc < 2 )
+		Usage();
+	if( strcmp(argv[1], "sysex") == 0 )
+		return BenchSysEx(argc - 1, argv + 1);
+	if( strcmp(argv[1], "chord") == 0 )
+		return BenchChord(argc - 1, argv + 1);
+	if( strcmp(argv[1], "clock") == 0 )
+		return BenchClock(argc - 1, argv + 1);
+	if( strcmp(argv[1], "mpe") == 0 )
+		return BenchMpe(argc - 1, argv + 1);
+	Usage();
+	return 2;
+}
@@ -27,12 +27,26 @@ int main(void) {
     MAP_SysCtlClockSet(SYSCTL_SYSDIV_2_5 | SYSCTL_USE_PLL | SYSCTL_XTAL_16MHZ | SYSCTL_OSC_MAIN);
 
     Initialize();
+    InputScanInit();
+    MIDI_Keys_Init();
+    EncodersInit();
+    FadersInit();
 
     // initialize USB
     USBStackModeSet(0, eUSBModeForceDevice, 0);
 
     // initialize USB MIDI Device
     USBMIDI_Init(0);
+    USBMIDI_SysExCallbackSet(sysExReceived);
+    USBMIDI_ReplayModeSet(true, REPLAY_MAX_AGE_MS);
+    FwUpdate_Init();
+
+    // master clock at the default tempo; the right button starts and stops
+    MidiClockInit();
+    MidiClockEnable(true);
+
+    // MIDI time code, 25 fps, stopped
+    MtcGenInit();
 
     // initialize master interrput
     MAP_IntMasterEnable();
@@ -47,33 +61,57 @@ int main(void) {
         connected = USBMIDI_IsConnected();
 
     	if(connected) {
-    		if(prev_state == false) { prev_state = true; }
+    		if(prev_state == false) {
+			prev_state = true;
+			MIDI_Keys_Connected();
+		}
     	} else {
     		if(prev_state == true) { prev_state = false; }
+    		// local input still goes to the replay buffer, for the host to get
+    		// when it configures us again
+    		MIDI_Input_Task();
+    		EncodersTask();
+    		FadersTask();
+    		// deliver the Note Offs for whatever the host left on
+    		MIDI_USB_Rx_Task();
+    		// sleep until the scan timer, the ADC, SysTick or USB.
+    		MAP_SysCtlSleep();
     		continue;
     	}
 
+    	// bus suspended: low power until resume, local input wakes the host
+    	if(USBMIDI_IsSuspended()) {
+    		MIDI_USB_Suspend_Task();
+    		continue;
+    	}
+
+    	// keys and buttons, scanned by the timer
+    	MIDI_Input_Task();
+
+    	// rotary encoders to relative CC / NRPN
+    	EncodersTask();
+
+    	// faders and pots, sampled by the ADC
+    	FadersTask();
+
     	// will receive MIDI notes and print them on serial
     	MIDI_USB_Rx_Task();
 
+    	// program pages of an incoming firmware image
+    	FwUpdate_Task();
+
     	// will receive MIDI notes and echo them back
     	// MIDI_USB_Loop_Task();
 
-        // note on
-        noteOn(0, 0x40, 0x44);
-        MAP_SysCtlDelay(8000000);
-
-        // note off
-        noteOff(0, 0x40, 0x44);
-        MAP_SysCtlDelay(8000000);
+        // note on, note off
+        MIDI_Demo_Task();
 
         /*
-        // control change
-        controlChange(0x1, 0x0, 128);
-        MAP_SysCtlDelay(8000000);
-
-        // pitch bend
-        pitchBend(0x1, 64);
+        // control change and pitch bend
+        USBMIDIBatch_Init(&batch);
+        USBMIDIBatch_ControlChange(&batch, DEMO_CABLE, 0x1, 0x0, 127);
+        USBMIDIBatch_PitchBend(&batch, DEMO_CABLE, 0x1, 8192);
+        USBMIDI_InEpBatchWrite(&batch);
         MAP_SysCtlDelay(8000000);
         */
 
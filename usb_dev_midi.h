@@ -28,19 +28,53 @@
 
 #include "midi.h"
 #include "usbmidi.h"
+#include "usbmidi_critical.h"
+#include "usbmidi_mpe.h"
+#include "fwupdate/fwupdate.h"
+#include "buttons.h"
+#include "keymatrix.h"
+#include "inputscan.h"
+#include "encoders.h"
+#include "faders.h"
+#include "midiclock.h"
+#include "mtcgen.h"
 
 #define SYSTICKS_PER_SECOND 100
 #define SYSTICK_PERIOD_MS   (1000 / SYSTICKS_PER_SECOND)
 
-uint32_t g_ui32SysTickCount;
+// notes held longer than this across a USB reconnect are not replayed
+#define REPLAY_MAX_AGE_MS   500
+
+// cable for the demo notes and the left button
+#define DEMO_CABLE          1
+
+// play the keys as an MPE lower zone, each held key on a member channel of
+// its own, with this many members (1-15); 0 sends them all on KEYMATRIX_CHANNEL
+#define KEYS_MPE_MEMBERS    0
+
+// Interrupt priorities, highest first (three bits, steps of 0x20):
+//   0x20  Timer 0A  key and button scan; never calls into the USB stack
+//   0x40  USB0, Timer 2A (MIDI clock), Timer 3A (MTC), SysTick (remote wakeup):
+//         the USB stack's own level, USBMIDI_INT_PRIORITY. They never preempt
+//         each other, and the main loop masks them with BASEPRI only.
+//   0x60  ADC0 SS0  faders, a whole block of scans to answer in
+//   0xE0  UART0     console; waits for everything
+// Each driver sets its own in its Init(); SysTick and UART0 are set here.
+#define UART_INT_PRIORITY   0xE0
+
+volatile uint32_t g_ui32SysTickCount;
 uint32_t g_ui32SysClock;
 
-USBMIDI_Message_t txmsg;
 USBMIDI_Message_t rxmsg;
 
+#if KEYS_MPE_MEMBERS
+USBMIDIMpeZone_t keysZone;
+#endif
+
 
 void SysTickIntHandler(void) {
     g_ui32SysTickCount++;
+    USBMIDI_Tick(SYSTICK_PERIOD_MS);
 }
 
 void Initialize(void) {
@@ -70,7 +104,14 @@ void Initialize(void) {
     // Get SysClock
     g_ui32SysClock = MAP_SysCtlClockGet();
 
-    // Enable system tick
+    // Keep only USB and the buttons clocked while the CPU sleeps
+    MAP_SysCtlPeripheralSleepEnable(SYSCTL_PERIPH_USB0);
+    MAP_SysCtlPeripheralSleepEnable(SYSCTL_PERIPH_GPIOF);
+    MAP_SysCtlPeripheralSleepEnable(SYSCTL_PERIPH_GPIOD);
+    MAP_SysCtlPeripheralClockGating(true);
+
+    // Enable system tick, at the USB interrupt's priority for USBMIDI_Tick()
+    MAP_IntPrioritySet(FAULT_SYSTICK, USBMIDI_INT_PRIORITY);
     MAP_SysTickPeriodSet(g_ui32SysClock / SYSTICKS_PER_SECOND);
     MAP_SysTickIntEnable();
     MAP_SysTickEnable();
@@ -84,45 +125,143 @@ void ConfigureUART0(void) {
     MAP_GPIOPinConfigure(GPIO_PA1_U0TX);
     MAP_GPIOPinTypeUART(GPIO_PORTA_BASE, GPIO_PIN_0 | GPIO_PIN_1);
     UARTClockSourceSet(UART0_BASE, UART_CLOCK_PIOSC);
+    MAP_IntPrioritySet(INT_UART0, UART_INT_PRIORITY);
     UARTStdioConfig(0, 115200, 16000000);
 }
 
-void noteOn(short channel, uint8_t note, uint8_t velocity) {
-    txmsg.header = USB_MIDI_HEADER(1, USB_MIDI_CIN_NOTEON);
-    txmsg.byte1 = MIDI_MSG_NOTEON | channel;
-    txmsg.byte2 = note;
-    txmsg.byte3 = velocity;
-    USBMIDI_InEpMsgWrite(&txmsg);
+void sysExReceived(const USBMIDISysExMsg_t *msg) {
+    const USBMIDISysExBlock_t *blk;
+    uint32_t sum = 0;
+    uint16_t i;
+
+    // firmware update messages are taken care of here
+    if(FwUpdate_SysEx(msg)) {
+        return;
+    }
+
+    // and the loopback latency mode's commands
+    if(USBMIDI_LoopbackSysEx(msg)) {
+        return;
+    }
+
+    // and the statistics query
+    if(USBMIDI_StatsSysEx(msg)) {
+        return;
+    }
+
+    // walk the chain in place, no copy needed
+    for(blk = msg->first; blk; blk = blk->next) {
+        for(i = 0; i < blk->len; i++) {
+            sum += blk->data[i];
+        }
+    }
+    UARTprintf("sysex cable %d : %d bytes : sum %08x\n", msg->cable, msg->length, sum);
 }
 
-void noteOff(short channel, uint8_t note, uint8_t velocity) {
-    txmsg.header = USB_MIDI_HEADER(1, USB_MIDI_CIN_NOTEOFF);
-    txmsg.byte1 = MIDI_MSG_NOTEOFF | channel;
-    txmsg.byte2 = note;
-    txmsg.byte3 = velocity;
-    USBMIDI_InEpMsgWrite(&txmsg);
+void MIDI_Keys_Init(void) {
+#if KEYS_MPE_MEMBERS
+    USBMIDIMpe_Init(&keysZone, KEYMATRIX_CABLE, USBMIDI_MPE_LOWER, KEYS_MPE_MEMBERS);
+#endif
 }
 
-void controlChange(short channel, uint8_t key, uint8_t value) {
-    txmsg.header = USB_MIDI_HEADER(1, USB_MIDI_CIN_CTRLCHANGE);
-    txmsg.byte1 = MIDI_MSG_CTRLCHANGE | channel;
-    txmsg.byte2 = key;
-    txmsg.byte3 = value;
-    USBMIDI_InEpMsgWrite(&txmsg);
+void MIDI_Keys_Connected(void) {
+#if KEYS_MPE_MEMBERS
+    USBMIDIBatch_t batch;
+
+    // the host learns the zone from its configuration message, on every connect
+    USBMIDIBatch_Init(&batch);
+    USBMIDIMpe_Configure(&keysZone, &batch);
+    USBMIDI_InEpBatchWrite(&batch);
+#endif
 }
 
-void pitchBend(short channel, uint16_t pitch) {
-    txmsg.header = USB_MIDI_HEADER(1, USB_MIDI_CIN_PITCHBEND);
-    txmsg.byte1 = MIDI_MSG_PITCHBEND | channel;
-    txmsg.byte2 = pitch & 0x7F; // lsb
-    txmsg.byte3 = (pitch >> 7) & 0x7F; // msb
-    USBMIDI_InEpMsgWrite(&txmsg);
+void MIDI_Keys_Note(uint32_t key, bool on, uint8_t velocity) {
+#if KEYS_MPE_MEMBERS
+    USBMIDIBatch_t batch;
+    uint8_t note = KEYMATRIX_FIRST_NOTE + key;
+
+    // an empty batch always has room for a note on, steal included
+    USBMIDIBatch_Init(&batch);
+    if(on) {
+        USBMIDIMpe_NoteOn(&keysZone, &batch, note, velocity);
+    } else {
+        USBMIDIMpe_NoteOff(&keysZone, &batch, note, velocity);
+    }
+    USBMIDI_InEpBatchWrite(&batch);
+#else
+    KeyMatrixNoteWrite(key, on, velocity);
+#endif
 }
 
 void MIDI_USB_Rx_Task(void) {
     while(USBMIDI_OutEpFIFO_Pop(&rxmsg)) {
         UARTprintf("%02x : %02x : %02x : %02x\n", rxmsg.header, rxmsg.byte1, rxmsg.byte2, rxmsg.byte3);
     }
+    USBMIDI_SysExTask();
+}
+
+void MIDI_Input_Task(void) {
+    static const USBMIDIMtcTime_t mtcZero = { 0, 0, 0, 0, USBMIDI_MTC_25 };
+    USBMIDIBatch_t batch;
+    tInputEvent event;
+
+    // debounced edges from the scan timer; time each one through to the host
+    while(InputScanEventGet(&event)) {
+        if(event.ui8Source == INPUTSCAN_SOURCE_KEY) {
+            MIDI_Keys_Note(event.ui8Id, event.bPressed, event.ui8Velocity);
+        } else if(event.ui8Id == LEFT_BUTTON) {
+            USBMIDIBatch_Init(&batch);
+            if(event.bPressed) {
+                USBMIDIBatch_NoteOn(&batch, DEMO_CABLE, 0, 0x40, 0x44);
+            } else {
+                USBMIDIBatch_NoteOff(&batch, DEMO_CABLE, 0, 0x40, 0x44);
+            }
+            USBMIDI_InEpBatchWrite(&batch);
+        } else {
+            // right button: transport; Start/Stop go out with the next clock,
+            // and time code runs from zero alongside
+            if(event.ui8Id == RIGHT_BUTTON && event.bPressed) {
+                if(MidiClockIsPlaying()) {
+                    MidiClockStop();
+                    MtcGenStop();
+                } else {
+                    MidiClockStart();
+                    MtcGenLocate(&mtcZero);
+                    MtcGenStart();
+                }
+            }
+            continue;
+        }
+        USBMIDI_LatencyProbe(event.ui32Time);
+    }
+}
+
+void MIDI_USB_Suspend_Task(void) {
+    // sleep until the scan timer, SysTick or USB, then look at the local input.
+    // a press is queued and wakes the host; it goes out on resume.
+    MAP_SysCtlSleep();
+    MIDI_Input_Task();
+    EncodersTask();
+}
+
+void MIDI_Demo_Task(void) {
+    static uint32_t next = 0;
+    static bool on = false;
+    USBMIDIBatch_t batch;
+
+    // toggle a note every 300 ms without blocking the loop
+    if((int32_t)(g_ui32SysTickCount - next) < 0) {
+        return;
+    }
+    next = g_ui32SysTickCount + 30;
+    on = !on;
+    USBMIDIBatch_Init(&batch);
+    if(on) {
+        USBMIDIBatch_NoteOn(&batch, DEMO_CABLE, 0, 0x40, 0x44);
+    } else {
+        USBMIDIBatch_NoteOff(&batch, DEMO_CABLE, 0, 0x40, 0x44);
+    }
+    USBMIDI_InEpBatchWrite(&batch);
 }
 
 void MIDI_USB_Loop_Task(void) {
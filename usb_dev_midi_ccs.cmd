@@ -1,16 +1,26 @@
 --retain=g_pfnVectors
+--retain=g_pfnBootVectors
 
-#define APP_BASE 0x00000000
+/*
+ * The boot stub (fwboot.c) owns the first 2 KB. The application is slot A.
+ * Slot B (0x20000) and the update record (0x3F800) are left to fwupdate.c,
+ * so FLASH only covers slot A.
+ */
+#define BOOT_BASE 0x00000000
+#define APP_BASE 0x00000800
 #define RAM_BASE 0x20000000
 
 MEMORY
 {
-    FLASH (RX) : origin = APP_BASE, length = 0x00040000
+    BOOT  (RX) : origin = BOOT_BASE, length = 0x00000800
+    FLASH (RX) : origin = APP_BASE, length = 0x0001F800
     SRAM (RWX) : origin = 0x20000000, length = 0x00008000
 }
 
 SECTIONS
 {
+    .bootvecs:  > BOOT_BASE
+    .boot   :   > BOOT
     .intvecs:   > APP_BASE
     .text   :   > FLASH
     .const  :   > FLASH